@@ -0,0 +1,136 @@
+#pragma once
+
+#include <kesclient/response.hxx>
+#include <kesrv/util/continuousbuffer.hxx>
+#include <kesrv/util/jsonframer.hxx>
+#include <kesrv/util/readbuffer.hxx>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+struct ConnectionOptions
+{
+    size_t readSize = 65536;
+    size_t responseLimit = 64 * 1024 * 1024;
+
+    // after a failed connect the next attempt waits this long, doubling up to maxReconnectDelay
+    std::chrono::milliseconds reconnectDelay = std::chrono::milliseconds(100);
+    std::chrono::milliseconds maxReconnectDelay = std::chrono::seconds(5);
+};
+
+
+//
+// a pipelined connection to the server; requests get their request.id from the connection
+// and responses are matched by it, so any number of requests may be in flight
+//
+// the socket is opened on the first request and reopened on the next one after it fails;
+// requests that were in flight when the connection dropped complete with the error,
+// requests issued while disconnected wait for the reconnect
+//
+// send() and command() may be called from any thread; callbacks run on the io_context
+// and get a view into the receive buffer that is only valid during the call
+//
+
+class KESCLIENT_EXPORT Connection final
+    : public boost::noncopyable
+{
+public:
+    using Callback = std::function<void(const boost::system::error_code& ec, const ResponseView& response)>;
+
+    ~Connection();
+    // 'address' is host:port, unix:/path or unix:@abstract-name
+    explicit Connection(boost::asio::io_context& io, const std::string& address, const ConnectionOptions& options = ConnectionOptions());
+
+    // 'json' is a request object without request.id
+    Kes::Request::Id send(std::string json, Callback callback);
+    std::future<Response> send(std::string json);
+
+    // a request with the command name only
+    Kes::Request::Id command(const char* name, Callback callback);
+    std::future<Response> command(const char* name);
+
+    // closes the socket; outstanding requests complete with operation_aborted
+    void stop() noexcept;
+
+    bool connected() const noexcept
+    {
+        return m_connected.load(std::memory_order_relaxed);
+    }
+
+private:
+    enum class State
+    {
+        Disconnected,
+        Connecting,
+        Connected
+    };
+
+    struct Outgoing
+    {
+        Kes::Request::Id id;
+        std::string data;
+        Callback callback;
+    };
+
+    struct Pending
+    {
+        Kes::Request::Id id;
+        Callback callback;
+    };
+
+    static std::string withId(std::string json, Kes::Request::Id id);
+    static std::future<Response> futureFor(Callback& callback);
+
+    void enqueue(Outgoing&& request);
+    void kick() noexcept;
+    void connect() noexcept;
+    void onConnect(const boost::system::error_code& ec) noexcept;
+    void disconnect(const boost::system::error_code& ec) noexcept;
+    void flush() noexcept;
+    void read(Kes::Util::ReadBuffer::Ptr buffer) noexcept;
+    void process(const char* data, size_t size) noexcept;
+    bool dispatch(const char* data, size_t size) noexcept;
+    void fail(std::deque<Pending>& requests, const boost::system::error_code& ec) noexcept;
+    static void complete(Callback& callback, const boost::system::error_code& ec, const ResponseView& response) noexcept;
+
+    boost::asio::io_context& m_io;
+    boost::asio::io_context::strand m_strand;
+    ConnectionOptions m_options;
+    std::vector<boost::asio::generic::stream_protocol::endpoint> m_endpoints;
+    std::atomic<Kes::Request::Id> m_nextId = 1;
+    std::atomic<bool> m_connected = false;
+
+    // everything below is only touched on the strand
+    State m_state = State::Disconnected;
+    bool m_stopped = false;
+    uint32_t m_generation = 0;  // bumped on disconnect, stale completions are ignored
+    std::unique_ptr<boost::asio::generic::stream_protocol::socket> m_socket;
+    boost::asio::steady_timer m_reconnectTimer;
+    boost::asio::steady_timer::time_point m_nextAttempt;
+    std::chrono::milliseconds m_delay = std::chrono::milliseconds(0);
+    bool m_reconnectPending = false;
+    std::deque<Outgoing> m_queue;
+    std::deque<Pending> m_inFlight;
+    std::vector<std::string> m_writing;
+    std::vector<boost::asio::const_buffer> m_writeBuffers;
+    Kes::Util::ContinuousBuffer m_bufferIn;
+    Kes::Util::JsonFramer m_framer;
+};
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
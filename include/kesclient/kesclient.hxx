@@ -0,0 +1,14 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+    #ifdef KESCLIENT_EXPORTS
+        #define KESCLIENT_EXPORT __declspec(dllexport)
+    #else
+        #define KESCLIENT_EXPORT __declspec(dllimport)
+    #endif
+#else
+    #define KESCLIENT_EXPORT __attribute__((visibility("default")))
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <kesclient/kesclient.hxx>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+// one entry of a list_processes/diff_processes response; absent fields keep their defaults
+struct ProcessEntry
+{
+    int pid = -1;
+    int ppid = 0;
+    int pgrp = 0;
+    int tpgid = 0;
+    int session = 0;
+    int ruid = 0;
+    double cpu = -1;    // % of one CPU, negative while unknown
+    bool newcomer = false;
+    std::string comm;
+    std::string statComm;
+    std::string exe;
+    std::string cmdLine;
+    std::string error;  // set instead of the fields above if the process could not be read
+
+    void clear() noexcept
+    {
+        pid = -1;
+        ppid = 0;
+        pgrp = 0;
+        tpgid = 0;
+        session = 0;
+        ruid = 0;
+        cpu = -1;
+        newcomer = false;
+        comm.clear();
+        statComm.clear();
+        exe.clear();
+        cmdLine.clear();
+        error.clear();
+    }
+};
+
+
+struct ProcessList
+{
+    std::vector<ProcessEntry> processes;
+    std::vector<int> deleted;
+    std::string token;      // present it in the first request of a new session to resume from here
+    bool resumed = false;   // the lists are relative to the presented token, not a full list
+    std::string nextCursor; // present it with the same sort to get the next page; empty on the last one
+    double systemBusy = -1; // % of all CPUs, negative while unknown
+};
+
+
+//
+// decodes the process lists of a response with a SAX pass; the entries already in 'out'
+// are overwritten in place, so a list reused across polls keeps its string buffers;
+// throws on malformed JSON
+//
+
+KESCLIENT_EXPORT void decodeProcesses(std::string_view json, ProcessList& out);
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <kesclient/kesclient.hxx>
+#include <kesrv/request.hxx>
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+//
+// a non-owning view of one response frame; top-level fields are located by a shallow scan
+// that skips nested values without parsing them
+//
+
+class KESCLIENT_EXPORT ResponseView final
+{
+public:
+    ResponseView() noexcept = default;
+
+    ResponseView(const char* data, size_t size) noexcept
+        : m_json(data, size)
+    {
+    }
+
+    std::string_view json() const noexcept
+    {
+        return m_json;
+    }
+
+    // the raw JSON text of a top-level value (strings keep their quotes); empty if missing
+    std::string_view raw(std::string_view key) const noexcept;
+
+    // the contents of a top-level string value; escape sequences are not decoded
+    std::optional<std::string_view> string(std::string_view key) const noexcept;
+
+    std::optional<int64_t> integer(std::string_view key) const noexcept;
+
+    std::optional<Kes::Request::Id> id() const noexcept;
+    std::string_view status() const noexcept;
+    std::string_view reason() const noexcept;
+
+    bool success() const noexcept
+    {
+        return status() == Kes::Response::Success;
+    }
+
+private:
+    std::string_view m_json;
+};
+
+
+//
+// an owning copy of a response, for callers that outlive the receive buffer
+//
+
+class Response final
+{
+public:
+    Response() = default;
+
+    explicit Response(std::string json) noexcept
+        : m_json(std::move(json))
+    {
+    }
+
+    const std::string& json() const noexcept
+    {
+        return m_json;
+    }
+
+    ResponseView view() const noexcept
+    {
+        return ResponseView(m_json.data(), m_json.size());
+    }
+
+private:
+    std::string m_json;
+};
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
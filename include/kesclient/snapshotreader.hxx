@@ -0,0 +1,69 @@
+#pragma once
+
+#include <kesclient/processlist.hxx>
+
+#include <kesrv/processmanager/snapshot.hxx>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+//
+// reads the process table a server publishes in shared memory (kexplorer-server --shm);
+// a read is a copy out of the mapping: no syscalls and no server involvement, unless
+// the server has restarted and the region has to be mapped again
+//
+
+class KESCLIENT_EXPORT SnapshotReader final
+    : public boost::noncopyable
+{
+public:
+    ~SnapshotReader();
+
+    // throws if there is no such region or its layout is not supported
+    explicit SnapshotReader(const std::string& name = Kes::Snapshot::DefaultName);
+
+    // changes whenever a new snapshot is published; 0 if none is available
+    uint64_t generation() noexcept;
+
+    // copies the latest snapshot into 'out' reusing its entries, 'out.deleted' is cleared;
+    // false if no snapshot is available (yet, or any more)
+    bool read(ProcessList& out);
+
+    // describe the snapshot returned by the last successful read()
+    uint64_t lastGeneration() const noexcept
+    {
+        return m_generation;
+    }
+
+    uint64_t lastTimestamp() const noexcept
+    {
+        return m_timestamp;
+    }
+
+    bool truncated() const noexcept
+    {
+        return m_truncated;
+    }
+
+private:
+    void map();
+    void unmap() noexcept;
+    bool remap() noexcept;
+
+    std::string m_name;
+    void* m_region = nullptr;
+    uint64_t m_size = 0;
+    const Kes::Snapshot::Header* m_header = nullptr;
+    uint64_t m_generation = 0;
+    uint64_t m_timestamp = 0;
+    bool m_truncated = false;
+};
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <kesrv/condition.hxx>
+#include <kesrv/kesrv.hxx>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+namespace Kes
+{
+
+namespace Capture
+{
+
+//
+// request capture file: a header followed by session and request records (native byte order);
+// times are nanoseconds since the capture start; a request is stamped with the time its first
+// byte was read, not the time it was recorded
+//
+
+constexpr char Magic[8] = { 'K', 'E', 'S', 'C', 'A', 'P', '\x01', '\0' };
+
+enum class RecordType : char
+{
+    SessionStarted = 'S',
+    SessionFinished = 'E',
+    Request = 'R'
+};
+
+
+struct Record
+{
+    RecordType type = RecordType::Request;
+    uint32_t session = 0;
+    uint64_t time = 0;
+    std::string data;   // the request bytes
+};
+
+
+class KESRV_EXPORT Writer final
+    : public boost::noncopyable
+{
+public:
+    static constexpr std::chrono::milliseconds DefaultFlushInterval = std::chrono::milliseconds(1000);
+
+    ~Writer();
+    // the buffered records are also written out every flushInterval, so a quiet server
+    // does not sit on them
+    explicit Writer(const char* fileName, std::chrono::milliseconds flushInterval = DefaultFlushInterval);
+
+    // all of these may be called from any thread and never throw
+    void sessionStarted(uint32_t session) noexcept;
+    void sessionFinished(uint32_t session) noexcept;
+    // 'received' is the Util::Clock::ticks() the request started arriving at
+    void request(uint32_t session, uint64_t received, const char* data, size_t size) noexcept;
+
+    void flush() noexcept;
+
+private:
+    void append(RecordType type, uint32_t session, uint64_t ticks, const char* data, size_t size) noexcept;
+    void flushLocked() noexcept;
+    void flusher() noexcept;
+
+    static constexpr size_t FlushThreshold = 64 * 1024;
+
+    std::FILE* m_file;
+    uint64_t m_started;                     // Util::Clock ticks
+    std::chrono::milliseconds m_flushInterval;
+    std::mutex m_mutex;
+    std::string m_buffer;
+    Condition m_wakeup;
+    std::atomic<bool> m_stop = false;
+    std::unique_ptr<std::thread> m_flusher;
+};
+
+
+class KESRV_EXPORT Reader final
+    : public boost::noncopyable
+{
+public:
+    explicit Reader(std::istream& stream);
+
+    // false at the end of the stream; throws on corrupted input
+    bool next(Record& record);
+
+private:
+    std::istream& m_stream;
+};
+
+
+} // namespace Capture {}
+
+} // namespace Kes {}
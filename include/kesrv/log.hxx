@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kesrv/kesrv.hxx>
+#include <kesrv/logrecord.hxx>
 
 
 namespace Kes
@@ -27,6 +28,30 @@ struct ILog
     virtual bool writev(Level level, const char* format, va_list args) noexcept = 0;
     virtual bool write(Level level, const char* format, ...) noexcept = 0;
 
+    // deferred formatting: the default renders the record right away
+    virtual bool put(Level level, Record&& record) noexcept
+    {
+        try
+        {
+            std::string text;
+            render(record, text);
+            return write(level, "%s", text.c_str());
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    // typed entry point; 'format' must be a string literal
+    template <typename... Args>
+    bool print(Level level, const char* format, const Args&... args) noexcept
+    {
+        Record record;
+        record.assign(format, args...);
+        return put(level, std::move(record));
+    }
+
 protected:
     virtual ~ILog() {}
 };
@@ -39,19 +64,19 @@ protected:
 
 
 #define LogDebug(log, ...) \
-    log && (log->level() <= Kes::Log::Level::Debug) && log->write(Kes::Log::Level::Debug, __VA_ARGS__)
+    log && (log->level() <= Kes::Log::Level::Debug) && log->print(Kes::Log::Level::Debug, __VA_ARGS__)
 
 #define LogInfo(log, ...) \
-    log && (log->level() <= Kes::Log::Level::Info) && log->write(Kes::Log::Level::Info, __VA_ARGS__)
+    log && (log->level() <= Kes::Log::Level::Info) && log->print(Kes::Log::Level::Info, __VA_ARGS__)
 
 #define LogWarning(log, ...) \
-    log && (log->level() <= Kes::Log::Level::Warning) && log->write(Kes::Log::Level::Warning, __VA_ARGS__)
+    log && (log->level() <= Kes::Log::Level::Warning) && log->print(Kes::Log::Level::Warning, __VA_ARGS__)
 
 #define LogError(log, ...) \
-    log && (log->level() <= Kes::Log::Level::Error) && log->write(Kes::Log::Level::Error, __VA_ARGS__)
+    log && (log->level() <= Kes::Log::Level::Error) && log->print(Kes::Log::Level::Error, __VA_ARGS__)
 
 #define LogFatal(log, ...) \
-    log && (log->level() <= Kes::Log::Level::Fatal) && log->write(Kes::Log::Level::Fatal, __VA_ARGS__)
+    log && (log->level() <= Kes::Log::Level::Fatal) && log->print(Kes::Log::Level::Fatal, __VA_ARGS__)
 
 
 
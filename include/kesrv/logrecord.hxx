@@ -0,0 +1,284 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <istream>
+#include <vector>
+
+#include <time.h>
+
+
+namespace Kes
+{
+
+namespace Log
+{
+
+enum class Level;
+
+
+//
+// a log record with deferred formatting: the format string pointer plus typed raw arguments;
+// the format string must have static storage duration, string arguments are copied
+//
+
+class KESRV_EXPORT Record final
+{
+public:
+    static constexpr size_t MaxArgs = 12;
+    static constexpr size_t InlineSize = 256;
+
+    enum class Type : uint8_t
+    {
+        Int,
+        UInt,
+        Double,
+        String,
+        Pointer
+    };
+
+    union Value
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+        struct
+        {
+            uint32_t offset;
+            uint32_t length;
+        } s;
+    };
+
+    ~Record()
+    {
+        clear();
+    }
+
+    Record() noexcept
+    {
+    }
+
+    Record(const Record&) = delete;
+    Record& operator=(const Record&) = delete;
+
+    Record(Record&& o) noexcept
+    {
+        *this = std::move(o);
+    }
+
+    Record& operator=(Record&& o) noexcept;
+
+    template <typename... Args>
+    void assign(const char* fmt, const Args&... args) noexcept
+    {
+        static_assert(sizeof...(Args) <= MaxArgs, "Too many log arguments");
+
+        clear();
+
+        format = fmt;
+        count = 0;
+
+        // measure strings first so that they are copied once
+        size_t required = 0;
+        (measure(required, args), ...);
+        if (required > InlineSize)
+        {
+            m_heap = static_cast<char*>(::malloc(required));
+            if (!m_heap)
+                required = 0; // strings will be truncated to nothing
+        }
+
+        m_capacity = uint32_t(m_heap ? required : InlineSize);
+        (add(args), ...);
+    }
+
+    // preformatted text, used by the va_list entry point
+    void assignv(const char* fmt, va_list args) noexcept;
+
+    void clear() noexcept
+    {
+        if (m_heap)
+        {
+            ::free(m_heap);
+            m_heap = nullptr;
+        }
+
+        m_used = 0;
+        m_capacity = 0;
+        count = 0;
+        format = nullptr;
+    }
+
+    bool isText() const noexcept
+    {
+        return format == TextFormat;
+    }
+
+    const char* strings() const noexcept
+    {
+        return m_heap ? m_heap : m_inline;
+    }
+
+    uint32_t stringsSize() const noexcept
+    {
+        return m_used;
+    }
+
+    const char* string(size_t index) const noexcept
+    {
+        return strings() + values[index].s.offset;
+    }
+
+    static const char* const TextFormat;
+
+    const char* format = nullptr;
+    uint8_t count = 0;
+    Type types[MaxArgs];
+    Value values[MaxArgs];
+
+private:
+    // a char buffer, as opposed to a pointer that may be null
+    template <typename T>
+    static constexpr bool IsCharArray = std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>;
+
+    template <typename T>
+    static void measure(size_t& required, const T& v) noexcept
+    {
+        using U = std::decay_t<T>;
+        if constexpr (IsCharArray<T>)
+            required += std::strlen(v) + 1;
+        else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>)
+            required += (v ? std::strlen(v) : 6) + 1;
+        else if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>)
+            required += v.length() + 1;
+    }
+
+    template <typename T>
+    void add(const T& v) noexcept
+    {
+        using U = std::decay_t<T>;
+        auto& value = values[count];
+        auto& type = types[count];
+
+        if constexpr (IsCharArray<T>)
+        {
+            type = Type::String;
+            value.s = addString(std::string_view(v));
+        }
+        else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>)
+        {
+            type = Type::String;
+            value.s = addString(v ? std::string_view(v) : std::string_view("(null)"));
+        }
+        else if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>)
+        {
+            type = Type::String;
+            value.s = addString(std::string_view(v.data(), v.length()));
+        }
+        else if constexpr (std::is_floating_point_v<U>)
+        {
+            type = Type::Double;
+            value.d = double(v);
+        }
+        else if constexpr (std::is_enum_v<U>)
+        {
+            type = Type::Int;
+            value.i = int64_t(v);
+        }
+        else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+        {
+            type = Type::Int;
+            value.i = int64_t(v);
+        }
+        else if constexpr (std::is_integral_v<U>)
+        {
+            type = Type::UInt;
+            value.u = uint64_t(v);
+        }
+        else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>)
+        {
+            type = Type::Pointer;
+            value.p = static_cast<const void*>(v);
+        }
+        else
+        {
+            static_assert(std::is_void_v<U>, "Unsupported log argument type");
+        }
+
+        ++count;
+    }
+
+    decltype(Value::s) addString(std::string_view s) noexcept
+    {
+        decltype(Value::s) r = { m_used, 0 };
+        if (m_used < m_capacity)
+        {
+            auto length = std::min(s.length(), size_t(m_capacity - m_used - 1));
+            auto dest = (m_heap ? m_heap : m_inline) + m_used;
+            std::memcpy(dest, s.data(), length);
+            dest[length] = '\0';
+
+            r.length = uint32_t(length);
+            m_used += uint32_t(length + 1);
+        }
+
+        return r;
+    }
+
+    uint32_t m_used = 0;
+    uint32_t m_capacity = 0;
+    char* m_heap = nullptr;
+    char m_inline[InlineSize];
+};
+
+
+// printf-style rendering; argument types come from the record, not from length modifiers
+KESRV_EXPORT void render(const char* format, uint8_t count, const Record::Type* types, const Record::Value* values, const char* strings, std::string& out);
+KESRV_EXPORT void render(const Record& record, std::string& out);
+
+KESRV_EXPORT size_t formatPrefix(Level level, const struct timespec& time, char* prefix, size_t size) noexcept;
+
+
+//
+// binary log file: a header followed by format definitions and records (native byte order)
+//
+
+namespace Binary
+{
+
+constexpr char Magic[8] = { 'K', 'E', 'S', 'L', 'O', 'G', '\x01', '\0' };
+
+KESRV_EXPORT void appendHeader(std::string& out);
+KESRV_EXPORT void appendFormat(std::string& out, uint32_t id, const char* format);
+KESRV_EXPORT void appendRecord(std::string& out, Level level, const struct timespec& time, uint32_t formatId, const Record& record);
+
+
+class KESRV_EXPORT Reader final
+    : public boost::noncopyable
+{
+public:
+    struct Entry
+    {
+        Level level;
+        struct timespec time;
+        std::string text;
+    };
+
+    explicit Reader(std::istream& stream);
+
+    // false at the end of the stream; throws on corrupted input
+    bool next(Entry& entry);
+
+private:
+    std::istream& m_stream;
+    std::vector<std::string> m_formats;
+    std::string m_strings;
+};
+
+
+} // namespace Binary {}
+
+} // namespace Log {}
+
+} // namespace Kes {}
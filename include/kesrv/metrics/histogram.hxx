@@ -0,0 +1,177 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <atomic>
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace Metrics
+{
+
+class ShardHistogram;
+
+
+//
+// log-linear (HDR-style) histogram of non-negative integer values:
+// values below 2 * SubBuckets are exact, above that every power of two is split
+// into SubBuckets linear buckets, so the relative error stays below 1 / SubBuckets
+//
+
+class KESRV_EXPORT Histogram final
+{
+public:
+    static constexpr unsigned SubBucketBits = 5;
+    static constexpr uint64_t SubBuckets = uint64_t(1) << SubBucketBits;
+    static constexpr unsigned MaxMagnitude = 40; // larger values are clamped (~18 minutes in ns)
+    static constexpr uint64_t MaxValue = (uint64_t(1) << (MaxMagnitude + 1)) - 1;
+    static constexpr size_t BucketCount = 2 * SubBuckets + (MaxMagnitude - SubBucketBits) * SubBuckets;
+
+    static size_t bucketIndex(uint64_t value) noexcept
+    {
+        if (value > MaxValue)
+            value = MaxValue;
+
+        if (value < 2 * SubBuckets)
+            return size_t(value);
+
+        unsigned magnitude = 63 - __builtin_clzll(value);
+        auto sub = (value >> (magnitude - SubBucketBits)) - SubBuckets;
+        return size_t(2 * SubBuckets + (magnitude - SubBucketBits - 1) * SubBuckets + sub);
+    }
+
+    // the highest value that falls into the bucket
+    static uint64_t bucketUpperBound(size_t index) noexcept
+    {
+        if (index < 2 * SubBuckets)
+            return index;
+
+        auto magnitude = unsigned((index - 2 * SubBuckets) / SubBuckets) + SubBucketBits + 1;
+        auto sub = (index - 2 * SubBuckets) % SubBuckets;
+        auto shift = magnitude - SubBucketBits;
+        return ((SubBuckets + sub) << shift) + (uint64_t(1) << shift) - 1;
+    }
+
+    Histogram()
+        : m_buckets(BucketCount, 0)
+    {
+    }
+
+    void record(uint64_t value, uint64_t count = 1) noexcept
+    {
+        m_buckets[bucketIndex(value)] += count;
+        m_count += count;
+        m_sum += value * count;
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+
+    void merge(const Histogram& other) noexcept;
+    void reset() noexcept;
+
+    uint64_t count() const noexcept
+    {
+        return m_count;
+    }
+
+    uint64_t sum() const noexcept
+    {
+        return m_sum;
+    }
+
+    uint64_t min() const noexcept
+    {
+        return m_count ? m_min : 0;
+    }
+
+    uint64_t max() const noexcept
+    {
+        return m_max;
+    }
+
+    uint64_t mean() const noexcept
+    {
+        return m_count ? (m_sum / m_count) : 0;
+    }
+
+    // q in [0, 1]; 0 if the histogram is empty
+    uint64_t percentile(double q) const noexcept;
+
+    uint64_t bucket(size_t index) const noexcept
+    {
+        return m_buckets[index];
+    }
+
+private:
+    friend class ShardHistogram;
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_min = UINT64_MAX;
+    uint64_t m_max = 0;
+};
+
+
+//
+// a counter that is written by one thread and read by any;
+// plain load + store instead of an atomic RMW keeps the writer free of bus locks
+//
+
+class Counter final
+{
+public:
+    void add(uint64_t n = 1) noexcept
+    {
+        m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    uint64_t load() const noexcept
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> m_value = 0;
+};
+
+
+//
+// single-writer histogram readable from other threads; merged into a Histogram on read
+//
+
+class KESRV_EXPORT ShardHistogram final
+    : public boost::noncopyable
+{
+public:
+    ShardHistogram() noexcept;
+
+    void record(uint64_t value) noexcept
+    {
+        m_buckets[Histogram::bucketIndex(value)].add();
+        m_count.add();
+        m_sum.add(value);
+
+        if (value < m_min.load(std::memory_order_relaxed))
+            m_min.store(value, std::memory_order_relaxed);
+        if (value > m_max.load(std::memory_order_relaxed))
+            m_max.store(value, std::memory_order_relaxed);
+    }
+
+    void mergeInto(Histogram& to) const noexcept;
+
+private:
+    Counter m_buckets[Histogram::BucketCount];
+    Counter m_count;
+    Counter m_sum;
+    std::atomic<uint64_t> m_min = UINT64_MAX;
+    std::atomic<uint64_t> m_max = 0;
+};
+
+
+} // namespace Metrics {}
+
+} // namespace Kes {}
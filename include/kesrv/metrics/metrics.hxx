@@ -0,0 +1,225 @@
+#pragma once
+
+#include <kesrv/metrics/histogram.hxx>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+
+namespace Kes
+{
+
+namespace Metrics
+{
+
+// monotonic nanoseconds
+inline uint64_t now() noexcept
+{
+    struct timespec ts = {};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+
+enum class Stage
+{
+    Parse,
+    Handler,
+    Serialize,
+    Count // should go last
+};
+
+constexpr size_t StageCount = size_t(Stage::Count);
+
+
+struct CommandStats
+{
+    std::string name;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    Histogram stages[StageCount];
+};
+
+
+struct Snapshot
+{
+    std::vector<CommandStats> commands;
+    Histogram stages[StageCount];   // all commands
+    Histogram write;                // response write completion
+    Histogram scan;                 // procfs scan
+    uint64_t scanProcesses = 0;     // process count of the last scan
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t sessionsActive = 0;
+    uint64_t sessionsTotal = 0;
+};
+
+
+//
+// server metrics; every recording thread writes its own shard, snapshot() merges them
+//
+
+class KESRV_EXPORT Registry final
+    : public boost::noncopyable
+{
+public:
+    static constexpr size_t MaxCommands = 32;
+    static constexpr size_t UnknownCommand = 0;
+
+    ~Registry();
+    Registry();
+
+    // idempotent; returns UnknownCommand when the table is full
+    size_t registerCommand(const char* name);
+
+    void countRequest(size_t command, bool failed) noexcept
+    {
+        auto s = shard();
+        if (!s)
+            return;
+
+        auto& c = s->commands[command < MaxCommands ? command : UnknownCommand];
+        c.requests.add();
+        if (failed)
+            c.errors.add();
+    }
+
+    void recordStage(size_t command, Stage stage, uint64_t ns) noexcept
+    {
+        auto s = shard();
+        if (!s)
+            return;
+
+        auto h = histogram(s->commands[command < MaxCommands ? command : UnknownCommand].stages[size_t(stage)]);
+        if (h)
+            h->record(ns);
+    }
+
+    void recordWrite(uint64_t ns, size_t bytes) noexcept
+    {
+        auto s = shard();
+        if (!s)
+            return;
+
+        s->bytesOut.add(bytes);
+
+        auto h = histogram(s->write);
+        if (h)
+            h->record(ns);
+    }
+
+    void countBytesIn(size_t bytes) noexcept
+    {
+        auto s = shard();
+        if (s)
+            s->bytesIn.add(bytes);
+    }
+
+    void sessionStarted() noexcept
+    {
+        auto s = shard();
+        if (s)
+            s->sessionsStarted.add();
+    }
+
+    void sessionFinished() noexcept
+    {
+        auto s = shard();
+        if (s)
+            s->sessionsFinished.add();
+    }
+
+    void recordScan(uint64_t ns, size_t processes) noexcept
+    {
+        m_scanProcesses.store(processes, std::memory_order_relaxed);
+
+        auto s = shard();
+        if (!s)
+            return;
+
+        auto h = histogram(s->scan);
+        if (h)
+            h->record(ns);
+    }
+
+    Snapshot snapshot() const;
+
+private:
+    using HistogramSlot = std::atomic<ShardHistogram*>;
+
+    struct Shard
+    {
+        struct Command
+        {
+            Counter requests;
+            Counter errors;
+            HistogramSlot stages[StageCount] = {};
+        };
+
+        ~Shard();
+        explicit Shard(std::thread::id owner) noexcept
+            : owner(owner)
+        {}
+
+        const std::thread::id owner;
+        Command commands[MaxCommands];
+        HistogramSlot write = nullptr;
+        HistogramSlot scan = nullptr;
+        Counter bytesIn;
+        Counter bytesOut;
+        Counter sessionsStarted;
+        Counter sessionsFinished;
+    };
+
+    Shard* shard() noexcept
+    {
+        // the last used shard is cached per thread
+        thread_local struct
+        {
+            uint64_t registry = 0;
+            Shard* shard = nullptr;
+        } t_cache;
+
+        if (t_cache.registry == m_id)
+            return t_cache.shard;
+
+        auto s = findShard();
+        if (s)
+        {
+            t_cache.registry = m_id;
+            t_cache.shard = s;
+        }
+
+        return s;
+    }
+
+    // histograms are allocated on the first use by the owning thread
+    static ShardHistogram* histogram(HistogramSlot& slot) noexcept
+    {
+        auto h = slot.load(std::memory_order_relaxed);
+        if (!h)
+        {
+            h = new (std::nothrow) ShardHistogram;
+            slot.store(h, std::memory_order_release);
+        }
+
+        return h;
+    }
+
+    Shard* findShard() noexcept;
+
+    const uint64_t m_id;
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::string m_commands[MaxCommands];
+    size_t m_commandCount = 1; // UnknownCommand
+    std::atomic<uint64_t> m_scanProcesses = 0;
+};
+
+
+} // namespace Metrics {}
+
+} // namespace Kes {}
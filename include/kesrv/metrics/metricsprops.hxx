@@ -0,0 +1,49 @@
+#pragma once
+
+#include <kesrv/propertybag.hxx>
+
+namespace Kes
+{
+
+namespace MetricsProps
+{
+
+namespace Private
+{
+
+void registerAll();
+
+} // namespace Private {}
+
+
+// histogram (all durations are in nanoseconds)
+using Count = PropertyInfo<uint64_t, KES_PROPID("stats.count"), "Count", PropertyFormatter<uint64_t>>;
+using Min = PropertyInfo<uint64_t, KES_PROPID("stats.min"), "Min", PropertyFormatter<uint64_t>>;
+using Mean = PropertyInfo<uint64_t, KES_PROPID("stats.mean"), "Mean", PropertyFormatter<uint64_t>>;
+using P50 = PropertyInfo<uint64_t, KES_PROPID("stats.p50"), "50th Percentile", PropertyFormatter<uint64_t>>;
+using P99 = PropertyInfo<uint64_t, KES_PROPID("stats.p99"), "99th Percentile", PropertyFormatter<uint64_t>>;
+using P999 = PropertyInfo<uint64_t, KES_PROPID("stats.p999"), "99.9th Percentile", PropertyFormatter<uint64_t>>;
+using Max = PropertyInfo<uint64_t, KES_PROPID("stats.max"), "Max", PropertyFormatter<uint64_t>>;
+
+using Parse = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.parse"), "Parse Time", NullPropertyFormatter>;
+using Handler = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.handler"), "Handler Time", NullPropertyFormatter>;
+using Serialize = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.serialize"), "Serialization Time", NullPropertyFormatter>;
+using Write = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.write"), "Write Time", NullPropertyFormatter>;
+using Scan = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.scan"), "Procfs Scan Time", NullPropertyFormatter>;
+
+using Command = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.command"), "Command Stats", NullPropertyFormatter>;
+using CommandList = PropertyInfo<PropertyBag::Array, KES_PROPID("stats.commands"), "Command Stats List", NullPropertyFormatter, Command>;
+using Name = PropertyInfo<std::string, KES_PROPID("stats.name"), "Command", PropertyFormatter<std::string>>;
+using Requests = PropertyInfo<uint64_t, KES_PROPID("stats.requests"), "Requests", PropertyFormatter<uint64_t>>;
+using Errors = PropertyInfo<uint64_t, KES_PROPID("stats.errors"), "Errors", PropertyFormatter<uint64_t>>;
+
+using Stages = PropertyInfo<PropertyBag::Table, KES_PROPID("stats.stages"), "Stage Times", NullPropertyFormatter>;
+using BytesIn = PropertyInfo<uint64_t, KES_PROPID("stats.bytes_in"), "Bytes Received", PropertyFormatter<uint64_t>>;
+using BytesOut = PropertyInfo<uint64_t, KES_PROPID("stats.bytes_out"), "Bytes Sent", PropertyFormatter<uint64_t>>;
+using ActiveSessions = PropertyInfo<uint64_t, KES_PROPID("stats.active_sessions"), "Active Sessions", PropertyFormatter<uint64_t>>;
+using TotalSessions = PropertyInfo<uint64_t, KES_PROPID("stats.total_sessions"), "Total Sessions", PropertyFormatter<uint64_t>>;
+using ScanProcesses = PropertyInfo<uint64_t, KES_PROPID("stats.scan_processes"), "Processes Scanned", PropertyFormatter<uint64_t>>;
+
+} // namespace MetricsProps {}
+
+} // namespace Kes {}
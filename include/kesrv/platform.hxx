@@ -22,6 +22,7 @@
 
 // often-used platform headers
 
+#include <utility> // Boost.Asio 1.74 uses std::exchange without including it
 
 #include <boost/asio.hpp>
 #include <boost/noncopyable.hpp>
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <kesrv/log.hxx>
+#include <kesrv/requestprocessor.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// list_cgroups: the cgroup v2 groups that have processes and their ancestors (or the ones under
+// cgroup.path), with the process count, CPU rate and resident size of the processes in each
+// subtree, and cpu.stat, memory.current and memory.pressure from the cgroupfs;
+// the process stats come from the scans of the ProcessManager, which is asked for a sample when
+// none is MaxSampleAge recent; the sums of the cgroups are not regrouped: they are adjusted by
+// the difference a process makes as it comes, changes or goes, and rolled up to the ancestors
+// per request; the cgroup of a process is read when it shows up and again once MembershipInterval
+// old, since a process can be moved; the paths are interned, and the slot of a cgroup that loses
+// its last member is reused
+//
+
+class KESRV_EXPORT CgroupManager final
+    : public IRequestHandler
+    , public IScanListener
+{
+public:
+    static constexpr const char* DefaultRoot = "/sys/fs/cgroup";
+    static constexpr std::chrono::seconds MembershipInterval{10};
+    // a newer one would not have new rates (CpuSampler::MinInterval)
+    static constexpr std::chrono::milliseconds MaxSampleAge{200};
+
+    ~CgroupManager();
+    explicit CgroupManager(IRequestProcessor* rp, Log::ILog* log, ProcessManager* processes, const std::string& procFsRoot = ProcFs::ProcFs::DefaultRoot,
+        const std::string& cgroupRoot = DefaultRoot);
+
+    CgroupManager(const CgroupManager&) = delete;
+    CgroupManager& operator=(const CgroupManager&) = delete;
+
+    CgroupManager(CgroupManager&&) = delete;
+    CgroupManager& operator=(CgroupManager&&) = delete;
+
+    bool process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response) override;
+    // the aggregates are the same for every session
+    void startSession(uint32_t) override {}
+    void endSession(uint32_t) override {}
+
+    void scanned(const std::vector<IScanListener::Process>& processes, uint64_t time) override;
+
+private:
+    static constexpr uint32_t NoCgroup = uint32_t(-1);
+
+    // the direct members of a cgroup, or a whole subtree
+    struct Totals
+    {
+        uint32_t processes = 0;
+        uint32_t rated = 0;         // the processes with a CPU rate
+        int64_t cpu = 0;            // hundredths of a percent of one CPU
+        uint64_t rss = 0;           // bytes
+    };
+
+    struct Cgroup
+    {
+        std::string path;           // empty while the slot is free
+        Totals totals;
+    };
+
+    // what a process contributes to its cgroup
+    struct Member
+    {
+        uint64_t startTicks = 0;
+        uint32_t cgroup = NoCgroup;
+        uint32_t scan = 0;
+        bool rated = false;
+        int64_t cpu = 0;
+        uint64_t rss = 0;
+        uint64_t membershipTime = 0;    // Metrics::now() of the cgroup read
+    };
+
+    bool listCgroups(Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
+    // takes in the last sample the ProcessManager sent, if there is a new one
+    void update();
+    // every cgroup with members and every ancestor of one, with the sums of its subtree
+    std::map<std::string, Totals> rollUp() const;
+    uint32_t intern(const std::string& path);
+    void attach(Member& member, uint32_t cgroup) noexcept;
+    void detach(Member& member) noexcept;
+    PropertyBag serialize(const std::string& path, const Totals& totals, uint32_t own);
+
+    IRequestProcessor* m_rp;
+    Log::ILog* m_log;
+    ProcessManager* m_processes;
+    ProcFs::ProcFs m_procFs;
+    std::string m_cgroupRoot;
+    uint32_t m_scan = 0;
+    std::unordered_map<pid_t, Member> m_members;
+    std::vector<Cgroup> m_cgroups;                      // by interned id
+    std::vector<uint32_t> m_free;                       // ids of the empty slots
+    std::unordered_map<std::string, uint32_t> m_ids;
+    std::mutex m_mutex;
+
+    // filled under the lock of the ProcessManager, which must not wait for m_mutex
+    std::mutex m_sampleMutex;
+    std::vector<IScanListener::Process> m_sample;
+    uint64_t m_sampleTime = 0;
+    bool m_sampled = false;                             // m_sample is not taken in yet
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
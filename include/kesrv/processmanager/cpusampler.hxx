@@ -0,0 +1,84 @@
+#pragma once
+
+#include <kesrv/processmanager/procfs.hxx>
+
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// turns cumulative CPU ticks into rates: keeps the previous sample of every pid (or tid)
+// in an open-addressing table of fixed-size entries, and the previous /proc/stat totals;
+// a rate is recomputed only once MinInterval has passed since its baseline, so scans that
+// follow each other closely (several sessions) report the last rate instead of noise
+//
+
+class KESRV_EXPORT CpuSampler final
+    : public boost::noncopyable
+{
+public:
+    static constexpr uint64_t MinInterval = 200 * 1000 * 1000ULL; // ns
+    static constexpr size_t InitialCapacity = 1024;
+
+    CpuSampler();
+
+    // starts a scan; entries not updated for a couple of scans are dropped when the table fills up
+    void beginScan() noexcept
+    {
+        ++m_epoch;
+    }
+
+    // 'now' is CLOCK_MONOTONIC ns; returns the percentage of one CPU, negative while unknown
+    double update(pid_t id, uint64_t startTicks, uint64_t cpuTicks, uint64_t now);
+
+    void updateSystem(const ProcFs::CpuTimes& times, uint64_t now) noexcept;
+
+    // percentages of all CPUs, negative while unknown
+    double systemBusy() const noexcept
+    {
+        return m_systemBusy;
+    }
+
+    double systemIdle() const noexcept
+    {
+        return (m_systemBusy < 0) ? m_systemBusy : 100.0 - m_systemBusy;
+    }
+
+    size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+private:
+    struct Entry
+    {
+        pid_t id;               // 0 = free
+        uint32_t epoch;
+        float rate;             // < 0 while unknown
+        uint64_t startTicks;    // tells a reused id from the original
+        uint64_t cpuTicks;
+        uint64_t time;
+    };
+
+    Entry* find(pid_t id) noexcept;
+    void rehash(size_t capacity);
+
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+    uint32_t m_epoch = 0;
+    double m_ticksPerSecond;
+
+    ProcFs::CpuTimes m_system;
+    uint64_t m_systemTime = 0;
+    double m_systemBusy = -1;
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
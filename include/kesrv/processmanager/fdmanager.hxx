@@ -0,0 +1,121 @@
+#pragma once
+
+#include <kesrv/log.hxx>
+#include <kesrv/requestprocessor.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// list_fds: the open files of one process (process.pid) or of all of them, in pid and then fd
+// order, a chunk of at most process.limit descriptors per response; process.next_cursor is there
+// while more are left and goes into the process.cursor of the request for the next chunk;
+// a process with a million descriptors has its fd directory walked once per listing rather than
+// once per chunk: the session keeps the numbers that did not fit
+//
+// list_sockets: the sockets of /proc/net/{tcp,tcp6,udp,udp6,unix}, each with the pids that hold it;
+// the owners come from an inode index built by one walk over every fd directory and shared by
+// all sessions; a new generation of the index is built when it gets old or when the tables show
+// a socket it does not know, though not more often than once per index interval, so that the
+// sockets of unreadable processes do not cause a walk per query; the walk holds no lock that
+// list_fds needs, and the socket links list_fds comes across are owners known before the next walk
+//
+
+class KESRV_EXPORT FdManager final
+    : public IRequestHandler
+{
+public:
+    static constexpr size_t DefaultChunk = 4096;
+    static constexpr size_t MaxChunk = 65536;
+    static constexpr std::chrono::milliseconds DefaultIndexInterval{1000};
+    static constexpr std::chrono::seconds MaxIndexAge{30};
+    static constexpr size_t MaxSightings = 65536;
+
+    ~FdManager();
+    explicit FdManager(IRequestProcessor* rp, Log::ILog* log, const std::string& procFsRoot = ProcFs::ProcFs::DefaultRoot,
+        std::chrono::milliseconds indexInterval = DefaultIndexInterval);
+
+    FdManager(const FdManager&) = delete;
+    FdManager& operator=(const FdManager&) = delete;
+
+    FdManager(FdManager&&) = delete;
+    FdManager& operator=(FdManager&&) = delete;
+
+    bool process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response) override;
+    void startSession(uint32_t id) override;
+    void endSession(uint32_t id) override;
+
+private:
+    struct Session
+    {
+        using Ptr = std::unique_ptr<Session>;
+
+        explicit Session(uint32_t id) noexcept
+            : sessionId(id)
+        {}
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        uint32_t sessionId;
+        pid_t pendingPid = ProcFs::InvalidPid;
+        int pendingAfter = -1;                          // the last fd of pendingPid the previous chunk sent
+        std::vector<int> pendingFds;                    // sorted; what the previous chunk left of pendingPid
+    };
+
+    using Owner = std::pair<uint64_t, pid_t>;               // (inode, pid)
+
+    struct SocketIndex
+    {
+        using Ptr = std::shared_ptr<const SocketIndex>;
+
+        uint64_t generation = 0;
+        uint64_t started = 0;                               // Metrics::now() when the walk began
+        uint64_t time = 0;                                  // and when it was over
+        std::vector<Owner> owners;                          // sorted
+    };
+
+    // a socket link list_fds came across
+    struct Sighting
+    {
+        Owner owner;
+        uint64_t time;                                      // Metrics::now()
+    };
+
+    bool listFds(Session* session, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
+    // the sorted fds of 'pid' above 'after', from the session if the previous chunk stopped at exactly that fd
+    std::optional<std::vector<int>> fdsAfter(Session* session, pid_t pid, int after);
+
+    bool listSockets(Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
+    // the current index and the sorted owners seen since its walk began
+    SocketIndex::Ptr socketIndex(std::vector<Owner>& seen);
+    // walks the fd directories unless another walk replaced generation 'current' meanwhile
+    void buildSocketIndex(uint64_t current);
+    void addSightings(const std::vector<Owner>& owners);
+
+    IRequestProcessor* m_rp;
+    Log::ILog* m_log;
+    ProcFs::ProcFs m_procFs;
+    const uint64_t m_indexInterval;                     // ns
+    std::mutex m_mutex;                                 // guards the sessions
+    std::unordered_map<uint32_t, Session::Ptr> m_sessions;
+    std::mutex m_buildMutex;                            // one walk at a time
+    std::mutex m_indexMutex;                            // guards the two below, never held over a walk
+    SocketIndex::Ptr m_sockets;
+    std::vector<Sighting> m_sightings;                  // since m_sockets
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
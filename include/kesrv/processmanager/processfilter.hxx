@@ -0,0 +1,119 @@
+#pragma once
+
+#include <kesrv/propertybag.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+
+#include <string_view>
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// a compiled process filter expression:
+//
+//   expr       := term { ("or" | "||") term }
+//   term       := factor { ("and" | "&&") factor }
+//   factor     := ("not" | "!") factor | "(" expr ")" | field op value
+//   op         := "==" | "!=" | "<" | "<=" | ">" | ">=" | "~" (glob) | "=~" (extended regex)
+//   value      := number | 'string' | "string" | bareword
+//
+// e.g. uid == 1000 and (comm ~ 'nginx*' or cmdline =~ "^/usr/s?bin/") and not state == Z
+//
+
+class KESRV_EXPORT ProcessFilter final
+    : public boost::noncopyable
+{
+public:
+    static constexpr size_t MaxLength = 4096;
+    static constexpr size_t MaxDepth = 64;
+
+    // what an expression can look at
+    struct Subject
+    {
+        const ProcFs::Stat& stat;
+        const std::string& comm;
+        const std::string& exe;
+        const std::string& cmdLine;
+        double cpu = -1;                // % of one CPU, negative while unknown
+        const ProcFs::Memory* memory = nullptr;
+        const ProcFs::IoCounters* io = nullptr;
+        const ProcFs::IoRates* ioRates = nullptr;
+        int64_t fdCount = -1;           // negative if the fd directory was not read
+        const ProcFs::Namespaces* namespaces = nullptr;
+        pid_t nsPid = ProcFs::InvalidPid;
+        int nsLevel = -1;               // negative if NSpid was not read
+        uint64_t smapsTime = 0;         // when memory.smaps was read, Metrics::now(); 0 = never
+    };
+
+    ~ProcessFilter();
+
+    // throws Kes::Exception naming the offending position
+    explicit ProcessFilter(const std::string& expression);
+
+    const std::string& expression() const noexcept
+    {
+        return m_expression;
+    }
+
+    bool match(const Subject& subject) const noexcept;
+
+    // the ProcFs::FileMask files the expression looks at
+    uint32_t files() const noexcept
+    {
+        return m_files;
+    }
+
+private:
+    struct Node;
+    class Parser;
+
+    bool evaluate(size_t index, const Subject& subject) const noexcept;
+
+    std::string m_expression;
+    std::vector<Node> m_nodes;
+    size_t m_root = 0;
+    uint32_t m_files = 0;
+};
+
+
+
+//
+// a process field: what a response can carry and what expressions and sorts can refer to,
+// all from the one table; either 'number' or 'text' is set; numbers that were not read
+// compare as -1; 'add' is null for the fields a request cannot select
+//
+
+struct KESRV_EXPORT ProcessField
+{
+    const char* idstr;      // the response key, e.g. process.ruid
+    uint32_t files;         // ProcFs::FileMask
+    double (*number)(const ProcessFilter::Subject&);
+    const char* (*text)(const ProcessFilter::Subject&);
+    void (*add)(PropertyBag& table, const ProcessFilter::Subject&);
+
+    // without the response key prefix, the way expressions and cursors spell it
+    const char* name() const noexcept
+    {
+        return idstr + 8;
+    }
+
+    bool selectable() const noexcept
+    {
+        return add != nullptr;
+    }
+
+    static const std::vector<ProcessField>& all() noexcept;
+
+    // the name may come with the response key prefix, e.g. process.ruid
+    static const ProcessField* find(std::string_view name) noexcept;
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
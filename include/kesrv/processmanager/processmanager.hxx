@@ -1,11 +1,18 @@
 #pragma once
 
 #include <kesrv/log.hxx>
+#include <kesrv/metrics/metrics.hxx>
 #include <kesrv/requestprocessor.hxx>
+#include <kesrv/processmanager/cpusampler.hxx>
+#include <kesrv/processmanager/processfilter.hxx>
 #include <kesrv/processmanager/procfs.hxx>
 
+#include <chrono>
+#include <deque>
+#include <map>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 
 namespace Kes
@@ -14,12 +21,56 @@ namespace Kes
 namespace Private
 {
 
+// the cadence of the fields that are expensive to read (ProcFs::SlowFiles)
+struct RefreshOptions
+{
+    std::chrono::milliseconds slowInterval = std::chrono::milliseconds(10000);
+    std::chrono::milliseconds scanBudget = std::chrono::milliseconds(50);  // for slow reads, per scan
+};
+
+
+//
+// gets the stats of every scan that read them, so that the managers that aggregate processes
+// do not scan them again; called under the lock of the ProcessManager, so it must not call back
+//
+
+class IScanListener
+{
+public:
+    struct Process
+    {
+        pid_t pid;
+        pid_t ppid;
+        pid_t pgrp;
+        pid_t tpgid;
+        pid_t session;
+        uid_t ruid;
+        uint64_t startTicks;
+        double cpu;                         // % of one CPU, negative while unknown
+        uint64_t rss;                       // bytes
+        std::string comm;                   // from stat
+    };
+
+    virtual ~IScanListener() = default;
+    // 'time' is Metrics::now() of the scan
+    virtual void scanned(const std::vector<Process>& processes, uint64_t time) = 0;
+};
+
+
+//
+// answers list_processes and diff_processes: a session gets the full list, then what changed
+// since its previous response or since the generation of a token it presents
+//
+
 class KESRV_EXPORT ProcessManager final
     : public IRequestHandler
 {
 public:
+    static constexpr size_t DefaultHistoryDepth = 64;
+    static constexpr std::chrono::milliseconds DefaultHistoryAge = std::chrono::minutes(10);
+
     ~ProcessManager();
-    explicit ProcessManager(IRequestProcessor* rp, Log::ILog* log);
+    explicit ProcessManager(IRequestProcessor* rp, Log::ILog* log, Metrics::Registry* metrics, const std::string& procFsRoot = ProcFs::ProcFs::DefaultRoot, size_t historyDepth = DefaultHistoryDepth, const RefreshOptions& refresh = RefreshOptions(), std::chrono::milliseconds historyAge = DefaultHistoryAge);
 
     ProcessManager(const ProcessManager&) = delete;
     ProcessManager& operator=(const ProcessManager&) = delete;
@@ -31,7 +82,17 @@ public:
     void startSession(uint32_t id) override;
     void endSession(uint32_t id) override;
 
+    // the listeners get every scan that read the stats
+    void addListener(IScanListener* listener);
+    void removeListener(IScanListener* listener);
+    // for a listener that needs the stats fresher than the sessions keep them: reads the stats
+    // alone unless a scan did within maxAge
+    void sample(std::chrono::nanoseconds maxAge);
+
 private:
+    // a response field a request can select
+    using Column = ProcessField;
+
     struct ProcessInfo
     {
         using Ptr = std::unique_ptr<ProcessInfo>;
@@ -44,16 +105,43 @@ private:
         ProcessInfo(const ProcessInfo&) = delete;
         ProcessInfo& operator=(const ProcessInfo&) = delete;
 
-        PropertyBag serialize() const;
+        PropertyBag serialize(const std::vector<const Column*>& columns) const;
+
+        // what filters, sorts and columns look at
+        ProcessFilter::Subject subject() const noexcept;
+
+        // changes whenever anything serialize() writes for these columns changes
+        uint32_t computeDigest(const std::vector<const Column*>& columns) const noexcept;
 
         uint32_t timestamp;
         bool newcomer = false;
+        uint32_t digest = 0;                // of the columns of the last scan
+        uint32_t files = ProcFs::AllFiles;  // what was read
+        double cpu = -1;                    // % of one CPU since the previous sample, negative while unknown
+        uint64_t smapsTime = 0;             // when memory.smaps was read, Metrics::now()
+        int64_t fdCount = -1;               // negative unless FdDir was read
+        std::shared_ptr<const ProcFs::Namespaces> namespaces;   // null unless NsDir was read
+        pid_t nsPid = ProcFs::InvalidPid;   // in the innermost pid namespace
+        int nsLevel = -1;
         ProcFs::Stat stat;
+        ProcFs::Memory memory;
+        ProcFs::IoCounters io;
+        ProcFs::IoRates ioRates;
         std::string comm;
         std::string exe;
         std::string cmdLine;
     };
 
+    // what the client was sent of a namespace group
+    struct GroupState
+    {
+        uint64_t key = 0;
+        uint32_t members = 0;               // digest of the pids
+        uint32_t digest = 0;                // of the rest
+
+        bool operator==(const GroupState&) const = default;
+    };
+
     struct Session
     {
         using Ptr = std::unique_ptr<Session>;
@@ -69,18 +157,137 @@ private:
         uint32_t timestamp = 0;
         std::unordered_map<pid_t, ProcessInfo::Ptr> processes;
         std::vector<pid_t> removedPids;
+
+        // recompiled only when the expression changes
+        std::unique_ptr<ProcessFilter> filter;
+        // what the last partial response listed
+        std::unordered_set<pid_t> visible;
+        bool partial = false;
+        // what the last grouped response left the client with
+        std::vector<GroupState> groups;
+    };
+
+    // the order and the page a request asks for; no sort field means no particular order
+    struct View
+    {
+        const ProcessField* sortBy = nullptr;
+        bool descending = false;
+        size_t limit = 0;
+        bool cursor = false;
+        pid_t cursorPid = ProcFs::InvalidPid;
+        double cursorNumber = 0;
+        std::string cursorText;
+        std::vector<const Column*> columns;
+        uint32_t files = 0;                 // what the columns and the sort need
+        bool refresh = false;               // re-read the slow files regardless of their age
+        bool groupByNamespace = false;
+    };
+
+    // what select() actually orders
+    struct SortKey
+    {
+        double number;
+        const char* text;
+        pid_t pid;
+        ProcessInfo* process;
+    };
+
+    // a cached slow read; startTicks tells a reused pid from the original
+    struct SlowSample
+    {
+        uint64_t startTicks = 0;
+        uint64_t time = 0;                  // Metrics::now(), 0 = never read
+        ProcFs::Memory::Smaps smaps;
+    };
+
+    // the previous io sample of a process; the rates are kept until the next one is MinInterval away
+    struct IoSample
+    {
+        uint64_t startTicks = 0;
+        uint64_t time = 0;
+        ProcFs::IoCounters counters;
+        ProcFs::IoRates rates;
+    };
+
+    struct NamespacesHash
+    {
+        size_t operator()(const ProcFs::Namespaces& namespaces) const noexcept
+        {
+            size_t h = namespaces.valid;
+            for (auto inode: namespaces.inodes)
+                h = h * 1000003 ^ std::hash<uint64_t>()(inode);
+
+            return h;
+        }
+    };
+
+    // the processes a scan saw through a projection, sorted by pid
+    struct Generation
+    {
+        uint64_t id = 0;
+        uint64_t projection = 0;
+        uint64_t time = 0;                  // Metrics::now() of the last scan that saw it
+        uint64_t fingerprint = 0;           // of the processes, in no particular order
+        std::vector<std::pair<pid_t, uint32_t>> processes; // pid, digest
+        std::vector<GroupState> groups;     // by key, empty unless grouped
     };
 
     bool process(Session* session, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
     bool listProcesses(bool initial, Session* session, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
-    ProcessInfo::Ptr readProcess(pid_t pid, uint32_t timestamp);
-    void readProcesses(bool initial, Session* session);
+    bool resumeProcesses(Session* session, const Generation& base, const View& view, Kes::Request::Id id, PropertyBag& response);
+    void addSystemCpu(PropertyBag& response) const;
+    // only the groups that differ from 'known' (by key) unless that is null
+    void addNamespaceGroups(Session* session, const std::vector<GroupState>* known, PropertyBag& response) const;
+    void updateFilter(Session* session, const PropertyBag& request);
+    static bool matches(const Session* session, const ProcessInfo& process) noexcept;
+    // a filter expression and/or a sorted page narrow the list to a partial view; its diffs report
+    // the processes that left it as deleted and the ones that entered it as new
+    static bool isPartial(const Session* session, const View& view) noexcept;
+    static View parseView(const PropertyBag& request);
+    std::vector<ProcessInfo*> select(const Session* session, const View& view, std::string& nextCursor) const;
+    static uint64_t projection(const View& view) noexcept;
+    // a generation is what a scan saw through one projection (the fields a request selects);
+    // the scans of any session that see the same share it; it is kept for historyAge and while
+    // it is among the last historyDepth of its projection, and a new session presenting its
+    // token gets only what changed since
+    uint64_t recordGeneration(const Session* session, uint64_t projection);
+    const Generation* findGeneration(const std::string& token, uint64_t projection) const noexcept;
+    void expireGenerations(uint64_t now);
+    std::string makeToken(uint64_t generation) const;
+    static const std::vector<const Column*>& defaultColumns();
+    ProcessInfo::Ptr readProcess(pid_t pid, uint32_t timestamp, uint32_t files);
+    void readProcesses(bool initial, Session* session, const View& view);
+    // after every scan that read the stats, session or sample, under m_mutex
+    void notifyListeners(const std::vector<IScanListener::Process>& processes, uint64_t time);
+    // slow fields are cached across scans and sessions and re-read once older than the slow
+    // interval, the oldest first, for as long as the scan budget lasts; the rest keep their
+    // cached values, which come with their age
+    void readSlowFiles(const Session* session, bool refresh);
+    void updateIoRates(ProcessInfo& process, uint64_t now);
+    // the processes of a container share one entry, which goes away with the last of them
+    std::shared_ptr<const ProcFs::Namespaces> internNamespaces(const ProcFs::Namespaces& namespaces);
 
     IRequestProcessor* m_rp;
     Log::ILog* m_log;
+    Metrics::Registry* m_metrics;
     ProcFs::ProcFs m_procFs;
+    CpuSampler m_cpu;
+    const RefreshOptions m_refresh;
+    std::unordered_map<pid_t, SlowSample> m_slow;
+    std::unordered_map<pid_t, IoSample> m_io;
+    std::unordered_map<ProcFs::Namespaces, std::weak_ptr<const ProcFs::Namespaces>, NamespacesHash> m_namespaces;
     std::mutex m_mutex;
     std::unordered_map<uint32_t, Session::Ptr> m_sessions;
+    std::vector<IScanListener*> m_listeners;
+    uint64_t m_sampleTime = 0;              // Metrics::now() of the last scan the listeners got
+
+    // tokens of a previous server instance are not honoured
+    const uint64_t m_instance;
+    const size_t m_historyDepth;
+    const uint64_t m_historyAge;            // ns
+    std::map<uint64_t, Generation> m_history;
+    std::unordered_map<uint64_t, std::deque<uint64_t>> m_projections;  // projection -> its generations, oldest first
+    uint64_t m_lastGeneration = 0;
 };
 
 
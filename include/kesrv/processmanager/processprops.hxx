@@ -34,6 +34,243 @@ using Comm = PropertyInfo<std::string, KES_PROPID("process.comm"), "Program Name
 using CmdLine = PropertyInfo<std::string, KES_PROPID("process.cmdline"), "Command Line", PropertyFormatter<std::string>>;
 using Exe = PropertyInfo<std::string, KES_PROPID("process.exe"), "Executable Name", PropertyFormatter<std::string>>;
 
+// the rest of /proc/<pid>/stat
+using State = PropertyInfo<std::string, KES_PROPID("process.state"), "State", PropertyFormatter<std::string>>;
+using TtyNr = PropertyInfo<int, KES_PROPID("process.tty_nr"), "Controlling Terminal", PropertyFormatter<int>>;
+using Flags = PropertyInfo<unsigned int, KES_PROPID("process.flags"), "Kernel Flags", PropertyFormatter<unsigned int>>;
+using MinFlt = PropertyInfo<uint64_t, KES_PROPID("process.minflt"), "Minor Faults", PropertyFormatter<uint64_t>>;
+using CMinFlt = PropertyInfo<uint64_t, KES_PROPID("process.cminflt"), "Minor Faults of Waited Children", PropertyFormatter<uint64_t>>;
+using MajFlt = PropertyInfo<uint64_t, KES_PROPID("process.majflt"), "Major Faults", PropertyFormatter<uint64_t>>;
+using CMajFlt = PropertyInfo<uint64_t, KES_PROPID("process.cmajflt"), "Major Faults of Waited Children", PropertyFormatter<uint64_t>>;
+using UTime = PropertyInfo<uint64_t, KES_PROPID("process.utime"), "User Time", PropertyFormatter<uint64_t>>;
+using STime = PropertyInfo<uint64_t, KES_PROPID("process.stime"), "System Time", PropertyFormatter<uint64_t>>;
+using CUTime = PropertyInfo<int64_t, KES_PROPID("process.cutime"), "User Time of Waited Children", PropertyFormatter<int64_t>>;
+using CSTime = PropertyInfo<int64_t, KES_PROPID("process.cstime"), "System Time of Waited Children", PropertyFormatter<int64_t>>;
+using Priority = PropertyInfo<int64_t, KES_PROPID("process.priority"), "Priority", PropertyFormatter<int64_t>>;
+using Nice = PropertyInfo<int64_t, KES_PROPID("process.nice"), "Nice", PropertyFormatter<int64_t>>;
+using NumThreads = PropertyInfo<int64_t, KES_PROPID("process.num_threads"), "Threads", PropertyFormatter<int64_t>>;
+using ItRealValue = PropertyInfo<int64_t, KES_PROPID("process.itrealvalue"), "Next SIGALRM", PropertyFormatter<int64_t>>;
+using StartTicks = PropertyInfo<uint64_t, KES_PROPID("process.starttime"), "Start Time (Ticks Since Boot)", PropertyFormatter<uint64_t>>;
+using VSize = PropertyInfo<uint64_t, KES_PROPID("process.vsize"), "Virtual Memory Size", PropertyFormatter<uint64_t>>;
+using Rss = PropertyInfo<int64_t, KES_PROPID("process.rss"), "Resident Set Size", PropertyFormatter<int64_t>>;
+using RssLim = PropertyInfo<uint64_t, KES_PROPID("process.rsslim"), "Resident Set Size Limit", PropertyFormatter<uint64_t>>;
+using StartCode = PropertyInfo<uint64_t, KES_PROPID("process.startcode"), "Start of Code", PropertyFormatter<uint64_t>>;
+using EndCode = PropertyInfo<uint64_t, KES_PROPID("process.endcode"), "End of Code", PropertyFormatter<uint64_t>>;
+using StartStack = PropertyInfo<uint64_t, KES_PROPID("process.startstack"), "Start of Stack", PropertyFormatter<uint64_t>>;
+using KstkEsp = PropertyInfo<uint64_t, KES_PROPID("process.kstkesp"), "Stack Pointer", PropertyFormatter<uint64_t>>;
+using KstkEip = PropertyInfo<uint64_t, KES_PROPID("process.kstkeip"), "Instruction Pointer", PropertyFormatter<uint64_t>>;
+using Signal = PropertyInfo<uint64_t, KES_PROPID("process.signal"), "Pending Signals", PropertyFormatter<uint64_t>>;
+using Blocked = PropertyInfo<uint64_t, KES_PROPID("process.blocked"), "Blocked Signals", PropertyFormatter<uint64_t>>;
+using SigIgnore = PropertyInfo<uint64_t, KES_PROPID("process.sigignore"), "Ignored Signals", PropertyFormatter<uint64_t>>;
+using SigCatch = PropertyInfo<uint64_t, KES_PROPID("process.sigcatch"), "Caught Signals", PropertyFormatter<uint64_t>>;
+using WChan = PropertyInfo<uint64_t, KES_PROPID("process.wchan"), "Wait Channel", PropertyFormatter<uint64_t>>;
+using NSwap = PropertyInfo<uint64_t, KES_PROPID("process.nswap"), "Pages Swapped", PropertyFormatter<uint64_t>>;
+using CNSwap = PropertyInfo<uint64_t, KES_PROPID("process.cnswap"), "Pages Swapped by Children", PropertyFormatter<uint64_t>>;
+using ExitSignal = PropertyInfo<int, KES_PROPID("process.exit_signal"), "Exit Signal", PropertyFormatter<int>>;
+using Processor = PropertyInfo<int, KES_PROPID("process.processor"), "Last CPU", PropertyFormatter<int>>;
+using RtPriority = PropertyInfo<unsigned int, KES_PROPID("process.rt_priority"), "Realtime Priority", PropertyFormatter<unsigned int>>;
+using Policy = PropertyInfo<unsigned int, KES_PROPID("process.policy"), "Scheduling Policy", PropertyFormatter<unsigned int>>;
+using DelayAcctBlkioTicks = PropertyInfo<uint64_t, KES_PROPID("process.delayacct_blkio_ticks"), "Block I/O Delays", PropertyFormatter<uint64_t>>;
+using GuestTime = PropertyInfo<uint64_t, KES_PROPID("process.guest_time"), "Guest Time", PropertyFormatter<uint64_t>>;
+using CGuestTime = PropertyInfo<int64_t, KES_PROPID("process.cguest_time"), "Guest Time of Waited Children", PropertyFormatter<int64_t>>;
+using StartData = PropertyInfo<uint64_t, KES_PROPID("process.start_data"), "Start of Data", PropertyFormatter<uint64_t>>;
+using EndData = PropertyInfo<uint64_t, KES_PROPID("process.end_data"), "End of Data", PropertyFormatter<uint64_t>>;
+using StartBrk = PropertyInfo<uint64_t, KES_PROPID("process.start_brk"), "Start of Heap", PropertyFormatter<uint64_t>>;
+using ArgStart = PropertyInfo<uint64_t, KES_PROPID("process.arg_start"), "Start of Arguments", PropertyFormatter<uint64_t>>;
+using ArgEnd = PropertyInfo<uint64_t, KES_PROPID("process.arg_end"), "End of Arguments", PropertyFormatter<uint64_t>>;
+using EnvStart = PropertyInfo<uint64_t, KES_PROPID("process.env_start"), "Start of Environment", PropertyFormatter<uint64_t>>;
+using EnvEnd = PropertyInfo<uint64_t, KES_PROPID("process.env_end"), "End of Environment", PropertyFormatter<uint64_t>>;
+using ExitCode = PropertyInfo<int, KES_PROPID("process.exit_code"), "Exit Code", PropertyFormatter<int>>;
+
+// StartTicks converted to an absolute time
+using StartTime = PropertyInfo<uint64_t, KES_PROPID("process.start_time"), "Start Time", PropertyFormatter<uint64_t>>;
+
+// memory detail in bytes: statm, status and smaps_rollup; the last one is refreshed on a slower
+// cadence, SmapsAge tells how old the values are (ms)
+using Shared = PropertyInfo<uint64_t, KES_PROPID("process.shared"), "Shared Resident Memory", PropertyFormatter<uint64_t>>;
+using Text = PropertyInfo<uint64_t, KES_PROPID("process.text"), "Text Size", PropertyFormatter<uint64_t>>;
+using Data = PropertyInfo<uint64_t, KES_PROPID("process.data"), "Data + Stack Size", PropertyFormatter<uint64_t>>;
+using RssAnon = PropertyInfo<uint64_t, KES_PROPID("process.rss_anon"), "Resident Anonymous Memory", PropertyFormatter<uint64_t>>;
+using RssFile = PropertyInfo<uint64_t, KES_PROPID("process.rss_file"), "Resident File Mappings", PropertyFormatter<uint64_t>>;
+using RssShmem = PropertyInfo<uint64_t, KES_PROPID("process.rss_shmem"), "Resident Shared Memory", PropertyFormatter<uint64_t>>;
+using Swap = PropertyInfo<uint64_t, KES_PROPID("process.swap"), "Swapped Out", PropertyFormatter<uint64_t>>;
+using Pss = PropertyInfo<uint64_t, KES_PROPID("process.pss"), "Proportional Set Size", PropertyFormatter<uint64_t>>;
+using PssAnon = PropertyInfo<uint64_t, KES_PROPID("process.pss_anon"), "Proportional Anonymous Memory", PropertyFormatter<uint64_t>>;
+using PssFile = PropertyInfo<uint64_t, KES_PROPID("process.pss_file"), "Proportional File Mappings", PropertyFormatter<uint64_t>>;
+using PssShmem = PropertyInfo<uint64_t, KES_PROPID("process.pss_shmem"), "Proportional Shared Memory", PropertyFormatter<uint64_t>>;
+using SwapPss = PropertyInfo<uint64_t, KES_PROPID("process.swap_pss"), "Proportional Swap", PropertyFormatter<uint64_t>>;
+using SmapsAge = PropertyInfo<uint64_t, KES_PROPID("process.smaps_age"), "smaps_rollup Age", PropertyFormatter<uint64_t>>;
+
+// /proc/<pid>/io counters, and their rates per second between the last two samples
+using IoRChar = PropertyInfo<uint64_t, KES_PROPID("process.io_rchar"), "Characters Read", PropertyFormatter<uint64_t>>;
+using IoWChar = PropertyInfo<uint64_t, KES_PROPID("process.io_wchar"), "Characters Written", PropertyFormatter<uint64_t>>;
+using IoSyscR = PropertyInfo<uint64_t, KES_PROPID("process.io_syscr"), "Read Syscalls", PropertyFormatter<uint64_t>>;
+using IoSyscW = PropertyInfo<uint64_t, KES_PROPID("process.io_syscw"), "Write Syscalls", PropertyFormatter<uint64_t>>;
+using IoReadBytes = PropertyInfo<uint64_t, KES_PROPID("process.io_read_bytes"), "Bytes Read from Storage", PropertyFormatter<uint64_t>>;
+using IoWriteBytes = PropertyInfo<uint64_t, KES_PROPID("process.io_write_bytes"), "Bytes Written to Storage", PropertyFormatter<uint64_t>>;
+using IoCancelledWriteBytes = PropertyInfo<uint64_t, KES_PROPID("process.io_cancelled_write_bytes"), "Cancelled Write Bytes", PropertyFormatter<uint64_t>>;
+using IoRCharRate = PropertyInfo<double, KES_PROPID("process.io_rchar_rate"), "Characters Read/s", PropertyFormatter<double>>;
+using IoWCharRate = PropertyInfo<double, KES_PROPID("process.io_wchar_rate"), "Characters Written/s", PropertyFormatter<double>>;
+using IoSyscRRate = PropertyInfo<double, KES_PROPID("process.io_syscr_rate"), "Read Syscalls/s", PropertyFormatter<double>>;
+using IoSyscWRate = PropertyInfo<double, KES_PROPID("process.io_syscw_rate"), "Write Syscalls/s", PropertyFormatter<double>>;
+using IoReadBytesRate = PropertyInfo<double, KES_PROPID("process.io_read_bytes_rate"), "Bytes Read from Storage/s", PropertyFormatter<double>>;
+using IoWriteBytesRate = PropertyInfo<double, KES_PROPID("process.io_write_bytes_rate"), "Bytes Written to Storage/s", PropertyFormatter<double>>;
+using IoCancelledWriteBytesRate = PropertyInfo<double, KES_PROPID("process.io_cancelled_write_bytes_rate"), "Cancelled Write Bytes/s", PropertyFormatter<double>>;
+
+// the /proc/<pid>/fd entries, counted without reading a link
+using FdCount = PropertyInfo<uint64_t, KES_PROPID("process.fd_count"), "Open Files", PropertyFormatter<uint64_t>>;
+
+// the inode numbers the /proc/<pid>/ns links name; the processes of a container share them
+using PidNs = PropertyInfo<uint64_t, KES_PROPID("process.pid_ns"), "PID Namespace", PropertyFormatter<uint64_t>>;
+using MntNs = PropertyInfo<uint64_t, KES_PROPID("process.mnt_ns"), "Mount Namespace", PropertyFormatter<uint64_t>>;
+using NetNs = PropertyInfo<uint64_t, KES_PROPID("process.net_ns"), "Network Namespace", PropertyFormatter<uint64_t>>;
+using UserNs = PropertyInfo<uint64_t, KES_PROPID("process.user_ns"), "User Namespace", PropertyFormatter<uint64_t>>;
+using CgroupNs = PropertyInfo<uint64_t, KES_PROPID("process.cgroup_ns"), "Cgroup Namespace", PropertyFormatter<uint64_t>>;
+// the pid in the innermost pid namespace, and how deeply that one is nested (0 outside of containers)
+using NsPid = PropertyInfo<int, KES_PROPID("process.ns_pid"), "Namespace PID", PropertyFormatter<int>>;
+using NsLevel = PropertyInfo<int, KES_PROPID("process.ns_level"), "Namespace Level", PropertyFormatter<int>>;
+
+// rates between the last two samples, percentages
+using Cpu = PropertyInfo<double, KES_PROPID("process.cpu"), "CPU %", PropertyFormatter<double>>;
+using SystemBusy = PropertyInfo<double, KES_PROPID("system.cpu_busy"), "System CPU Busy %", PropertyFormatter<double>>;
+using SystemIdle = PropertyInfo<double, KES_PROPID("system.cpu_idle"), "System CPU Idle %", PropertyFormatter<double>>;
+
+using Token = PropertyInfo<std::string, KES_PROPID("process.token"), "Generation Token", PropertyFormatter<std::string>>;
+using Resumed = PropertyInfo<bool, KES_PROPID("process.resumed"), "Resumed", PropertyFormatter<bool>>;
+using Filter = PropertyInfo<std::string, KES_PROPID("process.filter"), "Filter", PropertyFormatter<std::string>>;
+using SortBy = PropertyInfo<std::string, KES_PROPID("process.sort_by"), "Sort By", PropertyFormatter<std::string>>;
+using Order = PropertyInfo<std::string, KES_PROPID("process.order"), "Sort Order", PropertyFormatter<std::string>>;
+using Limit = PropertyInfo<int, KES_PROPID("process.limit"), "Limit", PropertyFormatter<int>>;
+using Cursor = PropertyInfo<std::string, KES_PROPID("process.cursor"), "Cursor", PropertyFormatter<std::string>>;
+using NextCursor = PropertyInfo<std::string, KES_PROPID("process.next_cursor"), "Next Cursor", PropertyFormatter<std::string>>;
+using Fields = PropertyInfo<PropertyBag::Array, KES_PROPID("process.fields"), "Fields", NullPropertyFormatter, std::string>;
+// re-read the slow fields now instead of on their cadence
+using Refresh = PropertyInfo<bool, KES_PROPID("process.refresh"), "Refresh", PropertyFormatter<bool>>;
+// "namespace": the processes the filter lets through come in groups as well, one per set of namespaces;
+// a diff carries the groups that changed and the keys of the ones that are gone; the namespaces
+// come with a group the client does not have yet, and the pids when they changed
+using GroupBy = PropertyInfo<std::string, KES_PROPID("process.group_by"), "Group By", PropertyFormatter<std::string>>;
+
+using Group = PropertyInfo<PropertyBag::Table, KES_PROPID("group.group"), "Process Group", NullPropertyFormatter>;
+using GroupList = PropertyInfo<PropertyBag::Array, KES_PROPID("group.group_list"), "Process Group List", NullPropertyFormatter, Group>;
+using DeletedGroup = PropertyInfo<uint64_t, KES_PROPID("group.deleted_group"), "Deleted Group", NullPropertyFormatter>;
+using DeletedGroupList = PropertyInfo<PropertyBag::Array, KES_PROPID("group.deleted_group_list"), "Deleted Group List", NullPropertyFormatter, uint64_t>;
+// the same for the same set of namespaces; 0 for the processes whose namespaces could not be read
+using GroupKey = PropertyInfo<uint64_t, KES_PROPID("group.key"), "Group Key", PropertyFormatter<uint64_t>>;
+using GroupProcesses = PropertyInfo<uint64_t, KES_PROPID("group.processes"), "Processes", PropertyFormatter<uint64_t>>;
+using GroupPid = PropertyInfo<int, KES_PROPID("group.pid"), "PID", PropertyFormatter<int>>;
+using GroupPids = PropertyInfo<PropertyBag::Array, KES_PROPID("group.pids"), "PIDs", NullPropertyFormatter, GroupPid>;
+// the process that is pid 1 of the group's pid namespace, when the group has it
+using GroupLeader = PropertyInfo<int, KES_PROPID("group.leader"), "Init PID", PropertyFormatter<int>>;
+using GroupCpu = PropertyInfo<double, KES_PROPID("group.cpu"), "CPU %", PropertyFormatter<double>>;
+
+// list_threads/diff_threads; the request may name one process with process.pid
+using Thread = PropertyInfo<PropertyBag::Table, KES_PROPID("thread.thread"), "Thread Info", NullPropertyFormatter>;
+using DeletedThread = PropertyInfo<int, KES_PROPID("thread.deleted_thread"), "Deleted Thread", NullPropertyFormatter>;
+using ThreadList = PropertyInfo<PropertyBag::Array, KES_PROPID("thread.thread_list"), "Thread List", NullPropertyFormatter, Thread>;
+using DeletedThreadList = PropertyInfo<PropertyBag::Array, KES_PROPID("thread.deleted_thread_list"), "Deleted Thread List", NullPropertyFormatter, int>;
+
+using ThreadError = PropertyInfo<std::string, KES_PROPID("thread.error"), "__Error", PropertyFormatter<std::string>>;
+using ThreadNewcomer = PropertyInfo<bool, KES_PROPID("thread.newcomer"), "__New", PropertyFormatter<bool>>;
+using Tid = PropertyInfo<int, KES_PROPID("thread.tid"), "TID", PropertyFormatter<int>>;
+using ThreadPid = PropertyInfo<int, KES_PROPID("thread.pid"), "PID", PropertyFormatter<int>>;
+using ThreadComm = PropertyInfo<std::string, KES_PROPID("thread.comm"), "Thread Name", PropertyFormatter<std::string>>;
+using ThreadState = PropertyInfo<std::string, KES_PROPID("thread.state"), "State", PropertyFormatter<std::string>>;
+using ThreadCpu = PropertyInfo<double, KES_PROPID("thread.cpu"), "CPU %", PropertyFormatter<double>>;
+using ThreadProcessor = PropertyInfo<int, KES_PROPID("thread.processor"), "Last CPU", PropertyFormatter<int>>;
+using ThreadWChan = PropertyInfo<std::string, KES_PROPID("thread.wchan"), "Wait Channel", PropertyFormatter<std::string>>;
+using ThreadPriority = PropertyInfo<int64_t, KES_PROPID("thread.priority"), "Priority", PropertyFormatter<int64_t>>;
+using ThreadNice = PropertyInfo<int64_t, KES_PROPID("thread.nice"), "Nice", PropertyFormatter<int64_t>>;
+using ThreadUTime = PropertyInfo<uint64_t, KES_PROPID("thread.utime"), "User Time", PropertyFormatter<uint64_t>>;
+using ThreadSTime = PropertyInfo<uint64_t, KES_PROPID("thread.stime"), "System Time", PropertyFormatter<uint64_t>>;
+
+// list_fds; the request may name one process with process.pid, and pages through the descriptors
+// with process.limit and process.cursor
+using Fd = PropertyInfo<PropertyBag::Table, KES_PROPID("fd.fd"), "File Descriptor Info", NullPropertyFormatter>;
+using FdList = PropertyInfo<PropertyBag::Array, KES_PROPID("fd.fd_list"), "File Descriptor List", NullPropertyFormatter, Fd>;
+// read /proc/<pid>/fdinfo as well
+using FdWithInfo = PropertyInfo<bool, KES_PROPID("fd.with_info"), "With fdinfo", PropertyFormatter<bool>>;
+
+using FdPid = PropertyInfo<int, KES_PROPID("fd.pid"), "PID", PropertyFormatter<int>>;
+using FdNumber = PropertyInfo<int, KES_PROPID("fd.number"), "FD", PropertyFormatter<int>>;
+using FdType = PropertyInfo<std::string, KES_PROPID("fd.type"), "Type", PropertyFormatter<std::string>>;
+using FdTarget = PropertyInfo<std::string, KES_PROPID("fd.target"), "Target", PropertyFormatter<std::string>>;
+using FdInode = PropertyInfo<uint64_t, KES_PROPID("fd.inode"), "Inode", PropertyFormatter<uint64_t>>;
+using FdPos = PropertyInfo<uint64_t, KES_PROPID("fd.pos"), "Position", PropertyFormatter<uint64_t>>;
+using FdFlags = PropertyInfo<uint64_t, KES_PROPID("fd.flags"), "Flags", PropertyFormatter<uint64_t>>;
+using FdMntId = PropertyInfo<int, KES_PROPID("fd.mnt_id"), "Mount ID", PropertyFormatter<int>>;
+
+// list_sockets; the request may pick one table with socket.protocol and one port with socket.local_port
+using Socket = PropertyInfo<PropertyBag::Table, KES_PROPID("socket.socket"), "Socket Info", NullPropertyFormatter>;
+using SocketList = PropertyInfo<PropertyBag::Array, KES_PROPID("socket.socket_list"), "Socket List", NullPropertyFormatter, Socket>;
+// the socket-to-pid index the owners come from; a new one is built when sockets nobody is known to own show up
+using SocketIndexGeneration = PropertyInfo<uint64_t, KES_PROPID("socket.index_generation"), "Socket Index Generation", PropertyFormatter<uint64_t>>;
+
+using SocketProtocol = PropertyInfo<std::string, KES_PROPID("socket.protocol"), "Protocol", PropertyFormatter<std::string>>;
+using SocketLocalAddress = PropertyInfo<std::string, KES_PROPID("socket.local_address"), "Local Address", PropertyFormatter<std::string>>;
+using SocketLocalPort = PropertyInfo<int, KES_PROPID("socket.local_port"), "Local Port", PropertyFormatter<int>>;
+using SocketRemoteAddress = PropertyInfo<std::string, KES_PROPID("socket.remote_address"), "Remote Address", PropertyFormatter<std::string>>;
+using SocketRemotePort = PropertyInfo<int, KES_PROPID("socket.remote_port"), "Remote Port", PropertyFormatter<int>>;
+using SocketState = PropertyInfo<std::string, KES_PROPID("socket.state"), "State", PropertyFormatter<std::string>>;
+using SocketUid = PropertyInfo<int, KES_PROPID("socket.uid"), "User ID", PropertyFormatter<int>>;
+using SocketInode = PropertyInfo<uint64_t, KES_PROPID("socket.inode"), "Inode", PropertyFormatter<uint64_t>>;
+using SocketTxQueue = PropertyInfo<uint64_t, KES_PROPID("socket.tx_queue"), "Send Queue", PropertyFormatter<uint64_t>>;
+using SocketRxQueue = PropertyInfo<uint64_t, KES_PROPID("socket.rx_queue"), "Receive Queue", PropertyFormatter<uint64_t>>;
+using SocketPath = PropertyInfo<std::string, KES_PROPID("socket.path"), "Path", PropertyFormatter<std::string>>;
+using SocketPid = PropertyInfo<int, KES_PROPID("socket.pid"), "PID", PropertyFormatter<int>>;
+using SocketPids = PropertyInfo<PropertyBag::Array, KES_PROPID("socket.pids"), "PIDs", NullPropertyFormatter, SocketPid>;
+
+// list_cgroups; the request may narrow the list down to a subtree with cgroup.path
+using Cgroup = PropertyInfo<PropertyBag::Table, KES_PROPID("cgroup.cgroup"), "Cgroup Info", NullPropertyFormatter>;
+using CgroupList = PropertyInfo<PropertyBag::Array, KES_PROPID("cgroup.cgroup_list"), "Cgroup List", NullPropertyFormatter, Cgroup>;
+
+using CgroupPath = PropertyInfo<std::string, KES_PROPID("cgroup.path"), "Path", PropertyFormatter<std::string>>;
+// sums over the processes of the cgroup and the ones below it, but own_processes, which counts
+// the direct members; cpu is not there before any of them has a rate; the cgroupfs counters
+// below include the processes that are gone
+using CgroupProcesses = PropertyInfo<uint64_t, KES_PROPID("cgroup.processes"), "Processes", PropertyFormatter<uint64_t>>;
+using CgroupOwnProcesses = PropertyInfo<uint64_t, KES_PROPID("cgroup.own_processes"), "Own Processes", PropertyFormatter<uint64_t>>;
+using CgroupCpu = PropertyInfo<double, KES_PROPID("cgroup.cpu"), "CPU %", PropertyFormatter<double>>;
+using CgroupRss = PropertyInfo<uint64_t, KES_PROPID("cgroup.rss"), "Resident Set Size", PropertyFormatter<uint64_t>>;
+// cpu.stat, us
+using CgroupCpuUsage = PropertyInfo<uint64_t, KES_PROPID("cgroup.cpu_usage_usec"), "CPU Time", PropertyFormatter<uint64_t>>;
+using CgroupCpuUser = PropertyInfo<uint64_t, KES_PROPID("cgroup.cpu_user_usec"), "User Time", PropertyFormatter<uint64_t>>;
+using CgroupCpuSystem = PropertyInfo<uint64_t, KES_PROPID("cgroup.cpu_system_usec"), "System Time", PropertyFormatter<uint64_t>>;
+using CgroupCpuNrThrottled = PropertyInfo<uint64_t, KES_PROPID("cgroup.cpu_nr_throttled"), "Throttled Periods", PropertyFormatter<uint64_t>>;
+using CgroupCpuThrottled = PropertyInfo<uint64_t, KES_PROPID("cgroup.cpu_throttled_usec"), "Throttled Time", PropertyFormatter<uint64_t>>;
+// memory.current, bytes
+using CgroupMemoryCurrent = PropertyInfo<uint64_t, KES_PROPID("cgroup.memory_current"), "Memory Usage", PropertyFormatter<uint64_t>>;
+// memory.pressure: % of the time some or all of the tasks stalled on memory, and the total stall in us
+using CgroupMemorySomeAvg10 = PropertyInfo<double, KES_PROPID("cgroup.memory_some_avg10"), "Memory Pressure (some, 10s)", PropertyFormatter<double>>;
+using CgroupMemorySomeAvg60 = PropertyInfo<double, KES_PROPID("cgroup.memory_some_avg60"), "Memory Pressure (some, 60s)", PropertyFormatter<double>>;
+using CgroupMemorySomeAvg300 = PropertyInfo<double, KES_PROPID("cgroup.memory_some_avg300"), "Memory Pressure (some, 300s)", PropertyFormatter<double>>;
+using CgroupMemorySomeTotal = PropertyInfo<uint64_t, KES_PROPID("cgroup.memory_some_total"), "Memory Stall (some)", PropertyFormatter<uint64_t>>;
+using CgroupMemoryFullAvg10 = PropertyInfo<double, KES_PROPID("cgroup.memory_full_avg10"), "Memory Pressure (full, 10s)", PropertyFormatter<double>>;
+using CgroupMemoryFullAvg60 = PropertyInfo<double, KES_PROPID("cgroup.memory_full_avg60"), "Memory Pressure (full, 60s)", PropertyFormatter<double>>;
+using CgroupMemoryFullAvg300 = PropertyInfo<double, KES_PROPID("cgroup.memory_full_avg300"), "Memory Pressure (full, 300s)", PropertyFormatter<double>>;
+using CgroupMemoryFullTotal = PropertyInfo<uint64_t, KES_PROPID("cgroup.memory_full_total"), "Memory Stall (full)", PropertyFormatter<uint64_t>>;
+
+// lookup_symbol takes symbol.addresses, hex strings with or without 0x; find_symbols takes
+// symbol.prefix and process.limit, and sets symbol.more when the limit cut the list short;
+// process.refresh reloads the index if a module came or went
+using SymbolAddresses = PropertyInfo<PropertyBag::Array, KES_PROPID("symbol.addresses"), "Addresses", NullPropertyFormatter, std::string>;
+using SymbolPrefix = PropertyInfo<std::string, KES_PROPID("symbol.prefix"), "Prefix", PropertyFormatter<std::string>>;
+using SymbolMore = PropertyInfo<bool, KES_PROPID("symbol.more"), "More", PropertyFormatter<bool>>;
+// the symbols in the index
+using SymbolCount = PropertyInfo<uint64_t, KES_PROPID("symbol.count"), "Symbol Count", PropertyFormatter<uint64_t>>;
+
+using Symbol = PropertyInfo<PropertyBag::Table, KES_PROPID("symbol.symbol"), "Symbol Info", NullPropertyFormatter>;
+using SymbolList = PropertyInfo<PropertyBag::Array, KES_PROPID("symbol.symbol_list"), "Symbol List", NullPropertyFormatter, Symbol>;
+
+// the address looked up, or where the symbol starts; a lookup below the lowest symbol has nothing else
+using SymbolAddress = PropertyInfo<std::string, KES_PROPID("symbol.address"), "Address", PropertyFormatter<std::string>>;
+using SymbolName = PropertyInfo<std::string, KES_PROPID("symbol.name"), "Name", PropertyFormatter<std::string>>;
+// from the start of the symbol
+using SymbolOffset = PropertyInfo<uint64_t, KES_PROPID("symbol.offset"), "Offset", PropertyFormatter<uint64_t>>;
+// empty for the kernel itself
+using SymbolModule = PropertyInfo<std::string, KES_PROPID("symbol.module"), "Module", PropertyFormatter<std::string>>;
+using SymbolType = PropertyInfo<std::string, KES_PROPID("symbol.type"), "Type", PropertyFormatter<std::string>>;
+
 } // namespace ProcessProps {}
 
 } // namespace Kes {}
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <kesrv/log.hxx>
 
+#include <optional>
+#include <string_view>
 #include <vector>
 
 
@@ -14,6 +16,25 @@ namespace ProcFs
 constexpr pid_t InvalidPid = pid_t(-1);
 constexpr pid_t KernelPid = 0;
 
+// the per-process files a reader may need to look at
+enum FileMask : uint32_t
+{
+    StatFile = 0x01,        // stat, plus the owner of the /proc/<pid> directory
+    CommFile = 0x02,
+    ExeFile = 0x04,         // a readlink
+    CmdLineFile = 0x08,
+    StatmFile = 0x10,
+    StatusFile = 0x20,
+    SmapsFile = 0x40,       // smaps_rollup
+    IoFile = 0x80,          // needs ptrace read access
+    FdDir = 0x100,          // the /proc/<pid>/fd entries counted, no links read; needs ptrace read access
+    NsDir = 0x200,          // the /proc/<pid>/ns links, plus the NSpid line of status; needs ptrace read access
+    AllFiles = 0x3ff
+};
+
+// the files the kernel walks the page tables for; worth reading on a slower cadence than the rest
+constexpr uint32_t SlowFiles = SmapsFile;
+
 struct KESRV_EXPORT Stat
 {
     bool valid = false;
@@ -72,34 +93,247 @@ struct KESRV_EXPORT Stat
     /*50*/ unsigned long env_end = 0;
     /*51*/ int exit_code = 0;
 
-    uint64_t startTime;                                // process start time
+    uint64_t startTime = 0;                            // process start time
     uid_t ruid = uid_t(-1);                              // real user ID of process owner
 
     Stat() = default;
 };
 
 
+// memory detail in bytes; every group comes from its own file
+struct KESRV_EXPORT Memory
+{
+    struct Statm
+    {
+        bool valid = false;
+        uint64_t shared = 0;        // resident file-backed pages
+        uint64_t text = 0;
+        uint64_t data = 0;          // data + stack
+    };
+
+    struct Status
+    {
+        bool valid = false;
+        uint64_t rssAnon = 0;
+        uint64_t rssFile = 0;
+        uint64_t rssShmem = 0;
+        uint64_t swap = 0;
+        // NSpid: the pid in the reader's pid namespace first, the one in the innermost last;
+        // nothing before Linux 4.1
+        std::vector<pid_t> nsPids;
+    };
+
+    struct Smaps
+    {
+        bool valid = false;
+        uint64_t pss = 0;
+        uint64_t pssAnon = 0;       // the Pss_* split needs Linux 5.9+
+        uint64_t pssFile = 0;
+        uint64_t pssShmem = 0;
+        uint64_t swapPss = 0;
+    };
+
+    Statm statm;
+    Status status;
+    Smaps smaps;
+};
+
+
+// /proc/<pid>/io
+struct KESRV_EXPORT IoCounters
+{
+    bool valid = false;
+    uint64_t rchar = 0;                 // bytes passed to read(2) and alike
+    uint64_t wchar = 0;
+    uint64_t syscr = 0;                 // read syscalls
+    uint64_t syscw = 0;
+    uint64_t readBytes = 0;             // fetched from the storage layer
+    uint64_t writeBytes = 0;
+    uint64_t cancelledWriteBytes = 0;   // dirtied, then truncated away before writeback
+};
+
+// IoCounters deltas per second
+struct KESRV_EXPORT IoRates
+{
+    bool valid = false;
+    double rchar = 0;
+    double wchar = 0;
+    double syscr = 0;
+    double syscw = 0;
+    double readBytes = 0;
+    double writeBytes = 0;
+    double cancelledWriteBytes = 0;
+};
+
+
+// the namespaces of a process: the inode numbers the /proc/<pid>/ns links name, 0 for the ones
+// that could not be read; processes in one container have the same ones
+struct KESRV_EXPORT Namespaces
+{
+    enum Kind : unsigned
+    {
+        Pid,
+        Mnt,
+        Net,
+        User,
+        Cgroup,
+        KindCount
+    };
+
+    bool valid = false;                 // any of the links was read
+    uint64_t inodes[KindCount] = {};
+
+    bool operator==(const Namespaces& other) const noexcept = default;
+
+    static const char* kindName(Kind kind) noexcept;
+};
+
+
+// an open file of a process: the /proc/<pid>/fd/<n> link and, when asked for, /proc/<pid>/fdinfo/<n>
+struct KESRV_EXPORT FileDescriptor
+{
+    enum class Type
+    {
+        File,
+        Socket,
+        Pipe,
+        AnonInode,
+        Other
+    };
+
+    int fd = -1;
+    Type type = Type::Other;
+    uint64_t inode = 0;         // of a socket or a pipe
+    std::string target;
+
+    bool infoValid = false;
+    uint64_t pos = 0;
+    uint32_t flags = 0;         // O_* of open(2)
+    int mntId = -1;
+
+    static const char* typeName(Type type) noexcept;
+};
+
+
+// a line of /proc/net/{tcp,tcp6,udp,udp6,unix}; the tables are the ones of the reader's network namespace
+struct KESRV_EXPORT Socket
+{
+    enum class Protocol
+    {
+        Tcp,
+        Tcp6,
+        Udp,
+        Udp6,
+        Unix
+    };
+
+    Protocol protocol = Protocol::Tcp;
+    std::string localAddress;
+    uint16_t localPort = 0;
+    std::string remoteAddress;
+    uint16_t remotePort = 0;
+    uint8_t state = 0;          // TCP_* of the kernel; SS_* for unix sockets
+    bool listening = false;
+    uid_t uid = uid_t(-1);
+    uint64_t inode = 0;         // 0 for a socket no file refers to, e.g. in TIME_WAIT
+    uint64_t txQueue = 0;
+    uint64_t rxQueue = 0;
+    std::string path;           // unix sockets only; abstract ones start with '@'
+
+    static const char* protocolName(Protocol protocol) noexcept;
+    static std::optional<Protocol> protocolFromName(std::string_view name) noexcept;
+    const char* stateName() const noexcept;
+};
+
+
+// the aggregate cpu line of /proc/stat, in clock ticks; guest time is already part of user
+struct KESRV_EXPORT CpuTimes
+{
+    bool valid = false;
+    uint64_t user = 0;
+    uint64_t nice = 0;
+    uint64_t system = 0;
+    uint64_t idle = 0;
+    uint64_t iowait = 0;
+    uint64_t irq = 0;
+    uint64_t softirq = 0;
+    uint64_t steal = 0;
+
+    uint64_t busyTicks() const noexcept
+    {
+        return user + nice + system + irq + softirq + steal;
+    }
+
+    uint64_t idleTicks() const noexcept
+    {
+        return idle + iowait;
+    }
+};
+
+
 class KESRV_EXPORT ProcFs final
 {
 public:
-    explicit ProcFs(Log::ILog* log);
+    static constexpr const char* DefaultRoot = "/proc";
+
+    explicit ProcFs(Log::ILog* log, const std::string& root = DefaultRoot);
 
-    static std::string root();
+    const std::string& root() const noexcept
+    {
+        return m_root;
+    }
 
     Stat readStat(pid_t pid) noexcept;
     std::string readComm(pid_t pid) noexcept;
     std::string readExePath(pid_t pid) noexcept;
     std::string readCmdLine(pid_t pid) noexcept;
 
+    Memory::Statm readStatm(pid_t pid) noexcept;
+    Memory::Status readStatus(pid_t pid) noexcept;
+    Memory::Smaps readSmapsRollup(pid_t pid) noexcept;
+    IoCounters readIo(pid_t pid) noexcept;
+
     std::vector<pid_t> enumeratePids() noexcept;
 
-    uint64_t getBootTime() noexcept;
+    // /proc/<pid>/task/<tid>; the stat of a thread has the same layout as the one of a process
+    std::vector<pid_t> enumerateTids(pid_t pid) noexcept;
+    Stat readTaskStat(pid_t pid, pid_t tid) noexcept;
+    // the kernel function a thread sleeps in, empty for a running one
+    std::string readWChan(pid_t pid, pid_t tid) noexcept;
+
+    // the numbers in /proc/<pid>/fd, unordered; nothing if the directory cannot be read, which
+    // takes ptrace read access to the process
+    std::optional<std::vector<int>> enumerateFds(pid_t pid) noexcept;
+    // the same directory walk, only counted
+    std::optional<uint64_t> countFds(pid_t pid) noexcept;
+    // the links of 'fds', and their fdinfo if 'info' is set; the ones closed meanwhile are left out
+    std::vector<FileDescriptor> readFds(pid_t pid, const std::vector<int>& fds, bool info) noexcept;
+
+    // the unified hierarchy ("0::<path>") line of /proc/<pid>/cgroup; nothing for a process that is gone
+    // or lives on a cgroup v1 only system
+    std::optional<std::string> readCgroup(pid_t pid) noexcept;
+
+    Namespaces readNamespaces(pid_t pid) noexcept;
+
+    std::vector<Socket> readSockets(Socket::Protocol protocol) noexcept;
+
+    CpuTimes readCpuTimes() noexcept;
+
+    // read once by the constructor: instances are shared by worker threads
+    uint64_t getBootTime() const noexcept
+    {
+        return m_bootTime;
+    }
 
 private:
+    Stat readStatAt(std::string&& path, pid_t pid) noexcept;
+    std::vector<pid_t> enumerateNumeric(const std::string& path, const char* what) noexcept;
     uint64_t getBootTimeImpl() noexcept;
     uint64_t fromRelativeTime(uint64_t relative) noexcept;
 
     Log::ILog* m_log;
+    std::string m_root;
+    uint64_t m_bootTime = 0;
 };
 
 
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <atomic>
+
+
+namespace Kes
+{
+
+namespace Snapshot
+{
+
+//
+// the process table published in POSIX shared memory for same-host readers
+//
+// the region is a Header followed by two Buffers; the writer fills the buffer the header does
+// not point at, then advances Header::generation, so readers normally copy a buffer nobody
+// writes to; each buffer also carries a seqlock (odd while being written), which catches
+// a reader that is still copying when the writer comes back to that buffer two scans later;
+// integers are in native byte order: the region never leaves the host
+//
+
+constexpr char Magic[8] = { 'K', 'E', 'S', 'S', 'H', 'M', '\x01', '\0' };
+constexpr uint32_t Version = 1;
+constexpr const char* DefaultName = "/kexplorer";
+
+constexpr size_t Alignment = 64; // buffers start on their own cache lines
+
+
+enum class State : uint32_t
+{
+    Starting,
+    Live,
+    Closed          // the writer has gone; the name may already refer to a newer region
+};
+
+
+enum ProcessFlags : uint32_t
+{
+    ProcessValid = 0x1      // the process could be read; 'error' is set otherwise
+};
+
+
+enum BufferFlags : uint32_t
+{
+    BufferTruncated = 0x1   // some processes or strings did not fit
+};
+
+
+// a string in the string area of the same buffer, not NUL-terminated
+struct StringRef
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+
+struct Process
+{
+    int32_t pid;
+    int32_t ppid;
+    int32_t pgrp;
+    int32_t tpgid;
+    int32_t session;
+    int32_t ruid;
+    uint32_t flags;         // ProcessFlags
+    uint32_t reserved;
+    StringRef comm;
+    StringRef statComm;
+    StringRef exe;
+    StringRef cmdLine;
+    StringRef error;
+};
+
+
+// followed by Process records[Header::capacity], then char strings[Header::stringCapacity]
+struct Buffer
+{
+    std::atomic<uint64_t> sequence;     // seqlock: odd while the buffer is being written
+    uint64_t generation;                // the generation this buffer was written for
+    uint64_t timestamp;                 // CLOCK_REALTIME nanoseconds of the scan
+    uint32_t count;                     // valid Process records
+    uint32_t flags;                     // BufferFlags
+    uint64_t stringsUsed;
+};
+
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t processSize;
+    uint32_t capacity;                  // Process records per buffer
+    uint64_t stringCapacity;            // string bytes per buffer
+    uint64_t bufferOffset[2];
+    uint64_t bufferSize;
+    uint64_t regionSize;
+    int64_t writerPid;
+    std::atomic<uint32_t> state;        // State
+    uint32_t reserved;
+    std::atomic<uint64_t> generation;   // buffer (generation & 1) is current; 0 until the first scan
+};
+
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free, "Shared atomics must be lock-free");
+static_assert(std::is_standard_layout_v<Process> && (sizeof(Process) == 72));
+static_assert(std::is_standard_layout_v<Buffer> && (sizeof(Buffer) == 40));
+static_assert(std::is_standard_layout_v<Header>);
+
+
+constexpr uint64_t align(uint64_t size) noexcept
+{
+    return (size + Alignment - 1) & ~uint64_t(Alignment - 1);
+}
+
+constexpr uint64_t headerSize() noexcept
+{
+    return align(sizeof(Header));
+}
+
+constexpr uint64_t bufferSize(uint32_t capacity, uint64_t stringCapacity) noexcept
+{
+    return align(sizeof(Buffer) + uint64_t(capacity) * sizeof(Process) + stringCapacity);
+}
+
+constexpr uint64_t regionSize(uint32_t capacity, uint64_t stringCapacity) noexcept
+{
+    return headerSize() + 2 * bufferSize(capacity, stringCapacity);
+}
+
+
+inline Process* processes(Buffer* buffer) noexcept
+{
+    return reinterpret_cast<Process*>(buffer + 1);
+}
+
+inline const Process* processes(const Buffer* buffer) noexcept
+{
+    return reinterpret_cast<const Process*>(buffer + 1);
+}
+
+inline char* strings(Buffer* buffer, uint32_t capacity) noexcept
+{
+    return reinterpret_cast<char*>(processes(buffer) + capacity);
+}
+
+inline const char* strings(const Buffer* buffer, uint32_t capacity) noexcept
+{
+    return reinterpret_cast<const char*>(processes(buffer) + capacity);
+}
+
+
+} // namespace Snapshot {}
+
+} // namespace Kes {}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <kesrv/condition.hxx>
+#include <kesrv/log.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+#include <kesrv/processmanager/snapshot.hxx>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+struct SnapshotOptions
+{
+    std::string name = Snapshot::DefaultName;
+    std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+    uint32_t capacity = 32768;                      // processes per snapshot
+    uint64_t stringCapacity = 8 * 1024 * 1024;      // string bytes per snapshot
+    std::string group;                              // name or gid allowed to read the region; empty for the owner only
+};
+
+
+//
+// publishes the process table into a POSIX shared-memory region (see snapshot.hxx) from the
+// scans of the ProcessManager; the region is removed by the destructor
+//
+// the region is created mode 0600, or 0640 with SnapshotOptions::group; an existing region
+// is replaced only if it is a snapshot region of the same user whose writer is gone
+//
+
+class KESRV_EXPORT SnapshotPublisher final
+    : public IScanListener
+    , public boost::noncopyable
+{
+public:
+    ~SnapshotPublisher();
+    explicit SnapshotPublisher(Log::ILog* log, ProcessManager* processes, const std::string& procFsRoot, const SnapshotOptions& options = SnapshotOptions());
+
+    // publishes every 'interval' until stopped
+    void start();
+    void stop() noexcept;
+
+    // publishes the last scan unless it is already out; the ProcessManager samples the stats
+    // for it if no scan is 'interval' recent; not to be mixed with start()
+    void publish();
+
+    void scanned(const std::vector<IScanListener::Process>& processes, uint64_t time) override;
+
+    uint64_t generation() const noexcept
+    {
+        return m_header->generation.load(std::memory_order_relaxed);
+    }
+
+private:
+    // what the scans do not read; kept until the process execs or goes away
+    struct Details
+    {
+        uint64_t startTicks = 0;
+        std::string statComm;
+        uint64_t generation = 0;            // of the last snapshot that had the process
+        std::string comm;
+        std::string exe;
+        std::string cmdLine;
+    };
+
+    void run() noexcept;
+    const Details& details(const IScanListener::Process& process, uint64_t generation);
+    Snapshot::StringRef addString(Snapshot::Buffer* buffer, const std::string& s) noexcept;
+
+    Log::ILog* m_log;
+    ProcessManager* m_processes;
+    SnapshotOptions m_options;
+    ProcFs::ProcFs m_procFs;
+    std::unordered_map<pid_t, Details> m_details;
+    std::mutex m_sampleMutex;
+    std::vector<IScanListener::Process> m_sample;
+    bool m_sampled = false;                 // m_sample is not out yet
+    uint64_t m_size = 0;
+    void* m_region = nullptr;
+    Snapshot::Header* m_header = nullptr;
+    Condition m_stop;
+    std::unique_ptr<std::thread> m_thread;
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <kesrv/log.hxx>
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace ProcFs
+{
+
+//
+// the symbols of /proc/kallsyms, the ones of the loaded modules included, sorted by address:
+// fixed-size entries that refer to one pool of NUL-terminated names, plus the entry numbers in
+// name order for prefix searches; about 16 bytes per symbol on top of its name
+//
+// an index can be saved to a cache file that carries the key of the kernel build and module
+// set it was made for; loading it again is a single mmap, the arrays are used where they lie;
+// integers are in native byte order: the file never leaves the host
+//
+
+class KESRV_EXPORT SymbolIndex final
+    : public boost::noncopyable
+{
+public:
+    static constexpr char CacheMagic[8] = { 'K', 'E', 'S', 'S', 'Y', 'M', '\x01', '\0' };
+    static constexpr uint32_t CacheVersion = 2;
+
+    struct Symbol
+    {
+        uint64_t address = 0;
+        char type = '?';                // as nm(1) prints it: T, t, D, ...
+        std::string_view name;
+        std::string_view module;        // empty for the kernel itself
+    };
+
+    ~SymbolIndex();
+    SymbolIndex() noexcept = default;
+
+    // 'path' is kallsyms; 'modulesPath' the modules file that tells where the modules end, if
+    // any; throws Kes::Exception if kallsyms cannot be read
+    static std::unique_ptr<SymbolIndex> load(const std::string& path, const std::string& modulesPath = std::string());
+
+    // nothing if the file is not there, is not a cache or was made for another key
+    static std::unique_ptr<SymbolIndex> map(const std::string& cachePath, uint64_t key, Log::ILog* log) noexcept;
+
+    // written next to the target, then renamed over it; false on failure
+    bool save(const std::string& cachePath, uint64_t key, Log::ILog* log) const noexcept;
+
+    // tells the kernel builds, boots and module sets apart: a hash of sys/kernel/{osrelease,version},
+    // of sys/kernel/random/boot_id and of the modules file under 'procFsRoot'
+    static uint64_t kernelKey(const std::string& procFsRoot) noexcept;
+
+    size_t size() const noexcept
+    {
+        return m_count;
+    }
+
+    bool mapped() const noexcept
+    {
+        return m_region != nullptr;
+    }
+
+    // every address reads as 0 when kptr_restrict hides them from the reader
+    bool addressesHidden() const noexcept
+    {
+        return m_count && !m_entries[m_count - 1].address;
+    }
+
+    // the symbol at or below 'address', the global one of those sharing an address; a symbol
+    // reaches up to the next one, the last of a module up to the end of the module (only its own
+    // address if that is not known) and the last of the kernel, _end, only its own address;
+    // nothing outside of those
+    std::optional<Symbol> lookup(uint64_t address) const noexcept;
+
+    // at most 'limit' symbols whose names start with 'prefix', in name order; 'more' tells if
+    // the limit cut the list short
+    std::vector<Symbol> findPrefix(std::string_view prefix, size_t limit, bool& more) const;
+
+private:
+    struct Entry
+    {
+        uint64_t address;
+        uint32_t name;          // offset in the pool
+        uint16_t module;        // index in the module table, 0 = the kernel
+        char type;
+        uint8_t reserved;
+    };
+
+    static_assert(sizeof(Entry) == 16);
+
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t entrySize;
+        uint64_t key;
+        uint64_t count;         // followed by Entry[count], uint64_t moduleEnds[modules],
+        uint64_t modules;       // uint32_t byName[count], uint32_t modules[modules] (pool
+        uint64_t poolSize;      // offsets of the names) and char pool[poolSize]
+    };
+
+    Symbol symbolAt(uint32_t index) const noexcept;
+    void attach() noexcept;
+
+    // what load() builds; empty for a mapped index
+    std::vector<Entry> m_ownedEntries;
+    std::vector<uint32_t> m_ownedByName;
+    std::vector<uint32_t> m_ownedModules;
+    std::vector<uint64_t> m_ownedModuleEnds;
+    std::vector<char> m_ownedPool;
+
+    // either the vectors above or the mapped cache
+    const Entry* m_entries = nullptr;
+    const uint32_t* m_byName = nullptr;
+    const uint32_t* m_modules = nullptr;
+    const uint64_t* m_moduleEnds = nullptr;     // 0 if not known; always for the kernel
+    const char* m_pool = nullptr;
+    size_t m_count = 0;
+    size_t m_moduleCount = 0;
+    size_t m_poolSize = 0;
+
+    void* m_region = nullptr;
+    size_t m_regionSize = 0;
+};
+
+
+} // namespace ProcFs {}
+
+} // namespace Kes {}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <kesrv/log.hxx>
+#include <kesrv/requestprocessor.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+#include <kesrv/processmanager/symbolindex.hxx>
+
+#include <mutex>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// lookup_symbol: the kernel symbol and the offset into it of every address in symbol.addresses;
+// find_symbols: at most process.limit symbols whose names start with symbol.prefix, by name
+//
+// the index is built on the first request and kept: taken from the cache file if one was made
+// for the running kernel and module set, otherwise parsed out of kallsyms (and saved to the cache
+// then); a failed load is retried by the next request; process.refresh reloads the index if the
+// module set changed since
+//
+
+class KESRV_EXPORT SymbolManager final
+    : public IRequestHandler
+{
+public:
+    static constexpr size_t DefaultLimit = 100;
+    static constexpr size_t MaxLimit = 10000;
+
+    ~SymbolManager();
+    explicit SymbolManager(IRequestProcessor* rp, Log::ILog* log, const std::string& procFsRoot = ProcFs::ProcFs::DefaultRoot, const std::string& cachePath = std::string());
+
+    SymbolManager(const SymbolManager&) = delete;
+    SymbolManager& operator=(const SymbolManager&) = delete;
+
+    SymbolManager(SymbolManager&&) = delete;
+    SymbolManager& operator=(SymbolManager&&) = delete;
+
+    bool process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response) override;
+    // the index is the same for every session
+    void startSession(uint32_t) override {}
+    void endSession(uint32_t) override {}
+
+private:
+    // nullptr and the reason if there is no index
+    const ProcFs::SymbolIndex* index(const PropertyBag& request, std::string& error);
+    bool lookupSymbol(const ProcFs::SymbolIndex& index, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
+    bool findSymbols(const ProcFs::SymbolIndex& index, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
+
+    IRequestProcessor* m_rp;
+    Log::ILog* m_log;
+    std::string m_procFsRoot;
+    std::string m_cachePath;                            // empty for no cache
+    std::unique_ptr<ProcFs::SymbolIndex> m_index;
+    uint64_t m_key = 0;                                 // of the kernel m_index was made for
+    std::mutex m_mutex;
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
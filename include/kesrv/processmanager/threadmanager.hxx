@@ -0,0 +1,143 @@
+#pragma once
+
+#include <kesrv/log.hxx>
+#include <kesrv/requestprocessor.hxx>
+#include <kesrv/processmanager/cpusampler.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// list_threads/diff_threads: the threads of one process (process.pid) or of all of them;
+// a diff only carries the threads that changed since the previous response of the session,
+// the new ones flagged, and the tids that are gone;
+// a scan enumerates the task directories and then reads the thread stats, both spread over
+// the worker threads once there is enough to read; the workers are started with the manager
+// and wait for the next scan between them; a thread that has not run since the
+// previous scan is assumed to still wait where it did, so its wchan is not read again
+//
+
+class KESRV_EXPORT ThreadManager final
+    : public IRequestHandler
+{
+public:
+    static constexpr size_t MaxWorkers = 8;
+    static constexpr size_t MinTasksPerWorker = 256;   // reading fewer is not worth a thread
+
+    ~ThreadManager();
+    explicit ThreadManager(IRequestProcessor* rp, Log::ILog* log, const std::string& procFsRoot = ProcFs::ProcFs::DefaultRoot, size_t workers = 0);
+
+    ThreadManager(const ThreadManager&) = delete;
+    ThreadManager& operator=(const ThreadManager&) = delete;
+
+    ThreadManager(ThreadManager&&) = delete;
+    ThreadManager& operator=(ThreadManager&&) = delete;
+
+    bool process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response) override;
+    void startSession(uint32_t id) override;
+    void endSession(uint32_t id) override;
+
+private:
+    struct ThreadInfo
+    {
+        pid_t pid = ProcFs::InvalidPid;
+        uint32_t timestamp = 0;
+        uint32_t digest = 0;
+        double cpu = -1;
+        ProcFs::Stat stat;
+        std::string wchan;
+
+        PropertyBag serialize(bool newcomer) const;
+        uint32_t computeDigest() const noexcept;
+    };
+
+    struct Session
+    {
+        using Ptr = std::unique_ptr<Session>;
+
+        explicit Session(uint32_t id) noexcept
+            : sessionId(id)
+        {}
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        uint32_t sessionId;
+        uint32_t timestamp = 0;
+        std::unordered_map<pid_t, ThreadInfo> threads;  // by tid
+    };
+
+    // what a worker reads for one thread
+    struct Task
+    {
+        pid_t pid;
+        pid_t tid;
+        uint64_t time = 0;
+        bool wchanRead = false;
+        ProcFs::Stat stat;
+        std::string wchan;
+    };
+
+    // the threads that help the calling one with a scan
+    class Pool final
+    {
+    public:
+        using Job = std::function<void(size_t, size_t)>;
+
+        ~Pool();
+        explicit Pool(size_t threads);
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        // calls job(begin, end) for chunks of [0, count) on the calling thread and up to 'helpers' pool threads
+        void parallelFor(size_t count, size_t helpers, size_t chunk, const Job& job);
+
+    private:
+        void worker() noexcept;
+        void drain() noexcept;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeup;
+        std::condition_variable m_done;
+        std::vector<std::thread> m_threads;
+        bool m_stop = false;
+        uint64_t m_generation = 0;                      // of the current job
+        size_t m_wanted = 0;                            // helpers the current job still takes
+        size_t m_busy = 0;                              // helpers working on it
+        const Job* m_job = nullptr;
+        size_t m_count = 0;
+        size_t m_chunk = 0;
+        std::atomic<size_t> m_next{0};
+    };
+
+    bool listThreads(bool initial, Session* session, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response);
+    std::vector<Task> scan(const Session* session, const std::vector<pid_t>& pids);
+    size_t workersFor(size_t items) const noexcept;
+
+    IRequestProcessor* m_rp;
+    Log::ILog* m_log;
+    ProcFs::ProcFs m_procFs;
+    const size_t m_workers;
+    CpuSampler m_cpu;                                   // by tid
+    std::mutex m_mutex;
+    std::unordered_map<uint32_t, Session::Ptr> m_sessions;
+    Pool m_pool;                                        // m_workers - 1 threads
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
@@ -124,6 +124,12 @@ struct PropertyFormatter<T, std::enable_if_t<std::is_integral<T>::value && !std:
     void operator()(const Property& v, std::ostream& s) { s << std::any_cast<T>(v.value); }
 };
 
+template <typename T>
+struct PropertyFormatter<T, std::enable_if_t<std::is_floating_point<T>::value>>
+{
+    void operator()(const Property& v, std::ostream& s) { s << std::any_cast<T>(v.value); }
+};
+
 template <typename T>
 struct PropertyFormatter<T, std::enable_if_t<std::is_same<T, std::string>::value>>
 {
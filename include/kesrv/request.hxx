@@ -15,6 +15,7 @@ namespace Props
 
 using Id = PropertyInfo<Request::Id, KES_PROPID("request.id"), "RequestId", PropertyFormatter<Request::Id>>;
 using Command = PropertyInfo<std::string, KES_PROPID("request.request"), "Request", PropertyFormatter<std::string>>;
+using Trace = PropertyInfo<bool, KES_PROPID("request.trace"), "Trace", PropertyFormatter<bool>>;
 
 } // namespace Props {}
 
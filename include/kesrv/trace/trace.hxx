@@ -0,0 +1,157 @@
+#pragma once
+
+#include <kesrv/propertybag.hxx>
+#include <kesrv/util/clock.hxx>
+
+
+namespace Kes
+{
+
+namespace Trace
+{
+
+// timings of the request framing, taken by the session for every request (a TSC read or two)
+// since only the parsed request tells whether it is traced
+struct Frame
+{
+    uint64_t received = 0;   // ticks when the first byte of the request arrived
+    uint64_t detection = 0;  // ticks spent looking for the request boundaries
+    uint64_t framed = 0;     // ticks when its end was found
+};
+
+
+//
+// per-request timing breakdown, active only for requests with "request.trace": true;
+// instrumented code looks it up with Context::current() and does nothing when it is null
+//
+
+class KESRV_EXPORT Context final
+    : public boost::noncopyable
+{
+public:
+    static constexpr size_t MaxFiles = 16;
+
+    struct File
+    {
+        const char* name = nullptr; // static string
+        uint64_t ticks = 0;
+        uint32_t count = 0;
+    };
+
+    explicit Context(const Frame& frame, uint64_t parseStarted, uint64_t parsed) noexcept
+        : m_frame(frame)
+        , m_parseStarted(parseStarted)
+        , m_parsed(parsed)
+    {
+    }
+
+    static Context* current() noexcept
+    {
+        return slot();
+    }
+
+    void addFile(const char* name, uint64_t ticks) noexcept
+    {
+        for (size_t i = 0; i < m_fileCount; ++i)
+        {
+            if (m_files[i].name == name)
+            {
+                m_files[i].ticks += ticks;
+                ++m_files[i].count;
+                return;
+            }
+        }
+
+        if (m_fileCount < MaxFiles)
+            m_files[m_fileCount++] = { name, ticks, 1 };
+    }
+
+    void handled(uint64_t ticks) noexcept
+    {
+        m_handled = ticks;
+    }
+
+    void serialized(uint64_t ticks) noexcept
+    {
+        m_serialized = ticks;
+    }
+
+    // the "response.trace" table, durations in nanoseconds
+    PropertyBag serialize() const;
+
+    // appends the trace to an already serialized JSON response object
+    void appendTo(std::string& response) const;
+
+    // makes a context current for the calling thread
+    class Activate final
+        : public boost::noncopyable
+    {
+    public:
+        ~Activate()
+        {
+            slot() = m_prev;
+        }
+
+        explicit Activate(Context* context) noexcept
+            : m_prev(slot())
+        {
+            slot() = context;
+        }
+
+    private:
+        Context* m_prev;
+    };
+
+private:
+    static Context*& slot() noexcept
+    {
+        thread_local Context* t_current = nullptr;
+        return t_current;
+    }
+
+    Frame m_frame;
+    uint64_t m_parseStarted;
+    uint64_t m_parsed;
+    uint64_t m_handled = 0;
+    uint64_t m_serialized = 0;
+    File m_files[MaxFiles];
+    size_t m_fileCount = 0;
+};
+
+
+//
+// accounts the scope duration to a file in the current trace context, if any
+//
+
+class FileScope final
+    : public boost::noncopyable
+{
+public:
+    ~FileScope()
+    {
+        if (m_context)
+            m_context->addFile(m_name, Util::Clock::ticks() - m_started);
+    }
+
+    explicit FileScope(const char* name) noexcept
+        : m_context(Context::current())
+        , m_name(name)
+        , m_started(m_context ? Util::Clock::ticks() : 0)
+    {
+    }
+
+private:
+    Context* m_context;
+    const char* m_name;
+    uint64_t m_started;
+};
+
+
+// the session hands the framing timings to the request processor through the calling thread
+KESRV_EXPORT void setFrame(const Frame& frame) noexcept;
+KESRV_EXPORT const Frame& frame() noexcept;
+
+
+} // namespace Trace {}
+
+} // namespace Kes {}
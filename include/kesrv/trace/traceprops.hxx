@@ -0,0 +1,36 @@
+#pragma once
+
+#include <kesrv/propertybag.hxx>
+
+namespace Kes
+{
+
+namespace TraceProps
+{
+
+namespace Private
+{
+
+void registerAll();
+
+} // namespace Private {}
+
+
+// all durations are in nanoseconds
+using Trace = PropertyInfo<PropertyBag::Table, KES_PROPID("response.trace"), "Trace", NullPropertyFormatter>;
+using Frame = PropertyInfo<uint64_t, KES_PROPID("trace.frame"), "Frame Detection", PropertyFormatter<uint64_t>>;
+using Queue = PropertyInfo<uint64_t, KES_PROPID("trace.queue"), "Queueing", PropertyFormatter<uint64_t>>;
+using Parse = PropertyInfo<uint64_t, KES_PROPID("trace.parse"), "JSON Parse", PropertyFormatter<uint64_t>>;
+using Handler = PropertyInfo<uint64_t, KES_PROPID("trace.handler"), "Handler", PropertyFormatter<uint64_t>>;
+using Serialize = PropertyInfo<uint64_t, KES_PROPID("trace.serialize"), "Serialization", PropertyFormatter<uint64_t>>;
+using Clock = PropertyInfo<std::string, KES_PROPID("trace.clock"), "Clock Source", PropertyFormatter<std::string>>;
+
+using File = PropertyInfo<PropertyBag::Table, KES_PROPID("trace.file"), "File Reads", NullPropertyFormatter>;
+using FileList = PropertyInfo<PropertyBag::Array, KES_PROPID("trace.files"), "File Read List", NullPropertyFormatter, File>;
+using FileName = PropertyInfo<std::string, KES_PROPID("trace.name"), "File", PropertyFormatter<std::string>>;
+using FileReads = PropertyInfo<uint64_t, KES_PROPID("trace.count"), "Reads", PropertyFormatter<uint64_t>>;
+using FileTime = PropertyInfo<uint64_t, KES_PROPID("trace.time"), "Read Time", PropertyFormatter<uint64_t>>;
+
+} // namespace TraceProps {}
+
+} // namespace Kes {}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define KES_HAS_TSC 1
+#else
+    #define KES_HAS_TSC 0
+#endif
+
+
+namespace Kes
+{
+
+namespace Util
+{
+
+namespace Clock
+{
+
+//
+// cheap monotonic timestamps for tracing: TSC ticks when the TSC is invariant,
+// CLOCK_MONOTONIC_RAW nanoseconds otherwise; use nanoseconds() to convert intervals
+//
+
+KESRV_EXPORT bool detectInvariantTsc() noexcept;
+
+inline bool usesTsc() noexcept
+{
+    static const bool tsc = detectInvariantTsc();
+    return tsc;
+}
+
+inline uint64_t ticks() noexcept
+{
+#if KES_HAS_TSC
+    if (usesTsc())
+        return __rdtsc();
+#endif
+
+    struct timespec ts = {};
+    ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+// the first call with the TSC in use calibrates it (a few milliseconds)
+KESRV_EXPORT uint64_t nanoseconds(uint64_t ticks) noexcept;
+
+} // namespace Clock {}
+
+} // namespace Util {}
+
+} // namespace Kes {}
@@ -286,6 +286,17 @@ inline constexpr uint32_t crc32(const char* str) noexcept
     return c ^ 0xFFFFFFFF;
 }
 
+// incremental: pass the previous result as 'crc' to continue
+inline constexpr uint32_t crc32(const void* data, size_t size, uint32_t crc = 0) noexcept
+{
+    auto p = static_cast<const unsigned char*>(data);
+    uint32_t c = crc ^ 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i)
+        c = g_Crc32Table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+
+    return c ^ 0xFFFFFFFF;
+}
+
 } // namespace Util {}
 
 } // namespace Kes {}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <kesrv/exception.hxx>
+
+
+namespace Kes
+{
+
+namespace Util
+{
+
+//
+// finds the boundaries of JSON objects sent back to back over a stream;
+// braces inside string literals are skipped, the scan state survives partial reads
+//
+
+class JsonFramer final
+{
+public:
+    static constexpr size_t Incomplete = size_t(-1);
+
+    // scans data[begin, end) continuing from the previous call; returns the offset just past
+    // the closing brace of the first complete top-level object, or Incomplete
+    size_t next(const char* data, size_t begin, size_t end)
+    {
+        for (auto pos = begin; pos < end; ++pos)
+        {
+            auto c = data[pos];
+
+            if (m_inString)
+            {
+                if (m_escape)
+                    m_escape = false;
+                else if (c == '\\')
+                    m_escape = true;
+                else if (c == '"')
+                    m_inString = false;
+            }
+            else if (c == '"')
+            {
+                if (m_depth > 0)
+                    m_inString = true;
+            }
+            else if (c == '{')
+            {
+                ++m_depth;
+            }
+            else if (c == '}')
+            {
+                if (m_depth == 0)
+                    throw Exception(KES_HERE(), "Invalid JSON");
+
+                if (--m_depth == 0)
+                    return pos + 1;
+            }
+        }
+
+        return Incomplete;
+    }
+
+    // true if an object has been started but not finished
+    bool inProgress() const noexcept
+    {
+        return m_depth > 0;
+    }
+
+    void reset() noexcept
+    {
+        m_depth = 0;
+        m_inString = false;
+        m_escape = false;
+    }
+
+private:
+    size_t m_depth = 0;
+    bool m_inString = false;
+    bool m_escape = false;
+};
+
+
+} // namespace Util {}
+
+} // namespace Kes {}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <atomic>
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace Util
+{
+
+//
+// bounded lock-free multi-producer single-consumer ring
+// (D. Vyukov's sequenced cells; producers never block, a full ring rejects the item)
+//
+
+template <typename T>
+class MpscRing final
+    : public boost::noncopyable
+{
+    static_assert(std::is_default_constructible_v<T>);
+
+public:
+    explicit MpscRing(size_t capacity)
+        : m_cells(roundUp(capacity))
+        , m_mask(m_cells.size() - 1)
+    {
+        for (size_t i = 0; i < m_cells.size(); ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const noexcept
+    {
+        return m_cells.size();
+    }
+
+    // approximate number of items waiting for the consumer
+    size_t size() const noexcept
+    {
+        auto head = m_enqueuePos.load(std::memory_order_relaxed);
+        auto tail = m_dequeuePos.load(std::memory_order_relaxed);
+        return (head > tail) ? (head - tail) : 0;
+    }
+
+    // fill(T&) is called on the reserved cell; it must not throw
+    template <typename FillT>
+    bool push(FillT&& fill) noexcept
+    {
+        Cell* cell = nullptr;
+        auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(cell->data);
+
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only: collect up to 'max' published items without releasing them
+    size_t peek(T** out, size_t max) noexcept
+    {
+        auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while (count < max)
+        {
+            auto& cell = m_cells[(pos + count) & m_mask];
+            auto seq = cell.sequence.load(std::memory_order_acquire);
+            if (seq != pos + count + 1)
+                break;
+
+            out[count++] = &cell.data;
+        }
+
+        return count;
+    }
+
+    // consumer only: hand 'count' peeked cells back to the producers
+    void release(size_t count) noexcept
+    {
+        auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto& cell = m_cells[(pos + i) & m_mask];
+            cell.sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+        }
+
+        m_dequeuePos.store(pos + count, std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t roundUp(size_t v) noexcept
+    {
+        size_t r = 2;
+        while (r < v)
+            r <<= 1;
+        return r;
+    }
+
+    std::vector<Cell> m_cells;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePos = 0;
+    alignas(64) std::atomic<size_t> m_dequeuePos = 0;
+};
+
+
+} // namespace Util {}
+
+} // namespace Kes {}
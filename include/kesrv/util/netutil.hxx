@@ -2,6 +2,8 @@
 
 #include <kesrv/kesrv.hxx>
 
+#include <vector>
+
 
 namespace Kes
 {
@@ -9,9 +11,21 @@ namespace Kes
 namespace Util
 {
 
+// unix domain socket addresses: unix:/path/to/socket, or unix:@name for the abstract namespace
+constexpr const char LocalAddressPrefix[] = "unix:";
+
 KESRV_EXPORT std::pair<std::string, uint16_t> splitAddress(const std::string& s);
 KESRV_EXPORT boost::asio::ip::tcp::endpoint endpointFromString(const std::string& s);
 
+KESRV_EXPORT bool isLocalAddress(const std::string& s) noexcept;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+KESRV_EXPORT boost::asio::local::stream_protocol::endpoint localEndpointFromString(const std::string& s);
+#endif
+
+// either kind of address, resolved into endpoints a generic stream socket can connect to
+KESRV_EXPORT std::vector<boost::asio::generic::stream_protocol::endpoint> resolveEndpoints(boost::asio::io_context& io, const std::string& s);
+
 
 } // namespace Util {}
 
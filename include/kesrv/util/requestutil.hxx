@@ -99,6 +99,19 @@ void addToArray(PropertyBag& array, PropertyBag&& val)
     array.array().push_back(std::make_unique<PropertyBag>(std::move(val)));
 }
 
+// a scalar property of a table; nullptr if it is absent or of another type
+template <typename PropertyInfoT>
+const typename PropertyInfoT::ValueType* findInTable(const PropertyBag& table) noexcept
+{
+    assert(table.isTable());
+
+    auto it = table.table().find(PropertyInfoT::idstr());
+    if ((it == table.table().end()) || !it->second->isProperty())
+        return nullptr;
+
+    return std::any_cast<typename PropertyInfoT::ValueType>(&it->second->property().value);
+}
+
 } // namespace Util {}
 
 } // namespace Kes {}
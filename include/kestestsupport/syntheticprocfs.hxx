@@ -0,0 +1,128 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <random>
+#include <vector>
+
+
+namespace Kes
+{
+
+namespace ProcFs
+{
+
+//
+// a fake procfs tree, with a cgroupfs tree under it, for the tests and the benchmarks; the
+// files are described next to their writers; the tree is removed by the destructor
+//
+
+class SyntheticProcFs final
+    : public boost::noncopyable
+{
+public:
+    static constexpr pid_t FirstPid = 1000;
+
+    ~SyntheticProcFs();
+
+    // 'root' must not exist or be empty
+    explicit SyntheticProcFs(const std::string& root, size_t processes, unsigned seed = 1);
+
+    const std::string& root() const noexcept
+    {
+        return m_root;
+    }
+
+    // the cgroupfs mount point to read the cgroups of the processes under
+    const std::string& cgroupRoot() const noexcept
+    {
+        return m_cgroupRoot;
+    }
+
+    const std::vector<pid_t>& pids() const noexcept
+    {
+        return m_pids;
+    }
+
+    // replaces 'count' random processes with new ones (new pids are never reused);
+    // the surviving processes and the system accumulate some CPU time, and every process
+    // reads IoReadStep and writes IoWriteStep more bytes
+    void churn(size_t count);
+
+    static constexpr uint64_t IoReadStep = 1024 * 1024;
+    static constexpr uint64_t IoWriteStep = 256 * 1024;
+
+    // fd 0 is /dev/null, 1 a pipe, 2 a socket, 3 an eventfd and the rest regular files;
+    // the pipe and socket inodes are pid * 16 + fd
+    static size_t fdCountOf(pid_t pid) noexcept
+    {
+        return (pid % 16 == 0) ? 64 : 5;
+    }
+
+    static constexpr unsigned CgroupCount = 4;
+
+    // "/system.slice/svc-<n>.service"; cgroup n has usage_usec (n + 1) * 1000000, user_usec and
+    // system_usec half of it each, memory.current (n + 1) MB and "some" memory pressure avg10 n
+    static std::string cgroupOf(pid_t pid);
+    static std::string cgroupPath(unsigned n);
+
+    // 0 for the host; the first process of a container is pid 1 in it
+    static constexpr unsigned ContainerCount = 4;
+
+    static unsigned containerOf(pid_t pid) noexcept
+    {
+        return unsigned(pid % (ContainerCount + 1));
+    }
+
+    // the pid inside the container
+    static pid_t nsPidOf(pid_t pid) noexcept
+    {
+        return containerOf(pid) ? pid_t((pid - FirstPid) / (ContainerCount + 1) + 1) : pid;
+    }
+
+    // in the order pid, mnt, net, user, cgroup; the containers share the user namespace of the host
+    static uint64_t namespaceOf(pid_t pid, unsigned kind) noexcept
+    {
+        auto container = (kind == 3) ? 0 : containerOf(pid);
+        return container ? 4026532000ULL + container * 8 + kind : 4026531835ULL + kind;
+    }
+
+    // kernel symbol i is at KernelTextBase + i * SymbolStep, global if i is even; "_stext" and
+    // "_text" share the address of symbol 0, "_end" follows the last one
+    static constexpr uint64_t KernelTextBase = 0xffffffff81000000ULL;
+    static constexpr uint64_t SymbolStep = 0x100;
+    static constexpr unsigned KernelSymbolCount = 1000;
+    static std::string kernelSymbolName(unsigned i);
+
+    // the symbols of ModuleName, all local, listed backwards
+    static constexpr const char* ModuleName = "synthmod";
+    static constexpr uint64_t ModuleBase = 0xffffffffc0000000ULL;
+    static constexpr uint64_t ModuleSize = 16384;
+    static constexpr unsigned ModuleSymbolCount = 50;
+    static std::string moduleSymbolName(unsigned i);
+
+private:
+    void writeCgroups();
+    void writeKernel();
+    void addProcess(pid_t pid);
+    void removeProcess(pid_t pid);
+    void writeStat(pid_t pid, pid_t tid, unsigned long utime, unsigned long stime);
+    void writeSystemStat();
+    void writeIo(pid_t pid);
+    void writeFds(const std::string& dir, pid_t pid);
+    void writeNet();
+
+    std::string m_root;
+    std::string m_cgroupRoot;
+    std::vector<pid_t> m_pids;
+    pid_t m_nextPid = FirstPid;
+    uint64_t m_busyTicks = 0;
+    uint64_t m_idleTicks = 0;
+    uint64_t m_churns = 0;
+    std::mt19937 m_random;
+};
+
+
+} // namespace ProcFs {}
+
+} // namespace Kes {}
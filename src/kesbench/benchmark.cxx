@@ -0,0 +1,201 @@
+#include "benchmark.hxx"
+
+#include <kesrv/json.hxx>
+#include <kesrv/metrics/metrics.hxx>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <new>
+
+#include <kexplorer-version.h>
+
+
+namespace
+{
+
+std::atomic<uint64_t> g_allocCount = 0;
+std::atomic<uint64_t> g_allocBytes = 0;
+
+void* allocate(size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+
+    auto p = ::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+} // namespace {}
+
+
+void* operator new(size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    ::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    ::free(p);
+}
+
+
+namespace Kesbench
+{
+
+AllocationCounters allocations() noexcept
+{
+    return { g_allocCount.load(std::memory_order_relaxed), g_allocBytes.load(std::memory_order_relaxed) };
+}
+
+
+void Runner::runBatch(const char* name, uint64_t bytes, const Body& body)
+{
+    if (!m_options.filter.empty() && !std::strstr(name, m_options.filter.c_str()))
+        return;
+
+    const auto minNs = uint64_t(m_options.minTime * 1e9);
+
+    // warm up and find the iteration count
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        auto started = Kes::Metrics::now();
+        body(iterations);
+        auto elapsed = Kes::Metrics::now() - started;
+
+        if ((elapsed >= minNs) || (iterations >= (uint64_t(1) << 40)))
+            break;
+
+        // aim a bit above the target, but never grow more than 10x at once
+        auto next = elapsed ? uint64_t(double(iterations) * 1.2 * double(minNs) / double(elapsed)) : iterations * 10;
+        iterations = std::clamp(next, iterations + 1, iterations * 10);
+    }
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.bytes = bytes;
+
+    std::vector<double> samples;
+    auto repetitions = std::max(m_options.repetitions, 1u);
+    for (unsigned r = 0; r < repetitions; ++r)
+    {
+        auto allocs = allocations();
+        auto started = Kes::Metrics::now();
+
+        body(iterations);
+
+        auto elapsed = Kes::Metrics::now() - started;
+        auto allocsAfter = allocations();
+
+        samples.push_back(double(elapsed) / double(iterations));
+
+        // allocations are deterministic enough: keep the last repetition
+        result.allocsPerOp = double(allocsAfter.count - allocs.count) / double(iterations);
+        result.allocBytesPerOp = double(allocsAfter.bytes - allocs.bytes) / double(iterations);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.nsMin = samples.front();
+    result.nsMax = samples.back();
+    result.nsPerOp = (samples.size() % 2) ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+
+    std::cerr << name << ": " << result.nsPerOp << " ns/op, " << result.allocsPerOp << " allocs/op, " << result.allocBytesPerOp << " B/op\n";
+
+    m_results.push_back(std::move(result));
+}
+
+std::string Runner::toJson() const
+{
+    Kes::Json::StringBuffer sb;
+    Kes::Json::Writer<Kes::Json::StringBuffer> writer(sb);
+
+    writer.StartObject();
+
+    writer.Key("version");
+    writer.String(KES_VERSION_STR);
+    writer.Key("min_time");
+    writer.Double(m_options.minTime);
+    writer.Key("repetitions");
+    writer.Uint(m_options.repetitions);
+
+    writer.Key("benchmarks");
+    writer.StartArray();
+    for (auto& r: m_results)
+    {
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(r.name.c_str());
+        writer.Key("iterations");
+        writer.Uint64(r.iterations);
+        writer.Key("ns_per_op");
+        writer.Double(r.nsPerOp);
+        writer.Key("ns_min");
+        writer.Double(r.nsMin);
+        writer.Key("ns_max");
+        writer.Double(r.nsMax);
+        writer.Key("allocs_per_op");
+        writer.Double(r.allocsPerOp);
+        writer.Key("alloc_bytes_per_op");
+        writer.Double(r.allocBytesPerOp);
+        writer.Key("bytes");
+        writer.Uint64(r.bytes);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    return std::string(sb.GetString(), sb.GetSize());
+}
+
+
+} // namespace Kesbench {}
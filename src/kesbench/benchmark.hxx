@@ -0,0 +1,86 @@
+#pragma once
+
+#include <kesrv/kesrv.hxx>
+
+#include <functional>
+#include <vector>
+
+
+namespace Kesbench
+{
+
+// heap usage of the whole process, counted by the replaced global operator new
+struct AllocationCounters
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocationCounters allocations() noexcept;
+
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations = 0;        // per repetition
+    double nsPerOp = 0;             // median over repetitions
+    double nsMin = 0;
+    double nsMax = 0;
+    double allocsPerOp = 0;
+    double allocBytesPerOp = 0;
+    uint64_t bytes = 0;             // payload processed by one operation, if meaningful
+};
+
+
+struct Options
+{
+    std::string filter;             // substring of the benchmark name
+    double minTime = 0.2;           // seconds per repetition
+    unsigned repetitions = 5;
+};
+
+
+//
+// runs a benchmark body repeatedly: the iteration count is grown until one repetition
+// takes at least minTime, then the repetitions are timed with that count
+//
+
+class Runner final
+    : public boost::noncopyable
+{
+public:
+    using Body = std::function<void(uint64_t iterations)>;
+
+    explicit Runner(const Options& options)
+        : m_options(options)
+    {}
+
+    // 'body' performs the given number of operations
+    void runBatch(const char* name, uint64_t bytes, const Body& body);
+
+    template <typename F>
+    void run(const char* name, uint64_t bytes, F&& op)
+    {
+        runBatch(name, bytes, [&op](uint64_t iterations) { for (uint64_t i = 0; i < iterations; ++i) op(); });
+    }
+
+    template <typename F>
+    void run(const char* name, F&& op)
+    {
+        run(name, 0, std::forward<F>(op));
+    }
+
+    const std::vector<Result>& results() const noexcept
+    {
+        return m_results;
+    }
+
+    std::string toJson() const;
+
+private:
+    Options m_options;
+    std::vector<Result> m_results;
+};
+
+
+} // namespace Kesbench {}
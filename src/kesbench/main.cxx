@@ -0,0 +1,292 @@
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+#include <kesrv/util/continuousbuffer.hxx>
+#include <kesrv/util/requestutil.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+
+#include "benchmark.hxx"
+#include "requestprocessor.hxx"
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include <unistd.h>
+
+
+namespace
+{
+
+class NullLog final
+    : public Kes::Log::ILog
+{
+public:
+    Kes::Log::Level level() const noexcept override
+    {
+        return Kes::Log::Level::Off;
+    }
+
+    bool writev(Kes::Log::Level, const char*, va_list) noexcept override
+    {
+        return true;
+    }
+
+    bool write(Kes::Log::Level, const char*, ...) noexcept override
+    {
+        return true;
+    }
+
+    bool put(Kes::Log::Level, Kes::Log::Record&&) noexcept override
+    {
+        return true;
+    }
+};
+
+
+class ErrorHandler final
+    : public Kes::IPropertyErrorHandler
+{
+public:
+    Kes::CallbackResult handle([[maybe_unused]] Kes::SourceLocation where, const std::string& message) noexcept override
+    {
+        if (m_message.empty())
+            m_message = message;
+
+        return Kes::CallbackResult::Continue;
+    }
+
+    const std::string& message() const noexcept
+    {
+        return m_message;
+    }
+
+private:
+    std::string m_message;
+};
+
+
+template <typename T>
+void doNotOptimize(const T& value) noexcept
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+
+// a process list resembling a list_processes response
+Kes::PropertyBag makeProcessList(size_t count)
+{
+    Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+    Kes::PropertyBag processes{Kes::ProcessProps::ProcessList::idstr(), Kes::PropertyBag::Array()};
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Kes::PropertyBag process{std::string(), Kes::PropertyBag::Table()};
+
+        auto pid = int(1000 + i);
+        auto comm = "worker-" + std::to_string(i);
+        Kes::Util::addToTable<Kes::ProcessProps::Pid>(process, pid);
+        Kes::Util::addToTable<Kes::ProcessProps::PPid>(process, 1);
+        Kes::Util::addToTable<Kes::ProcessProps::PGrp>(process, pid);
+        Kes::Util::addToTable<Kes::ProcessProps::Tpgid>(process, -1);
+        Kes::Util::addToTable<Kes::ProcessProps::Session>(process, pid);
+        Kes::Util::addToTable<Kes::ProcessProps::Comm>(process, comm);
+        Kes::Util::addToTable<Kes::ProcessProps::Ruid>(process, 1000);
+        Kes::Util::addToTable<Kes::ProcessProps::StatComm>(process, comm);
+        Kes::Util::addToTable<Kes::ProcessProps::Exe>(process, "/usr/lib/example/" + comm);
+        Kes::Util::addToTable<Kes::ProcessProps::CmdLine>(process, "/usr/lib/example/" + comm + " --config /etc/example/" + comm + ".conf --verbose");
+
+        Kes::Util::addToArray<Kes::ProcessProps::Process>(processes, std::move(process));
+    }
+
+    Kes::Util::addToTable<Kes::ProcessProps::ProcessList>(response, std::move(processes));
+    Kes::Util::addToTable<Kes::Request::Props::Id>(response, 1);
+    Kes::Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+
+    return response;
+}
+
+
+void procFsBenchmarks(Kesbench::Runner& runner, Kes::Log::ILog* log, const std::string& root, pid_t self)
+{
+    Kes::ProcFs::ProcFs procFs(log, root);
+
+    runner.run("procfs.enumerate_pids", [&procFs]() { auto pids = procFs.enumeratePids(); doNotOptimize(pids); });
+    runner.run("procfs.read_stat", [&procFs, self]() { auto stat = procFs.readStat(self); doNotOptimize(stat); });
+    runner.run("procfs.read_comm", [&procFs, self]() { auto comm = procFs.readComm(self); doNotOptimize(comm); });
+    runner.run("procfs.read_cmdline", [&procFs, self]() { auto cmdLine = procFs.readCmdLine(self); doNotOptimize(cmdLine); });
+    runner.run("procfs.read_exe_path", [&procFs, self]() { auto exe = procFs.readExePath(self); doNotOptimize(exe); });
+}
+
+void propertyBagBenchmarks(Kesbench::Runner& runner, size_t processCount)
+{
+    auto bag = makeProcessList(processCount);
+    auto json = Kes::propertyBagToJson(bag);
+
+    runner.run("propertybag.to_json", json.size(), [&bag]() { auto out = Kes::propertyBagToJson(bag); doNotOptimize(out); });
+
+    // parsing is in situ: every iteration parses a fresh copy of the source
+    std::vector<char> buffer(json.size() + 1);
+    ErrorHandler eh;
+    runner.run("propertybag.from_json", json.size(),
+        [&buffer, &json, &eh]()
+        {
+            std::memcpy(buffer.data(), json.c_str(), json.size() + 1);
+            auto parsed = Kes::propertyBagFromJson(buffer.data(), &eh);
+            doNotOptimize(parsed);
+        }
+    );
+
+    if (!eh.message().empty())
+        std::cerr << "propertybag.from_json: " << eh.message() << "\n";
+}
+
+void bufferBenchmarks(Kesbench::Runner& runner)
+{
+    const std::string request("{\"request.id\":12345,\"request.request\":\"diff_processes\"}");
+
+    Kes::Util::ContinuousBuffer buffer(4096, 1024 * 1024);
+    runner.run("continuousbuffer.push_pop", request.size(),
+        [&buffer, &request]()
+        {
+            buffer.push(request.data(), request.size());
+            buffer.pop(request.size());
+        }
+    );
+
+    // a request split across reads; the pop leaves a tail that has to be shifted on the next push
+    const size_t chunk = request.size() / 3;
+    runner.run("continuousbuffer.push_pop_fragmented", request.size(),
+        [&buffer, &request, chunk]()
+        {
+            buffer.push(request.data(), chunk);
+            buffer.push(request.data() + chunk, chunk);
+            buffer.push(request.data() + 2 * chunk, request.size() - 2 * chunk);
+            buffer.push(request.data(), 1);
+            buffer.pop(request.size());
+            buffer.pop(1);
+        }
+    );
+}
+
+void pipelineBenchmarks(Kesbench::Runner& runner, Kes::Log::ILog* log, const std::string& root)
+{
+    Kes::Metrics::Registry metrics;
+    Kes::Private::RequestProcessor rp(log, &metrics);
+    Kes::Private::ProcessManager pm(&rp, log, &metrics, root);
+
+    const uint32_t sessionId = 1;
+    rp.startSession(sessionId);
+
+    auto pipeline = [&rp, sessionId](const char* command)
+    {
+        auto request = Kes::Util::Request::simple(1, command);
+        std::vector<char> buffer(request.size() + 1);
+
+        return [&rp, sessionId, request, buffer]() mutable
+        {
+            std::memcpy(buffer.data(), request.c_str(), request.size() + 1);
+            auto response = rp.process(sessionId, buffer.data(), request.size());
+            doNotOptimize(response);
+        };
+    };
+
+    runner.run("pipeline.list_processes", pipeline("list_processes"));
+    runner.run("pipeline.diff_processes", pipeline("diff_processes"));
+
+    rp.endSession(sessionId);
+}
+
+} // namespace {}
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+        po::options_description options("Command line options");
+        options.add_options()
+            ("help,h", "display this message")
+            ("filter,f", po::value<std::string>(), "run only benchmarks whose names contain this string")
+            ("min-time,t", po::value<double>()->default_value(0.2), "minimal duration of a repetition, seconds")
+            ("repetitions,r", po::value<unsigned>()->default_value(5), "number of timed repetitions")
+            ("processes,p", po::value<size_t>()->default_value(500), "process count of the synthetic process list")
+            ("procfs-root", po::value<std::string>(), "procfs mount point (default /proc)")
+            ("synthetic,s", po::value<size_t>(), "scan a generated procfs tree with this many processes instead")
+            ("output,o", po::value<std::string>(), "write the JSON results to this file instead of stdout")
+        ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, options), vm);
+        po::notify(vm);
+
+        if (vm.count("help"))
+        {
+            std::cerr << options << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        Kes::initialize();
+
+        Kesbench::Options benchOptions;
+        if (vm.count("filter"))
+            benchOptions.filter = vm["filter"].as<std::string>();
+        benchOptions.minTime = vm["min-time"].as<double>();
+        benchOptions.repetitions = vm["repetitions"].as<unsigned>();
+
+        NullLog log;
+        Kesbench::Runner runner(benchOptions);
+
+        std::string root(Kes::ProcFs::ProcFs::DefaultRoot);
+        if (vm.count("procfs-root"))
+            root = vm["procfs-root"].as<std::string>();
+
+        auto self = ::getpid();
+
+        std::unique_ptr<Kes::ProcFs::SyntheticProcFs> synthetic;
+        if (vm.count("synthetic"))
+        {
+            auto count = vm["synthetic"].as<size_t>();
+            std::cerr << "Generating " << count << " processes...\n";
+
+            synthetic.reset(new Kes::ProcFs::SyntheticProcFs("/tmp/kesbench-procfs-" + std::to_string(self), count));
+            root = synthetic->root();
+            self = synthetic->pids().empty() ? self : synthetic->pids().front();
+        }
+
+        procFsBenchmarks(runner, &log, root, self);
+        propertyBagBenchmarks(runner, vm["processes"].as<size_t>());
+        bufferBenchmarks(runner);
+        pipelineBenchmarks(runner, &log, root);
+
+        auto json = runner.toJson();
+        if (vm.count("output"))
+        {
+            auto fileName = vm["output"].as<std::string>();
+            std::ofstream file(fileName);
+            if (!file)
+            {
+                std::cerr << "Failed to create " << fileName << "\n";
+                return EXIT_FAILURE;
+            }
+
+            file << json << "\n";
+        }
+        else
+        {
+            std::cout << json << "\n";
+        }
+
+        Kes::finalize();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,473 @@
+#include <kesclient/connection.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/util/netutil.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+Connection::~Connection()
+{
+    // the io_context must not be running any more: pending callbacks are dropped
+    if (m_socket && m_socket->is_open())
+    {
+        boost::system::error_code ec;
+        m_socket->close(ec);
+    }
+}
+
+Connection::Connection(boost::asio::io_context& io, const std::string& address, const ConnectionOptions& options)
+    : m_io(io)
+    , m_strand(io)
+    , m_options(options)
+    , m_endpoints(Kes::Util::resolveEndpoints(io, address))
+    , m_reconnectTimer(io)
+    , m_nextAttempt(boost::asio::steady_timer::clock_type::now())
+    , m_bufferIn(options.readSize, options.responseLimit)
+{
+}
+
+Kes::Request::Id Connection::send(std::string json, Callback callback)
+{
+    auto id = m_nextId.fetch_add(1, std::memory_order_relaxed);
+    enqueue({ id, withId(std::move(json), id), std::move(callback) });
+    return id;
+}
+
+std::future<Response> Connection::send(std::string json)
+{
+    Callback callback;
+    auto future = futureFor(callback);
+    send(std::move(json), std::move(callback));
+    return future;
+}
+
+Kes::Request::Id Connection::command(const char* name, Callback callback)
+{
+    auto id = m_nextId.fetch_add(1, std::memory_order_relaxed);
+    enqueue({ id, Kes::Util::Request::simple(id, name), std::move(callback) });
+    return id;
+}
+
+std::future<Response> Connection::command(const char* name)
+{
+    Callback callback;
+    auto future = futureFor(callback);
+    command(name, std::move(callback));
+    return future;
+}
+
+void Connection::stop() noexcept
+{
+    try
+    {
+        boost::asio::dispatch(
+            m_strand,
+            [this]()
+            {
+                if (m_stopped)
+                    return;
+
+                m_stopped = true;
+
+                boost::system::error_code ec;
+                m_reconnectTimer.cancel(ec);
+
+                if (m_socket)
+                    m_socket->close(ec);
+
+                ++m_generation;
+                m_state = State::Disconnected;
+                m_connected = false;
+
+                fail(m_inFlight, boost::asio::error::operation_aborted);
+
+                std::deque<Pending> queued;
+                for (auto& request: m_queue)
+                    queued.push_back({ request.id, std::move(request.callback) });
+                m_queue.clear();
+
+                fail(queued, boost::asio::error::operation_aborted);
+            }
+        );
+    }
+    catch (...)
+    {
+        // not much we can do here
+    }
+}
+
+// the id goes first, so ResponseView and the server find it early
+std::string Connection::withId(std::string json, Kes::Request::Id id)
+{
+    auto open = json.find_first_not_of(" \t\r\n");
+    if ((open == std::string::npos) || (json[open] != '{'))
+        throw Kes::Exception(KES_HERE(), "A request must be a JSON object");
+
+    auto next = json.find_first_not_of(" \t\r\n", open + 1);
+    bool empty = (next != std::string::npos) && (json[next] == '}');
+
+    std::string field("\"");
+    field.append(Kes::Request::Props::Id::idstr());
+    field.append("\":");
+    field.append(std::to_string(id));
+    if (!empty)
+        field.push_back(',');
+
+    json.insert(open + 1, field);
+    return json;
+}
+
+std::future<Response> Connection::futureFor(Callback& callback)
+{
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+
+    callback = [promise](const boost::system::error_code& ec, const ResponseView& response)
+    {
+        if (ec)
+            promise->set_exception(std::make_exception_ptr(Kes::Exception(KES_HERE(), "Request failed: " + ec.message())));
+        else
+            promise->set_value(Response(std::string(response.json())));
+    };
+
+    return future;
+}
+
+void Connection::enqueue(Outgoing&& request)
+{
+    boost::asio::post(
+        m_strand,
+        [this, request = std::move(request)]() mutable
+        {
+            if (m_stopped)
+            {
+                complete(request.callback, boost::asio::error::operation_aborted, ResponseView());
+                return;
+            }
+
+            m_queue.push_back(std::move(request));
+            kick();
+        }
+    );
+}
+
+void Connection::kick() noexcept
+{
+    if (m_state == State::Connected)
+    {
+        flush();
+        return;
+    }
+
+    if ((m_state == State::Connecting) || m_reconnectPending)
+        return;
+
+    if (boost::asio::steady_timer::clock_type::now() >= m_nextAttempt)
+    {
+        connect();
+        return;
+    }
+
+    // the previous attempt failed recently
+    m_reconnectPending = true;
+    m_reconnectTimer.expires_at(m_nextAttempt);
+    m_reconnectTimer.async_wait(
+        m_strand.wrap(
+            [this](const boost::system::error_code& ec)
+            {
+                m_reconnectPending = false;
+                if (!ec && !m_stopped && (m_state == State::Disconnected) && !m_queue.empty())
+                    connect();
+            }
+        )
+    );
+}
+
+void Connection::connect() noexcept
+{
+    try
+    {
+        m_state = State::Connecting;
+        m_socket.reset(new boost::asio::generic::stream_protocol::socket(m_io));
+
+        boost::asio::async_connect(
+            *m_socket,
+            m_endpoints,
+            m_strand.wrap(
+                [this, generation = m_generation](const boost::system::error_code& ec, const boost::asio::generic::stream_protocol::endpoint&)
+                {
+                    if (m_stopped || (generation != m_generation))
+                        return;
+
+                    onConnect(ec);
+                }
+            )
+        );
+    }
+    catch (...)
+    {
+        onConnect(boost::asio::error::no_memory);
+    }
+}
+
+void Connection::onConnect(const boost::system::error_code& ec) noexcept
+{
+    if (ec)
+    {
+        m_state = State::Disconnected;
+        m_socket.reset();
+
+        m_delay = std::min(std::max(m_options.reconnectDelay, m_delay * 2), m_options.maxReconnectDelay);
+        m_nextAttempt = boost::asio::steady_timer::clock_type::now() + m_delay;
+
+        // nobody to talk to: waiting requests fail, the next one tries again
+        std::deque<Pending> queued;
+        for (auto& request: m_queue)
+            queued.push_back({ request.id, std::move(request.callback) });
+        m_queue.clear();
+
+        fail(queued, ec);
+        return;
+    }
+
+    m_state = State::Connected;
+    m_connected = true;
+    m_delay = std::chrono::milliseconds(0);
+
+    // fails harmlessly on unix domain sockets
+    boost::system::error_code ignored;
+    m_socket->set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+
+    read(nullptr);
+    flush();
+}
+
+void Connection::disconnect(const boost::system::error_code& ec) noexcept
+{
+    if (m_socket)
+    {
+        boost::system::error_code ignored;
+        m_socket->close(ignored);
+    }
+
+    ++m_generation;
+    m_state = State::Disconnected;
+    m_connected = false;
+
+    m_writing.clear();
+    m_writeBuffers.clear();
+    m_bufferIn.reset();
+    m_framer.reset();
+
+    fail(m_inFlight, ec);
+
+    if (!m_stopped && !m_queue.empty())
+        kick();
+}
+
+// everything queued goes out in one gathered write
+void Connection::flush() noexcept
+{
+    if ((m_state != State::Connected) || !m_writing.empty() || m_queue.empty())
+        return;
+
+    try
+    {
+        while (!m_queue.empty())
+        {
+            auto& request = m_queue.front();
+            m_inFlight.push_back({ request.id, std::move(request.callback) });
+            m_writing.push_back(std::move(request.data));
+            m_queue.pop_front();
+        }
+
+        for (auto& data: m_writing)
+            m_writeBuffers.push_back(boost::asio::const_buffer(data.data(), data.size()));
+
+        boost::asio::async_write(
+            *m_socket,
+            m_writeBuffers,
+            m_strand.wrap(
+                [this, generation = m_generation](const boost::system::error_code& ec, size_t)
+                {
+                    if (m_stopped || (generation != m_generation))
+                        return;
+
+                    if (ec)
+                    {
+                        disconnect(ec);
+                        return;
+                    }
+
+                    m_writing.clear();
+                    m_writeBuffers.clear();
+
+                    flush();
+                }
+            )
+        );
+    }
+    catch (...)
+    {
+        disconnect(boost::asio::error::no_memory);
+    }
+}
+
+void Connection::read(Kes::Util::ReadBuffer::Ptr buffer) noexcept
+{
+    try
+    {
+        if (!buffer)
+            buffer = Kes::Util::ReadBuffer::create(m_options.readSize);
+
+        m_socket->async_read_some(
+            boost::asio::buffer(buffer->data(buffer->w_index()), buffer->size()),
+            m_strand.wrap(
+                [this, buffer, generation = m_generation](const boost::system::error_code& ec, size_t transferred)
+                {
+                    if (m_stopped || (generation != m_generation))
+                        return;
+
+                    if (ec)
+                    {
+                        disconnect(ec);
+                        return;
+                    }
+
+                    buffer->swap();
+
+                    // start another read immediately
+                    read(buffer);
+
+                    process(buffer->data(buffer->r_index()), transferred);
+                }
+            )
+        );
+    }
+    catch (...)
+    {
+        disconnect(boost::asio::error::no_memory);
+    }
+}
+
+// complete frames are handed out straight from the read buffer;
+// only a frame split between reads is assembled in m_bufferIn
+void Connection::process(const char* data, size_t size) noexcept
+{
+    auto generation = m_generation;
+
+    try
+    {
+        if (!m_bufferIn.used())
+        {
+            size_t start = 0;
+            while (start < size)
+            {
+                auto end = m_framer.next(data, start, size);
+                if (end == Kes::Util::JsonFramer::Incomplete)
+                    break;
+
+                if (!dispatch(data + start, end - start) || m_stopped || (generation != m_generation))
+                    return;
+
+                start = end;
+            }
+
+            if ((start < size) && m_framer.inProgress() && !m_bufferIn.push(data + start, size - start))
+                throw Kes::Exception(KES_HERE(), "Response size exceeds limit");
+
+            return;
+        }
+
+        auto pos = m_bufferIn.used();
+        if (!m_bufferIn.push(data, size))
+            throw Kes::Exception(KES_HERE(), "Response size exceeds limit");
+
+        for (;;)
+        {
+            auto end = m_framer.next(m_bufferIn.data(), pos, m_bufferIn.used());
+            if (end == Kes::Util::JsonFramer::Incomplete)
+                break;
+
+            if (!dispatch(m_bufferIn.data(), end) || m_stopped || (generation != m_generation))
+                return;
+
+            m_bufferIn.pop(end);
+            pos = 0;
+        }
+
+        if (!m_framer.inProgress())
+            m_bufferIn.reset(); // whitespace between frames
+    }
+    catch (...)
+    {
+        disconnect(boost::system::errc::make_error_code(boost::system::errc::bad_message));
+    }
+}
+
+bool Connection::dispatch(const char* data, size_t size) noexcept
+{
+    // the framer counts from the previous frame's end, which may leave whitespace in front
+    while (size && (*data != '{'))
+    {
+        ++data;
+        --size;
+    }
+
+    ResponseView view(data, size);
+
+    auto it = m_inFlight.begin();
+    auto id = view.id();
+    if (id)
+    {
+        // responses normally come in order: the match is at the front
+        while ((it != m_inFlight.end()) && (it->id != *id))
+            ++it;
+    }
+
+    // a response without an id (e.g. to an unparseable request) goes to the oldest request
+    if (it == m_inFlight.end())
+    {
+        disconnect(boost::system::errc::make_error_code(boost::system::errc::bad_message));
+        return false;
+    }
+
+    auto callback = std::move(it->callback);
+    m_inFlight.erase(it);
+
+    complete(callback, boost::system::error_code(), view);
+    return true;
+}
+
+void Connection::fail(std::deque<Pending>& requests, const boost::system::error_code& ec) noexcept
+{
+    // callbacks may issue new requests: work on a detached list
+    std::deque<Pending> failed;
+    failed.swap(requests);
+
+    for (auto& request: failed)
+        complete(request.callback, ec, ResponseView());
+}
+
+void Connection::complete(Callback& callback, const boost::system::error_code& ec, const ResponseView& response) noexcept
+{
+    try
+    {
+        if (callback)
+            callback(ec, response);
+    }
+    catch (...)
+    {
+        // callbacks must not break the connection
+    }
+}
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
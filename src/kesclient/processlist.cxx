@@ -0,0 +1,242 @@
+#include <kesclient/processlist.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/json.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+
+#include <rapidjson/memorystream.h>
+#include <rapidjson/encodedstream.h>
+
+#include <cstring>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+namespace
+{
+
+//
+// depth 1 is the response, depth 2 the process lists, depth 3 a process entry
+//
+
+class ProcessListHandler final
+    : public Kes::Json::BaseReaderHandler<Kes::Json::UTF8<>, ProcessListHandler>
+{
+public:
+    explicit ProcessListHandler(ProcessList& out) noexcept
+        : m_out(out)
+    {
+    }
+
+    void finish()
+    {
+        m_out.processes.resize(m_count);
+    }
+
+    bool StartObject()
+    {
+        ++m_depth;
+
+        if ((m_depth == 3) && (m_section == Section::Processes))
+        {
+            if (m_count == m_out.processes.size())
+                m_out.processes.emplace_back();
+            else
+                m_out.processes[m_count].clear();
+
+            m_entry = &m_out.processes[m_count++];
+        }
+
+        return true;
+    }
+
+    bool EndObject(Kes::Json::SizeType)
+    {
+        if (m_depth == 3)
+            m_entry = nullptr;
+
+        --m_depth;
+        return true;
+    }
+
+    bool StartArray()
+    {
+        ++m_depth;
+
+        if (m_depth == 2)
+            m_section = m_pending;
+
+        return true;
+    }
+
+    bool EndArray(Kes::Json::SizeType)
+    {
+        if (m_depth == 2)
+            m_section = Section::None;
+
+        --m_depth;
+        return true;
+    }
+
+    bool Key(const char* str, Kes::Json::SizeType, bool)
+    {
+        if (m_depth == 1)
+        {
+            m_pending = Section::None;
+            m_string = nullptr;
+            m_bool = nullptr;
+            m_double = nullptr;
+
+            if (!std::strcmp(str, Kes::ProcessProps::ProcessList::idstr()))
+                m_pending = Section::Processes;
+            else if (!std::strcmp(str, Kes::ProcessProps::DeletedProcessList::idstr()))
+                m_pending = Section::Deleted;
+            else if (!std::strcmp(str, Kes::ProcessProps::Token::idstr()))
+                m_string = &m_out.token;
+            else if (!std::strcmp(str, Kes::ProcessProps::Resumed::idstr()))
+                m_bool = &m_out.resumed;
+            else if (!std::strcmp(str, Kes::ProcessProps::NextCursor::idstr()))
+                m_string = &m_out.nextCursor;
+            else if (!std::strcmp(str, Kes::ProcessProps::SystemBusy::idstr()))
+                m_double = &m_out.systemBusy;
+        }
+        else if ((m_depth == 3) && m_entry)
+        {
+            m_int = nullptr;
+            m_string = nullptr;
+            m_bool = nullptr;
+            m_double = nullptr;
+
+            if (!std::strcmp(str, Kes::ProcessProps::Pid::idstr()))
+                m_int = &m_entry->pid;
+            else if (!std::strcmp(str, Kes::ProcessProps::PPid::idstr()))
+                m_int = &m_entry->ppid;
+            else if (!std::strcmp(str, Kes::ProcessProps::PGrp::idstr()))
+                m_int = &m_entry->pgrp;
+            else if (!std::strcmp(str, Kes::ProcessProps::Tpgid::idstr()))
+                m_int = &m_entry->tpgid;
+            else if (!std::strcmp(str, Kes::ProcessProps::Session::idstr()))
+                m_int = &m_entry->session;
+            else if (!std::strcmp(str, Kes::ProcessProps::Ruid::idstr()))
+                m_int = &m_entry->ruid;
+            else if (!std::strcmp(str, Kes::ProcessProps::Cpu::idstr()))
+                m_double = &m_entry->cpu;
+            else if (!std::strcmp(str, Kes::ProcessProps::Newcomer::idstr()))
+                m_bool = &m_entry->newcomer;
+            else if (!std::strcmp(str, Kes::ProcessProps::Comm::idstr()))
+                m_string = &m_entry->comm;
+            else if (!std::strcmp(str, Kes::ProcessProps::StatComm::idstr()))
+                m_string = &m_entry->statComm;
+            else if (!std::strcmp(str, Kes::ProcessProps::Exe::idstr()))
+                m_string = &m_entry->exe;
+            else if (!std::strcmp(str, Kes::ProcessProps::CmdLine::idstr()))
+                m_string = &m_entry->cmdLine;
+            else if (!std::strcmp(str, Kes::ProcessProps::Error::idstr()))
+                m_string = &m_entry->error;
+        }
+
+        return true;
+    }
+
+    bool Int(int i)
+    {
+        if ((m_depth == 2) && (m_section == Section::Deleted))
+            m_out.deleted.push_back(i);
+        else if ((m_depth == 3) && m_entry && m_int)
+            *m_int = i;
+        else
+            Double(i);
+
+        return true;
+    }
+
+    bool Uint(unsigned u)
+    {
+        return Int(int(u));
+    }
+
+    bool Int64(int64_t i)
+    {
+        return Int(int(i));
+    }
+
+    bool Uint64(uint64_t u)
+    {
+        return Int(int(u));
+    }
+
+    bool Double(double d)
+    {
+        if (((m_depth == 3) && m_entry && m_double) || ((m_depth == 1) && m_double))
+            *m_double = d;
+
+        return true;
+    }
+
+    bool Bool(bool b)
+    {
+        if (((m_depth == 3) && m_entry && m_bool) || ((m_depth == 1) && m_bool))
+            *m_bool = b;
+
+        return true;
+    }
+
+    bool String(const char* str, Kes::Json::SizeType length, bool)
+    {
+        if (((m_depth == 3) && m_entry && m_string) || ((m_depth == 1) && m_string))
+            m_string->assign(str, length);
+
+        return true;
+    }
+
+private:
+    enum class Section
+    {
+        None,
+        Processes,
+        Deleted
+    };
+
+    ProcessList& m_out;
+    size_t m_count = 0;
+    int m_depth = 0;
+    Section m_pending = Section::None;
+    Section m_section = Section::None;
+    ProcessEntry* m_entry = nullptr;
+    int* m_int = nullptr;
+    bool* m_bool = nullptr;
+    double* m_double = nullptr;
+    std::string* m_string = nullptr;
+};
+
+} // namespace {}
+
+
+KESCLIENT_EXPORT void decodeProcesses(std::string_view json, ProcessList& out)
+{
+    out.deleted.clear();
+    out.token.clear();
+    out.resumed = false;
+    out.nextCursor.clear();
+    out.systemBusy = -1;
+
+    ProcessListHandler handler(out);
+
+    Kes::Json::MemoryStream memory(json.data(), json.size());
+    Kes::Json::EncodedInputStream<Kes::Json::UTF8<>, Kes::Json::MemoryStream> stream(memory);
+
+    Kes::Json::Reader reader;
+    auto result = reader.Parse<Kes::Json::kParseStopWhenDoneFlag>(stream, handler);
+    if (result.IsError())
+        throw Kes::Exception(KES_HERE(), std::string("Invalid response: ") + Kes::Json::GetParseError_En(result.Code()));
+
+    handler.finish();
+}
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
@@ -0,0 +1,173 @@
+#include <kesclient/response.hxx>
+
+#include <charconv>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+namespace
+{
+
+bool isSpace(char c) noexcept
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+size_t skipSpace(std::string_view s, size_t pos) noexcept
+{
+    while ((pos < s.size()) && isSpace(s[pos]))
+        ++pos;
+
+    return pos;
+}
+
+// pos is at the opening quote; returns the offset past the closing one or npos
+size_t skipString(std::string_view s, size_t pos) noexcept
+{
+    for (++pos; pos < s.size(); ++pos)
+    {
+        if (s[pos] == '\\')
+            ++pos;
+        else if (s[pos] == '"')
+            return pos + 1;
+    }
+
+    return std::string_view::npos;
+}
+
+// returns the offset past the value that starts at pos or npos
+size_t skipValue(std::string_view s, size_t pos) noexcept
+{
+    if (pos >= s.size())
+        return std::string_view::npos;
+
+    auto c = s[pos];
+    if (c == '"')
+        return skipString(s, pos);
+
+    if ((c == '{') || (c == '['))
+    {
+        size_t depth = 0;
+        while (pos < s.size())
+        {
+            c = s[pos];
+            if (c == '"')
+            {
+                pos = skipString(s, pos);
+                if (pos == std::string_view::npos)
+                    return pos;
+
+                continue;
+            }
+
+            if ((c == '{') || (c == '['))
+                ++depth;
+            else if (((c == '}') || (c == ']')) && (--depth == 0))
+                return pos + 1;
+
+            ++pos;
+        }
+
+        return std::string_view::npos;
+    }
+
+    // a number or a literal
+    while ((pos < s.size()) && (s[pos] != ',') && (s[pos] != '}') && (s[pos] != ']') && !isSpace(s[pos]))
+        ++pos;
+
+    return pos;
+}
+
+} // namespace {}
+
+
+std::string_view ResponseView::raw(std::string_view key) const noexcept
+{
+    auto& s = m_json;
+    auto pos = skipSpace(s, 0);
+    if ((pos >= s.size()) || (s[pos] != '{'))
+        return {};
+
+    ++pos;
+    for (;;)
+    {
+        pos = skipSpace(s, pos);
+        if ((pos >= s.size()) || (s[pos] != '"'))
+            return {};
+
+        auto keyEnd = skipString(s, pos);
+        if (keyEnd == std::string_view::npos)
+            return {};
+
+        auto name = s.substr(pos + 1, keyEnd - pos - 2);
+
+        pos = skipSpace(s, keyEnd);
+        if ((pos >= s.size()) || (s[pos] != ':'))
+            return {};
+
+        auto valueStart = skipSpace(s, pos + 1);
+        auto valueEnd = skipValue(s, valueStart);
+        if ((valueEnd == std::string_view::npos) || (valueEnd == valueStart))
+            return {};
+
+        if (name == key)
+            return s.substr(valueStart, valueEnd - valueStart);
+
+        pos = skipSpace(s, valueEnd);
+        if ((pos >= s.size()) || (s[pos] != ','))
+            return {};
+
+        ++pos;
+    }
+}
+
+std::optional<std::string_view> ResponseView::string(std::string_view key) const noexcept
+{
+    auto value = raw(key);
+    if ((value.size() < 2) || (value.front() != '"'))
+        return std::nullopt;
+
+    return value.substr(1, value.size() - 2);
+}
+
+std::optional<int64_t> ResponseView::integer(std::string_view key) const noexcept
+{
+    auto value = raw(key);
+    if (value.empty())
+        return std::nullopt;
+
+    int64_t result = 0;
+    auto r = std::from_chars(value.data(), value.data() + value.size(), result);
+    if ((r.ec != std::errc()) || (r.ptr != value.data() + value.size()))
+        return std::nullopt;
+
+    return result;
+}
+
+std::optional<Kes::Request::Id> ResponseView::id() const noexcept
+{
+    auto value = integer(Kes::Request::Props::Id::idstr());
+    if (!value)
+        return std::nullopt;
+
+    return Kes::Request::Id(*value);
+}
+
+std::string_view ResponseView::status() const noexcept
+{
+    return string(Kes::Response::Props::Status::idstr()).value_or(std::string_view());
+}
+
+std::string_view ResponseView::reason() const noexcept
+{
+    return string(Kes::Response::Props::Reason::idstr()).value_or(std::string_view());
+}
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
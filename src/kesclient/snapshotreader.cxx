@@ -0,0 +1,188 @@
+#include <kesclient/snapshotreader.hxx>
+
+#include <kesrv/exception.hxx>
+#include <kesrv/util/format.hxx>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace Kes
+{
+
+namespace Client
+{
+
+namespace
+{
+
+// a reader only retries when the writer laps it, i.e. when a copy takes longer than two scans
+const size_t kMaxAttempts = 64;
+
+} // namespace {}
+
+
+SnapshotReader::~SnapshotReader()
+{
+    unmap();
+}
+
+SnapshotReader::SnapshotReader(const std::string& name)
+    : m_name(name)
+{
+    map();
+}
+
+void SnapshotReader::map()
+{
+    auto fd = ::shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+        throw Kes::Exception(KES_HERE(), Kes::Util::format("Failed to open the shared memory region %s: %s", m_name.c_str(), ::strerror(errno)));
+
+    struct ::stat st = {};
+    if ((::fstat(fd, &st) == -1) || (uint64_t(st.st_size) < sizeof(Kes::Snapshot::Header)))
+    {
+        ::close(fd);
+        throw Kes::Exception(KES_HERE(), "Invalid shared memory region size");
+    }
+
+    auto region = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (region == MAP_FAILED)
+        throw Kes::Exception(KES_HERE(), Kes::Util::format("Failed to map the shared memory region: %s", ::strerror(errno)));
+
+    m_region = region;
+    m_size = uint64_t(st.st_size);
+    auto header = static_cast<const Kes::Snapshot::Header*>(region);
+
+    // the magic is written last
+    bool valid = !std::memcmp(header->magic, Kes::Snapshot::Magic, sizeof(Kes::Snapshot::Magic));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    valid = valid
+        && (header->version == Kes::Snapshot::Version)
+        && (header->headerSize == Kes::Snapshot::headerSize())
+        && (header->processSize == sizeof(Kes::Snapshot::Process))
+        && (header->regionSize <= m_size)
+        && (header->bufferSize >= sizeof(Kes::Snapshot::Buffer) + uint64_t(header->capacity) * sizeof(Kes::Snapshot::Process) + header->stringCapacity);
+
+    for (auto offset: header->bufferOffset)
+        valid = valid && (offset >= header->headerSize) && (offset + header->bufferSize <= header->regionSize);
+
+    if (!valid)
+    {
+        unmap();
+        throw Kes::Exception(KES_HERE(), "Unsupported shared memory region layout");
+    }
+
+    m_header = header;
+}
+
+void SnapshotReader::unmap() noexcept
+{
+    if (m_region)
+        ::munmap(m_region, m_size);
+
+    m_region = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+}
+
+bool SnapshotReader::remap() noexcept
+{
+    unmap();
+
+    try
+    {
+        map();
+        return true;
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+}
+
+uint64_t SnapshotReader::generation() noexcept
+{
+    if (!m_header || (m_header->state.load(std::memory_order_acquire) == uint32_t(Kes::Snapshot::State::Closed)))
+    {
+        if (!remap())
+            return 0;
+    }
+
+    return m_header->generation.load(std::memory_order_acquire);
+}
+
+bool SnapshotReader::read(ProcessList& out)
+{
+    for (size_t attempt = 0; attempt < kMaxAttempts; ++attempt)
+    {
+        auto generation = this->generation();
+        if (!generation)
+            return false;
+
+        auto buffer = reinterpret_cast<const Kes::Snapshot::Buffer*>(static_cast<const char*>(m_region) + m_header->bufferOffset[generation & 1]);
+        auto sequence = buffer->sequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+            continue; // the writer is back on this buffer already
+
+        // anything read below may be torn until the sequence is checked again, so it is only bounded, not trusted
+        auto capacity = m_header->capacity;
+        auto stringCapacity = m_header->stringCapacity;
+        auto count = std::min(buffer->count, capacity);
+        auto records = Kes::Snapshot::processes(buffer);
+        auto strings = Kes::Snapshot::strings(buffer, capacity);
+
+        auto assign = [strings, stringCapacity](std::string& to, const Kes::Snapshot::StringRef& ref)
+        {
+            if (uint64_t(ref.offset) + ref.length <= stringCapacity)
+                to.assign(strings + ref.offset, ref.length);
+            else
+                to.clear();
+        };
+
+        out.processes.resize(count);
+        out.deleted.clear();
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto& record = records[i];
+            auto& entry = out.processes[i];
+
+            entry.pid = record.pid;
+            entry.ppid = record.ppid;
+            entry.pgrp = record.pgrp;
+            entry.tpgid = record.tpgid;
+            entry.session = record.session;
+            entry.ruid = record.ruid;
+            entry.newcomer = false;
+            assign(entry.comm, record.comm);
+            assign(entry.statComm, record.statComm);
+            assign(entry.exe, record.exe);
+            assign(entry.cmdLine, record.cmdLine);
+            assign(entry.error, record.error);
+        }
+
+        auto timestamp = buffer->timestamp;
+        auto flags = buffer->flags;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (buffer->sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        m_generation = generation;
+        m_timestamp = timestamp;
+        m_truncated = (flags & Kes::Snapshot::BufferTruncated) != 0;
+        return true;
+    }
+
+    return false;
+}
+
+
+} // namespace Client {}
+
+} // namespace Kes {}
@@ -0,0 +1,294 @@
+#include "loadgen.hxx"
+
+#include <kesclient/connection.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/metrics/metrics.hxx>
+
+#include <deque>
+#include <iomanip>
+#include <iostream>
+
+
+namespace Kesctl
+{
+
+namespace
+{
+
+// in-flight requests are awaited this long after the load stops
+const auto kDrainTimeout = std::chrono::seconds(5);
+
+// send times a session keeps while its pipeline is full; the ones beyond are skipped and counted
+const size_t kMaxDue = 4096;
+
+} // namespace {}
+
+
+struct LoadGenerator::Session final
+    : public boost::noncopyable
+{
+    explicit Session(boost::asio::io_context& io, const std::string& address, size_t index, size_t commands)
+        : index(index)
+        , connection(io, address)
+        , timer(io)
+        , stats(commands)
+        , nextCommand(index % commands)
+    {
+    }
+
+    size_t index;
+    Kes::Client::Connection connection;
+    boost::asio::steady_timer timer;
+    size_t outstanding = 0;
+    std::deque<uint64_t> due;           // send times postponed by the pipeline limit, at most kMaxDue
+    uint64_t skipped = 0;               // send times dropped because 'due' was full
+    std::vector<CommandStats> stats;
+    size_t nextCommand;
+    uint64_t interval = 0;
+    uint64_t nextDue = 0;
+    bool failing = false;               // a failure was reported and nothing has succeeded since
+    bool finished = false;
+};
+
+
+LoadGenerator::~LoadGenerator()
+{
+}
+
+LoadGenerator::LoadGenerator(boost::asio::io_context& io, const std::string& address, const LoadOptions& options)
+    : m_io(io)
+    , m_address(address)
+    , m_options(options)
+    , m_timer(io)
+{
+    if (m_options.commands.empty())
+        throw Kes::Exception(KES_HERE(), "No commands to issue");
+
+    if (!m_options.sessions || !m_options.pipeline)
+        throw Kes::Exception(KES_HERE(), "Session count and pipelining depth must be positive");
+
+}
+
+void LoadGenerator::start()
+{
+    for (size_t i = 0; i < m_options.sessions; ++i)
+        m_sessions.push_back(std::make_unique<Session>(m_io, m_address, i, m_options.commands.size()));
+
+    m_running = m_sessions.size();
+    m_started = Kes::Metrics::now();
+
+    for (auto& session: m_sessions)
+    {
+        if (m_options.rate > 0)
+        {
+            // sessions are spread over the interval so that they do not fire in bursts
+            session->interval = uint64_t(1e9 * double(m_options.sessions) / m_options.rate);
+            session->nextDue = m_started + session->interval * session->index / m_options.sessions;
+            schedule(*session);
+        }
+        else
+        {
+            for (size_t i = 0; i < m_options.pipeline; ++i)
+                send(*session, Kes::Metrics::now());
+        }
+    }
+
+    m_timer.expires_after(std::chrono::nanoseconds(uint64_t(m_options.duration * 1e9)));
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (!ec)
+                stop();
+        }
+    );
+}
+
+void LoadGenerator::stop() noexcept
+{
+    if (m_stopping)
+        return;
+
+    m_stopping = true;
+    m_stopped = Kes::Metrics::now();
+
+    for (auto& session: m_sessions)
+    {
+        session->due.clear();
+
+        boost::system::error_code ec;
+        session->timer.cancel(ec);
+
+        finishIfIdle(*session);
+    }
+
+    if (!m_running)
+        return;
+
+    // do not wait for a stuck server forever
+    m_timer.expires_after(kDrainTimeout);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec)
+                return;
+
+            for (auto& session: m_sessions)
+                finish(*session);
+        }
+    );
+}
+
+void LoadGenerator::schedule(Session& session)
+{
+    if (m_stopping)
+        return;
+
+    auto now = Kes::Metrics::now();
+    auto delay = (session.nextDue > now) ? (session.nextDue - now) : 0;
+
+    session.timer.expires_after(std::chrono::nanoseconds(delay));
+    session.timer.async_wait(
+        [this, &session](const boost::system::error_code& ec)
+        {
+            if (ec || m_stopping)
+                return;
+
+            // catch up on every send time that has passed
+            auto now = Kes::Metrics::now();
+            while (session.nextDue <= now)
+            {
+                if (session.outstanding < m_options.pipeline)
+                    send(session, session.nextDue);
+                else if (session.due.size() < kMaxDue)
+                    session.due.push_back(session.nextDue);
+                else
+                    ++session.skipped;
+
+                session.nextDue += session.interval;
+            }
+
+            schedule(session);
+        }
+    );
+}
+
+void LoadGenerator::send(Session& session, uint64_t started)
+{
+    auto command = session.nextCommand;
+    session.nextCommand = (session.nextCommand + 1) % m_options.commands.size();
+
+    ++session.outstanding;
+
+    session.connection.command(
+        m_options.commands[command].c_str(),
+        [this, &session, command, started](const boost::system::error_code& ec, const Kes::Client::ResponseView& response)
+        {
+            onResponse(session, command, started, ec, response);
+        }
+    );
+}
+
+void LoadGenerator::onResponse(Session& session, size_t command, uint64_t started, const boost::system::error_code& ec, const Kes::Client::ResponseView& response) noexcept
+{
+    auto now = Kes::Metrics::now();
+
+    --session.outstanding;
+
+    if (session.finished)
+        return;
+
+    if (ec)
+    {
+        // the connection reopens on the next request
+        if (!session.failing)
+            std::cerr << "Session " << session.index << ": " << ec.message() << "\n";
+
+        session.failing = true;
+        session.stats[command].lost();
+    }
+    else
+    {
+        session.failing = false;
+        session.stats[command].account(response, now - started);
+    }
+
+    if (m_stopping)
+    {
+        finishIfIdle(session);
+    }
+    else if (m_options.rate > 0)
+    {
+        if (!session.due.empty())
+        {
+            send(session, session.due.front());
+            session.due.pop_front();
+        }
+    }
+    else
+    {
+        send(session, now);
+    }
+}
+
+void LoadGenerator::finishIfIdle(Session& session) noexcept
+{
+    if (!session.outstanding)
+        finish(session);
+}
+
+void LoadGenerator::finish(Session& session) noexcept
+{
+    if (session.finished)
+        return;
+
+    session.finished = true;
+
+    boost::system::error_code ec;
+    session.timer.cancel(ec);
+
+    // whatever is still in flight completes with operation_aborted and is ignored
+    session.connection.stop();
+
+    sessionFinished();
+}
+
+void LoadGenerator::sessionFinished() noexcept
+{
+    if (m_running && (--m_running == 0))
+    {
+        boost::system::error_code ec;
+        m_timer.cancel(ec);
+        m_io.stop();
+    }
+}
+
+void LoadGenerator::report(std::ostream& out) const
+{
+    std::vector<CommandStats> total(m_options.commands.size());
+    uint64_t skipped = 0;
+    for (auto& session: m_sessions)
+    {
+        auto& stats = session->stats;
+        for (size_t i = 0; i < stats.size(); ++i)
+            total[i].merge(stats[i]);
+
+        skipped += session->skipped;
+    }
+
+    auto elapsed = double((m_stopped ? m_stopped : Kes::Metrics::now()) - m_started) / 1e9;
+
+    out << "sessions: " << m_options.sessions << ", pipeline: " << m_options.pipeline << ", ";
+    if (m_options.rate > 0)
+        out << "rate: " << m_options.rate << " req/s";
+    else
+        out << "closed loop";
+    out << ", elapsed: " << std::fixed << std::setprecision(2) << elapsed << " s\n";
+
+    if (skipped)
+        out << "skipped: " << skipped << " sends, the server fell behind the rate\n";
+
+    printStats(out, m_options.commands, total, elapsed);
+}
+
+
+} // namespace Kesctl {}
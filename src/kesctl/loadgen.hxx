@@ -0,0 +1,67 @@
+#pragma once
+
+#include "loadstats.hxx"
+
+#include <ostream>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+
+namespace Kesctl
+{
+
+struct LoadOptions
+{
+    size_t sessions = 1;
+    std::vector<std::string> commands;  // issued round-robin by every session
+    double rate = 0;                    // requests/s over all sessions; 0 means closed loop
+    size_t pipeline = 1;                // requests in flight per session
+    double duration = 10;               // seconds
+};
+
+
+//
+// drives N concurrent sessions, each on its own client connection, and measures
+// per-command latency; in the rate mode latency is counted from the scheduled send time, so a slow server
+// cannot hide its queueing by slowing the generator down
+//
+
+class LoadGenerator final
+    : public boost::noncopyable
+{
+public:
+    ~LoadGenerator();
+    explicit LoadGenerator(boost::asio::io_context& io, const std::string& address, const LoadOptions& options);
+
+    // starts issuing requests; the connections are opened by the first ones
+    void start();
+
+    // stops issuing requests; in-flight ones are still awaited for a while
+    void stop() noexcept;
+
+    void report(std::ostream& out) const;
+
+private:
+    struct Session;
+
+    void schedule(Session& session);
+    void send(Session& session, uint64_t started);
+    void onResponse(Session& session, size_t command, uint64_t started, const boost::system::error_code& ec, const Kes::Client::ResponseView& response) noexcept;
+    void finishIfIdle(Session& session) noexcept;
+    void finish(Session& session) noexcept;
+    void sessionFinished() noexcept;
+
+    boost::asio::io_context& m_io;
+    std::string m_address;
+    LoadOptions m_options;
+    std::vector<std::unique_ptr<Session>> m_sessions;
+    boost::asio::steady_timer m_timer;
+    size_t m_running = 0;
+    bool m_stopping = false;
+    uint64_t m_started = 0;
+    uint64_t m_stopped = 0;
+};
+
+
+} // namespace Kesctl {}
@@ -0,0 +1,104 @@
+#include "loadstats.hxx"
+
+#include <iomanip>
+
+
+namespace Kesctl
+{
+
+namespace
+{
+
+size_t findValue(std::string_view json, std::string_view key) noexcept
+{
+    auto pos = json.find(key);
+    if (pos == std::string_view::npos)
+        return pos;
+
+    pos += key.length();
+    while ((pos < json.length()) && ((json[pos] == ' ') || (json[pos] == ':')))
+        ++pos;
+
+    return pos;
+}
+
+} // namespace {}
+
+
+void CommandStats::account(const Kes::Client::ResponseView& response, uint64_t latencyNs)
+{
+    ++completed;
+    latency.record(latencyNs);
+
+    if (!response.success())
+        ++errors;
+}
+
+
+void printStats(std::ostream& out, const std::vector<std::string>& commands, const std::vector<CommandStats>& stats, double elapsed)
+{
+    out << std::left << std::setw(18) << "command" << std::right
+        << std::setw(10) << "requests" << std::setw(8) << "errors" << std::setw(11) << "req/s"
+        << std::setw(11) << "p50 us" << std::setw(11) << "p90 us" << std::setw(11) << "p99 us" << std::setw(11) << "p99.9 us" << std::setw(11) << "max us" << "\n";
+
+    auto us = [](uint64_t ns) { return double(ns) / 1000.0; };
+
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        auto& s = stats[i];
+        out << std::left << std::setw(18) << commands[i] << std::right
+            << std::setw(10) << s.completed << std::setw(8) << s.errors
+            << std::fixed << std::setprecision(1)
+            << std::setw(11) << (elapsed > 0 ? double(s.completed) / elapsed : 0.0)
+            << std::setw(11) << us(s.latency.percentile(0.5)) << std::setw(11) << us(s.latency.percentile(0.9))
+            << std::setw(11) << us(s.latency.percentile(0.99)) << std::setw(11) << us(s.latency.percentile(0.999))
+            << std::setw(11) << us(s.latency.max()) << "\n";
+    }
+}
+
+bool findString(std::string_view json, std::string_view key, std::string& value)
+{
+    auto pos = findValue(json, key);
+    if ((pos >= json.length()) || (json[pos] != '"'))
+        return false;
+
+    auto end = json.find('"', pos + 1);
+    if (end == std::string_view::npos)
+        return false;
+
+    value.assign(json.substr(pos + 1, end - pos - 1));
+    return true;
+}
+
+bool eraseInt(std::string& json, std::string_view key)
+{
+    auto begin = json.find(key);
+    auto pos = findValue(json, key);
+    if (pos >= json.length())
+        return false;
+
+    char* end = nullptr;
+    std::strtoll(json.data() + pos, &end, 10);
+    if (end == json.data() + pos)
+        return false;
+
+    // the comma after the pair, or else the one before it
+    auto stop = size_t(end - json.data());
+    auto next = json.find_first_not_of(" \t\r\n", stop);
+    if ((next != std::string::npos) && (json[next] == ','))
+    {
+        stop = next + 1;
+    }
+    else if (begin > 0)
+    {
+        auto prev = json.find_last_not_of(" \t\r\n", begin - 1);
+        if ((prev != std::string::npos) && (json[prev] == ','))
+            begin = prev;
+    }
+
+    json.erase(begin, stop - begin);
+    return true;
+}
+
+
+} // namespace Kesctl {}
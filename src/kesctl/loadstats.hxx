@@ -0,0 +1,47 @@
+#pragma once
+
+#include <kesclient/response.hxx>
+#include <kesrv/metrics/histogram.hxx>
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+
+namespace Kesctl
+{
+
+struct CommandStats
+{
+    uint64_t completed = 0;
+    uint64_t errors = 0;        // failed responses and requests lost with the connection
+    Kes::Metrics::Histogram latency;
+
+    void merge(const CommandStats& other)
+    {
+        completed += other.completed;
+        errors += other.errors;
+        latency.merge(other.latency);
+    }
+
+    // a response the connection has matched to its request: checks the status and records the latency
+    void account(const Kes::Client::ResponseView& response, uint64_t latencyNs);
+
+    void lost() noexcept
+    {
+        ++errors;
+    }
+};
+
+
+// prints a table with throughput and latency percentiles, one row per command
+void printStats(std::ostream& out, const std::vector<std::string>& commands, const std::vector<CommandStats>& stats, double elapsed);
+
+// looks for a top-level "key":"<string>" without parsing the whole JSON
+bool findString(std::string_view json, std::string_view key, std::string& value);
+
+// removes a top-level "key":<integer> and the comma that separates it
+bool eraseInt(std::string& json, std::string_view key);
+
+
+} // namespace Kesctl {}
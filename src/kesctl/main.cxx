@@ -1,9 +1,14 @@
-#include "client.hxx"
+#include "loadgen.hxx"
+#include "replay.hxx"
+#include "watch.hxx"
 
-#include <kesrv/util/netutil.hxx>
-#include <kesrv/util/requestutil.hxx>
+#include <kesclient/connection.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/processmanager/snapshot.hxx>
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
@@ -11,6 +16,8 @@
 
 int main(int argc, char* argv[])
 {
+    int result = EXIT_SUCCESS;
+
     try
     {
         namespace po = boost::program_options;
@@ -18,15 +25,31 @@ int main(int argc, char* argv[])
         options.add_options()
             ("help,h", "display this message")
             ("verbose,v", "display debug output")
-            ("address,a", po::value<std::string>(), "server address:port")
+            ("address,a", po::value<std::string>(), "server address:port, unix:/path or unix:@abstract-name")
             ("command,c", po::value<std::string>(), "execute command")
+            ("load,l", "generate load instead of executing a single command")
+            ("sessions,n", po::value<size_t>()->default_value(1), "load: concurrent sessions")
+            ("commands", po::value<std::string>()->default_value("list_processes,diff_processes"), "load: comma-separated commands issued round-robin")
+            ("rate,r", po::value<double>(), "load: target request rate over all sessions, req/s (closed loop if omitted)")
+            ("pipeline,p", po::value<size_t>()->default_value(1), "load: requests in flight per session")
+            ("duration,t", po::value<double>()->default_value(10), "load: duration, seconds")
+            ("watch,w", "poll diff_processes and display a top-like view")
+            ("interval,i", po::value<double>()->default_value(1.0), "watch: poll interval, seconds")
+            ("sort", po::value<std::string>()->default_value("pid"), "watch: sort key, one of pid, ppid, uid, comm, cpu")
+            ("reverse", "watch: reverse the sort order")
+            ("count", po::value<size_t>()->default_value(0), "watch: exit after this many refreshes (0 = run until interrupted)")
+            ("limit", po::value<size_t>()->default_value(0), "watch: only fetch this many processes in the sort order (0 = all)")
+            ("filter", po::value<std::string>(), "watch: only show the processes matching this expression, e.g. \"uid == 1000 and comm ~ 'nginx*'\"")
+            ("shm", po::value<std::string>()->implicit_value(std::string(Kes::Snapshot::DefaultName)), "watch: read the snapshots the server publishes in this shared memory region")
+            ("replay", po::value<std::string>(), "re-issue the requests from a server capture file")
+            ("speed", po::value<double>()->default_value(1.0), "replay: time scale, 2 is twice as fast, 0 is as fast as possible")
         ;
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, options), vm);
         po::notify(vm);
 
-        if (vm.count("help") || !vm.count("command"))
+        if (vm.count("help") || (!vm.count("command") && !vm.count("load") && !vm.count("replay") && !vm.count("watch")))
         {
             std::cerr << options << "\n";
             return EXIT_SUCCESS;
@@ -44,10 +67,6 @@ int main(int argc, char* argv[])
 
         boost::asio::io_context io;
 
-        auto endpoint = Kes::Util::splitAddress(addr);
-
-        Kesctl::Client client(io, endpoint.first.c_str(), endpoint.second, verbose, std::cout, std::cerr);
-
         boost::asio::signal_set signals(io);
         signals.add(SIGINT);
         signals.add(SIGTERM);
@@ -55,19 +74,127 @@ int main(int argc, char* argv[])
         signals.add(SIGPIPE);
         signals.add(SIGHUP);
 #endif
-        signals.async_wait(
-            [&io, &client]([[maybe_unused]] boost::system::error_code ec, [[maybe_unused]] int signo)
+
+        if (vm.count("watch"))
+        {
+            Kesctl::WatchOptions watchOptions;
+            watchOptions.interval = vm["interval"].as<double>();
+            watchOptions.sort = vm["sort"].as<std::string>();
+            watchOptions.reverse = (vm.count("reverse") > 0);
+            watchOptions.count = vm["count"].as<size_t>();
+            watchOptions.limit = vm["limit"].as<size_t>();
+            if (vm.count("shm"))
+                watchOptions.snapshot = vm["shm"].as<std::string>();
+
+            if (vm.count("filter"))
+                watchOptions.filter = vm["filter"].as<std::string>();
+
+            Kesctl::Watcher watcher(io, addr, watchOptions, std::cout);
+
+            signals.async_wait(
+                [&watcher]([[maybe_unused]] boost::system::error_code ec, [[maybe_unused]] int signo)
+                {
+                    watcher.stop();
+                }
+            );
+
+            watcher.start();
+
+            io.run();
+        }
+        else if (vm.count("replay"))
+        {
+            auto fileName = vm["replay"].as<std::string>();
+            std::ifstream file(fileName, std::ios::binary);
+            if (!file)
+                throw Kes::Exception(KES_HERE(), "Failed to open " + fileName);
+
+            Kesctl::Replayer replayer(io, addr, file, vm["speed"].as<double>());
+
+            signals.async_wait(
+                [&replayer]([[maybe_unused]] boost::system::error_code ec, [[maybe_unused]] int signo)
+                {
+                    replayer.stop();
+                }
+            );
+
+            replayer.start();
+
+            io.run();
+
+            replayer.report(std::cout);
+        }
+        else if (vm.count("load"))
+        {
+            Kesctl::LoadOptions loadOptions;
+            loadOptions.sessions = vm["sessions"].as<size_t>();
+            loadOptions.pipeline = vm["pipeline"].as<size_t>();
+            loadOptions.duration = vm["duration"].as<double>();
+            if (vm.count("rate"))
+                loadOptions.rate = vm["rate"].as<double>();
+
+            std::istringstream commands(vm["commands"].as<std::string>());
+            std::string command;
+            while (std::getline(commands, command, ','))
             {
-                client.stop();
-                io.stop();
+                if (!command.empty())
+                    loadOptions.commands.push_back(command);
             }
-        );
 
+            Kesctl::LoadGenerator generator(io, addr, loadOptions);
+
+            signals.async_wait(
+                [&generator]([[maybe_unused]] boost::system::error_code ec, [[maybe_unused]] int signo)
+                {
+                    generator.stop();
+                }
+            );
 
-        auto cmd = vm["command"].as<std::string>();
-        client.command(Kes::Util::Request::simple(1, cmd.c_str()));
+            generator.start();
 
-        io.run();
+            io.run();
+
+            generator.report(std::cout);
+        }
+        else
+        {
+            Kes::Client::Connection connection(io, addr);
+
+            signals.async_wait(
+                [&io, &connection]([[maybe_unused]] boost::system::error_code ec, [[maybe_unused]] int signo)
+                {
+                    connection.stop();
+                    io.stop();
+                }
+            );
+
+            auto cmd = vm["command"].as<std::string>();
+            if (verbose)
+                std::cout << "Sending " << cmd << " to " << addr << "\n";
+
+            connection.command(
+                cmd.c_str(),
+                [&io, &result, verbose](const boost::system::error_code& ec, const Kes::Client::ResponseView& response)
+                {
+                    if (ec)
+                    {
+                        std::cerr << "Request failed: " << ec.message() << "\n";
+                        result = EXIT_FAILURE;
+                    }
+                    else
+                    {
+                        if (verbose)
+                            std::cout << "Received " << response.json().size() << " bytes\n";
+
+                        std::cout << response.json() << "\n";
+                    }
+
+                    io.stop();
+                }
+            );
+
+            io.run();
+        }
 
         Kes::finalize();
     }
@@ -77,5 +204,5 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
+    return result;
 }
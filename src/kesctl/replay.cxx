@@ -0,0 +1,314 @@
+#include "replay.hxx"
+
+#include <kesclient/connection.hxx>
+#include <kesrv/metrics/metrics.hxx>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+
+namespace Kesctl
+{
+
+struct Replayer::Session final
+    : public boost::noncopyable
+{
+    struct Request
+    {
+        uint64_t time;
+        std::string data;
+        size_t command;
+    };
+
+    explicit Session(boost::asio::io_context& io, uint32_t id)
+        : id(id)
+        , timer(io)
+    {
+    }
+
+    void setStart(uint64_t time) noexcept
+    {
+        start = time;
+        hasStart = true;
+    }
+
+    void add(Request&& request)
+    {
+        if (!hasStart)
+            setStart(request.time);
+
+        requests.push_back(std::move(request));
+    }
+
+    uint32_t id;
+    boost::asio::steady_timer timer;
+    std::unique_ptr<Kes::Client::Connection> connection;    // opened at the captured start
+    std::vector<Request> requests;
+    size_t next = 0;
+    size_t outstanding = 0;
+    uint64_t start = 0;
+    bool hasStart = false;
+    std::vector<CommandStats> stats;
+    bool failing = false;       // a failure was reported and nothing has succeeded since
+    bool closed = false;
+};
+
+
+Replayer::~Replayer()
+{
+}
+
+Replayer::Replayer(boost::asio::io_context& io, const std::string& address, std::istream& capture, double speed)
+    : m_io(io)
+    , m_address(address)
+    , m_speed(speed)
+{
+    // session ids may be reused by the server after a restart: a new start opens a new session
+    std::unordered_map<uint32_t, Session*> active;
+
+    Kes::Capture::Reader reader(capture);
+    Kes::Capture::Record record;
+    while (reader.next(record))
+    {
+        auto it = active.find(record.session);
+
+        switch (record.type)
+        {
+        case Kes::Capture::RecordType::SessionStarted:
+        {
+            m_sessions.push_back(std::make_unique<Session>(m_io, record.session));
+            m_sessions.back()->setStart(record.time);
+            active[record.session] = m_sessions.back().get();
+            break;
+        }
+
+        case Kes::Capture::RecordType::SessionFinished:
+            if (it != active.end())
+                active.erase(it);
+            break;
+
+        case Kes::Capture::RecordType::Request:
+        {
+            if (it == active.end())
+            {
+                // the capture may start in the middle of a session
+                m_sessions.push_back(std::make_unique<Session>(m_io, record.session));
+                it = active.insert({ record.session, m_sessions.back().get() }).first;
+            }
+
+            std::string name;
+            if (!findString(record.data, "\"request.request\"", name))
+                name = "<unknown>";
+
+            // replaying a captured stop would shut the target server down mid-replay
+            if (name == "stop")
+                break;
+
+            // the connection numbers its requests itself
+            eraseInt(record.data, "\"request.id\"");
+
+            auto command = commandIndex(name);
+            it->second->add({ record.time, std::move(record.data), command });
+            ++m_requests;
+            break;
+        }
+        }
+    }
+}
+
+size_t Replayer::commandIndex(const std::string& command)
+{
+    auto it = std::find(m_commands.begin(), m_commands.end(), command);
+    if (it != m_commands.end())
+        return size_t(it - m_commands.begin());
+
+    m_commands.push_back(command);
+    return m_commands.size() - 1;
+}
+
+uint64_t Replayer::scaled(uint64_t time) const noexcept
+{
+    return (m_speed > 0) ? uint64_t(double(time) / m_speed) : 0;
+}
+
+void Replayer::start()
+{
+    m_started = Kes::Metrics::now();
+    m_running = m_sessions.size();
+
+    if (!m_running)
+    {
+        m_io.stop();
+        return;
+    }
+
+    for (auto& session: m_sessions)
+    {
+        auto s = session.get();
+        wait(
+            *s,
+            scaled(s->start),
+            [this, s]()
+            {
+                try
+                {
+                    s->connection = std::make_unique<Kes::Client::Connection>(m_io, m_address);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Session " << s->id << ": " << e.what() << "\n";
+                    close(*s);
+                    return;
+                }
+
+                s->stats.resize(m_commands.size());
+                sendDue(*s);
+            }
+        );
+    }
+}
+
+void Replayer::stop() noexcept
+{
+    if (m_stopping)
+        return;
+
+    m_stopping = true;
+
+    for (auto& session: m_sessions)
+        close(*session);
+}
+
+template <typename F>
+void Replayer::wait(Session& session, uint64_t at, F&& then)
+{
+    auto now = Kes::Metrics::now() - m_started;
+
+    session.timer.expires_after(std::chrono::nanoseconds(at > now ? at - now : 0));
+    session.timer.async_wait(
+        [&session, then = std::forward<F>(then)](const boost::system::error_code& ec)
+        {
+            if (!ec && !session.closed)
+                then();
+        }
+    );
+}
+
+// sends every request whose time has come, then sleeps until the next one
+void Replayer::sendDue(Session& session)
+{
+    auto now = Kes::Metrics::now() - m_started;
+    while ((session.next < session.requests.size()) && (scaled(session.requests[session.next].time) <= now))
+    {
+        auto& request = session.requests[session.next++];
+        auto command = request.command;
+        auto started = Kes::Metrics::now();
+
+        try
+        {
+            // the capture is no longer needed once sent
+            session.connection->send(
+                std::move(request.data),
+                [this, &session, command, started](const boost::system::error_code& ec, const Kes::Client::ResponseView& response)
+                {
+                    onResponse(session, command, started, ec, response);
+                }
+            );
+
+            ++session.outstanding;
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Session " << session.id << ": " << e.what() << "\n";
+            session.stats[command].lost();
+        }
+    }
+
+    if (session.next < session.requests.size())
+        wait(session, scaled(session.requests[session.next].time), [this, &session]() { sendDue(session); });
+    else
+        finishIfDone(session);
+}
+
+void Replayer::onResponse(Session& session, size_t command, uint64_t started, const boost::system::error_code& ec, const Kes::Client::ResponseView& response) noexcept
+{
+    --session.outstanding;
+
+    if (session.closed)
+        return;
+
+    if (ec)
+    {
+        // the connection reopens on the next request
+        if (!session.failing)
+            std::cerr << "Session " << session.id << ": " << ec.message() << "\n";
+
+        session.failing = true;
+        session.stats[command].lost();
+    }
+    else
+    {
+        session.failing = false;
+        session.stats[command].account(response, Kes::Metrics::now() - started);
+    }
+
+    finishIfDone(session);
+}
+
+void Replayer::finishIfDone(Session& session) noexcept
+{
+    if ((session.next == session.requests.size()) && !session.outstanding)
+        close(session);
+}
+
+void Replayer::close(Session& session) noexcept
+{
+    if (session.closed)
+        return;
+
+    session.closed = true;
+
+    boost::system::error_code ec;
+    session.timer.cancel(ec);
+
+    if (session.connection)
+        session.connection->stop();
+
+    sessionFinished();
+}
+
+void Replayer::sessionFinished() noexcept
+{
+    if (m_running && (--m_running == 0))
+    {
+        m_finished = Kes::Metrics::now();
+        m_io.stop();
+    }
+}
+
+void Replayer::report(std::ostream& out) const
+{
+    std::vector<CommandStats> total(m_commands.size());
+    for (auto& session: m_sessions)
+    {
+        auto& stats = session->stats;
+        for (size_t i = 0; i < stats.size(); ++i)
+            total[i].merge(stats[i]);
+    }
+
+    auto elapsed = double((m_finished ? m_finished : Kes::Metrics::now()) - m_started) / 1e9;
+
+    out << "sessions: " << m_sessions.size() << ", requests: " << m_requests << ", speed: ";
+    if (m_speed > 0)
+        out << m_speed << "x";
+    else
+        out << "max";
+    out << ", elapsed: " << std::fixed << std::setprecision(2) << elapsed << " s\n";
+
+    printStats(out, m_commands, total, elapsed);
+}
+
+
+} // namespace Kesctl {}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "loadstats.hxx"
+
+#include <kesrv/capture.hxx>
+
+#include <ostream>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+
+namespace Kesctl
+{
+
+//
+// re-issues a server capture: every captured session gets its own connection, fed at
+// the captured times divided by 'speed' (0 means as fast as possible); the captured
+// request ids are replaced by the connection's own
+//
+
+class Replayer final
+    : public boost::noncopyable
+{
+public:
+    ~Replayer();
+    explicit Replayer(boost::asio::io_context& io, const std::string& address, std::istream& capture, double speed);
+
+    void start();
+    void stop() noexcept;
+
+    void report(std::ostream& out) const;
+
+private:
+    struct Session;
+
+    size_t commandIndex(const std::string& command);
+    uint64_t scaled(uint64_t time) const noexcept;
+
+    template <typename F>
+    void wait(Session& session, uint64_t at, F&& then);
+    void sendDue(Session& session);
+    void onResponse(Session& session, size_t command, uint64_t started, const boost::system::error_code& ec, const Kes::Client::ResponseView& response) noexcept;
+    void finishIfDone(Session& session) noexcept;
+    void close(Session& session) noexcept;
+    void sessionFinished() noexcept;
+
+    boost::asio::io_context& m_io;
+    std::string m_address;
+    double m_speed;
+    std::vector<std::string> m_commands;
+    std::vector<std::unique_ptr<Session>> m_sessions;
+    size_t m_requests = 0;
+    size_t m_running = 0;
+    bool m_stopping = false;
+    uint64_t m_started = 0;
+    uint64_t m_finished = 0;
+};
+
+
+} // namespace Kesctl {}
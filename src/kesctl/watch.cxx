@@ -0,0 +1,491 @@
+#include "watch.hxx"
+
+#include <kesrv/exception.hxx>
+#include <kesrv/metrics/metrics.hxx>
+
+#include <algorithm>
+#include <cstring>
+
+#if !KES_WINDOWS
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+
+namespace Kesctl
+{
+
+namespace
+{
+
+// used when the output is not a terminal
+const size_t kDefaultRows = 25;
+const size_t kDefaultColumns = 120;
+
+// the header takes this many lines
+const size_t kHeaderRows = 3;
+
+
+void terminalSize(size_t& rows, size_t& columns) noexcept
+{
+    rows = kDefaultRows;
+    columns = kDefaultColumns;
+
+#if !KES_WINDOWS
+    struct winsize ws = {};
+    if ((::ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) && ws.ws_row && ws.ws_col)
+    {
+        rows = ws.ws_row;
+        columns = ws.ws_col;
+    }
+#endif
+}
+
+bool isTerminal() noexcept
+{
+#if !KES_WINDOWS
+    return ::isatty(STDOUT_FILENO) != 0;
+#else
+    return false;
+#endif
+}
+
+// as a JSON string literal
+std::string quoted(const std::string& s)
+{
+    std::string result("\"");
+    for (auto c: s)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            result.push_back('\\');
+            result.push_back(c);
+        }
+        else if (uint8_t(c) < 0x20)
+        {
+            char buffer[8];
+            ::snprintf(buffer, sizeof(buffer), "\\u%04x", unsigned(c));
+            result.append(buffer);
+        }
+        else
+        {
+            result.push_back(c);
+        }
+    }
+
+    result.push_back('"');
+    return result;
+}
+
+template <typename Value>
+void appendField(std::string& line, const char* format, Value value)
+{
+    char buffer[16];
+    auto length = ::snprintf(buffer, sizeof(buffer), format, value);
+    if (length > 0)
+        line.append(buffer, std::min(size_t(length), sizeof(buffer) - 1));
+}
+
+void appendPadded(std::string& line, const std::string& s, size_t width)
+{
+    line.append(s, 0, width);
+    if (s.length() < width)
+        line.append(width - s.length(), ' ');
+}
+
+} // namespace {}
+
+
+Watcher::~Watcher()
+{
+    if (m_terminal)
+        m_out << "\x1b[?25h" << std::flush; // show the cursor
+}
+
+Watcher::Watcher(boost::asio::io_context& io, const std::string& address, const WatchOptions& options, std::ostream& out)
+    : m_io(io)
+    , m_options(options)
+    , m_out(out)
+    , m_terminal(isTerminal())
+    , m_server(address)
+    , m_connection(io, address)
+    , m_timer(io)
+{
+    if (m_options.sort == "pid")
+        m_sort = SortKey::Pid;
+    else if (m_options.sort == "ppid")
+        m_sort = SortKey::PPid;
+    else if (m_options.sort == "uid")
+        m_sort = SortKey::Uid;
+    else if (m_options.sort == "comm")
+        m_sort = SortKey::Comm;
+    else if (m_options.sort == "cpu")
+        m_sort = SortKey::Cpu;
+    else
+        throw Kes::Exception(KES_HERE(), "Unknown sort key: " + m_options.sort);
+
+    if (m_options.interval <= 0)
+        throw Kes::Exception(KES_HERE(), "The poll interval must be positive");
+
+    if (!m_options.snapshot.empty())
+    {
+#if KES_LINUX
+        m_snapshot.reset(new Kes::Client::SnapshotReader(m_options.snapshot));
+        m_server = "shm:" + m_options.snapshot;
+#else
+        throw Kes::Exception(KES_HERE(), "Shared memory snapshots are not supported on this platform");
+#endif
+    }
+}
+
+void Watcher::start()
+{
+    if (m_terminal)
+        m_out << "\x1b[?25l\x1b[2J" << std::flush; // hide the cursor, clear the screen
+
+    m_due = boost::asio::steady_timer::clock_type::now();
+    poll();
+}
+
+void Watcher::stop() noexcept
+{
+    if (m_stopped)
+        return;
+
+    m_stopped = true;
+
+    boost::system::error_code ec;
+    m_timer.cancel(ec);
+
+    m_connection.stop();
+    m_io.stop();
+}
+
+void Watcher::poll() noexcept
+{
+    if (m_stopped)
+        return;
+
+#if KES_LINUX
+    if (m_snapshot)
+    {
+        pollSnapshot();
+        return;
+    }
+#endif
+
+    m_sent = Kes::Metrics::now();
+
+    try
+    {
+        auto callback = [this](const boost::system::error_code& ec, const Kes::Client::ResponseView& response)
+        {
+            onResponse(ec, response);
+        };
+
+        // a new session resumes from the last token instead of pulling the full list again
+        auto resume = m_initial && !m_list.token.empty();
+        if (!resume && m_options.filter.empty() && !m_options.limit)
+        {
+            m_connection.command(m_initial ? "list_processes" : "diff_processes", callback);
+        }
+        else
+        {
+            std::string request("{\"request.request\":");
+            request.append((m_initial && !resume) ? "\"list_processes\"" : "\"diff_processes\"");
+
+            if (resume)
+                request.append(",\"process.token\":").append(quoted(m_list.token));
+
+            if (!m_options.filter.empty())
+                request.append(",\"process.filter\":").append(quoted(m_options.filter));
+
+            // the server picks the top entries in the same order the table is shown in
+            if (m_options.limit)
+            {
+                request.append(",\"process.sort_by\":").append(quoted(m_options.sort));
+                request.append(",\"process.order\":").append(m_options.reverse ? "\"desc\"" : "\"asc\"");
+                request.append(",\"process.limit\":").append(std::to_string(m_options.limit));
+            }
+
+            request.push_back('}');
+            m_connection.send(request, callback);
+        }
+    }
+    catch (std::exception& e)
+    {
+        m_status = e.what();
+        render();
+        stop();
+    }
+}
+
+void Watcher::pollSnapshot() noexcept
+{
+#if KES_LINUX
+    m_sent = Kes::Metrics::now();
+
+    try
+    {
+        if (!m_snapshot->read(m_list))
+        {
+            m_status = "no snapshot available";
+        }
+        else
+        {
+            m_latency = Kes::Metrics::now() - m_sent;
+
+            // a snapshot is a full list: the rows it no longer has are the deleted processes
+            m_pids.clear();
+            for (auto& entry: m_list.processes)
+            {
+                entry.newcomer = !m_initial && !m_rows.count(entry.pid);
+                m_pids.push_back(entry.pid);
+            }
+
+            std::sort(m_pids.begin(), m_pids.end());
+            for (auto& row: m_rows)
+            {
+                if (!std::binary_search(m_pids.begin(), m_pids.end(), row.first))
+                    m_list.deleted.push_back(row.first);
+            }
+
+            apply(false);
+
+            m_initial = false;
+            m_status.clear();
+        }
+    }
+    catch (std::exception& e)
+    {
+        m_status = e.what();
+    }
+
+    frameDone();
+#endif
+}
+
+// polls run at a fixed rate; a slow response delays the next poll but does not shift the schedule
+void Watcher::schedule() noexcept
+{
+    if (m_stopped)
+        return;
+
+    auto interval = std::chrono::duration_cast<boost::asio::steady_timer::duration>(std::chrono::duration<double>(m_options.interval));
+    auto now = boost::asio::steady_timer::clock_type::now();
+
+    m_due += interval;
+    if (m_due < now)
+        m_due = now;
+
+    m_timer.expires_at(m_due);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (!ec)
+                poll();
+        }
+    );
+}
+
+void Watcher::onResponse(const boost::system::error_code& ec, const Kes::Client::ResponseView& response) noexcept
+{
+    if (m_stopped)
+        return;
+
+    if (ec)
+    {
+        // the next connection is a new server session: start over with a full list
+        m_initial = true;
+        m_status = "request failed: " + ec.message() + ", retrying";
+    }
+    else if (!response.success())
+    {
+        m_status = "server error: " + std::string(response.reason());
+    }
+    else
+    {
+        m_latency = Kes::Metrics::now() - m_sent;
+
+        try
+        {
+            Kes::Client::decodeProcesses(response.json(), m_list);
+            apply(m_initial && !m_list.resumed);
+
+            m_initial = false;
+            m_status.clear();
+        }
+        catch (std::exception& e)
+        {
+            m_initial = true;
+            m_status = e.what();
+        }
+    }
+
+    frameDone();
+}
+
+void Watcher::frameDone() noexcept
+{
+    render();
+
+    if (m_options.count && (++m_frames >= m_options.count))
+        stop();
+    else
+        schedule();
+}
+
+// existing rows keep their string buffers, so steady-state updates do not allocate
+void Watcher::apply(bool initial)
+{
+    if (initial)
+        m_rows.clear();
+
+    m_added = 0;
+    m_removed = 0;
+
+    for (auto& entry: m_list.processes)
+    {
+        auto result = m_rows.try_emplace(entry.pid);
+        if (result.second)
+            ++m_added;
+
+        auto& row = result.first->second;
+        row.pid = entry.pid;
+        row.ppid = entry.ppid;
+        row.pgrp = entry.pgrp;
+        row.tpgid = entry.tpgid;
+        row.session = entry.session;
+        row.ruid = entry.ruid;
+        row.cpu = entry.cpu;
+        row.newcomer = entry.newcomer;
+        row.comm.assign(entry.comm);
+        row.statComm.assign(entry.statComm);
+        row.exe.assign(entry.exe);
+        row.cmdLine.assign(entry.cmdLine);
+        row.error.assign(entry.error);
+    }
+
+    for (auto pid: m_list.deleted)
+    {
+        if (m_rows.erase(pid))
+            ++m_removed;
+    }
+}
+
+bool Watcher::less(const Row* a, const Row* b) const noexcept
+{
+    int c = 0;
+    switch (m_sort)
+    {
+    case SortKey::Pid: break;
+    case SortKey::PPid: c = (a->ppid < b->ppid) ? -1 : (a->ppid > b->ppid); break;
+    case SortKey::Uid: c = (a->ruid < b->ruid) ? -1 : (a->ruid > b->ruid); break;
+    case SortKey::Comm: c = a->comm.compare(b->comm); break;
+    case SortKey::Cpu: c = (a->cpu < b->cpu) ? -1 : (a->cpu > b->cpu); break;
+    }
+
+    if (!c)
+        c = (a->pid < b->pid) ? -1 : (a->pid > b->pid);
+
+    return m_options.reverse ? (c > 0) : (c < 0);
+}
+
+void Watcher::render() noexcept
+{
+    try
+    {
+        size_t rows = kDefaultRows;
+        size_t columns = kDefaultColumns;
+        if (m_terminal)
+            terminalSize(rows, columns);
+
+        auto visible = (rows > kHeaderRows) ? std::min(rows - kHeaderRows, m_rows.size()) : 0;
+
+        // only the visible rows need to be ordered
+        m_order.clear();
+        for (auto& row: m_rows)
+            m_order.push_back(&row.second);
+
+        std::partial_sort(m_order.begin(), m_order.begin() + visible, m_order.end(), [this](const Row* a, const Row* b) { return less(a, b); });
+
+        m_screen.clear();
+
+        auto endLine = [this, columns](size_t start)
+        {
+            if (m_screen.size() - start > columns)
+                m_screen.resize(start + columns);
+
+            if (m_terminal)
+                m_screen.append("\x1b[K");
+
+            m_screen.push_back('\n');
+        };
+
+        if (m_terminal)
+            m_screen.append("\x1b[H");
+
+        auto start = m_screen.size();
+        char line[256];
+        auto length = ::snprintf(line, sizeof(line), "%s  processes: %zu  new: %zu  gone: %zu  poll: %.1f ms  every %.1f s  sort: %s%s",
+            m_server.c_str(), m_rows.size(), m_added, m_removed, double(m_latency) / 1e6, m_options.interval, m_options.sort.c_str(), m_options.reverse ? " (reverse)" : "");
+        if (length > 0)
+            m_screen.append(line, std::min(size_t(length), sizeof(line) - 1));
+        if (m_list.systemBusy >= 0)
+            appendField(m_screen, "  cpu: %.1f%%", m_list.systemBusy);
+        endLine(start);
+
+        start = m_screen.size();
+        m_screen.append(m_status);
+        endLine(start);
+
+        start = m_screen.size();
+        if (m_terminal)
+            m_screen.append("\x1b[7m");
+        m_screen.append("    PID    PPID    UID   CPU% COMM             COMMAND");
+        endLine(start + (m_terminal ? 4 : 0));
+        if (m_terminal)
+            m_screen.append("\x1b[0m");
+
+        for (size_t i = 0; i < visible; ++i)
+        {
+            auto row = m_order[i];
+
+            if (m_terminal && row->newcomer)
+                m_screen.append("\x1b[1m");
+
+            auto textStart = m_screen.size();
+
+            appendField(m_screen, "%7d ", row->pid);
+            appendField(m_screen, "%7d ", row->ppid);
+            appendField(m_screen, "%6d ", row->ruid);
+            if (row->cpu < 0)
+                m_screen.append("     - ");
+            else
+                appendField(m_screen, "%6.1f ", row->cpu);
+            appendPadded(m_screen, row->comm, 16);
+            m_screen.push_back(' ');
+            m_screen.append(row->error.empty() ? row->cmdLine : row->error);
+
+            endLine(textStart);
+
+            if (m_terminal && row->newcomer)
+                m_screen.append("\x1b[0m");
+        }
+
+        if (m_terminal)
+            m_screen.append("\x1b[J");
+        else
+            m_screen.push_back('\n');
+
+        m_out.write(m_screen.data(), std::streamsize(m_screen.size()));
+        m_out.flush();
+    }
+    catch (...)
+    {
+        // not much we can do here
+    }
+}
+
+
+} // namespace Kesctl {}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <kesclient/connection.hxx>
+#include <kesclient/processlist.hxx>
+#if KES_LINUX
+    #include <kesclient/snapshotreader.hxx>
+#endif
+
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+
+namespace Kesctl
+{
+
+struct WatchOptions
+{
+    double interval = 1;            // seconds between polls
+    std::string sort = "pid";       // pid, ppid, uid or comm
+    bool reverse = false;
+    size_t count = 0;               // refreshes before exiting; 0 means until interrupted
+    std::string snapshot;           // shared memory region to read instead of polling the server
+    std::string filter;             // server-side filter expression
+    size_t limit = 0;               // ask the server for the first entries in the sort order only; 0 means all
+};
+
+
+//
+// polls diff_processes over one connection and applies the deltas to a local process table,
+// then renders a top-like view of it; the decoded list, the table rows and the screen buffer
+// are reused between polls, so memory stays proportional to the process count;
+// alternatively reads the snapshots a server publishes in shared memory
+//
+
+class Watcher final
+    : public boost::noncopyable
+{
+public:
+    ~Watcher();
+    explicit Watcher(boost::asio::io_context& io, const std::string& address, const WatchOptions& options, std::ostream& out);
+
+    void start();
+    void stop() noexcept;
+
+private:
+    enum class SortKey
+    {
+        Pid,
+        PPid,
+        Uid,
+        Comm,
+        Cpu
+    };
+
+    using Row = Kes::Client::ProcessEntry;
+
+    void poll() noexcept;
+    void pollSnapshot() noexcept;
+    void schedule() noexcept;
+    void frameDone() noexcept;
+    void onResponse(const boost::system::error_code& ec, const Kes::Client::ResponseView& response) noexcept;
+    void apply(bool initial);
+    void render() noexcept;
+    bool less(const Row* a, const Row* b) const noexcept;
+
+    boost::asio::io_context& m_io;
+    WatchOptions m_options;
+    SortKey m_sort = SortKey::Pid;
+    std::ostream& m_out;
+    bool m_terminal = false;
+    std::string m_server;
+    Kes::Client::Connection m_connection;
+#if KES_LINUX
+    std::unique_ptr<Kes::Client::SnapshotReader> m_snapshot;
+#endif
+    boost::asio::steady_timer m_timer;
+    boost::asio::steady_timer::time_point m_due;
+    bool m_initial = true;
+    bool m_stopped = false;
+    size_t m_frames = 0;
+
+    // the mirror
+    Kes::Client::ProcessList m_list;
+    std::unordered_map<int, Row> m_rows;
+    size_t m_added = 0;
+    size_t m_removed = 0;
+    uint64_t m_sent = 0;
+    uint64_t m_latency = 0;
+    std::string m_status;
+
+    // per-frame scratch, reused
+    std::vector<const Row*> m_order;
+    std::vector<int> m_pids;
+    std::string m_screen;
+};
+
+
+} // namespace Kesctl {}
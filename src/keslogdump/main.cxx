@@ -0,0 +1,61 @@
+#include <kesrv/log.hxx>
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+        po::options_description options("Command line options");
+        options.add_options()
+            ("help,h", "display this message")
+            ("input,i", po::value<std::string>(), "binary log file")
+        ;
+
+        po::positional_options_description positional;
+        positional.add("input", 1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(options).positional(positional).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help") || !vm.count("input"))
+        {
+            std::cerr << options << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        Kes::initialize();
+
+        auto fileName = vm["input"].as<std::string>();
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Failed to open " << fileName << "\n";
+            return EXIT_FAILURE;
+        }
+
+        Kes::Log::Binary::Reader reader(file);
+        Kes::Log::Binary::Reader::Entry entry;
+        while (reader.next(entry))
+        {
+            char prefix[64];
+            auto prefixLength = Kes::Log::formatPrefix(entry.level, entry.time, prefix, sizeof(prefix));
+
+            std::cout.write(prefix, prefixLength);
+            std::cout << entry.text << "\n";
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
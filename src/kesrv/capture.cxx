@@ -0,0 +1,182 @@
+#include <kesrv/capture.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/knownprops.hxx>
+#include <kesrv/util/clock.hxx>
+#include <kesrv/util/format.hxx>
+
+#include <cstdio>
+
+
+namespace Kes
+{
+
+namespace Capture
+{
+
+namespace
+{
+
+// a request larger than this is not something the server would have accepted
+const uint32_t kMaxRequestSize = 64 * 1024 * 1024;
+
+template <typename T>
+void appendRaw(std::string& out, const T& v)
+{
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+void readRaw(std::istream& stream, T& v)
+{
+    stream.read(reinterpret_cast<char*>(&v), sizeof(v));
+    if (!stream)
+        throw Exception(KES_HERE(), "Unexpected end of the capture file");
+}
+
+} // namespace {}
+
+
+Writer::~Writer()
+{
+    m_stop = true;
+    m_wakeup.set();
+
+    if (m_flusher->joinable())
+        m_flusher->join();
+
+    flush();
+    std::fclose(m_file);
+}
+
+Writer::Writer(const char* fileName, std::chrono::milliseconds flushInterval)
+    : m_file(std::fopen(fileName, "wb"))
+    , m_started(Util::Clock::ticks())
+    , m_flushInterval(flushInterval)
+    , m_wakeup(true)
+{
+    if (!m_file)
+        throw Exception(KES_HERE(), Util::format("Failed to create the capture file %s", fileName), ExceptionProps::PosixErrorCode(errno));
+
+    m_buffer.append(Magic, sizeof(Magic));
+
+    m_flusher.reset(new std::thread([this]() { flusher(); }));
+}
+
+void Writer::sessionStarted(uint32_t session) noexcept
+{
+    append(RecordType::SessionStarted, session, Util::Clock::ticks(), nullptr, 0);
+}
+
+void Writer::sessionFinished(uint32_t session) noexcept
+{
+    append(RecordType::SessionFinished, session, Util::Clock::ticks(), nullptr, 0);
+}
+
+void Writer::request(uint32_t session, uint64_t received, const char* data, size_t size) noexcept
+{
+    append(RecordType::Request, session, received, data, size);
+}
+
+void Writer::append(RecordType type, uint32_t session, uint64_t ticks, const char* data, size_t size) noexcept
+{
+    uint64_t time = (ticks > m_started) ? Util::Clock::nanoseconds(ticks - m_started) : 0;
+
+    std::lock_guard l(m_mutex);
+
+    try
+    {
+        m_buffer.push_back(char(type));
+        appendRaw(m_buffer, session);
+        appendRaw(m_buffer, time);
+
+        if (type == RecordType::Request)
+        {
+            appendRaw(m_buffer, uint32_t(size));
+            m_buffer.append(data, size);
+        }
+    }
+    catch (...)
+    {
+        // not much we can do here
+    }
+
+    if (m_buffer.size() >= FlushThreshold)
+        flushLocked();
+}
+
+void Writer::flush() noexcept
+{
+    std::lock_guard l(m_mutex);
+    flushLocked();
+}
+
+void Writer::flushLocked() noexcept
+{
+    if (!m_buffer.empty())
+    {
+        std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file); // not much we can do on errors
+        std::fflush(m_file);
+        m_buffer.clear();
+    }
+}
+
+void Writer::flusher() noexcept
+{
+    while (!m_stop)
+    {
+        m_wakeup.wait(m_flushInterval);
+        flush();
+    }
+}
+
+
+Reader::Reader(std::istream& stream)
+    : m_stream(stream)
+{
+    char magic[sizeof(Magic)] = {};
+    m_stream.read(magic, sizeof(magic));
+    if (!m_stream || std::memcmp(magic, Magic, sizeof(Magic)))
+        throw Exception(KES_HERE(), "Not a capture file");
+}
+
+bool Reader::next(Record& record)
+{
+    char tag = 0;
+    if (!m_stream.get(tag))
+        return false;
+
+    switch (RecordType(tag))
+    {
+    case RecordType::SessionStarted:
+    case RecordType::SessionFinished:
+    case RecordType::Request:
+        break;
+    default:
+        throw Exception(KES_HERE(), Util::format("Invalid capture record tag 0x%02x", uint8_t(tag)));
+    }
+
+    record.type = RecordType(tag);
+    readRaw(m_stream, record.session);
+    readRaw(m_stream, record.time);
+    record.data.clear();
+
+    if (record.type == RecordType::Request)
+    {
+        uint32_t size = 0;
+        readRaw(m_stream, size);
+        if (size > kMaxRequestSize)
+            throw Exception(KES_HERE(), Util::format("Invalid request size %u", size));
+
+        record.data.resize(size);
+        m_stream.read(record.data.data(), size);
+        if (!m_stream)
+            throw Exception(KES_HERE(), "Unexpected end of the capture file");
+    }
+
+    return true;
+}
+
+
+} // namespace Capture {}
+
+} // namespace Kes {}
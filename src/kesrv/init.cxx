@@ -1,4 +1,7 @@
 #include <kesrv/exception.hxx>
+#include <kesrv/metrics/metricsprops.hxx>
+#include <kesrv/trace/traceprops.hxx>
+#include <kesrv/util/clock.hxx>
 #include <kesrv/util/requestutil.hxx>
 
 #if KES_LINUX
@@ -13,6 +16,11 @@ KESRV_EXPORT void initialize()
     Kes::ExceptionProps::Private::registerAll();
     Kes::Util::Request::Props::Private::registerAll();
     Kes::Util::Response::Props::Private::registerAll();
+    Kes::MetricsProps::Private::registerAll();
+    Kes::TraceProps::Private::registerAll();
+
+    // calibrate the clock here rather than on the first request
+    Kes::Util::Clock::nanoseconds(0);
 
 #if KES_LINUX
     Kes::ProcessProps::Private::registerAll();
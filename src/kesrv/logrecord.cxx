@@ -0,0 +1,446 @@
+#include <kesrv/exception.hxx>
+#include <kesrv/log.hxx>
+#include <kesrv/logrecord.hxx>
+#include <kesrv/util/format.hxx>
+
+
+namespace Kes
+{
+
+namespace Log
+{
+
+namespace
+{
+
+template <typename... Args>
+void appendFormatted(std::string& out, const char* spec, Args... args)
+{
+    char buffer[128];
+    auto length = ::snprintf(buffer, sizeof(buffer), spec, args...);
+    if (length < 0)
+        return;
+
+    if (size_t(length) < sizeof(buffer))
+    {
+        out.append(buffer, length);
+    }
+    else
+    {
+        auto pos = out.size();
+        out.resize(pos + length + 1);
+        ::snprintf(out.data() + pos, length + 1, spec, args...);
+        out.resize(pos + length);
+    }
+}
+
+template <typename T>
+void appendRaw(std::string& out, const T& v)
+{
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+void readRaw(std::istream& stream, T& v)
+{
+    stream.read(reinterpret_cast<char*>(&v), sizeof(v));
+    if (!stream)
+        throw Exception(KES_HERE(), "Unexpected end of the binary log");
+}
+
+} // namespace {}
+
+
+const char* const Record::TextFormat = "%s";
+
+Record& Record::operator=(Record&& o) noexcept
+{
+    if (this == &o)
+        return *this;
+
+    clear();
+
+    format = o.format;
+    count = o.count;
+    std::memcpy(types, o.types, count * sizeof(Type));
+    std::memcpy(values, o.values, count * sizeof(Value));
+
+    m_used = o.m_used;
+    m_capacity = o.m_capacity;
+    if (o.m_heap)
+    {
+        m_heap = o.m_heap;
+        o.m_heap = nullptr;
+    }
+    else
+    {
+        std::memcpy(m_inline, o.m_inline, m_used);
+    }
+
+    o.clear();
+    return *this;
+}
+
+void Record::assignv(const char* fmt, va_list args) noexcept
+{
+    clear();
+
+    format = TextFormat;
+    count = 1;
+    types[0] = Type::String;
+
+    va_list args1;
+    va_copy(args1, args);
+    auto required = ::vsnprintf(m_inline, InlineSize, fmt, args1);
+    va_end(args1);
+
+    if (required < 0)
+        required = 0;
+
+    if (size_t(required) >= InlineSize)
+    {
+        m_heap = static_cast<char*>(::malloc(required + 1));
+        if (m_heap)
+        {
+            va_list args2;
+            va_copy(args2, args);
+            ::vsnprintf(m_heap, required + 1, fmt, args2);
+            va_end(args2);
+        }
+        else
+        {
+            required = InlineSize - 1; // keep the truncated text
+        }
+    }
+
+    values[0].s = { 0, uint32_t(required) };
+    m_used = uint32_t(required + 1);
+    m_capacity = m_heap ? m_used : uint32_t(InlineSize);
+}
+
+
+KESRV_EXPORT void render(const char* format, uint8_t count, const Record::Type* types, const Record::Value* values, const char* strings, std::string& out)
+{
+    if (!format)
+        return;
+
+    size_t index = 0;
+    auto p = format;
+    while (*p)
+    {
+        auto percent = std::strchr(p, '%');
+        if (!percent)
+        {
+            out.append(p);
+            break;
+        }
+
+        out.append(p, percent - p);
+        p = percent + 1;
+
+        if (*p == '%')
+        {
+            out.push_back('%');
+            ++p;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        // length modifiers are dropped: the recorded argument type decides
+        char spec[32] = { '%' };
+        size_t specLength = 1;
+        int star[2] = {};
+        size_t stars = 0;
+
+        auto copySpec = [&spec, &specLength](char c)
+        {
+            if (specLength < sizeof(spec) - 4)
+                spec[specLength++] = c;
+        };
+
+        while (*p && std::strchr("-+ #0'", *p))
+            copySpec(*p++);
+
+        auto takeStar = [&]()
+        {
+            if (stars < 2)
+                star[stars++] = ((index < count) && (types[index] != Record::Type::String)) ? int(values[index].i) : 0;
+
+            ++index;
+            copySpec('*');
+            ++p;
+        };
+
+        if (*p == '*')
+            takeStar();
+        else
+            while (std::isdigit(*p))
+                copySpec(*p++);
+
+        if (*p == '.')
+        {
+            copySpec(*p++);
+            if (*p == '*')
+                takeStar();
+            else
+                while (std::isdigit(*p))
+                    copySpec(*p++);
+        }
+
+        while (*p && std::strchr("hlLqjzZt", *p))
+            ++p;
+
+        auto conversion = *p;
+        if (!conversion)
+            break;
+
+        ++p;
+
+        if (conversion == 'n')
+            continue;
+
+        if (index >= count)
+        {
+            // missing argument: keep the specification as is
+            out.append(percent, p - percent);
+            continue;
+        }
+
+        auto type = types[index];
+        auto& value = values[index];
+        ++index;
+
+        auto emit = [&](const char* modifier, char conv, auto arg)
+        {
+            char full[40];
+            std::memcpy(full, spec, specLength);
+            auto l = specLength;
+            for (auto m = modifier; *m; ++m)
+                full[l++] = *m;
+            full[l++] = conv;
+            full[l] = '\0';
+
+            if (stars == 2)
+                appendFormatted(out, full, star[0], star[1], arg);
+            else if (stars == 1)
+                appendFormatted(out, full, star[0], arg);
+            else
+                appendFormatted(out, full, arg);
+        };
+
+        switch (type)
+        {
+        case Record::Type::String:
+        {
+            auto s = value.s.length ? (strings + value.s.offset) : ""; // truncated strings may have no storage
+            if ((conversion == 's') && (specLength == 1))
+                out.append(s, value.s.length);
+            else
+                emit("", 's', s);
+            break;
+        }
+
+        case Record::Type::Double:
+            if (std::strchr("eEfFgGaA", conversion))
+                emit("", conversion, value.d);
+            else
+                emit("", 'g', value.d);
+            break;
+
+        case Record::Type::Pointer:
+            emit("", 'p', value.p);
+            break;
+
+        case Record::Type::Int:
+        case Record::Type::UInt:
+            if ((conversion == 'd') || (conversion == 'i'))
+                emit("ll", 'd', (type == Record::Type::Int) ? (long long)value.i : (long long)value.u);
+            else if (std::strchr("uoxX", conversion))
+                emit("ll", conversion, (unsigned long long)value.u);
+            else if (conversion == 'c')
+                emit("", 'c', int(value.i));
+            else if (conversion == 'p')
+                emit("", 'p', reinterpret_cast<const void*>(uintptr_t(value.u)));
+            else if (std::strchr("eEfFgGaA", conversion))
+                emit("", conversion, (type == Record::Type::Int) ? double(value.i) : double(value.u));
+            else if (type == Record::Type::Int)
+                emit("ll", 'd', (long long)value.i);
+            else
+                emit("ll", 'u', (unsigned long long)value.u);
+            break;
+        }
+    }
+}
+
+KESRV_EXPORT void render(const Record& record, std::string& out)
+{
+    if (record.isText())
+    {
+        out.append(record.string(0), record.values[0].s.length);
+        return;
+    }
+
+    render(record.format, record.count, record.types, record.values, record.strings(), out);
+}
+
+KESRV_EXPORT size_t formatPrefix(Level level, const struct timespec& time, char* prefix, size_t size) noexcept
+{
+    const char* strLevel = "?";
+    switch (level)
+    {
+    case Level::Debug: strLevel = "D"; break;
+    case Level::Info: strLevel = "I"; break;
+    case Level::Warning: strLevel = "W"; break;
+    case Level::Error: strLevel = "E"; break;
+    case Level::Fatal: strLevel = "!"; break;
+    default: break;
+    }
+
+    // round nanoseconds to milliseconds
+    auto sec = time.tv_sec;
+    long msec = 0;
+    if (time.tv_nsec >= 999500000)
+    {
+        sec++;
+        msec = 0;
+    }
+    else
+    {
+        msec = (time.tv_nsec + 500000) / 1000000;
+    }
+
+    struct tm localNow = {};
+    ::localtime_r(&sec, &localNow);
+
+    auto length = ::snprintf(prefix, size, "[%02d:%02d:%02d.%03ld %s] ", localNow.tm_hour, localNow.tm_min, localNow.tm_sec, msec, strLevel);
+    if (length < 0)
+        return 0;
+
+    return std::min(size_t(length), size - 1);
+}
+
+
+namespace Binary
+{
+
+KESRV_EXPORT void appendHeader(std::string& out)
+{
+    out.append(Magic, sizeof(Magic));
+}
+
+KESRV_EXPORT void appendFormat(std::string& out, uint32_t id, const char* format)
+{
+    uint32_t length = uint32_t(std::strlen(format));
+
+    out.push_back('F');
+    appendRaw(out, id);
+    appendRaw(out, length);
+    out.append(format, length);
+}
+
+KESRV_EXPORT void appendRecord(std::string& out, Level level, const struct timespec& time, uint32_t formatId, const Record& record)
+{
+    out.push_back('R');
+    appendRaw(out, uint8_t(level));
+    appendRaw(out, int64_t(time.tv_sec));
+    appendRaw(out, int32_t(time.tv_nsec));
+    appendRaw(out, formatId);
+    appendRaw(out, record.count);
+    out.append(reinterpret_cast<const char*>(record.types), record.count * sizeof(Record::Type));
+    out.append(reinterpret_cast<const char*>(record.values), record.count * sizeof(Record::Value));
+    appendRaw(out, record.stringsSize());
+    out.append(record.strings(), record.stringsSize());
+}
+
+
+Reader::Reader(std::istream& stream)
+    : m_stream(stream)
+{
+    char magic[sizeof(Magic)] = {};
+    m_stream.read(magic, sizeof(magic));
+    if (!m_stream || std::memcmp(magic, Magic, sizeof(Magic)))
+        throw Exception(KES_HERE(), "Not a binary log file");
+}
+
+bool Reader::next(Entry& entry)
+{
+    for (;;)
+    {
+        char tag = 0;
+        if (!m_stream.get(tag))
+            return false;
+
+        if (tag == 'F')
+        {
+            uint32_t id = 0;
+            uint32_t length = 0;
+            readRaw(m_stream, id);
+            readRaw(m_stream, length);
+
+            if (id > 1024 * 1024)
+                throw Exception(KES_HERE(), Util::format("Invalid format id %u", id));
+
+            if (m_formats.size() <= id)
+                m_formats.resize(id + 1);
+
+            m_formats[id].resize(length);
+            m_stream.read(m_formats[id].data(), length);
+            if (!m_stream)
+                throw Exception(KES_HERE(), "Unexpected end of the binary log");
+
+            continue;
+        }
+
+        if (tag != 'R')
+            throw Exception(KES_HERE(), Util::format("Invalid binary log tag 0x%02x", uint8_t(tag)));
+
+        uint8_t level = 0;
+        int64_t sec = 0;
+        int32_t nsec = 0;
+        uint32_t formatId = 0;
+        uint8_t count = 0;
+        readRaw(m_stream, level);
+        readRaw(m_stream, sec);
+        readRaw(m_stream, nsec);
+        readRaw(m_stream, formatId);
+        readRaw(m_stream, count);
+
+        if (count > Record::MaxArgs)
+            throw Exception(KES_HERE(), Util::format("Invalid argument count %u", count));
+
+        if (formatId >= m_formats.size())
+            throw Exception(KES_HERE(), Util::format("Unknown format id %u", formatId));
+
+        Record::Type types[Record::MaxArgs];
+        Record::Value values[Record::MaxArgs];
+        m_stream.read(reinterpret_cast<char*>(types), count * sizeof(Record::Type));
+        m_stream.read(reinterpret_cast<char*>(values), count * sizeof(Record::Value));
+
+        uint32_t stringsSize = 0;
+        readRaw(m_stream, stringsSize);
+        m_strings.resize(stringsSize);
+        m_stream.read(m_strings.data(), stringsSize);
+        if (!m_stream)
+            throw Exception(KES_HERE(), "Unexpected end of the binary log");
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            if ((types[i] == Record::Type::String) && values[i].s.length && (uint64_t(values[i].s.offset) + values[i].s.length >= stringsSize))
+                throw Exception(KES_HERE(), "Invalid string argument");
+        }
+
+        entry.level = Level(level);
+        entry.time.tv_sec = sec;
+        entry.time.tv_nsec = nsec;
+        entry.text.clear();
+
+        render(m_formats[formatId].c_str(), count, types, values, m_strings.data(), entry.text);
+        return true;
+    }
+}
+
+} // namespace Binary {}
+
+} // namespace Log {}
+
+} // namespace Kes {}
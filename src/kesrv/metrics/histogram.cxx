@@ -0,0 +1,82 @@
+#include <kesrv/metrics/histogram.hxx>
+
+#include <cmath>
+
+
+namespace Kes
+{
+
+namespace Metrics
+{
+
+void Histogram::merge(const Histogram& other) noexcept
+{
+    if (!other.m_count)
+        return;
+
+    for (size_t i = 0; i < BucketCount; ++i)
+        m_buckets[i] += other.m_buckets[i];
+
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+}
+
+void Histogram::reset() noexcept
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+uint64_t Histogram::percentile(double q) const noexcept
+{
+    if (!m_count)
+        return 0;
+
+    q = std::clamp(q, 0.0, 1.0);
+    auto target = std::max(uint64_t(std::ceil(q * double(m_count))), uint64_t(1));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        seen += m_buckets[i];
+        if (seen >= target)
+            return std::clamp(bucketUpperBound(i), min(), m_max);
+    }
+
+    return m_max;
+}
+
+
+ShardHistogram::ShardHistogram() noexcept
+{
+}
+
+void ShardHistogram::mergeInto(Histogram& to) const noexcept
+{
+    // the owner may be recording concurrently: the result is a consistent-enough snapshot
+    uint64_t count = 0;
+    for (size_t i = 0; i < Histogram::BucketCount; ++i)
+    {
+        auto n = m_buckets[i].load();
+        to.m_buckets[i] += n;
+        count += n;
+    }
+
+    if (!count)
+        return;
+
+    to.m_count += count;
+    to.m_sum += m_sum.load();
+    to.m_min = std::min(to.m_min, m_min.load(std::memory_order_relaxed));
+    to.m_max = std::max(to.m_max, m_max.load(std::memory_order_relaxed));
+}
+
+
+} // namespace Metrics {}
+
+} // namespace Kes {}
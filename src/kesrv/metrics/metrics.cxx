@@ -0,0 +1,145 @@
+#include <kesrv/metrics/metrics.hxx>
+
+
+namespace Kes
+{
+
+namespace Metrics
+{
+
+namespace
+{
+
+uint64_t makeRegistryId() noexcept
+{
+    static std::atomic<uint64_t> nextId = 1;
+    return nextId++;
+}
+
+} // namespace {}
+
+
+Registry::Shard::~Shard()
+{
+    for (auto& command: commands)
+    {
+        for (auto& stage: command.stages)
+            delete stage.load();
+    }
+
+    delete write.load();
+    delete scan.load();
+}
+
+Registry::~Registry()
+{
+}
+
+Registry::Registry()
+    : m_id(makeRegistryId())
+{
+    m_commands[UnknownCommand] = "<unknown>";
+}
+
+size_t Registry::registerCommand(const char* name)
+{
+    std::lock_guard l(m_mutex);
+
+    for (size_t i = 0; i < m_commandCount; ++i)
+    {
+        if (m_commands[i] == name)
+            return i;
+    }
+
+    if (m_commandCount == MaxCommands)
+        return UnknownCommand;
+
+    m_commands[m_commandCount] = name;
+    return m_commandCount++;
+}
+
+Registry::Shard* Registry::findShard() noexcept
+{
+    try
+    {
+        auto self = std::this_thread::get_id();
+
+        std::lock_guard l(m_mutex);
+
+        for (auto& s: m_shards)
+        {
+            if (s->owner == self)
+                return s.get();
+        }
+
+        m_shards.push_back(std::make_unique<Shard>(self));
+        return m_shards.back().get();
+    }
+    catch (std::exception&)
+    {
+        return nullptr; // metrics are not worth failing the request for
+    }
+}
+
+Snapshot Registry::snapshot() const
+{
+    Snapshot result;
+
+    std::lock_guard l(m_mutex);
+
+    result.commands.resize(m_commandCount);
+    for (size_t i = 0; i < m_commandCount; ++i)
+        result.commands[i].name = m_commands[i];
+
+    uint64_t sessionsStarted = 0;
+    uint64_t sessionsFinished = 0;
+
+    for (auto& s: m_shards)
+    {
+        for (size_t i = 0; i < m_commandCount; ++i)
+        {
+            auto& from = s->commands[i];
+            auto& to = result.commands[i];
+
+            to.requests += from.requests.load();
+            to.errors += from.errors.load();
+
+            for (size_t stage = 0; stage < StageCount; ++stage)
+            {
+                auto h = from.stages[stage].load(std::memory_order_acquire);
+                if (h)
+                    h->mergeInto(to.stages[stage]);
+            }
+        }
+
+        auto write = s->write.load(std::memory_order_acquire);
+        if (write)
+            write->mergeInto(result.write);
+
+        auto scan = s->scan.load(std::memory_order_acquire);
+        if (scan)
+            scan->mergeInto(result.scan);
+
+        result.bytesIn += s->bytesIn.load();
+        result.bytesOut += s->bytesOut.load();
+        sessionsStarted += s->sessionsStarted.load();
+        sessionsFinished += s->sessionsFinished.load();
+    }
+
+    for (auto& command: result.commands)
+    {
+        for (size_t stage = 0; stage < StageCount; ++stage)
+            result.stages[stage].merge(command.stages[stage]);
+    }
+
+    result.sessionsTotal = sessionsStarted;
+    result.sessionsActive = (sessionsStarted > sessionsFinished) ? (sessionsStarted - sessionsFinished) : 0;
+    result.scanProcesses = m_scanProcesses.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+
+} // namespace Metrics {}
+
+} // namespace Kes {}
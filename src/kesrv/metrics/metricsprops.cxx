@@ -0,0 +1,49 @@
+#include <kesrv/knownprops.hxx>
+#include <kesrv/metrics/metricsprops.hxx>
+
+
+namespace Kes
+{
+
+namespace MetricsProps
+{
+
+namespace Private
+{
+
+KESRV_EXPORT void registerAll()
+{
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Count>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Min>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Mean>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::P50>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::P99>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::P999>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Max>);
+
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Parse>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Handler>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Serialize>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Write>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Scan>);
+
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Command>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::CommandList>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Name>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Requests>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Errors>);
+
+    registerProperty(new PropertyInfoWrapper<MetricsProps::Stages>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::BytesIn>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::BytesOut>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::ActiveSessions>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::TotalSessions>);
+    registerProperty(new PropertyInfoWrapper<MetricsProps::ScanProcesses>);
+}
+
+
+} // namespace Private {}
+
+} // namespace MetricsProps {}
+
+} // namespace Kes {}
@@ -0,0 +1,435 @@
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/processmanager/cgroupmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/trace/trace.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+const char* const s_commands[] =
+{
+    "list_cgroups"
+};
+
+bool fail(PropertyBag& response, Kes::Request::Id id, std::string&& reason)
+{
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Fail));
+    Util::addToTable<Kes::Response::Props::Reason>(response, std::move(reason));
+    return true;
+}
+
+struct KeyedValue
+{
+    const char* key;    // with the separator
+    uint64_t* value;
+};
+
+// picks the "key <n>" lines of a cgroupfs file; false if none was there
+template <size_t N>
+bool readKeyedValues(const std::string& path, const KeyedValue (&values)[N])
+{
+    std::ifstream stream(path);
+    if (!stream.good())
+        return false;
+
+    std::string line;
+    size_t found = 0;
+    while ((found < N) && std::getline(stream, line))
+    {
+        for (auto& value: values)
+        {
+            auto length = std::strlen(value.key);
+            if (line.compare(0, length, value.key) == 0)
+            {
+                *value.value = std::strtoull(line.c_str() + length, nullptr, 10);
+                ++found;
+                break;
+            }
+        }
+    }
+
+    return found > 0;
+}
+
+struct Pressure
+{
+    double avg10 = 0;
+    double avg60 = 0;
+    double avg300 = 0;
+    uint64_t total = 0;     // us stalled
+};
+
+// "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+bool parsePressure(const std::string& line, Pressure& pressure)
+{
+    unsigned long long total = 0;
+    auto space = line.find(' ');
+    if ((space == std::string::npos) ||
+        (std::sscanf(line.c_str() + space, " avg10=%lf avg60=%lf avg300=%lf total=%llu", &pressure.avg10, &pressure.avg60, &pressure.avg300, &total) != 4))
+    {
+        return false;
+    }
+
+    pressure.total = total;
+    return true;
+}
+
+// "/a/b" -> "/a" -> "/"
+std::string parentOf(const std::string& path)
+{
+    auto slash = path.rfind('/');
+    return (slash == 0 || slash == std::string::npos) ? std::string("/") : path.substr(0, slash);
+}
+
+} // namespace {}
+
+
+CgroupManager::~CgroupManager()
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->unregisterHandler(cmd, this);
+    }
+
+    m_processes->removeListener(this);
+}
+
+CgroupManager::CgroupManager(IRequestProcessor* rp, Log::ILog* log, ProcessManager* processes, const std::string& procFsRoot, const std::string& cgroupRoot)
+    : m_rp(rp)
+    , m_log(log)
+    , m_processes(processes)
+    , m_procFs(log, procFsRoot)
+    , m_cgroupRoot(cgroupRoot)
+{
+    m_processes->addListener(this);
+
+    for (auto cmd: s_commands)
+    {
+        m_rp->registerHandler(cmd, this);
+    }
+}
+
+bool CgroupManager::process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    assert(request.isTable());
+    assert(response.isTable());
+
+    // calls scanned() unless a session scan was recent enough
+    m_processes->sample(MaxSampleAge);
+
+    std::lock_guard l(m_mutex);
+
+    if (!std::strcmp(key, "list_cgroups"))
+        return listCgroups(id, request, response);
+
+    m_log->write(Log::Level::Error, "CgroupManager: unknown command [%s]", key);
+    return false;
+}
+
+bool CgroupManager::listCgroups(Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    // the cgroup and the ones below it
+    std::string under;
+    if (auto path = Util::findInTable<ProcessProps::CgroupPath>(request))
+    {
+        if (path->empty() || (path->front() != '/'))
+            return fail(response, id, Util::format("Invalid cgroup path [%s]", path->c_str()));
+
+        under = *path;
+        while ((under.size() > 1) && (under.back() == '/'))
+            under.pop_back();
+
+        if (under == "/")
+            under.clear();
+    }
+
+    update();
+
+    {
+        PropertyBag cgroupArray{Kes::ProcessProps::CgroupList::idstr(), PropertyBag::Array()};
+
+        // by path
+        for (auto& cgroup: rollUp())
+        {
+            auto& path = cgroup.first;
+            if (!under.empty())
+            {
+                if ((path.compare(0, under.size(), under) != 0) || ((path.size() > under.size()) && (path[under.size()] != '/')))
+                    continue;
+            }
+
+            auto id = m_ids.find(path);
+            auto own = (id != m_ids.end()) ? m_cgroups[id->second].totals.processes : 0;
+            Util::addToArray<Kes::ProcessProps::Cgroup>(cgroupArray, serialize(path, cgroup.second, own));
+        }
+
+        Util::addToTable<Kes::ProcessProps::CgroupList>(response, std::move(cgroupArray));
+    }
+
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+void CgroupManager::scanned(const std::vector<IScanListener::Process>& processes, uint64_t time)
+{
+    std::lock_guard l(m_sampleMutex);
+
+    m_sample = processes;
+    m_sampleTime = time;
+    m_sampled = true;
+}
+
+void CgroupManager::update()
+{
+    static const uint64_t membershipInterval = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(MembershipInterval).count());
+
+    std::vector<IScanListener::Process> processes;
+    uint64_t now = 0;
+    {
+        std::lock_guard l(m_sampleMutex);
+        if (!m_sampled)
+            return;
+
+        processes.swap(m_sample);
+        now = m_sampleTime;
+        m_sampled = false;
+    }
+
+    ++m_scan;
+
+    for (auto& process: processes)
+    {
+        auto inserted = m_members.try_emplace(process.pid);
+        auto& member = inserted.first->second;
+
+        // a new process, a reused pid, or one that may have been moved since
+        if (inserted.second || (member.startTicks != process.startTicks) || (now - member.membershipTime >= membershipInterval))
+        {
+            auto path = m_procFs.readCgroup(process.pid);
+            auto cgroup = path ? intern(*path) : NoCgroup;
+            if (cgroup != member.cgroup)
+            {
+                detach(member);
+                attach(member, cgroup);
+            }
+
+            member.startTicks = process.startTicks;
+            member.membershipTime = now;
+        }
+
+        auto rated = process.cpu >= 0;
+        auto cpu = rated ? int64_t(std::llround(process.cpu * 100)) : 0;
+
+        if (member.cgroup != NoCgroup)
+        {
+            auto& totals = m_cgroups[member.cgroup].totals;
+            totals.rated += uint32_t(rated) - uint32_t(member.rated);
+            totals.cpu += cpu - member.cpu;
+            totals.rss += process.rss - member.rss;
+        }
+
+        member.rated = rated;
+        member.cpu = cpu;
+        member.rss = process.rss;
+        member.scan = m_scan;
+    }
+
+    for (auto it = m_members.begin(); it != m_members.end();)
+    {
+        if (it->second.scan != m_scan)
+        {
+            detach(it->second);
+            it = m_members.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+std::map<std::string, CgroupManager::Totals> CgroupManager::rollUp() const
+{
+    std::map<std::string, Totals> subtrees;
+    for (auto& cgroup: m_cgroups)
+    {
+        if (cgroup.path.empty())
+            continue;
+
+        for (auto path = cgroup.path;; path = parentOf(path))
+        {
+            auto& totals = subtrees[path];
+            totals.processes += cgroup.totals.processes;
+            totals.rated += cgroup.totals.rated;
+            totals.cpu += cgroup.totals.cpu;
+            totals.rss += cgroup.totals.rss;
+
+            if (path == "/")
+                break;
+        }
+    }
+
+    return subtrees;
+}
+
+uint32_t CgroupManager::intern(const std::string& path)
+{
+    auto it = m_ids.find(path);
+    if (it != m_ids.end())
+        return it->second;
+
+    uint32_t id;
+    if (!m_free.empty())
+    {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        id = uint32_t(m_cgroups.size());
+        m_cgroups.emplace_back();
+    }
+
+    m_cgroups[id].path = path;
+    m_ids.insert({ path, id });
+    return id;
+}
+
+void CgroupManager::attach(Member& member, uint32_t cgroup) noexcept
+{
+    member.cgroup = cgroup;
+    if (cgroup == NoCgroup)
+        return;
+
+    auto& totals = m_cgroups[cgroup].totals;
+    ++totals.processes;
+    totals.rated += uint32_t(member.rated);
+    totals.cpu += member.cpu;
+    totals.rss += member.rss;
+}
+
+void CgroupManager::detach(Member& member) noexcept
+{
+    if (member.cgroup == NoCgroup)
+        return;
+
+    auto& c = m_cgroups[member.cgroup];
+    c.totals.rated -= uint32_t(member.rated);
+    c.totals.cpu -= member.cpu;
+    c.totals.rss -= member.rss;
+
+    // the slot goes to the next new cgroup
+    if (--c.totals.processes == 0)
+    {
+        m_ids.erase(c.path);
+        c = Cgroup();
+        m_free.push_back(member.cgroup);
+    }
+
+    member.cgroup = NoCgroup;
+}
+
+PropertyBag CgroupManager::serialize(const std::string& path, const Totals& totals, uint32_t own)
+{
+    PropertyBag table{std::string(), PropertyBag::Table()};
+
+    Util::addToTable<ProcessProps::CgroupPath>(table, path);
+    Util::addToTable<ProcessProps::CgroupProcesses>(table, uint64_t(totals.processes));
+    Util::addToTable<ProcessProps::CgroupOwnProcesses>(table, uint64_t(own));
+    // the processes without a rate yet count as 0
+    if (totals.rated)
+        Util::addToTable<ProcessProps::CgroupCpu>(table, double(totals.cpu) / 100);
+
+    Util::addToTable<ProcessProps::CgroupRss>(table, totals.rss);
+
+    auto dir = m_cgroupRoot;
+    if (path != "/")
+        dir.append(path);
+
+    {
+        Trace::FileScope trace("cpu.stat");
+
+        uint64_t usage = 0;
+        uint64_t user = 0;
+        uint64_t system = 0;
+        uint64_t nrThrottled = 0;
+        uint64_t throttled = 0;
+        KeyedValue values[] =
+        {
+            { "usage_usec ", &usage },
+            { "user_usec ", &user },
+            { "system_usec ", &system },
+            { "nr_throttled ", &nrThrottled },
+            { "throttled_usec ", &throttled }
+        };
+
+        if (readKeyedValues(dir + "/cpu.stat", values))
+        {
+            Util::addToTable<ProcessProps::CgroupCpuUsage>(table, usage);
+            Util::addToTable<ProcessProps::CgroupCpuUser>(table, user);
+            Util::addToTable<ProcessProps::CgroupCpuSystem>(table, system);
+            Util::addToTable<ProcessProps::CgroupCpuNrThrottled>(table, nrThrottled);
+            Util::addToTable<ProcessProps::CgroupCpuThrottled>(table, throttled);
+        }
+    }
+
+    {
+        // not there for the root cgroup
+        Trace::FileScope trace("memory.current");
+
+        std::ifstream stream(dir + "/memory.current");
+        unsigned long long current = 0;
+        if (stream >> current)
+            Util::addToTable<ProcessProps::CgroupMemoryCurrent>(table, uint64_t(current));
+    }
+
+    {
+        Trace::FileScope trace("memory.pressure");
+
+        std::ifstream stream(dir + "/memory.pressure");
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            Pressure pressure;
+            if (!parsePressure(line, pressure))
+                continue;
+
+            if (line.compare(0, 5, "some ") == 0)
+            {
+                Util::addToTable<ProcessProps::CgroupMemorySomeAvg10>(table, pressure.avg10);
+                Util::addToTable<ProcessProps::CgroupMemorySomeAvg60>(table, pressure.avg60);
+                Util::addToTable<ProcessProps::CgroupMemorySomeAvg300>(table, pressure.avg300);
+                Util::addToTable<ProcessProps::CgroupMemorySomeTotal>(table, pressure.total);
+            }
+            else if (line.compare(0, 5, "full ") == 0)
+            {
+                Util::addToTable<ProcessProps::CgroupMemoryFullAvg10>(table, pressure.avg10);
+                Util::addToTable<ProcessProps::CgroupMemoryFullAvg60>(table, pressure.avg60);
+                Util::addToTable<ProcessProps::CgroupMemoryFullAvg300>(table, pressure.avg300);
+                Util::addToTable<ProcessProps::CgroupMemoryFullTotal>(table, pressure.total);
+            }
+        }
+    }
+
+    return table;
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
@@ -0,0 +1,116 @@
+#include <kesrv/processmanager/cpusampler.hxx>
+
+#include <unistd.h>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+CpuSampler::CpuSampler()
+    : m_entries(InitialCapacity, Entry{})
+    , m_ticksPerSecond(double(::sysconf(_SC_CLK_TCK)))
+{
+    assert(m_ticksPerSecond > 0);
+}
+
+CpuSampler::Entry* CpuSampler::find(pid_t id) noexcept
+{
+    auto mask = m_entries.size() - 1;
+    auto index = (uint32_t(id) * 2654435761u) & mask;
+    while (m_entries[index].id && (m_entries[index].id != id))
+        index = (index + 1) & mask;
+
+    return &m_entries[index];
+}
+
+// drops the entries that have not been seen for a couple of scans
+void CpuSampler::rehash(size_t capacity)
+{
+    std::vector<Entry> old(capacity, Entry{});
+    old.swap(m_entries);
+
+    m_size = 0;
+    for (auto& entry: old)
+    {
+        if (entry.id && (entry.epoch + 2 >= m_epoch))
+        {
+            *find(entry.id) = entry;
+            ++m_size;
+        }
+    }
+}
+
+double CpuSampler::update(pid_t id, uint64_t startTicks, uint64_t cpuTicks, uint64_t now)
+{
+    auto entry = find(id);
+    if (!entry->id)
+    {
+        // keep the load under 1/2, and under 3/8 after dropping the stale entries
+        if (2 * (m_size + 1) > m_entries.size())
+        {
+            rehash(m_entries.size());
+            if (8 * (m_size + 1) > 3 * m_entries.size())
+                rehash(2 * m_entries.size());
+
+            entry = find(id);
+        }
+
+        ++m_size;
+        *entry = Entry{ id, m_epoch, -1.0f, startTicks, cpuTicks, now };
+        return -1;
+    }
+
+    entry->epoch = m_epoch;
+
+    // a new process under an old id
+    if ((entry->startTicks != startTicks) || (cpuTicks < entry->cpuTicks))
+    {
+        *entry = Entry{ id, m_epoch, -1.0f, startTicks, cpuTicks, now };
+        return -1;
+    }
+
+    auto elapsed = now - entry->time;
+    if (elapsed >= MinInterval)
+    {
+        entry->rate = float(100.0 * (double(cpuTicks - entry->cpuTicks) / m_ticksPerSecond) / (double(elapsed) / 1e9));
+        entry->cpuTicks = cpuTicks;
+        entry->time = now;
+    }
+
+    return entry->rate;
+}
+
+void CpuSampler::updateSystem(const ProcFs::CpuTimes& times, uint64_t now) noexcept
+{
+    if (!times.valid)
+        return;
+
+    if (!m_system.valid || (times.busyTicks() < m_system.busyTicks()) || (times.idleTicks() < m_system.idleTicks()))
+    {
+        m_system = times;
+        m_systemTime = now;
+        m_systemBusy = -1;
+        return;
+    }
+
+    if (now - m_systemTime < MinInterval)
+        return;
+
+    auto busy = times.busyTicks() - m_system.busyTicks();
+    auto idle = times.idleTicks() - m_system.idleTicks();
+
+    // no ticks at all: keep the last value
+    if (busy + idle)
+        m_systemBusy = 100.0 * double(busy) / double(busy + idle);
+
+    m_system = times;
+    m_systemTime = now;
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
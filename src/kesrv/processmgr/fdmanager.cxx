@@ -0,0 +1,457 @@
+#include <kesrv/exception.hxx>
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/processmanager/fdmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+#include <algorithm>
+#include <limits>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+const char* const s_commands[] =
+{
+    "list_fds",
+    "list_sockets"
+};
+
+bool fail(PropertyBag& response, Kes::Request::Id id, std::string&& reason)
+{
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Fail));
+    Util::addToTable<Kes::Response::Props::Reason>(response, std::move(reason));
+    return true;
+}
+
+PropertyBag serialize(pid_t pid, const ProcFs::FileDescriptor& fd)
+{
+    PropertyBag table{std::string(), PropertyBag::Table()};
+
+    Util::addToTable<ProcessProps::FdPid>(table, int(pid));
+    Util::addToTable<ProcessProps::FdNumber>(table, fd.fd);
+    Util::addToTable<ProcessProps::FdType>(table, std::string(ProcFs::FileDescriptor::typeName(fd.type)));
+    Util::addToTable<ProcessProps::FdTarget>(table, fd.target);
+
+    if (fd.inode)
+        Util::addToTable<ProcessProps::FdInode>(table, fd.inode);
+
+    if (fd.infoValid)
+    {
+        Util::addToTable<ProcessProps::FdPos>(table, fd.pos);
+        Util::addToTable<ProcessProps::FdFlags>(table, uint64_t(fd.flags));
+        if (fd.mntId >= 0)
+            Util::addToTable<ProcessProps::FdMntId>(table, fd.mntId);
+    }
+
+    return table;
+}
+
+PropertyBag serialize(const ProcFs::Socket& socket, const std::vector<pid_t>& owners)
+{
+    PropertyBag table{std::string(), PropertyBag::Table()};
+
+    Util::addToTable<ProcessProps::SocketProtocol>(table, std::string(ProcFs::Socket::protocolName(socket.protocol)));
+    if (socket.protocol == ProcFs::Socket::Protocol::Unix)
+    {
+        if (!socket.path.empty())
+            Util::addToTable<ProcessProps::SocketPath>(table, socket.path);
+    }
+    else
+    {
+        Util::addToTable<ProcessProps::SocketLocalAddress>(table, socket.localAddress);
+        Util::addToTable<ProcessProps::SocketLocalPort>(table, int(socket.localPort));
+        Util::addToTable<ProcessProps::SocketRemoteAddress>(table, socket.remoteAddress);
+        Util::addToTable<ProcessProps::SocketRemotePort>(table, int(socket.remotePort));
+        Util::addToTable<ProcessProps::SocketUid>(table, int(socket.uid));
+        Util::addToTable<ProcessProps::SocketTxQueue>(table, socket.txQueue);
+        Util::addToTable<ProcessProps::SocketRxQueue>(table, socket.rxQueue);
+    }
+
+    Util::addToTable<ProcessProps::SocketState>(table, std::string(socket.stateName()));
+
+    if (socket.inode)
+        Util::addToTable<ProcessProps::SocketInode>(table, socket.inode);
+
+    if (!owners.empty())
+    {
+        PropertyBag pids{ProcessProps::SocketPids::idstr(), PropertyBag::Array()};
+        for (auto pid: owners)
+            Util::addToArray<ProcessProps::SocketPid>(pids, int(pid));
+
+        Util::addToTable<ProcessProps::SocketPids>(table, std::move(pids));
+    }
+
+    return table;
+}
+
+} // namespace {}
+
+
+FdManager::~FdManager()
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->unregisterHandler(cmd, this);
+    }
+}
+
+FdManager::FdManager(IRequestProcessor* rp, Log::ILog* log, const std::string& procFsRoot, std::chrono::milliseconds indexInterval)
+    : m_rp(rp)
+    , m_log(log)
+    , m_procFs(log, procFsRoot)
+    , m_indexInterval(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(indexInterval).count()))
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->registerHandler(cmd, this);
+    }
+}
+
+bool FdManager::process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    assert(request.isTable());
+    assert(response.isTable());
+
+    // the sockets are not per session, and a walk must not hold up list_fds
+    if (!std::strcmp(key, "list_sockets"))
+        return listSockets(id, request, response);
+
+    std::lock_guard l(m_mutex);
+
+    auto it = m_sessions.find(sessionId);
+    assert(it != m_sessions.end());
+    if (it == m_sessions.end())
+        return false;
+
+    if (!std::strcmp(key, "list_fds"))
+        return listFds(it->second.get(), id, request, response);
+
+    m_log->write(Log::Level::Error, "FdManager: unknown command [%s]", key);
+    return false;
+}
+
+void FdManager::startSession(uint32_t id)
+{
+    std::lock_guard l(m_mutex);
+
+    if (m_sessions.find(id) == m_sessions.end())
+        m_sessions.insert({ id, std::make_unique<Session>(id) });
+}
+
+void FdManager::endSession(uint32_t id)
+{
+    std::lock_guard l(m_mutex);
+
+    m_sessions.erase(id);
+}
+
+bool FdManager::listFds(Session* session, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    auto pid = Util::findInTable<ProcessProps::Pid>(request);
+    if (pid && (*pid <= 0))
+        return fail(response, id, Util::format("Invalid pid [%d]", *pid));
+
+    auto limit = Util::findInTable<ProcessProps::Limit>(request);
+    if (limit && (*limit <= 0))
+        return fail(response, id, Util::format("Invalid limit [%d]", *limit));
+
+    auto chunk = limit ? std::min(size_t(*limit), MaxChunk) : DefaultChunk;
+
+    auto withInfo = Util::findInTable<ProcessProps::FdWithInfo>(request);
+
+    // <pid>:<fd>, the last descriptor sent
+    pid_t fromPid = 0;
+    int afterFd = -1;
+    auto cursor = Util::findInTable<ProcessProps::Cursor>(request);
+    if (cursor && !cursor->empty())
+    {
+        char* end = nullptr;
+        auto p = std::strtol(cursor->c_str(), &end, 10);
+        auto valid = (*end == ':') && (p > 0);
+        auto f = valid ? std::strtol(end + 1, &end, 10) : -1;
+        if (!valid || *end || (f < 0) || (f > std::numeric_limits<int>::max()))
+            return fail(response, id, Util::format("Invalid cursor [%s]", cursor->c_str()));
+
+        fromPid = pid_t(p);
+        afterFd = int(f);
+    }
+
+    std::vector<pid_t> pids;
+    if (pid)
+    {
+        pids.push_back(pid_t(*pid));
+    }
+    else
+    {
+        pids = m_procFs.enumeratePids();
+        std::sort(pids.begin(), pids.end());
+    }
+
+    PropertyBag fdArray{Kes::ProcessProps::FdList::idstr(), PropertyBag::Array()};
+    std::vector<Owner> owners;
+
+    auto left = chunk;
+    pid_t lastPid = ProcFs::InvalidPid;
+    int lastFd = -1;
+    auto it = std::lower_bound(pids.begin(), pids.end(), fromPid);
+    for (; (it != pids.end()) && left; ++it)
+    {
+        auto fds = fdsAfter(session, *it, (*it == fromPid) ? afterFd : -1);
+        if (!fds)
+        {
+            // only worth an error when asked for the one process
+            if (pid)
+                return fail(response, id, Util::format("Failed to read the descriptors of process %d", *pid));
+
+            continue;
+        }
+
+        auto take = std::min(left, fds->size());
+
+        // whatever does not fit waits for the next chunk
+        session->pendingPid = *it;
+        session->pendingFds.assign(fds->begin() + take, fds->end());
+        fds->resize(take);
+        session->pendingAfter = take ? fds->back() : -1;
+
+        for (auto& fd: m_procFs.readFds(*it, *fds, withInfo && *withInfo))
+        {
+            if ((fd.type == ProcFs::FileDescriptor::Type::Socket) && fd.inode)
+                owners.push_back({ fd.inode, *it });
+
+            Util::addToArray<Kes::ProcessProps::Fd>(fdArray, serialize(*it, fd));
+        }
+
+        left -= take;
+        if (take)
+        {
+            lastPid = *it;
+            lastFd = fds->back();
+        }
+
+        if (!session->pendingFds.empty())
+            break;
+    }
+
+    Util::addToTable<Kes::ProcessProps::FdList>(response, std::move(fdArray));
+
+    if (!owners.empty())
+        addSightings(owners);
+
+    if (it != pids.end())
+        Util::addToTable<Kes::ProcessProps::NextCursor>(response, Util::format("%d:%d", lastPid, lastFd));
+
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+std::optional<std::vector<int>> FdManager::fdsAfter(Session* session, pid_t pid, int after)
+{
+    std::optional<std::vector<int>> fds;
+    if ((after >= 0) && (session->pendingPid == pid) && (session->pendingAfter == after))
+    {
+        // what the previous chunk left; the fds opened since then are not seen before the next listing;
+        // any other cursor (replayed or made up) reads the directory again
+        fds = std::move(session->pendingFds);
+    }
+    else
+    {
+        fds = m_procFs.enumerateFds(pid);
+        if (!fds)
+            return fds;
+
+        std::sort(fds->begin(), fds->end());
+    }
+
+    session->pendingPid = ProcFs::InvalidPid;
+    session->pendingAfter = -1;
+    session->pendingFds.clear();
+
+    fds->erase(fds->begin(), std::upper_bound(fds->begin(), fds->end(), after));
+    return fds;
+}
+
+bool FdManager::listSockets(Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    std::vector<ProcFs::Socket::Protocol> protocols =
+    {
+        ProcFs::Socket::Protocol::Tcp,
+        ProcFs::Socket::Protocol::Tcp6,
+        ProcFs::Socket::Protocol::Udp,
+        ProcFs::Socket::Protocol::Udp6,
+        ProcFs::Socket::Protocol::Unix
+    };
+
+    auto name = Util::findInTable<ProcessProps::SocketProtocol>(request);
+    if (name)
+    {
+        auto protocol = ProcFs::Socket::protocolFromName(*name);
+        if (!protocol)
+            return fail(response, id, Util::format("Unknown protocol [%s]", name->c_str()));
+
+        protocols = { *protocol };
+    }
+
+    auto port = Util::findInTable<ProcessProps::SocketLocalPort>(request);
+    if (port && ((*port <= 0) || (*port > 65535)))
+        return fail(response, id, Util::format("Invalid port [%d]", *port));
+
+    std::vector<ProcFs::Socket> sockets;
+    for (auto protocol: protocols)
+    {
+        // a port only narrows down the internet tables
+        if (port && (protocol == ProcFs::Socket::Protocol::Unix))
+            continue;
+
+        for (auto& socket: m_procFs.readSockets(protocol))
+        {
+            if (!port || (socket.localPort == *port))
+                sockets.push_back(std::move(socket));
+        }
+    }
+
+    std::vector<Owner> seen;
+    auto index = socketIndex(seen);
+
+    auto ownersOf = [&index, &seen](uint64_t inode)
+    {
+        std::vector<pid_t> pids;
+        auto less = [](const Owner& a, const Owner& b) { return a.first < b.first; };
+        if (index)
+        {
+            auto range = std::equal_range(index->owners.begin(), index->owners.end(), Owner(inode, 0), less);
+            for (auto it = range.first; it != range.second; ++it)
+                pids.push_back(it->second);
+        }
+
+        auto range = std::equal_range(seen.begin(), seen.end(), Owner(inode, 0), less);
+        for (auto it = range.first; it != range.second; ++it)
+            pids.push_back(it->second);
+
+        std::sort(pids.begin(), pids.end());
+        pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+        return pids;
+    };
+
+    auto refresh = Util::findInTable<ProcessProps::Refresh>(request);
+    auto age = index ? Metrics::now() - index->time : 0;
+    auto maxAge = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(MaxIndexAge).count());
+    auto rebuild = !index || (refresh && *refresh) || (age >= maxAge);
+    if (!rebuild && (age >= m_indexInterval))
+    {
+        rebuild = std::any_of(sockets.begin(), sockets.end(), [&ownersOf](const ProcFs::Socket& socket)
+        {
+            return socket.inode && ownersOf(socket.inode).empty();
+        });
+    }
+
+    if (rebuild)
+    {
+        buildSocketIndex(index ? index->generation : 0);
+        index = socketIndex(seen);
+    }
+
+    {
+        PropertyBag socketArray{Kes::ProcessProps::SocketList::idstr(), PropertyBag::Array()};
+
+        for (auto& socket: sockets)
+            Util::addToArray<Kes::ProcessProps::Socket>(socketArray, serialize(socket, socket.inode ? ownersOf(socket.inode) : std::vector<pid_t>()));
+
+        Util::addToTable<Kes::ProcessProps::SocketList>(response, std::move(socketArray));
+    }
+
+    Util::addToTable<Kes::ProcessProps::SocketIndexGeneration>(response, index->generation);
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+FdManager::SocketIndex::Ptr FdManager::socketIndex(std::vector<Owner>& seen)
+{
+    std::lock_guard l(m_indexMutex);
+
+    seen.clear();
+    seen.reserve(m_sightings.size());
+    for (auto& sighting: m_sightings)
+        seen.push_back(sighting.owner);
+
+    std::sort(seen.begin(), seen.end());
+    return m_sockets;
+}
+
+void FdManager::addSightings(const std::vector<Owner>& owners)
+{
+    auto now = Metrics::now();
+
+    std::lock_guard l(m_indexMutex);
+
+    // the next walk sees them anyway
+    for (auto& owner: owners)
+    {
+        if (m_sightings.size() >= MaxSightings)
+            break;
+
+        m_sightings.push_back(Sighting{ owner, now });
+    }
+}
+
+void FdManager::buildSocketIndex(uint64_t current)
+{
+    std::lock_guard build(m_buildMutex);
+
+    {
+        std::lock_guard l(m_indexMutex);
+        if (m_sockets && (m_sockets->generation != current))
+            return;
+    }
+
+    auto index = std::make_shared<SocketIndex>();
+    index->started = Metrics::now();
+
+    for (auto pid: m_procFs.enumeratePids())
+    {
+        auto fds = m_procFs.enumerateFds(pid);
+        if (!fds)
+            continue;
+
+        for (auto& fd: m_procFs.readFds(pid, *fds, false))
+        {
+            if (fd.type == ProcFs::FileDescriptor::Type::Socket)
+                index->owners.push_back({ fd.inode, pid });
+        }
+    }
+
+    // a process holding a socket twice is one owner
+    std::sort(index->owners.begin(), index->owners.end());
+    index->owners.erase(std::unique(index->owners.begin(), index->owners.end()), index->owners.end());
+    index->time = Metrics::now();
+
+    {
+        std::lock_guard l(m_indexMutex);
+
+        index->generation = current + 1;
+
+        // what list_fds saw while the walk was going on may be newer than the walk
+        auto started = index->started;
+        m_sightings.erase(std::remove_if(m_sightings.begin(), m_sightings.end(), [started](const Sighting& s) { return s.time < started; }), m_sightings.end());
+        m_sockets = index;
+    }
+
+    m_log->write(Log::Level::Debug, "FdManager: socket index generation %llu, %zu owners in %llu us", (unsigned long long)index->generation,
+        index->owners.size(), (unsigned long long)((index->time - index->started) / 1000));
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
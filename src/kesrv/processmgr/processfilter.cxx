@@ -0,0 +1,585 @@
+#include <kesrv/exception.hxx>
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/processmanager/processfilter.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include <fnmatch.h>
+#include <regex.h>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+// one-character strings for the 'state' field
+const char* charString(char c) noexcept
+{
+    static const auto table = []()
+    {
+        std::array<std::array<char, 2>, 256> t = {};
+        for (size_t i = 0; i < t.size(); ++i)
+            t[i][0] = char(i);
+
+        return t;
+    }();
+
+    return table[uint8_t(c)].data();
+}
+
+
+double rounded(double v) noexcept
+{
+    return std::round(v * 100) / 100;
+}
+
+// a number that is there once 'valid' holds; it is written as the property's value type
+#define KES_FIELD(PropertyInfoT, files, valid, value) \
+    { \
+        ProcessProps::PropertyInfoT::idstr(), files, \
+        [](const ProcessFilter::Subject& s) -> double { return (valid) ? double(value) : -1; }, \
+        nullptr, \
+        [](PropertyBag& t, const ProcessFilter::Subject& s) { if (valid) Util::addToTable<ProcessProps::PropertyInfoT>(t, ProcessProps::PropertyInfoT::ValueType(value)); } \
+    }
+
+#define KES_STAT_FIELD(PropertyInfoT, member) KES_FIELD(PropertyInfoT, ProcFs::StatFile, true, s.stat.member)
+#define KES_MEMORY_FIELD(PropertyInfoT, group, member, files) KES_FIELD(PropertyInfoT, files, s.memory && s.memory->group.valid, s.memory->group.member)
+#define KES_IO_FIELD(PropertyInfoT, member) KES_FIELD(PropertyInfoT, ProcFs::IoFile, s.io && s.io->valid, s.io->member)
+#define KES_IO_RATE_FIELD(PropertyInfoT, member) KES_FIELD(PropertyInfoT, ProcFs::IoFile, s.ioRates && s.ioRates->valid, rounded(s.ioRates->member))
+#define KES_NS_FIELD(PropertyInfoT, kind) KES_FIELD(PropertyInfoT, ProcFs::NsDir, s.namespaces && s.namespaces->inodes[ProcFs::Namespaces::kind], s.namespaces->inodes[ProcFs::Namespaces::kind])
+
+// a string; 'always' writes it even when empty
+#define KES_TEXT_FIELD(PropertyInfoT, files, always, value) \
+    { \
+        ProcessProps::PropertyInfoT::idstr(), files, \
+        nullptr, \
+        [](const ProcessFilter::Subject& s) -> const char* { return (value).c_str(); }, \
+        [](PropertyBag& t, const ProcessFilter::Subject& s) { if ((always) || !(value).empty()) Util::addToTable<ProcessProps::PropertyInfoT>(t, std::string(value)); } \
+    }
+
+// pid always comes along, the error replaces everything else
+const std::vector<ProcessField> s_fields =
+{
+    { ProcessProps::Pid::idstr(), 0, [](const ProcessFilter::Subject& s) { return double(s.stat.pid); }, nullptr, [](PropertyBag&, const ProcessFilter::Subject&) {} },
+    KES_TEXT_FIELD(StatComm, ProcFs::StatFile, false, s.stat.comm),
+    { ProcessProps::State::idstr(), ProcFs::StatFile, nullptr, [](const ProcessFilter::Subject& s) { return charString(s.stat.state); },
+        [](PropertyBag& t, const ProcessFilter::Subject& s) { Util::addToTable<ProcessProps::State>(t, std::string(1, s.stat.state)); } },
+    KES_STAT_FIELD(PPid, ppid),
+    KES_STAT_FIELD(PGrp, pgrp),
+    KES_STAT_FIELD(Session, session),
+    KES_STAT_FIELD(TtyNr, tty_nr),
+    KES_STAT_FIELD(Tpgid, tpgid),
+    KES_STAT_FIELD(Flags, flags),
+    KES_STAT_FIELD(MinFlt, minflt),
+    KES_STAT_FIELD(CMinFlt, cminflt),
+    KES_STAT_FIELD(MajFlt, majflt),
+    KES_STAT_FIELD(CMajFlt, cmajflt),
+    KES_STAT_FIELD(UTime, utime),
+    KES_STAT_FIELD(STime, stime),
+    KES_STAT_FIELD(CUTime, cutime),
+    KES_STAT_FIELD(CSTime, cstime),
+    KES_STAT_FIELD(Priority, priority),
+    KES_STAT_FIELD(Nice, nice),
+    KES_STAT_FIELD(NumThreads, num_threads),
+    KES_STAT_FIELD(ItRealValue, itrealvalue),
+    KES_STAT_FIELD(StartTicks, starttime),
+    KES_STAT_FIELD(VSize, vsize),
+    KES_STAT_FIELD(Rss, rss),
+    KES_STAT_FIELD(RssLim, rsslim),
+    KES_STAT_FIELD(StartCode, startcode),
+    KES_STAT_FIELD(EndCode, endcode),
+    KES_STAT_FIELD(StartStack, startstack),
+    KES_STAT_FIELD(KstkEsp, kstkesp),
+    KES_STAT_FIELD(KstkEip, kstkeip),
+    KES_STAT_FIELD(Signal, signal),
+    KES_STAT_FIELD(Blocked, blocked),
+    KES_STAT_FIELD(SigIgnore, sigignore),
+    KES_STAT_FIELD(SigCatch, sigcatch),
+    KES_STAT_FIELD(WChan, wchan),
+    KES_STAT_FIELD(NSwap, nswap),
+    KES_STAT_FIELD(CNSwap, cnswap),
+    KES_STAT_FIELD(ExitSignal, exit_signal),
+    KES_STAT_FIELD(Processor, processor),
+    KES_STAT_FIELD(RtPriority, rt_priority),
+    KES_STAT_FIELD(Policy, policy),
+    KES_STAT_FIELD(DelayAcctBlkioTicks, delayacct_blkio_ticks),
+    KES_STAT_FIELD(GuestTime, guest_time),
+    KES_STAT_FIELD(CGuestTime, cguest_time),
+    KES_STAT_FIELD(StartData, start_data),
+    KES_STAT_FIELD(EndData, end_data),
+    KES_STAT_FIELD(StartBrk, start_brk),
+    KES_STAT_FIELD(ArgStart, arg_start),
+    KES_STAT_FIELD(ArgEnd, arg_end),
+    KES_STAT_FIELD(EnvStart, env_start),
+    KES_STAT_FIELD(EnvEnd, env_end),
+    KES_STAT_FIELD(ExitCode, exit_code),
+    KES_STAT_FIELD(StartTime, startTime),
+    KES_STAT_FIELD(Ruid, ruid),
+    KES_FIELD(Cpu, ProcFs::StatFile, s.cpu >= 0, rounded(s.cpu)),
+    KES_MEMORY_FIELD(Shared, statm, shared, ProcFs::StatmFile),
+    KES_MEMORY_FIELD(Text, statm, text, ProcFs::StatmFile),
+    KES_MEMORY_FIELD(Data, statm, data, ProcFs::StatmFile),
+    KES_MEMORY_FIELD(RssAnon, status, rssAnon, ProcFs::StatusFile),
+    KES_MEMORY_FIELD(RssFile, status, rssFile, ProcFs::StatusFile),
+    KES_MEMORY_FIELD(RssShmem, status, rssShmem, ProcFs::StatusFile),
+    KES_MEMORY_FIELD(Swap, status, swap, ProcFs::StatusFile),
+    KES_MEMORY_FIELD(Pss, smaps, pss, ProcFs::SmapsFile),
+    KES_MEMORY_FIELD(PssAnon, smaps, pssAnon, ProcFs::SmapsFile),
+    KES_MEMORY_FIELD(PssFile, smaps, pssFile, ProcFs::SmapsFile),
+    KES_MEMORY_FIELD(PssShmem, smaps, pssShmem, ProcFs::SmapsFile),
+    KES_MEMORY_FIELD(SwapPss, smaps, swapPss, ProcFs::SmapsFile),
+    KES_IO_FIELD(IoRChar, rchar),
+    KES_IO_FIELD(IoWChar, wchar),
+    KES_IO_FIELD(IoSyscR, syscr),
+    KES_IO_FIELD(IoSyscW, syscw),
+    KES_IO_FIELD(IoReadBytes, readBytes),
+    KES_IO_FIELD(IoWriteBytes, writeBytes),
+    KES_IO_FIELD(IoCancelledWriteBytes, cancelledWriteBytes),
+    KES_IO_RATE_FIELD(IoRCharRate, rchar),
+    KES_IO_RATE_FIELD(IoWCharRate, wchar),
+    KES_IO_RATE_FIELD(IoSyscRRate, syscr),
+    KES_IO_RATE_FIELD(IoSyscWRate, syscw),
+    KES_IO_RATE_FIELD(IoReadBytesRate, readBytes),
+    KES_IO_RATE_FIELD(IoWriteBytesRate, writeBytes),
+    KES_IO_RATE_FIELD(IoCancelledWriteBytesRate, cancelledWriteBytes),
+    KES_FIELD(FdCount, ProcFs::FdDir, s.fdCount >= 0, s.fdCount),
+    KES_NS_FIELD(PidNs, Pid),
+    KES_NS_FIELD(MntNs, Mnt),
+    KES_NS_FIELD(NetNs, Net),
+    KES_NS_FIELD(UserNs, User),
+    KES_NS_FIELD(CgroupNs, Cgroup),
+    KES_FIELD(NsPid, ProcFs::NsDir, s.nsLevel >= 0, s.nsPid),
+    KES_FIELD(NsLevel, ProcFs::NsDir, s.nsLevel >= 0, s.nsLevel),
+    KES_FIELD(SmapsAge, ProcFs::SmapsFile, s.smapsTime, (Metrics::now() - s.smapsTime) / 1000000),
+    KES_TEXT_FIELD(Comm, ProcFs::CommFile, true, s.comm),
+    KES_TEXT_FIELD(Exe, ProcFs::ExeFile, false, s.exe),
+    KES_TEXT_FIELD(CmdLine, ProcFs::CmdLineFile, false, s.cmdLine),
+    { ProcessProps::Error::idstr(), ProcFs::StatFile, nullptr, [](const ProcessFilter::Subject& s) { return s.stat.error.c_str(); }, nullptr },
+};
+
+#undef KES_FIELD
+#undef KES_STAT_FIELD
+#undef KES_MEMORY_FIELD
+#undef KES_IO_FIELD
+#undef KES_IO_RATE_FIELD
+#undef KES_NS_FIELD
+#undef KES_TEXT_FIELD
+
+
+struct RegexFree
+{
+    void operator()(regex_t* r) noexcept
+    {
+        ::regfree(r);
+        delete r;
+    }
+};
+
+} // namespace {}
+
+
+struct ProcessFilter::Node
+{
+    enum class Kind
+    {
+        And,
+        Or,
+        Not,
+        Compare
+    };
+
+    enum class Op
+    {
+        Eq,
+        Ne,
+        Lt,
+        Le,
+        Gt,
+        Ge,
+        Glob,
+        Regex
+    };
+
+    Kind kind = Kind::Compare;
+    size_t left = 0;
+    size_t right = 0;
+    const ProcessField* field = nullptr;
+    Op op = Op::Eq;
+    double number = 0;
+    std::string text;
+    std::unique_ptr<regex_t, RegexFree> regex;
+};
+
+
+//
+// recursive descent straight into ProcessFilter::m_nodes
+//
+
+class ProcessFilter::Parser final
+{
+public:
+    Parser(const std::string& text, std::vector<Node>& nodes) noexcept
+        : m_text(text)
+        , m_nodes(nodes)
+    {
+    }
+
+    size_t parse()
+    {
+        auto root = expression(0);
+
+        skipSpace();
+        if (m_pos < m_text.length())
+            fail("unexpected input");
+
+        return root;
+    }
+
+private:
+    [[noreturn]] void fail(const char* what) const
+    {
+        throw Kes::Exception(KES_HERE(), Util::format("Invalid filter: %s at position %zu", what, m_pos));
+    }
+
+    void skipSpace() noexcept
+    {
+        while ((m_pos < m_text.length()) && std::isspace(uint8_t(m_text[m_pos])))
+            ++m_pos;
+    }
+
+    bool accept(const char* token) noexcept
+    {
+        skipSpace();
+
+        auto length = std::strlen(token);
+        if (m_text.compare(m_pos, length, token))
+            return false;
+
+        // keywords must not run into an identifier
+        if (std::isalpha(uint8_t(token[0])) && (m_pos + length < m_text.length()) && isIdentifier(m_text[m_pos + length]))
+            return false;
+
+        m_pos += length;
+        return true;
+    }
+
+    static bool isIdentifier(char c) noexcept
+    {
+        return std::isalnum(uint8_t(c)) || (c == '_') || (c == '.');
+    }
+
+    size_t add(Node&& node)
+    {
+        m_nodes.push_back(std::move(node));
+        return m_nodes.size() - 1;
+    }
+
+    size_t binary(Node::Kind kind, size_t left, size_t right)
+    {
+        Node node;
+        node.kind = kind;
+        node.left = left;
+        node.right = right;
+        return add(std::move(node));
+    }
+
+    size_t expression(size_t depth)
+    {
+        if (depth > MaxDepth)
+            fail("nesting too deep");
+
+        auto left = term(depth);
+        while (accept("or") || accept("||"))
+            left = binary(Node::Kind::Or, left, term(depth));
+
+        return left;
+    }
+
+    size_t term(size_t depth)
+    {
+        auto left = factor(depth);
+        while (accept("and") || accept("&&"))
+            left = binary(Node::Kind::And, left, factor(depth));
+
+        return left;
+    }
+
+    size_t factor(size_t depth)
+    {
+        if (depth > MaxDepth)
+            fail("nesting too deep");
+
+        if (accept("not") || ((m_text.compare(m_pos, 2, "!=") != 0) && accept("!")))
+        {
+            Node node;
+            node.kind = Node::Kind::Not;
+            node.left = factor(depth + 1);
+            return add(std::move(node));
+        }
+
+        if (accept("("))
+        {
+            auto inner = expression(depth + 1);
+            if (!accept(")"))
+                fail("')' expected");
+
+            return inner;
+        }
+
+        return comparison();
+    }
+
+    size_t comparison()
+    {
+        Node node;
+
+        skipSpace();
+        auto start = m_pos;
+        std::string name = identifier();
+        if (name.empty())
+            fail("field name expected");
+
+        node.field = ProcessField::find(name);
+        if (!node.field)
+        {
+            m_pos = start;
+            fail("unknown field");
+        }
+
+        // longest operators first
+        if (accept("=~"))
+            node.op = Node::Op::Regex;
+        else if (accept("=="))
+            node.op = Node::Op::Eq;
+        else if (accept("!="))
+            node.op = Node::Op::Ne;
+        else if (accept("<="))
+            node.op = Node::Op::Le;
+        else if (accept(">="))
+            node.op = Node::Op::Ge;
+        else if (accept("<"))
+            node.op = Node::Op::Lt;
+        else if (accept(">"))
+            node.op = Node::Op::Gt;
+        else if (accept("~"))
+            node.op = Node::Op::Glob;
+        else if (accept("="))
+            node.op = Node::Op::Eq;
+        else
+            fail("comparison operator expected");
+
+        skipSpace();
+        start = m_pos;
+
+        if (node.field->number)
+        {
+            if ((node.op == Node::Op::Glob) || (node.op == Node::Op::Regex))
+                fail("pattern match on a numeric field");
+
+            node.number = number();
+        }
+        else
+        {
+            node.text = string();
+
+            if (node.op == Node::Op::Regex)
+            {
+                node.regex.reset(new regex_t);
+                auto error = ::regcomp(node.regex.get(), node.text.c_str(), REG_EXTENDED | REG_NOSUB);
+                if (error)
+                {
+                    char message[128];
+                    ::regerror(error, node.regex.get(), message, sizeof(message));
+                    delete node.regex.release(); // regcomp failed: nothing to regfree
+
+                    m_pos = start;
+                    throw Kes::Exception(KES_HERE(), Util::format("Invalid filter: bad regular expression at position %zu: %s", m_pos, message));
+                }
+            }
+        }
+
+        node.kind = Node::Kind::Compare;
+        return add(std::move(node));
+    }
+
+    std::string identifier() noexcept
+    {
+        auto start = m_pos;
+        if ((m_pos < m_text.length()) && (std::isalpha(uint8_t(m_text[m_pos])) || (m_text[m_pos] == '_')))
+        {
+            while ((m_pos < m_text.length()) && isIdentifier(m_text[m_pos]))
+                ++m_pos;
+        }
+
+        return m_text.substr(start, m_pos - start);
+    }
+
+    double number()
+    {
+        auto start = m_text.c_str() + m_pos;
+        if (!std::isdigit(uint8_t(*start)) && (*start != '-') && (*start != '+') && (*start != '.'))
+            fail("number expected");
+
+        char* end = nullptr;
+        errno = 0;
+        auto value = std::strtod(start, &end);
+        if ((end == start) || (errno == ERANGE) || ((*end != '\0') && isIdentifier(*end)))
+            fail("number expected");
+
+        m_pos += end - start;
+        return value;
+    }
+
+    std::string string()
+    {
+        if (m_pos >= m_text.length())
+            fail("value expected");
+
+        auto quote = m_text[m_pos];
+        if ((quote != '\'') && (quote != '"'))
+        {
+            auto bare = identifier();
+            if (bare.empty())
+                fail("value expected");
+
+            return bare;
+        }
+
+        std::string value;
+        for (++m_pos; m_pos < m_text.length(); ++m_pos)
+        {
+            auto c = m_text[m_pos];
+            if (c == quote)
+            {
+                ++m_pos;
+                return value;
+            }
+
+            if ((c == '\\') && (m_pos + 1 < m_text.length()) && ((m_text[m_pos + 1] == quote) || (m_text[m_pos + 1] == '\\')))
+                c = m_text[++m_pos];
+
+            value.push_back(c);
+        }
+
+        fail("unterminated string");
+    }
+
+    const std::string& m_text;
+    std::vector<Node>& m_nodes;
+    size_t m_pos = 0;
+};
+
+
+const std::vector<ProcessField>& ProcessField::all() noexcept
+{
+    return s_fields;
+}
+
+const ProcessField* ProcessField::find(std::string_view name) noexcept
+{
+    const std::string_view prefix("process.");
+    if (name.substr(0, prefix.length()) == prefix)
+        name.remove_prefix(prefix.length());
+
+    // the short spelling of ruid
+    if (name == "uid")
+        name = "ruid";
+
+    for (auto& f: s_fields)
+    {
+        if (name == f.name())
+            return &f;
+    }
+
+    return nullptr;
+}
+
+
+ProcessFilter::~ProcessFilter()
+{
+}
+
+ProcessFilter::ProcessFilter(const std::string& expression)
+    : m_expression(expression)
+{
+    if (m_expression.length() > MaxLength)
+        throw Kes::Exception(KES_HERE(), "Invalid filter: too long");
+
+    Parser parser(m_expression, m_nodes);
+    m_root = parser.parse();
+
+    for (auto& node: m_nodes)
+    {
+        if (node.field)
+            m_files |= node.field->files;
+    }
+}
+
+bool ProcessFilter::match(const Subject& subject) const noexcept
+{
+    return evaluate(m_root, subject);
+}
+
+bool ProcessFilter::evaluate(size_t index, const Subject& subject) const noexcept
+{
+    auto& node = m_nodes[index];
+    switch (node.kind)
+    {
+    case Node::Kind::And:
+        return evaluate(node.left, subject) && evaluate(node.right, subject);
+
+    case Node::Kind::Or:
+        return evaluate(node.left, subject) || evaluate(node.right, subject);
+
+    case Node::Kind::Not:
+        return !evaluate(node.left, subject);
+
+    case Node::Kind::Compare:
+        break;
+    }
+
+    int c = 0;
+    if (node.field->number)
+    {
+        auto value = node.field->number(subject);
+        c = (value < node.number) ? -1 : (value > node.number);
+    }
+    else
+    {
+        auto value = node.field->text(subject);
+
+        if (node.op == Node::Op::Glob)
+            return ::fnmatch(node.text.c_str(), value, 0) == 0;
+
+        if (node.op == Node::Op::Regex)
+            return ::regexec(node.regex.get(), value, 0, nullptr, 0) == 0;
+
+        c = std::strcmp(value, node.text.c_str());
+    }
+
+    switch (node.op)
+    {
+    case Node::Op::Eq: return c == 0;
+    case Node::Op::Ne: return c != 0;
+    case Node::Op::Lt: return c < 0;
+    case Node::Op::Le: return c <= 0;
+    case Node::Op::Gt: return c > 0;
+    case Node::Op::Ge: return c >= 0;
+    default: return false;
+    }
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
@@ -1,7 +1,16 @@
+#include <kesrv/exception.hxx>
 #include <kesrv/processmanager/processmanager.hxx>
 #include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/util/crc32.hxx>
+#include <kesrv/util/format.hxx>
 #include <kesrv/util/requestutil.hxx>
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <unistd.h>
+
 namespace Kes
 {
 
@@ -17,6 +26,27 @@ const char* const s_commands[] =
     "diff_processes"
 };
 
+uint64_t makeInstanceId()
+{
+    std::random_device rd;
+    return (uint64_t(rd()) << 32) ^ uint64_t(rd()) ^ uint64_t(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+IScanListener::Process sampleOf(const ProcFs::Stat& stat, double cpu) noexcept
+{
+    static const uint64_t pageSize = uint64_t(::sysconf(_SC_PAGESIZE));
+
+    return IScanListener::Process{ stat.pid, stat.ppid, stat.pgrp, stat.tpgid, stat.session, stat.ruid, stat.starttime, cpu, uint64_t(std::max(stat.rss, 0L)) * pageSize, stat.comm };
+}
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t x) noexcept
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
 } // namespace {}
 
 ProcessManager::~ProcessManager()
@@ -27,10 +57,15 @@ ProcessManager::~ProcessManager()
     }
 }
 
-ProcessManager::ProcessManager(IRequestProcessor* rp, Log::ILog* log)
+ProcessManager::ProcessManager(IRequestProcessor* rp, Log::ILog* log, Metrics::Registry* metrics, const std::string& procFsRoot, size_t historyDepth, const RefreshOptions& refresh, std::chrono::milliseconds historyAge)
     : m_rp(rp)
     , m_log(log)
-    , m_procFs(log)
+    , m_metrics(metrics)
+    , m_procFs(log, procFsRoot)
+    , m_refresh(refresh)
+    , m_instance(makeInstanceId())
+    , m_historyDepth(std::max<size_t>(historyDepth, 1))
+    , m_historyAge(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(historyAge).count()))
 {
     for (auto cmd: s_commands)
     {
@@ -81,6 +116,50 @@ void ProcessManager::endSession(uint32_t id)
     }
 }
 
+void ProcessManager::addListener(IScanListener* listener)
+{
+    std::lock_guard l(m_mutex);
+
+    m_listeners.push_back(listener);
+}
+
+void ProcessManager::removeListener(IScanListener* listener)
+{
+    std::lock_guard l(m_mutex);
+
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+}
+
+void ProcessManager::sample(std::chrono::nanoseconds maxAge)
+{
+    std::lock_guard l(m_mutex);
+
+    auto now = Metrics::now();
+    if (m_listeners.empty() || (m_sampleTime && (now - m_sampleTime < uint64_t(maxAge.count()))))
+        return;
+
+    m_cpu.beginScan();
+    m_cpu.updateSystem(m_procFs.readCpuTimes(), now);
+
+    std::vector<IScanListener::Process> processes;
+    for (auto pid: m_procFs.enumeratePids())
+    {
+        auto stat = m_procFs.readStat(pid);
+        if (stat.valid)
+            processes.push_back(sampleOf(stat, m_cpu.update(pid, stat.starttime, stat.utime + stat.stime, now)));
+    }
+
+    notifyListeners(processes, now);
+}
+
+void ProcessManager::notifyListeners(const std::vector<IScanListener::Process>& processes, uint64_t time)
+{
+    m_sampleTime = time;
+
+    for (auto listener: m_listeners)
+        listener->scanned(processes, time);
+}
+
 bool ProcessManager::process(Session* session, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
 {
     if (!std::strcmp(key, "list_processes"))
@@ -93,15 +172,59 @@ bool ProcessManager::process(Session* session, const char* key, Kes::Request::Id
 
 bool ProcessManager::listProcesses(bool initial, Session* session, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
 {
-    readProcesses(initial, session);
+    View view;
+    try
+    {
+        view = parseView(request);
+        updateFilter(session, request);
+    }
+    catch (std::exception& e)
+    {
+        // the session is left as it was
+        Util::addToTable<Kes::Request::Props::Id>(response, id);
+        Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Fail));
+        Util::addToTable<Kes::Response::Props::Reason>(response, std::string(e.what()));
+        return true;
+    }
+
+    // a token only means something to a session that has no state yet
+    auto token = Util::findInTable<ProcessProps::Token>(request);
+    if (token && !session->timestamp)
+    {
+        auto base = findGeneration(*token, projection(view));
+        if (base)
+            return resumeProcesses(session, *base, view, id, response);
+
+        m_log->write(Log::Level::Info, "ProcessManager: session %u presented an unknown token, sending a full list", session->sessionId);
+        initial = true;
+    }
+
+    readProcesses(initial, session, view);
+
+    std::string nextCursor;
+    auto selected = select(session, view, nextCursor);
+
+    // what the client holds has to be tracked while the view is partial and once more after it is not
+    bool partial = isPartial(session, view);
+    bool tracked = partial || session->partial;
+    std::unordered_set<pid_t> visible;
 
     // list existing/new processes
     {
         PropertyBag processArray{Kes::ProcessProps::ProcessList::idstr(), PropertyBag::Array()};
         
-        for (auto& process: session->processes)
+        for (auto process: selected)
         {
-            auto jProcess = process.second->serialize();
+            auto pid = process->stat.pid;
+
+            // entered the view
+            if (tracked && !initial && !session->visible.count(pid))
+                process->newcomer = true;
+
+            if (partial)
+                visible.insert(pid);
+
+            auto jProcess = process->serialize(view.columns);
             Util::addToArray<Kes::ProcessProps::Process>(processArray, std::move(jProcess));
         }
 
@@ -111,23 +234,602 @@ bool ProcessManager::listProcesses(bool initial, Session* session, Kes::Request:
     // list deleted processes
     if (!initial)
     {
-        PropertyBag processArray{Kes::ProcessProps::ProcessList::idstr(), PropertyBag::Array()};
+        PropertyBag processArray{Kes::ProcessProps::DeletedProcessList::idstr(), PropertyBag::Array()};
         
         for (auto pid: session->removedPids)
         {
-            Util::addToArray<Kes::ProcessProps::DeletedProcess>(processArray, int(pid));
+            if (!tracked || session->visible.count(pid))
+                Util::addToArray<Kes::ProcessProps::DeletedProcess>(processArray, int(pid));
+        }
+
+        // left the view
+        if (partial)
+        {
+            for (auto pid: session->visible)
+            {
+                if (!visible.count(pid) && session->processes.count(pid))
+                    Util::addToArray<Kes::ProcessProps::DeletedProcess>(processArray, int(pid));
+            }
+        }
+
+        Util::addToTable<Kes::ProcessProps::DeletedProcessList>(response, std::move(processArray));
+    }
+
+    session->visible = std::move(visible);
+    session->partial = partial;
+
+    if (!nextCursor.empty())
+        Util::addToTable<Kes::ProcessProps::NextCursor>(response, std::move(nextCursor));
+
+    addSystemCpu(response);
+
+    if (view.groupByNamespace)
+        addNamespaceGroups(session, initial ? nullptr : &session->groups, response);
+    else
+        session->groups.clear();
+
+    Util::addToTable<Kes::ProcessProps::Token>(response, makeToken(recordGeneration(session, projection(view))));
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+bool ProcessManager::resumeProcesses(Session* session, const Generation& base, const View& view, Kes::Request::Id id, PropertyBag& response)
+{
+    // the session starts out with everything the scan finds, the response only carries the difference
+    readProcesses(true, session, view);
+
+    std::string nextCursor;
+    auto selected = select(session, view, nextCursor);
+    bool partial = isPartial(session, view);
+
+    auto find = [&base](pid_t pid)
+    {
+        auto it = std::lower_bound(base.processes.begin(), base.processes.end(), pid, [](const std::pair<pid_t, uint32_t>& p, pid_t pid) { return p.first < pid; });
+        return ((it != base.processes.end()) && (it->first == pid)) ? &*it : nullptr;
+    };
+
+    {
+        PropertyBag processArray{Kes::ProcessProps::ProcessList::idstr(), PropertyBag::Array()};
+
+        for (auto process: selected)
+        {
+            auto pid = process->stat.pid;
+
+            // the digest covers the columns only, not what a filter or a sort looks at, so a partial view gets all of its entries
+            auto known = find(pid);
+            if (known && !partial && (known->second == process->digest))
+                continue;
+
+            process->newcomer = !known;
+
+            if (partial)
+                session->visible.insert(pid);
+
+            auto jProcess = process->serialize(view.columns);
+            Util::addToArray<Kes::ProcessProps::Process>(processArray, std::move(jProcess));
+        }
+
+        Util::addToTable<Kes::ProcessProps::ProcessList>(response, std::move(processArray));
+    }
+
+    {
+        PropertyBag processArray{Kes::ProcessProps::DeletedProcessList::idstr(), PropertyBag::Array()};
+
+        for (auto& process: base.processes)
+        {
+            if (partial ? !session->visible.count(process.first) : !session->processes.count(process.first))
+                Util::addToArray<Kes::ProcessProps::DeletedProcess>(processArray, int(process.first));
         }
 
+        session->partial = partial;
+
         Util::addToTable<Kes::ProcessProps::DeletedProcessList>(response, std::move(processArray));
     }
 
+    m_log->write(Log::Level::Debug, "ProcessManager: session %u resumed from generation %llu", session->sessionId, (unsigned long long)base.id);
+
+    if (!nextCursor.empty())
+        Util::addToTable<Kes::ProcessProps::NextCursor>(response, std::move(nextCursor));
+
+    addSystemCpu(response);
+
+    // the client has the groups of the base generation
+    if (view.groupByNamespace)
+        addNamespaceGroups(session, &base.groups, response);
+
+    Util::addToTable<Kes::ProcessProps::Resumed>(response, true);
+    Util::addToTable<Kes::ProcessProps::Token>(response, makeToken(recordGeneration(session, projection(view))));
     Util::addToTable<Kes::Request::Props::Id>(response, id);
     Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
     return true;
 }
 
-void ProcessManager::readProcesses(bool initial, Session* session)
+void ProcessManager::addSystemCpu(PropertyBag& response) const
+{
+    if (m_cpu.systemBusy() < 0)
+        return;
+
+    Util::addToTable<Kes::ProcessProps::SystemBusy>(response, std::round(m_cpu.systemBusy() * 100) / 100);
+    Util::addToTable<Kes::ProcessProps::SystemIdle>(response, std::round(m_cpu.systemIdle() * 100) / 100);
+}
+
+// the groups cover every process the filter lets through, not only the ones of the page
+void ProcessManager::addNamespaceGroups(Session* session, const std::vector<GroupState>* known, PropertyBag& response) const
+{
+    struct Group
+    {
+        const ProcFs::Namespaces* namespaces = nullptr;
+        std::vector<pid_t> pids;
+        pid_t leader = ProcFs::InvalidPid;
+        double cpu = -1;
+        GroupState state;
+    };
+
+    // the entries are interned, so the pointer tells the set; the processes whose namespaces
+    // could not be read make a group of their own
+    std::unordered_map<const ProcFs::Namespaces*, Group> groups;
+    for (auto& process: session->processes)
+    {
+        auto& info = *process.second;
+        if (!matches(session, info))
+            continue;
+
+        auto& group = groups[info.namespaces.get()];
+        group.namespaces = info.namespaces.get();
+        group.pids.push_back(process.first);
+
+        if ((info.nsLevel > 0) && (info.nsPid == 1))
+            group.leader = process.first;
+
+        if (info.cpu >= 0)
+            group.cpu = std::max(group.cpu, 0.0) + info.cpu;
+    }
+
+    std::vector<Group*> ordered;
+    std::vector<GroupState> states;
+    ordered.reserve(groups.size());
+    states.reserve(groups.size());
+    for (auto& group: groups)
+    {
+        auto& g = group.second;
+        std::sort(g.pids.begin(), g.pids.end());
+
+        if (g.namespaces)
+        {
+            for (auto inode: g.namespaces->inodes)
+                g.state.key = mix(g.state.key ^ inode);
+        }
+
+        const int64_t values[] = { int64_t(g.pids.size()), int64_t(g.leader), int64_t(std::round(g.cpu * 100)) };
+        g.state.members = Util::crc32(g.pids.data(), g.pids.size() * sizeof(pid_t));
+        g.state.digest = Util::crc32(values, sizeof(values));
+
+        ordered.push_back(&g);
+        states.push_back(g.state);
+    }
+
+    // by the lowest pid, which tends to put the host first
+    std::sort(ordered.begin(), ordered.end(), [](const Group* a, const Group* b) { return a->pids.front() < b->pids.front(); });
+
+    auto byKey = [](const GroupState& a, const GroupState& b) { return a.key < b.key; };
+    std::sort(states.begin(), states.end(), byKey);
+
+    auto find = [known, &byKey](uint64_t key) -> const GroupState*
+    {
+        auto it = std::lower_bound(known->begin(), known->end(), GroupState{ key }, byKey);
+        return ((it != known->end()) && (it->key == key)) ? &*it : nullptr;
+    };
+
+    PropertyBag groupArray{Kes::ProcessProps::GroupList::idstr(), PropertyBag::Array()};
+    for (auto group: ordered)
+    {
+        auto sent = known ? find(group->state.key) : nullptr;
+        if (sent && (*sent == group->state))
+            continue;
+
+        PropertyBag table{std::string(), PropertyBag::Table()};
+        Util::addToTable<ProcessProps::GroupKey>(table, group->state.key);
+
+        if (group->namespaces && !sent)
+        {
+            auto& inodes = group->namespaces->inodes;
+            if (inodes[ProcFs::Namespaces::Pid])
+                Util::addToTable<ProcessProps::PidNs>(table, inodes[ProcFs::Namespaces::Pid]);
+            if (inodes[ProcFs::Namespaces::Mnt])
+                Util::addToTable<ProcessProps::MntNs>(table, inodes[ProcFs::Namespaces::Mnt]);
+            if (inodes[ProcFs::Namespaces::Net])
+                Util::addToTable<ProcessProps::NetNs>(table, inodes[ProcFs::Namespaces::Net]);
+            if (inodes[ProcFs::Namespaces::User])
+                Util::addToTable<ProcessProps::UserNs>(table, inodes[ProcFs::Namespaces::User]);
+            if (inodes[ProcFs::Namespaces::Cgroup])
+                Util::addToTable<ProcessProps::CgroupNs>(table, inodes[ProcFs::Namespaces::Cgroup]);
+        }
+
+        Util::addToTable<ProcessProps::GroupProcesses>(table, uint64_t(group->pids.size()));
+
+        if (group->leader != ProcFs::InvalidPid)
+            Util::addToTable<ProcessProps::GroupLeader>(table, int(group->leader));
+
+        if (group->cpu >= 0)
+            Util::addToTable<ProcessProps::GroupCpu>(table, std::round(group->cpu * 100) / 100);
+
+        if (!sent || (sent->members != group->state.members))
+        {
+            PropertyBag pids{ProcessProps::GroupPids::idstr(), PropertyBag::Array()};
+            for (auto pid: group->pids)
+                Util::addToArray<ProcessProps::GroupPid>(pids, int(pid));
+
+            Util::addToTable<ProcessProps::GroupPids>(table, std::move(pids));
+        }
+
+        Util::addToArray<Kes::ProcessProps::Group>(groupArray, std::move(table));
+    }
+
+    Util::addToTable<Kes::ProcessProps::GroupList>(response, std::move(groupArray));
+
+    if (known)
+    {
+        PropertyBag deletedArray{Kes::ProcessProps::DeletedGroupList::idstr(), PropertyBag::Array()};
+        for (auto& group: *known)
+        {
+            if (!std::binary_search(states.begin(), states.end(), group, byKey))
+                Util::addToArray<Kes::ProcessProps::DeletedGroup>(deletedArray, group.key);
+        }
+
+        Util::addToTable<Kes::ProcessProps::DeletedGroupList>(response, std::move(deletedArray));
+    }
+
+    session->groups = std::move(states);
+}
+
+void ProcessManager::updateFilter(Session* session, const PropertyBag& request)
+{
+    auto expression = Util::findInTable<ProcessProps::Filter>(request);
+    if (!expression || expression->empty())
+    {
+        session->filter.reset();
+        return;
+    }
+
+    if (session->filter && (session->filter->expression() == *expression))
+        return;
+
+    session->filter = std::make_unique<ProcessFilter>(*expression);
+}
+
+bool ProcessManager::matches(const Session* session, const ProcessInfo& process) noexcept
+{
+    if (!session->filter)
+        return true;
+
+    return session->filter->match(process.subject());
+}
+
+bool ProcessManager::isPartial(const Session* session, const View& view) noexcept
+{
+    return session->filter || view.limit || view.cursor;
+}
+
+// cursors look like <field>:<a|d>:<pid>:<value>, the value being the rest of the string
+ProcessManager::View ProcessManager::parseView(const PropertyBag& request)
+{
+    View view;
+
+    // fields: names with or without the 'process.' prefix, or "*" for everything
+    auto fields = request.table().find(ProcessProps::Fields::idstr());
+    if ((fields != request.table().end()) && fields->second->isArray())
+    {
+        for (auto& item: fields->second->array())
+        {
+            auto name = item->isProperty() ? std::any_cast<std::string>(&item->property().value) : nullptr;
+            if (!name)
+                throw Kes::Exception(KES_HERE(), "Field names must be strings");
+
+            if (*name == "*")
+            {
+                view.columns.clear();
+                for (auto& column: ProcessField::all())
+                {
+                    if (column.selectable())
+                        view.columns.push_back(&column);
+                }
+
+                break;
+            }
+
+            auto qualified = (name->compare(0, 8, "process.") == 0) ? *name : "process." + *name;
+            auto column = ProcessField::find(qualified);
+            if (!column || !column->selectable())
+                throw Kes::Exception(KES_HERE(), Util::format("Unknown field [%s]", name->c_str()));
+
+            if (std::find(view.columns.begin(), view.columns.end(), column) == view.columns.end())
+                view.columns.push_back(column);
+        }
+    }
+    else
+    {
+        view.columns = defaultColumns();
+    }
+
+    for (auto column: view.columns)
+        view.files |= column->files;
+
+    // cached values come with their age
+    if (view.files & ProcFs::SlowFiles)
+    {
+        auto age = ProcessField::find(ProcessProps::SmapsAge::idstr());
+        if (std::find(view.columns.begin(), view.columns.end(), age) == view.columns.end())
+            view.columns.push_back(age);
+    }
+
+    auto refresh = Util::findInTable<ProcessProps::Refresh>(request);
+    view.refresh = refresh && *refresh;
+
+    auto groupBy = Util::findInTable<ProcessProps::GroupBy>(request);
+    if (groupBy && !groupBy->empty())
+    {
+        if (*groupBy != "namespace")
+            throw Kes::Exception(KES_HERE(), Util::format("Unknown grouping [%s], expected namespace", groupBy->c_str()));
+
+        view.groupByNamespace = true;
+        view.files |= ProcFs::NsDir;
+    }
+
+    auto sortBy = Util::findInTable<ProcessProps::SortBy>(request);
+    auto order = Util::findInTable<ProcessProps::Order>(request);
+    auto limit = Util::findInTable<ProcessProps::Limit>(request);
+    auto cursor = Util::findInTable<ProcessProps::Cursor>(request);
+
+    if (!sortBy && !order && !limit && !cursor)
+        return view;
+
+    view.sortBy = ProcessField::find(sortBy ? *sortBy : std::string("pid"));
+    if (!view.sortBy)
+        throw Kes::Exception(KES_HERE(), Util::format("Unknown sort field [%s]", sortBy->c_str()));
+
+    view.files |= view.sortBy->files;
+
+    if (order)
+    {
+        if (*order == "desc")
+            view.descending = true;
+        else if (*order != "asc")
+            throw Kes::Exception(KES_HERE(), Util::format("Invalid sort order [%s], expected asc or desc", order->c_str()));
+    }
+
+    if (limit)
+    {
+        if (*limit < 0)
+            throw Kes::Exception(KES_HERE(), "Invalid limit");
+
+        view.limit = size_t(*limit);
+    }
+
+    if (cursor && !cursor->empty())
+    {
+        auto invalid = [&cursor]()
+        {
+            return Kes::Exception(KES_HERE(), Util::format("Invalid cursor [%s]", cursor->c_str()));
+        };
+
+        auto first = cursor->find(':');
+        auto second = (first != std::string::npos) ? cursor->find(':', first + 1) : std::string::npos;
+        auto third = (second != std::string::npos) ? cursor->find(':', second + 1) : std::string::npos;
+        if (third == std::string::npos)
+            throw invalid();
+
+        if ((cursor->compare(0, first, view.sortBy->name()) != 0) || (cursor->compare(first + 1, second - first - 1, view.descending ? "d" : "a") != 0))
+            throw Kes::Exception(KES_HERE(), "The cursor belongs to a different sort order");
+
+        char* end = nullptr;
+        view.cursorPid = pid_t(std::strtol(cursor->c_str() + second + 1, &end, 10));
+        if (end != cursor->c_str() + third)
+            throw invalid();
+
+        if (view.sortBy->number)
+        {
+            errno = 0;
+            view.cursorNumber = std::strtod(cursor->c_str() + third + 1, &end);
+            if ((end == cursor->c_str() + third + 1) || *end || (errno == ERANGE))
+                throw invalid();
+        }
+        else
+        {
+            view.cursorText = cursor->substr(third + 1);
+        }
+
+        view.cursor = true;
+    }
+
+    return view;
+}
+
+// only the entries of the requested page are ever fully ordered
+std::vector<ProcessManager::ProcessInfo*> ProcessManager::select(const Session* session, const View& view, std::string& nextCursor) const
 {
+    std::vector<ProcessInfo*> selected;
+
+    if (!view.sortBy)
+    {
+        selected.reserve(session->processes.size());
+        for (auto& process: session->processes)
+        {
+            if (matches(session, *process.second))
+                selected.push_back(process.second.get());
+        }
+
+        return selected;
+    }
+
+    auto field = view.sortBy;
+    auto before = [field, &view](const SortKey& a, const SortKey& b)
+    {
+        int c = field->number ? ((a.number < b.number) ? -1 : (a.number > b.number)) : std::strcmp(a.text, b.text);
+        if (c)
+            return view.descending ? (c > 0) : (c < 0);
+
+        return a.pid < b.pid;
+    };
+
+    SortKey after{ view.cursorNumber, view.cursorText.c_str(), view.cursorPid, nullptr };
+
+    std::vector<SortKey> keys;
+    keys.reserve(session->processes.size());
+    for (auto& process: session->processes)
+    {
+        auto& info = *process.second;
+        auto subject = info.subject();
+        if (session->filter && !session->filter->match(subject))
+            continue;
+
+        SortKey key{ field->number ? field->number(subject) : 0, field->text ? field->text(subject) : nullptr, process.first, &info };
+        if (view.cursor && !before(after, key))
+            continue;
+
+        keys.push_back(key);
+    }
+
+    if (view.limit && (keys.size() > view.limit))
+    {
+        std::nth_element(keys.begin(), keys.begin() + view.limit, keys.end(), before);
+        keys.resize(view.limit);
+        std::sort(keys.begin(), keys.end(), before);
+
+        if (!keys.empty())
+        {
+            auto& last = keys.back();
+            nextCursor = Util::format("%s:%s:%d:", field->name(), view.descending ? "d" : "a", int(last.pid));
+            nextCursor.append(field->number ? Util::format("%.17g", last.number) : std::string(last.text));
+        }
+    }
+    else
+    {
+        std::sort(keys.begin(), keys.end(), before);
+    }
+
+    selected.reserve(keys.size());
+    for (auto& key: keys)
+        selected.push_back(key.process);
+
+    return selected;
+}
+
+// the digests depend on what was read and serialized, so only generations of the same
+// projection can be compared
+uint64_t ProcessManager::projection(const View& view) noexcept
+{
+    uint64_t key = mix(view.files);
+    for (auto column: view.columns)
+        key += mix(uint64_t(column - ProcessField::all().data()) + 1);
+
+    // the generation keeps the groups then
+    if (view.groupByNamespace)
+        key += mix(~uint64_t(0));
+
+    return key;
+}
+
+// a scan that saw what the latest generation of its projection holds shares it; the fingerprint
+// tells that without sorting the table
+uint64_t ProcessManager::recordGeneration(const Session* session, uint64_t projection)
+{
+    auto now = Metrics::now();
+    expireGenerations(now);
+
+    uint64_t fingerprint = 0;
+    for (auto& process: session->processes)
+        fingerprint += mix((uint64_t(uint32_t(process.first)) << 32) | process.second->digest);
+
+    auto& ids = m_projections[projection];
+    if (!ids.empty())
+    {
+        auto& latest = m_history[ids.back()];
+        if ((latest.fingerprint == fingerprint) && (latest.processes.size() == session->processes.size()) && (latest.groups == session->groups))
+        {
+            latest.time = now;
+            return latest.id;
+        }
+    }
+
+    Generation current;
+    current.id = ++m_lastGeneration;
+    current.projection = projection;
+    current.time = now;
+    current.fingerprint = fingerprint;
+    current.processes.reserve(session->processes.size());
+    for (auto& process: session->processes)
+        current.processes.push_back({ process.first, process.second->digest });
+
+    std::sort(current.processes.begin(), current.processes.end());
+    current.groups = session->groups;
+
+    m_history.emplace(current.id, std::move(current));
+    ids.push_back(m_lastGeneration);
+
+    while (ids.size() > m_historyDepth)
+    {
+        m_history.erase(ids.front());
+        ids.pop_front();
+    }
+
+    return m_lastGeneration;
+}
+
+// the generations of a projection are in the order they were last seen in
+void ProcessManager::expireGenerations(uint64_t now)
+{
+    if (now < m_historyAge)
+        return;
+
+    auto oldest = now - m_historyAge;
+    for (auto it = m_projections.begin(); it != m_projections.end();)
+    {
+        auto& ids = it->second;
+        while (!ids.empty() && (m_history[ids.front()].time < oldest))
+        {
+            m_history.erase(ids.front());
+            ids.pop_front();
+        }
+
+        if (ids.empty())
+            it = m_projections.erase(it);
+        else
+            ++it;
+    }
+}
+
+const ProcessManager::Generation* ProcessManager::findGeneration(const std::string& token, uint64_t projection) const noexcept
+{
+    unsigned long long instance = 0;
+    unsigned long long generation = 0;
+    int consumed = 0;
+    if ((::sscanf(token.c_str(), "%llx.%llx%n", &instance, &generation, &consumed) != 2) || (size_t(consumed) != token.length()))
+        return nullptr;
+
+    if (instance != m_instance)
+        return nullptr;
+
+    auto it = m_history.find(generation);
+    if ((it == m_history.end()) || (it->second.projection != projection))
+        return nullptr;
+
+    // expired, but not yet collected
+    if (Metrics::now() - it->second.time > m_historyAge)
+        return nullptr;
+
+    return &it->second;
+}
+
+std::string ProcessManager::makeToken(uint64_t generation) const
+{
+    return Util::format("%016llx.%llx", (unsigned long long)m_instance, (unsigned long long)generation);
+}
+
+void ProcessManager::readProcesses(bool initial, Session* session, const View& view)
+{
+    auto files = view.files | (session->filter ? session->filter->files() : 0);
+
     ++session->timestamp;
 
     if (initial)
@@ -135,10 +837,22 @@ void ProcessManager::readProcesses(bool initial, Session* session)
 
     session->removedPids.clear();
 
+    auto started = m_metrics ? Metrics::now() : 0;
+
+    // cached values and previous samples are told from the ones of a reused pid by the start time
+    if (files & (ProcFs::SlowFiles | ProcFs::IoFile))
+        files |= ProcFs::StatFile;
+
+    if (files & ProcFs::StatFile)
+    {
+        m_cpu.beginScan();
+        m_cpu.updateSystem(m_procFs.readCpuTimes(), Metrics::now());
+    }
+
     auto pids = m_procFs.enumeratePids();
     for (auto pid: pids)
     {
-        auto process = readProcess(pid, session->timestamp);
+        auto process = readProcess(pid, session->timestamp, files);
         if (!initial)
         {
             // check if this is a new process
@@ -165,31 +879,288 @@ void ProcessManager::readProcesses(bool initial, Session* session)
     if (!initial)
     {
         // detect deleted processes
-        for (auto it = session->processes.begin(); it != session->processes.end(); ++it)
+        for (auto it = session->processes.begin(); it != session->processes.end();)
         {
             if (it->second->timestamp < session->timestamp)
             {
                 m_log->write(Log::Level::Info, "DELETED process %d [%s]", it->first, it->second->stat.comm.c_str());
 
                 session->removedPids.push_back(it->first);
-                session->processes.erase(it);
+                it = session->processes.erase(it);
+            }
+            else
+            {
+                ++it;
             }
         }
     }
+
+    if (files & ProcFs::SlowFiles)
+        readSlowFiles(session, view.refresh);
+
+    // the slow reads are in by now
+    for (auto& process: session->processes)
+        process.second->digest = process.second->computeDigest(view.columns);
+
+    if (files & ProcFs::NsDir)
+    {
+        // the sets whose last process is gone
+        for (auto it = m_namespaces.begin(); it != m_namespaces.end();)
+        {
+            if (it->second.expired())
+                it = m_namespaces.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    if ((files & ProcFs::StatFile) && !m_listeners.empty())
+    {
+        std::vector<IScanListener::Process> processes;
+        processes.reserve(session->processes.size());
+        for (auto& process: session->processes)
+        {
+            if (process.second->stat.valid)
+                processes.push_back(sampleOf(process.second->stat, process.second->cpu));
+        }
+
+        notifyListeners(processes, Metrics::now());
+    }
+
+    if (files & ProcFs::IoFile)
+    {
+        // forget the processes that are gone
+        for (auto it = m_io.begin(); it != m_io.end();)
+        {
+            if (!session->processes.count(it->first))
+                it = m_io.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    if (m_metrics)
+        m_metrics->recordScan(Metrics::now() - started, pids.size());
+}
+
+void ProcessManager::readSlowFiles(const Session* session, bool refresh)
+{
+    auto now = Metrics::now();
+    auto interval = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(m_refresh.slowInterval).count());
+    auto deadline = now + uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(m_refresh.scanBudget).count());
+
+    auto apply = [](const SlowSample& sample, ProcessInfo& process)
+    {
+        process.memory.smaps = sample.smaps;
+        process.smapsTime = sample.time;
+    };
+
+    // sample time, process
+    std::vector<std::pair<uint64_t, ProcessInfo*>> due;
+    for (auto& process: session->processes)
+    {
+        auto& info = *process.second;
+        if (!info.stat.valid)
+            continue;
+
+        // not worth a page table walk if the filter drops the process anyway
+        if (session->filter && !(session->filter->files() & ProcFs::SlowFiles) && !matches(session, info))
+            continue;
+
+        auto& sample = m_slow[process.first];
+        if (sample.startTicks != info.stat.starttime)
+            sample = SlowSample{ info.stat.starttime };
+
+        if (refresh || !sample.time || (now - sample.time >= interval))
+            due.push_back({ sample.time, &info });
+        else
+            apply(sample, info);
+    }
+
+    // the stalest first; whatever the budget does not cover keeps its cached values
+    std::sort(due.begin(), due.end(), [](const std::pair<uint64_t, ProcessInfo*>& a, const std::pair<uint64_t, ProcessInfo*>& b) { return a.first < b.first; });
+
+    size_t read = 0;
+    for (auto& entry: due)
+    {
+        auto& sample = m_slow[entry.second->stat.pid];
+
+        // at least one read per scan, so that a tiny budget still makes progress
+        if (!read || (Metrics::now() < deadline))
+        {
+            // an unreadable file is not retried before the interval is over either
+            sample.smaps = m_procFs.readSmapsRollup(entry.second->stat.pid);
+            sample.time = Metrics::now();
+            ++read;
+        }
+
+        apply(sample, *entry.second);
+    }
+
+    if (read < due.size())
+        m_log->write(Log::Level::Debug, "ProcessManager: scan budget exhausted, %zu of %zu slow reads postponed", due.size() - read, due.size());
+
+    // forget the processes that are gone
+    for (auto it = m_slow.begin(); it != m_slow.end();)
+    {
+        if (!session->processes.count(it->first))
+            it = m_slow.erase(it);
+        else
+            ++it;
+    }
 }
 
-ProcessManager::ProcessInfo::Ptr ProcessManager::readProcess(pid_t pid, uint32_t timestamp)
+ProcessManager::ProcessInfo::Ptr ProcessManager::readProcess(pid_t pid, uint32_t timestamp, uint32_t files)
 {
-    auto process = std::make_unique<ProcessInfo>(timestamp, m_procFs.readStat(pid));
+    ProcFs::Stat stat;
+    stat.pid = pid;
+    if (files & ProcFs::StatFile)
+        stat = m_procFs.readStat(pid);
+
+    auto process = std::make_unique<ProcessInfo>(timestamp, std::move(stat));
+    process->files = files;
+
+    if (process->stat.valid)
+        process->cpu = m_cpu.update(pid, process->stat.starttime, process->stat.utime + process->stat.stime, Metrics::now());
+
+    if (files & ProcFs::CommFile)
+        process->comm = m_procFs.readComm(pid);
+
+    if (files & ProcFs::ExeFile)
+        process->exe = m_procFs.readExePath(pid);
 
-    process->comm = m_procFs.readComm(pid);
-    process->exe = m_procFs.readExePath(pid);
-    process->cmdLine = m_procFs.readCmdLine(pid);
+    if (files & ProcFs::CmdLineFile)
+        process->cmdLine = m_procFs.readCmdLine(pid);
+
+    if (files & ProcFs::StatmFile)
+        process->memory.statm = m_procFs.readStatm(pid);
+
+    // NsDir takes the NSpid line of status
+    if (files & (ProcFs::StatusFile | ProcFs::NsDir))
+        process->memory.status = m_procFs.readStatus(pid);
+
+    if (files & ProcFs::IoFile)
+    {
+        process->io = m_procFs.readIo(pid);
+        if (process->io.valid && process->stat.valid)
+            updateIoRates(*process, Metrics::now());
+    }
+
+    if (files & ProcFs::FdDir)
+    {
+        auto count = m_procFs.countFds(pid);
+        if (count)
+            process->fdCount = int64_t(*count);
+    }
+
+    if (files & ProcFs::NsDir)
+    {
+        auto namespaces = m_procFs.readNamespaces(pid);
+        if (namespaces.valid)
+            process->namespaces = internNamespaces(namespaces);
+
+        auto& nsPids = process->memory.status.nsPids;
+        if (!nsPids.empty())
+        {
+            process->nsPid = nsPids.back();
+            process->nsLevel = int(nsPids.size()) - 1;
+        }
+    }
 
     return process;
 }
 
-PropertyBag ProcessManager::ProcessInfo::serialize() const
+void ProcessManager::updateIoRates(ProcessInfo& process, uint64_t now)
+{
+    static constexpr std::pair<uint64_t ProcFs::IoCounters::*, double ProcFs::IoRates::*> members[] =
+    {
+        { &ProcFs::IoCounters::rchar, &ProcFs::IoRates::rchar },
+        { &ProcFs::IoCounters::wchar, &ProcFs::IoRates::wchar },
+        { &ProcFs::IoCounters::syscr, &ProcFs::IoRates::syscr },
+        { &ProcFs::IoCounters::syscw, &ProcFs::IoRates::syscw },
+        { &ProcFs::IoCounters::readBytes, &ProcFs::IoRates::readBytes },
+        { &ProcFs::IoCounters::writeBytes, &ProcFs::IoRates::writeBytes },
+        { &ProcFs::IoCounters::cancelledWriteBytes, &ProcFs::IoRates::cancelledWriteBytes },
+    };
+
+    auto& sample = m_io[process.stat.pid];
+
+    // a new process, or a new one under an old pid
+    if (!sample.time || (sample.startTicks != process.stat.starttime))
+    {
+        sample = IoSample{ process.stat.starttime, now, process.io };
+        return;
+    }
+
+    // the same rule as for the CPU rates: too close to the baseline says little
+    auto elapsed = now - sample.time;
+    if (elapsed >= CpuSampler::MinInterval)
+    {
+        auto seconds = double(elapsed) / 1e9;
+        for (auto& member: members)
+        {
+            auto current = process.io.*member.first;
+            auto previous = sample.counters.*member.first;
+            sample.rates.*member.second = (current >= previous) ? double(current - previous) / seconds : 0;
+        }
+
+        sample.rates.valid = true;
+        sample.counters = process.io;
+        sample.time = now;
+    }
+
+    process.ioRates = sample.rates;
+}
+
+std::shared_ptr<const ProcFs::Namespaces> ProcessManager::internNamespaces(const ProcFs::Namespaces& namespaces)
+{
+    auto& entry = m_namespaces[namespaces];
+    auto shared = entry.lock();
+    if (!shared)
+    {
+        shared = std::make_shared<const ProcFs::Namespaces>(namespaces);
+        entry = shared;
+    }
+
+    return shared;
+}
+
+uint32_t ProcessManager::ProcessInfo::computeDigest(const std::vector<const Column*>& columns) const noexcept
+{
+    auto add = [](uint32_t crc, const char* s)
+    {
+        auto length = uint32_t(std::strlen(s));
+        crc = Util::crc32(&length, sizeof(length), crc);
+        return Util::crc32(s, length, crc);
+    };
+
+    const int32_t ids[] = { int32_t(files), int32_t(stat.valid) };
+    auto crc = Util::crc32(ids, sizeof(ids));
+    crc = add(crc, stat.error.c_str());
+
+    // what the columns write, as filters and sorts see it
+    auto subject = this->subject();
+    for (auto column: columns)
+    {
+        // the age moves by itself; the values it goes with are covered
+        if (!std::strcmp(column->idstr, ProcessProps::SmapsAge::idstr()))
+            continue;
+
+        if (column->number)
+        {
+            auto value = column->number(subject);
+            crc = Util::crc32(&value, sizeof(value), crc);
+        }
+        else
+        {
+            crc = add(crc, column->text(subject));
+        }
+    }
+
+    return crc;
+}
+
+PropertyBag ProcessManager::ProcessInfo::serialize(const std::vector<const Column*>& columns) const
 {
     PropertyBag table{std::string(), PropertyBag::Table()};
 
@@ -200,32 +1171,56 @@ PropertyBag ProcessManager::ProcessInfo::serialize() const
         Util::addToTable<ProcessProps::Newcomer>(table, true);
     }
     
-    if (!stat.valid)
+    if ((files & ProcFs::StatFile) && !stat.valid)
     {
         Util::addToTable<ProcessProps::Error>(table, stat.error);
     }
     else
     {    
-        Util::addToTable<ProcessProps::PPid>(table, int(stat.ppid));
-        Util::addToTable<ProcessProps::PGrp>(table, int(stat.pgrp));
-        Util::addToTable<ProcessProps::Tpgid>(table, int(stat.tpgid));
-        Util::addToTable<ProcessProps::Session>(table, int(stat.session));
-        Util::addToTable<ProcessProps::Comm>(table, comm);
-        Util::addToTable<ProcessProps::Ruid>(table, int(stat.ruid));
+        auto subject = this->subject();
+        for (auto column: columns)
+            column->add(table, subject);
+    }
 
-        if (!comm.empty())
-            Util::addToTable<ProcessProps::StatComm>(table, comm);
+    return table;
+}
 
-        if (!exe.empty())
-            Util::addToTable<ProcessProps::Exe>(table, exe);
+ProcessFilter::Subject ProcessManager::ProcessInfo::subject() const noexcept
+{
+    return { stat, comm, exe, cmdLine, cpu, &memory, &io, &ioRates, fdCount, namespaces.get(), nsPid, nsLevel, smapsTime };
+}
 
-        if (!cmdLine.empty())
-            Util::addToTable<ProcessProps::CmdLine>(table, cmdLine);
-    }
+// what a request that does not name its fields gets
+const std::vector<const ProcessManager::Column*>& ProcessManager::defaultColumns()
+{
+    static const std::vector<const Column*> selection = []()
+    {
+        const char* const names[] =
+        {
+            ProcessProps::PPid::idstr(),
+            ProcessProps::PGrp::idstr(),
+            ProcessProps::Tpgid::idstr(),
+            ProcessProps::Session::idstr(),
+            ProcessProps::Comm::idstr(),
+            ProcessProps::Ruid::idstr(),
+            ProcessProps::StatComm::idstr(),
+            ProcessProps::Exe::idstr(),
+            ProcessProps::CmdLine::idstr(),
+            ProcessProps::Cpu::idstr()
+        };
 
-    return table;
+        std::vector<const Column*> v;
+        for (auto name: names)
+        {
+            v.push_back(ProcessField::find(name));
+        }
+
+        return v;
+    }();
+
+    return selection;
 }
 
 } // namespace Private {}    
 
-} // namespace Kes {}
+} // namespace Kes {}
\ No newline at end of file
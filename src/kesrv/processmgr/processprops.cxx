@@ -24,10 +24,194 @@ KESRV_EXPORT void registerAll()
     registerProperty(new PropertyInfoWrapper<ProcessProps::PGrp>);
     registerProperty(new PropertyInfoWrapper<ProcessProps::Tpgid>);
     registerProperty(new PropertyInfoWrapper<ProcessProps::Session>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Ruid>);
     registerProperty(new PropertyInfoWrapper<ProcessProps::StatComm>);
     registerProperty(new PropertyInfoWrapper<ProcessProps::Comm>);
     registerProperty(new PropertyInfoWrapper<ProcessProps::CmdLine>);
     registerProperty(new PropertyInfoWrapper<ProcessProps::Exe>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::State>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::TtyNr>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Flags>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::MinFlt>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CMinFlt>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::MajFlt>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CMajFlt>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::UTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::STime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CUTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CSTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Priority>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Nice>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::NumThreads>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ItRealValue>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::StartTicks>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::VSize>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Rss>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::RssLim>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::StartCode>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::EndCode>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::StartStack>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::KstkEsp>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::KstkEip>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Signal>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Blocked>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SigIgnore>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SigCatch>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::WChan>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::NSwap>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CNSwap>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ExitSignal>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Processor>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::RtPriority>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Policy>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::DelayAcctBlkioTicks>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GuestTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CGuestTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::StartData>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::EndData>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::StartBrk>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ArgStart>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ArgEnd>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::EnvStart>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::EnvEnd>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ExitCode>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::StartTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Shared>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Text>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Data>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::RssAnon>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::RssFile>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::RssShmem>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Swap>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Pss>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::PssAnon>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::PssFile>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::PssShmem>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SwapPss>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SmapsAge>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoRChar>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoWChar>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoSyscR>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoSyscW>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoReadBytes>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoWriteBytes>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoCancelledWriteBytes>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoRCharRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoWCharRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoSyscRRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoSyscWRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoReadBytesRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoWriteBytesRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::IoCancelledWriteBytesRate>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdCount>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::PidNs>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::MntNs>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::NetNs>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::UserNs>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupNs>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::NsPid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::NsLevel>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Cpu>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SystemBusy>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SystemIdle>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Token>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Resumed>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Filter>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SortBy>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Order>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Limit>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Cursor>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::NextCursor>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Fields>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Refresh>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupBy>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Group>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupProcesses>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupPid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupPids>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupLeader>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::GroupCpu>);
+
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Thread>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::DeletedThread>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::DeletedThreadList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadError>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadNewcomer>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Tid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadPid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadComm>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadState>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadCpu>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadProcessor>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadWChan>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadPriority>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadNice>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadUTime>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::ThreadSTime>);
+
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Fd>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdWithInfo>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdPid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdNumber>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdType>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdTarget>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdInode>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdPos>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdFlags>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::FdMntId>);
+
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Socket>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketIndexGeneration>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketProtocol>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketLocalAddress>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketLocalPort>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketRemoteAddress>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketRemotePort>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketState>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketUid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketInode>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketTxQueue>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketRxQueue>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketPath>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketPid>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SocketPids>);
+
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Cgroup>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupPath>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupProcesses>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupCpu>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupRss>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupCpuUsage>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupCpuUser>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupCpuSystem>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupCpuNrThrottled>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupCpuThrottled>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemoryCurrent>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemorySomeAvg10>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemorySomeAvg60>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemorySomeAvg300>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemorySomeTotal>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemoryFullAvg10>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemoryFullAvg60>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemoryFullAvg300>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::CgroupMemoryFullTotal>);
+
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolAddresses>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolPrefix>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolMore>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolCount>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::Symbol>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolList>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolAddress>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolName>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolOffset>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolModule>);
+    registerProperty(new PropertyInfoWrapper<ProcessProps::SymbolType>);
 
 }
 
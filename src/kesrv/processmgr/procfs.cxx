@@ -2,15 +2,23 @@
 #include <kesrv/knownprops.hxx>
 
 #include <kesrv/processmanager/procfs.hxx>
+#include <kesrv/trace/trace.hxx>
 #include <kesrv/util/autoptr.hxx>
 #include <kesrv/util/exceptionutil.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/generichandle.hxx>
 #include <kesrv/util/posixerror.hxx>
 
 
+#include <charconv>
 #include <fstream>
 
+#include <arpa/inet.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 
 namespace Kes
@@ -32,36 +40,373 @@ struct DirCloser
 
 using DirHolder = Util::AutoPtr<DIR, DirCloser>;
 
+
+struct FileCloser
+{
+    void operator()(int fd) noexcept
+    {
+        ::close(fd);
+    }
+};
+
+using FileHolder = Util::GenericHandle<int, int, -1, FileCloser>;
+
+
+// calls fn(name) for the numeric entries of a directory straight from getdents64, with
+// neither a DIR nor an allocation per entry; 0 or the errno of the failure
+template <typename Fn>
+int forEachNumericEntry(const std::string& path, Fn&& fn)
+{
+    FileHolder dir(::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (!dir.valid())
+        return errno;
+
+    alignas(struct dirent64) char buffer[32768];
+    for (;;)
+    {
+        auto r = ::syscall(SYS_getdents64, dir.get(), buffer, sizeof(buffer));
+        if (r < 0)
+            return errno;
+
+        if (r == 0)
+            return 0;
+
+        for (long offset = 0; offset < r;)
+        {
+            auto entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+            if (std::isdigit(static_cast<unsigned char>(entry->d_name[0])))
+                fn(entry->d_name);
+
+            offset += entry->d_reclen;
+        }
+    }
+}
+
+void classify(FileDescriptor& entry) noexcept
+{
+    auto& target = entry.target;
+    auto inodeAt = [&target](size_t prefix) { return std::strtoull(target.c_str() + prefix, nullptr, 10); };
+
+    if (!target.empty() && (target[0] == '/'))
+    {
+        entry.type = FileDescriptor::Type::File;
+    }
+    else if (target.compare(0, 8, "socket:[") == 0)
+    {
+        entry.type = FileDescriptor::Type::Socket;
+        entry.inode = inodeAt(8);
+    }
+    else if (target.compare(0, 6, "pipe:[") == 0)
+    {
+        entry.type = FileDescriptor::Type::Pipe;
+        entry.inode = inodeAt(6);
+    }
+    else if (target.compare(0, 11, "anon_inode:") == 0)
+    {
+        entry.type = FileDescriptor::Type::AnonInode;
+    }
+}
+
+// the leading pos/flags/mnt_id lines; epoll and inotify descriptors append a line per watch, which are not looked at
+void readFdInfo(int dir, const char* name, FileDescriptor& entry) noexcept
+{
+    FileHolder file(::openat(dir, name, O_RDONLY | O_CLOEXEC));
+    if (!file.valid())
+        return;
+
+    char text[512];
+    auto r = ::read(file, text, sizeof(text) - 1);
+    if (r <= 0)
+        return;
+
+    text[r] = '\0';
+
+    const char* line = text;
+    while (line && *line)
+    {
+        if (!std::strncmp(line, "pos:", 4))
+            entry.pos = std::strtoull(line + 4, nullptr, 10);
+        else if (!std::strncmp(line, "flags:", 6))
+            entry.flags = uint32_t(std::strtoul(line + 6, nullptr, 8));
+        else if (!std::strncmp(line, "mnt_id:", 7))
+            entry.mntId = int(std::strtol(line + 7, nullptr, 10));
+
+        line = std::strchr(line, '\n');
+        if (line)
+            ++line;
+    }
+
+    entry.infoValid = true;
+}
+
+
+struct NamedField
+{
+    const char* key;    // with the colon
+    uint64_t* value;
+};
+
+// picks the "Key:   <n>" lines of status, smaps_rollup or io, the values multiplied by 'unit';
+// false if none was there: a permission check may fail the read rather than the open
+template <size_t N>
+bool readNamedFields(const std::string& path, const NamedField (&fields)[N], uint64_t unit)
+{
+    std::ifstream stream(path);
+    if (!stream.good())
+        return false;
+
+    std::string line;
+    size_t found = 0;
+    while ((found < N) && std::getline(stream, line))
+    {
+        for (auto& field: fields)
+        {
+            auto length = std::strlen(field.key);
+            if (line.compare(0, length, field.key) == 0)
+            {
+                *field.value = std::strtoull(line.c_str() + length, nullptr, 10) * unit;
+                ++found;
+                break;
+            }
+        }
+    }
+
+    return found > 0;
+}
+
+
+// the whole of a kernel table, which may be larger than what one read returns
+bool readWhole(const std::string& path, std::string& text)
+{
+    FileHolder file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!file.valid())
+        return false;
+
+    char buffer[65536];
+    for (;;)
+    {
+        auto r = ::read(file, buffer, sizeof(buffer));
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        if (r == 0)
+            return true;
+
+        text.append(buffer, size_t(r));
+    }
+}
+
+
+// the /proc/net parsers; a field never runs past the end of its line, the text ends with a '\0'
+
+inline int hexDigit(char c) noexcept
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+template <typename T>
+bool hexField(const char*& p, T& value, size_t maxDigits = sizeof(T) * 2) noexcept
+{
+    uint64_t v = 0;
+    size_t n = 0;
+    for (int d = hexDigit(*p); (d >= 0) && (n < maxDigits); d = hexDigit(*p))
+    {
+        v = (v << 4) | uint64_t(d);
+        ++p;
+        ++n;
+    }
+
+    value = T(v);
+    return n > 0;
+}
+
+template <typename T>
+bool decField(const char*& p, T& value) noexcept
+{
+    uint64_t v = 0;
+    auto start = p;
+    while ((*p >= '0') && (*p <= '9'))
+        v = v * 10 + uint64_t(*p++ - '0');
+
+    value = T(v);
+    return p > start;
+}
+
+inline void skipSpaces(const char*& p) noexcept
+{
+    while (*p == ' ')
+        ++p;
+}
+
+inline void skipField(const char*& p) noexcept
+{
+    while (*p && (*p != ' ') && (*p != '\n'))
+        ++p;
+
+    skipSpaces(p);
+}
+
+// "0100007F:1F90": the address comes as 32-bit words printed in host order, the port in network order
+bool parseEndpoint(const char*& p, bool v6, std::string& address, uint16_t& port)
+{
+    uint32_t words[4] = {};
+    for (size_t i = 0; i < (v6 ? 4u : 1u); ++i)
+    {
+        if (!hexField(p, words[i], 8))
+            return false;
+    }
+
+    if (*p != ':')
+        return false;
+
+    ++p;
+    if (!hexField(p, port, 4))
+        return false;
+
+    char text[INET6_ADDRSTRLEN];
+    if (!::inet_ntop(v6 ? AF_INET6 : AF_INET, words, text, sizeof(text)))
+        return false;
+
+    address.assign(text);
+    skipSpaces(p);
+    return true;
+}
+
+//   sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode
+//    0: 0100007F:1F90 00000000:0000 0A 00000000:00000000 00:00000000 00000000  1000        0 12345 ...
+bool parseInetLine(const char* p, bool v6, Socket& socket)
+{
+    skipSpaces(p);
+    skipField(p);
+
+    if (!parseEndpoint(p, v6, socket.localAddress, socket.localPort) || !parseEndpoint(p, v6, socket.remoteAddress, socket.remotePort))
+        return false;
+
+    if (!hexField(p, socket.state, 2))
+        return false;
+
+    skipSpaces(p);
+    if (!hexField(p, socket.txQueue, 16) || (*p != ':'))
+        return false;
+
+    ++p;
+    if (!hexField(p, socket.rxQueue, 16))
+        return false;
+
+    skipSpaces(p);
+    skipField(p);   // tr:tm->when
+    skipField(p);   // retrnsmt
+
+    if (!decField(p, socket.uid))
+        return false;
+
+    skipSpaces(p);
+    skipField(p);   // timeout
+
+    if (!decField(p, socket.inode))
+        return false;
+
+    socket.listening = ((socket.protocol == Socket::Protocol::Tcp) || (socket.protocol == Socket::Protocol::Tcp6)) && (socket.state == 0x0a);
+    return true;
+}
+
+// Num       RefCount Protocol Flags    Type St Inode Path
+// 0000000000000000: 00000002 00000000 00010000 0001 01 12345 /run/systemd/notify
+bool parseUnixLine(const char* p, Socket& socket)
+{
+    skipSpaces(p);
+    skipField(p);   // Num
+    skipField(p);   // RefCount
+    skipField(p);   // Protocol
+
+    uint32_t flags = 0;
+    uint32_t type = 0;
+    if (!hexField(p, flags, 8))
+        return false;
+
+    skipSpaces(p);
+    if (!hexField(p, type, 4))
+        return false;
+
+    skipSpaces(p);
+    if (!hexField(p, socket.state, 2))
+        return false;
+
+    skipSpaces(p);
+    if (!decField(p, socket.inode))
+        return false;
+
+    skipSpaces(p);
+    auto end = p;
+    while (*end && (*end != '\n'))
+        ++end;
+
+    socket.path.assign(p, end);
+    socket.listening = (flags & 0x10000) != 0;   // __SO_ACCEPTCON
+    return true;
+}
+
 } // namespace {}
 
-ProcFs::ProcFs(Log::ILog* log)
+ProcFs::ProcFs(Log::ILog* log, const std::string& root)
     : m_log(log)
+    , m_root(root)
 {
-    auto rootPath = root();
-    if (::access(rootPath.c_str(), R_OK) == -1)
+    if (::access(m_root.c_str(), R_OK) == -1)
     {   
         auto e = errno;
-        throw Kes::Exception(KES_HERE(), "Failed to access /proc", Kes::ExceptionProps::PosixErrorCode(e), Kes::ExceptionProps::DecodedError(Kes::Util::posixErrorToString(e)));
+        throw Kes::Exception(KES_HERE(), Util::format("Failed to access %s", m_root.c_str()), Kes::ExceptionProps::PosixErrorCode(e), Kes::ExceptionProps::DecodedError(Kes::Util::posixErrorToString(e)));
     }
+
+    m_bootTime = getBootTimeImpl();
 }
 
-std::string ProcFs::root()
+Stat ProcFs::readStat(pid_t pid) noexcept
 {
-    static std::string s_path("/proc");
-    return s_path;
+    Trace::FileScope trace("stat");
+
+    auto path = root();
+    path.append("/");
+    path.append(std::to_string(pid));
+
+    return readStatAt(std::move(path), pid);
 }
 
-Stat ProcFs::readStat(pid_t pid) noexcept
+Stat ProcFs::readTaskStat(pid_t pid, pid_t tid) noexcept
+{
+    Trace::FileScope trace("taskstat");
+
+    auto path = root();
+    path.append("/");
+    path.append(std::to_string(pid));
+    path.append("/task/");
+    path.append(std::to_string(tid));
+
+    return readStatAt(std::move(path), tid);
+}
+
+// 'path' is the /proc/<pid> or /proc/<pid>/task/<tid> directory
+Stat ProcFs::readStatAt(std::string&& path, pid_t pid) noexcept
 {
     Stat result;
     result.pid = pid; // Stat::pid is always valid
 
     try
     {
-        auto path = root();
-        path.append("/");
-        path.append(std::to_string(pid));
-        
         struct ::stat64 fileStat;
         if (::stat64(path.c_str(), &fileStat) == -1)
         {
@@ -293,6 +638,8 @@ Stat ProcFs::readStat(pid_t pid) noexcept
 
 std::string ProcFs::readComm(pid_t pid) noexcept
 {
+    Trace::FileScope trace("comm");
+
     try
     {
         auto path = root();
@@ -315,6 +662,8 @@ std::string ProcFs::readComm(pid_t pid) noexcept
 
 std::string ProcFs::readExePath(pid_t pid) noexcept
 {
+    Trace::FileScope trace("exe");
+
     try
     {
         auto path = root();
@@ -364,6 +713,8 @@ std::string ProcFs::readExePath(pid_t pid) noexcept
 
 std::string ProcFs::readCmdLine(pid_t pid) noexcept
 {
+    Trace::FileScope trace("cmdline");
+
     try
     {
         auto path = root();
@@ -406,18 +757,297 @@ std::string ProcFs::readCmdLine(pid_t pid) noexcept
     return std::string();
 }
 
+Memory::Statm ProcFs::readStatm(pid_t pid) noexcept
+{
+    Trace::FileScope trace("statm");
+
+    static const uint64_t pageSize = uint64_t(::sysconf(_SC_PAGESIZE));
+
+    Memory::Statm result;
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/statm");
+
+        // size resident shared text lib data dt, in pages
+        std::ifstream stream(path);
+        unsigned long long size = 0, resident = 0, shared = 0, text = 0, lib = 0, data = 0;
+        if (stream >> size >> resident >> shared >> text >> lib >> data)
+        {
+            result.shared = shared * pageSize;
+            result.text = text * pageSize;
+            result.data = data * pageSize;
+            result.valid = true;
+        }
+        else
+        {
+            LogDebug(m_log, "statm for process %d could not be read", pid);
+        }
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "statm for process %d could not be read: %s", pid, e.what());
+    }
+
+    return result;
+}
+
+Memory::Status ProcFs::readStatus(pid_t pid) noexcept
+{
+    Trace::FileScope trace("status");
+
+    Memory::Status result;
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/status");
+
+        const NamedField fields[] =
+        {
+            { "RssAnon:", &result.rssAnon },
+            { "RssFile:", &result.rssFile },
+            { "RssShmem:", &result.rssShmem },
+            { "VmSwap:", &result.swap },
+        };
+
+        std::ifstream stream(path);
+        std::string line;
+        size_t found = 0;
+        while (std::getline(stream, line))
+        {
+            // before the others
+            if (line.compare(0, 6, "NSpid:") == 0)
+            {
+                auto p = line.c_str() + 6;
+                for (;;)
+                {
+                    char* end = nullptr;
+                    auto value = std::strtol(p, &end, 10);
+                    if (end == p)
+                        break;
+
+                    result.nsPids.push_back(pid_t(value));
+                    p = end;
+                }
+
+                continue;
+            }
+
+            for (auto& field: fields)
+            {
+                auto length = std::strlen(field.key);
+                if (line.compare(0, length, field.key) == 0)
+                {
+                    *field.value = std::strtoull(line.c_str() + length, nullptr, 10) * 1024;
+                    ++found;
+                    break;
+                }
+            }
+
+            if (found == std::size(fields))
+                break;
+        }
+
+        // kernel threads have none of these
+        result.valid = found > 0;
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "status for process %d could not be read: %s", pid, e.what());
+    }
+
+    return result;
+}
+
+Memory::Smaps ProcFs::readSmapsRollup(pid_t pid) noexcept
+{
+    Trace::FileScope trace("smaps_rollup");
+
+    Memory::Smaps result;
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/smaps_rollup");
+
+        const NamedField fields[] =
+        {
+            { "Pss:", &result.pss },
+            { "Pss_Anon:", &result.pssAnon },
+            { "Pss_File:", &result.pssFile },
+            { "Pss_Shmem:", &result.pssShmem },
+            { "SwapPss:", &result.swapPss },
+        };
+
+        // needs PTRACE_MODE_READ access to the process
+        result.valid = readNamedFields(path, fields, 1024);
+        if (!result.valid)
+            LogDebug(m_log, "smaps_rollup for process %d could not be read: %d", pid, errno);
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "smaps_rollup for process %d could not be read: %s", pid, e.what());
+    }
+
+    return result;
+}
+
+IoCounters ProcFs::readIo(pid_t pid) noexcept
+{
+    Trace::FileScope trace("io");
+
+    IoCounters result;
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/io");
+
+        const NamedField fields[] =
+        {
+            { "rchar:", &result.rchar },
+            { "wchar:", &result.wchar },
+            { "syscr:", &result.syscr },
+            { "syscw:", &result.syscw },
+            { "read_bytes:", &result.readBytes },
+            { "write_bytes:", &result.writeBytes },
+            { "cancelled_write_bytes:", &result.cancelledWriteBytes },
+        };
+
+        // needs PTRACE_MODE_READ access to the process
+        result.valid = readNamedFields(path, fields, 1);
+        if (!result.valid)
+            LogDebug(m_log, "io for process %d could not be read: %d", pid, errno);
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "io for process %d could not be read: %s", pid, e.what());
+    }
+
+    return result;
+}
+
+std::optional<std::string> ProcFs::readCgroup(pid_t pid) noexcept
+{
+    Trace::FileScope trace("cgroup");
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/cgroup");
+
+        std::ifstream stream(path);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            if (line.compare(0, 3, "0::") == 0)
+                return line.substr(3);
+        }
+
+        LogDebug(m_log, "No cgroup v2 entry for process %d", pid);
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "cgroup for process %d could not be read: %s", pid, e.what());
+    }
+
+    return std::nullopt;
+}
+
+Namespaces ProcFs::readNamespaces(pid_t pid) noexcept
+{
+    Namespaces result;
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/ns");
+
+        FileHolder nsDir(::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!nsDir.valid())
+        {
+            LogDebug(m_log, "Failed to open the namespace directory of process %d: %d", pid, errno);
+            return result;
+        }
+
+        for (unsigned kind = 0; kind < Namespaces::KindCount; ++kind)
+        {
+            Trace::FileScope trace("ns");
+
+            // "pid:[4026531836]"
+            char target[64];
+            auto r = ::readlinkat(nsDir, Namespaces::kindName(Namespaces::Kind(kind)), target, sizeof(target) - 1);
+            if (r < 0)
+                continue;
+
+            target[r] = '\0';
+            auto bracket = std::strchr(target, '[');
+            if (!bracket)
+                continue;
+
+            result.inodes[kind] = std::strtoull(bracket + 1, nullptr, 10);
+            result.valid = true;
+        }
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "Namespaces of process %d could not be read: %s", pid, e.what());
+    }
+
+    return result;
+}
+
 std::vector<pid_t> ProcFs::enumeratePids() noexcept
+{
+    Trace::FileScope trace("pids");
+
+    return enumerateNumeric(root(), "PIDs");
+}
+
+std::vector<pid_t> ProcFs::enumerateTids(pid_t pid) noexcept
+{
+    Trace::FileScope trace("tids");
+
+    auto path = root();
+    path.append("/");
+    path.append(std::to_string(pid));
+    path.append("/task");
+
+    return enumerateNumeric(path, "TIDs");
+}
+
+std::vector<pid_t> ProcFs::enumerateNumeric(const std::string& path, const char* what) noexcept
 {
     std::vector<pid_t> result;
 
     try
     {
-        auto path = root();
         DirHolder dir(::opendir(path.c_str()));
+        if (!dir && (errno == ENOENT) && (path != root()))
+        {
+            // the process has just exited
+            LogDebug(m_log, "%s not found", path.c_str());
+            return result;
+        }
+
         if (!dir)
         {
             auto e = errno;
-            throw Kes::Exception(KES_HERE(), "Failed to open /proc", Kes::ExceptionProps::PosixErrorCode(e), Kes::ExceptionProps::DecodedError(Kes::Util::posixErrorToString(e)));
+            throw Kes::Exception(KES_HERE(), Util::format("Failed to open %s", path.c_str()), Kes::ExceptionProps::PosixErrorCode(e), Kes::ExceptionProps::DecodedError(Kes::Util::posixErrorToString(e)));
         }
     
         for (auto ent = ::readdir(dir); ent != nullptr; ent = ::readdir(dir))
@@ -432,7 +1062,7 @@ std::vector<pid_t> ProcFs::enumeratePids() noexcept
             }
             catch (std::exception& e)
             {
-                LogDebug(m_log, "Failed to parse PID %s: %s", ent->d_name, e.what());
+                LogDebug(m_log, "Failed to parse %s entry %s: %s", what, ent->d_name, e.what());
                 continue;
             }
 
@@ -441,16 +1071,306 @@ std::vector<pid_t> ProcFs::enumeratePids() noexcept
     }
     catch (Kes::Exception& e)
     {
-        LogError(m_log, "Failed to enumerate PIDs: %s", Kes::Util::formatException(e).c_str());
+        LogError(m_log, "Failed to enumerate %s: %s", what, Kes::Util::formatException(e).c_str());
     }
     catch (std::exception& e)
     {
-        LogError(m_log, "Failed to enumerate PIDs: %s", e.what());
+        LogError(m_log, "Failed to enumerate %s: %s", what, e.what());
     }
 
     return result;
 }
 
+const char* Namespaces::kindName(Kind kind) noexcept
+{
+    switch (kind)
+    {
+    case Pid: return "pid";
+    case Mnt: return "mnt";
+    case Net: return "net";
+    case User: return "user";
+    case Cgroup: return "cgroup";
+    default: return "";
+    }
+}
+
+const char* FileDescriptor::typeName(Type type) noexcept
+{
+    switch (type)
+    {
+    case Type::File: return "file";
+    case Type::Socket: return "socket";
+    case Type::Pipe: return "pipe";
+    case Type::AnonInode: return "anon_inode";
+    default: return "other";
+    }
+}
+
+std::optional<std::vector<int>> ProcFs::enumerateFds(pid_t pid) noexcept
+{
+    Trace::FileScope trace("fds");
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/fd");
+
+        std::vector<int> fds;
+        auto e = forEachNumericEntry(path, [&fds](const char* name) { fds.push_back(int(std::strtol(name, nullptr, 10))); });
+        if (!e)
+            return fds;
+
+        LogDebug(m_log, "Failed to enumerate the FDs of process %d: %d", pid, e);
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "Failed to enumerate the FDs of process %d: %s", pid, e.what());
+    }
+
+    return std::nullopt;
+}
+
+std::optional<uint64_t> ProcFs::countFds(pid_t pid) noexcept
+{
+    Trace::FileScope trace("fdcount");
+
+    auto path = root();
+    path.append("/");
+    path.append(std::to_string(pid));
+    path.append("/fd");
+
+    uint64_t count = 0;
+    auto e = forEachNumericEntry(path, [&count](const char*) { ++count; });
+    if (!e)
+        return count;
+
+    LogDebug(m_log, "Failed to count the FDs of process %d: %d", pid, e);
+    return std::nullopt;
+}
+
+std::vector<FileDescriptor> ProcFs::readFds(pid_t pid, const std::vector<int>& fds, bool info) noexcept
+{
+    std::vector<FileDescriptor> result;
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+
+        // the links are read relative to the directories, so the path is not rebuilt per fd
+        FileHolder fdDir(::open((path + "/fd").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!fdDir.valid())
+        {
+            LogDebug(m_log, "Failed to open the FD directory of process %d: %d", pid, errno);
+            return result;
+        }
+
+        FileHolder infoDir(info ? ::open((path + "/fdinfo").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1);
+
+#ifdef PATH_MAX
+        std::vector<char> buffer(PATH_MAX);
+#else
+        std::vector<char> buffer(4096);
+#endif
+
+        result.reserve(fds.size());
+        for (auto fd: fds)
+        {
+            char name[16];
+            *std::to_chars(name, name + sizeof(name) - 1, fd).ptr = '\0';
+
+            FileDescriptor entry;
+            entry.fd = fd;
+
+            {
+                Trace::FileScope trace("fd");
+
+                // a longer target comes back truncated, which is as much as the kernel keeps for it anyway
+                auto r = ::readlinkat(fdDir, name, buffer.data(), buffer.size());
+                if (r < 0)
+                    continue;
+
+                entry.target.assign(buffer.data(), size_t(r));
+            }
+
+            classify(entry);
+
+            if (infoDir.valid())
+            {
+                Trace::FileScope trace("fdinfo");
+                readFdInfo(infoDir, name, entry);
+            }
+
+            result.push_back(std::move(entry));
+        }
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "FDs of process %d could not be read: %s", pid, e.what());
+    }
+
+    return result;
+}
+
+std::string ProcFs::readWChan(pid_t pid, pid_t tid) noexcept
+{
+    Trace::FileScope trace("wchan");
+
+    try
+    {
+        auto path = root();
+        path.append("/");
+        path.append(std::to_string(pid));
+        path.append("/task/");
+        path.append(std::to_string(tid));
+        path.append("/wchan");
+
+        std::ifstream file(path.c_str(), std::ifstream::in);
+        std::string wchan;
+        if (std::getline(file, wchan) && (wchan != "0"))
+            return wchan;
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "wchan for thread %d:%d could not be read: %s", pid, tid, e.what());
+    }
+
+    return std::string();
+}
+
+const char* Socket::protocolName(Protocol protocol) noexcept
+{
+    switch (protocol)
+    {
+    case Protocol::Tcp: return "tcp";
+    case Protocol::Tcp6: return "tcp6";
+    case Protocol::Udp: return "udp";
+    case Protocol::Udp6: return "udp6";
+    default: return "unix";
+    }
+}
+
+std::optional<Socket::Protocol> Socket::protocolFromName(std::string_view name) noexcept
+{
+    for (auto protocol: { Protocol::Tcp, Protocol::Tcp6, Protocol::Udp, Protocol::Udp6, Protocol::Unix })
+    {
+        if (name == protocolName(protocol))
+            return protocol;
+    }
+
+    return std::nullopt;
+}
+
+const char* Socket::stateName() const noexcept
+{
+    if (protocol == Protocol::Unix)
+    {
+        static const char* const names[] = { "FREE", "UNCONNECTED", "CONNECTING", "CONNECTED", "DISCONNECTING" };
+        if (listening)
+            return "LISTEN";
+
+        return (state < std::size(names)) ? names[state] : "UNKNOWN";
+    }
+
+    // a datagram socket is "closed" until connected
+    if (((protocol == Protocol::Udp) || (protocol == Protocol::Udp6)) && (state == 0x07))
+        return "UNCONNECTED";
+
+    static const char* const names[] =
+    {
+        "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT",
+        "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"
+    };
+
+    return (state < std::size(names)) ? names[state] : "UNKNOWN";
+}
+
+std::vector<Socket> ProcFs::readSockets(Socket::Protocol protocol) noexcept
+{
+    Trace::FileScope trace(Socket::protocolName(protocol));
+
+    std::vector<Socket> result;
+
+    try
+    {
+        auto path = root();
+        path.append("/net/");
+        path.append(Socket::protocolName(protocol));
+
+        std::string text;
+        if (!readWhole(path, text))
+        {
+            LogDebug(m_log, "Failed to read %s: %d", path.c_str(), errno);
+            return result;
+        }
+
+        auto v6 = (protocol == Socket::Protocol::Tcp6) || (protocol == Socket::Protocol::Udp6);
+        auto end = text.c_str() + text.size();
+
+        // the first line is the header
+        auto line = static_cast<const char*>(std::memchr(text.c_str(), '\n', text.size()));
+        while (line && (++line < end))
+        {
+            Socket socket;
+            socket.protocol = protocol;
+
+            auto parsed = (protocol == Socket::Protocol::Unix) ? parseUnixLine(line, socket) : parseInetLine(line, v6, socket);
+            if (parsed)
+                result.push_back(std::move(socket));
+            else
+                LogDebug(m_log, "Invalid line in %s", path.c_str());
+
+            line = static_cast<const char*>(std::memchr(line, '\n', size_t(end - line)));
+        }
+    }
+    catch (std::exception& e)
+    {
+        LogDebug(m_log, "Sockets could not be read: %s", e.what());
+    }
+
+    return result;
+}
+
+CpuTimes ProcFs::readCpuTimes() noexcept
+{
+    Trace::FileScope trace("sysstat");
+
+    CpuTimes result;
+
+    std::string path = root();
+    path.append("/stat");
+
+    std::ifstream stream(path);
+    std::string s;
+    if (!stream.good() || !std::getline(stream, s) || (s.compare(0, 4, "cpu ") != 0))
+    {
+        LogDebug(m_log, "Failed to read the CPU times from %s", path.c_str());
+        return result;
+    }
+
+    uint64_t* const fields[] = { &result.user, &result.nice, &result.system, &result.idle, &result.iowait, &result.irq, &result.softirq, &result.steal };
+
+    // older kernels have fewer columns
+    auto p = s.c_str() + 4;
+    size_t parsed = 0;
+    for (auto field: fields)
+    {
+        char* end = nullptr;
+        *field = std::strtoull(p, &end, 10);
+        if (end == p)
+            break;
+
+        p = end;
+        ++parsed;
+    }
+
+    result.valid = (parsed >= 4);
+    return result;
+}
+
 uint64_t ProcFs::getBootTimeImpl() noexcept
 {
     std::string path = root();
@@ -484,21 +1404,14 @@ uint64_t ProcFs::getBootTimeImpl() noexcept
     return 0;
 }
 
-uint64_t ProcFs::getBootTime() noexcept
-{
-    static uint64_t bootTime = getBootTimeImpl();
-    return bootTime;
-}
-
 uint64_t ProcFs::fromRelativeTime(uint64_t relative) noexcept
 {
     static long clockRes = ::sysconf(_SC_CLK_TCK);
     assert(clockRes > 0);
 
-    auto bootTime = getBootTime();
     auto time = relative / clockRes;
 
-    return bootTime + time;
+    return m_bootTime + time;
 }
 
 } // namespace ProcFs {}
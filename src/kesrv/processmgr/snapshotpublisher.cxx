@@ -0,0 +1,348 @@
+#include <kesrv/exception.hxx>
+#include <kesrv/knownprops.hxx>
+#include <kesrv/processmanager/snapshotpublisher.hxx>
+#include <kesrv/util/exceptionutil.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/posixerror.hxx>
+
+#include <algorithm>
+#include <charconv>
+
+#include <fcntl.h>
+#include <grp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+[[noreturn]] void throwPosixError(Kes::SourceLocation&& location, const std::string& message, int e)
+{
+    throw Kes::Exception(std::move(location), message, Kes::ExceptionProps::PosixErrorCode(e), Kes::ExceptionProps::DecodedError(Kes::Util::posixErrorToString(e)));
+}
+
+// a region left behind by a crashed server is replaced, not reused: its readers must see it closed;
+// one that belongs to another user, to a live writer or to something else entirely is left alone
+void removeAbandoned(const std::string& name)
+{
+    auto fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1)
+    {
+        auto e = errno;
+        if (e == ENOENT)
+            return; // gone meanwhile
+
+        throwPosixError(KES_HERE(), Util::format("The shared memory region %s exists and cannot be opened", name.c_str()), e);
+    }
+
+    std::string reason;
+    void* region = MAP_FAILED;
+    struct stat st = {};
+    if (::fstat(fd, &st) == -1)
+        reason = "cannot be examined";
+    else if (st.st_uid != ::geteuid())
+        reason = "belongs to another user";
+    else if (uint64_t(st.st_size) < Snapshot::headerSize())
+        reason = "is not a snapshot region";
+    else if ((region = ::mmap(nullptr, Snapshot::headerSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+        reason = "cannot be mapped";
+
+    ::close(fd);
+
+    if (region != MAP_FAILED)
+    {
+        auto header = static_cast<Snapshot::Header*>(region);
+        if (std::memcmp(header->magic, Snapshot::Magic, sizeof(Snapshot::Magic)))
+            reason = "is not a snapshot region";
+        else if ((header->writerPid > 0) && ((::kill(pid_t(header->writerPid), 0) == 0) || (errno == EPERM)))
+            reason = Util::format("is published by the running process %lld", (long long)header->writerPid);
+        else
+            header->state.store(uint32_t(Snapshot::State::Closed), std::memory_order_release);
+
+        ::munmap(region, Snapshot::headerSize());
+    }
+
+    if (!reason.empty())
+        throw Kes::Exception(KES_HERE(), Util::format("The shared memory region %s already exists and %s", name.c_str(), reason.c_str()));
+
+    ::shm_unlink(name.c_str());
+}
+
+gid_t groupId(const std::string& group)
+{
+    gid_t gid = 0;
+    auto r = std::from_chars(group.data(), group.data() + group.size(), gid);
+    if ((r.ec == std::errc()) && (r.ptr == group.data() + group.size()))
+        return gid;
+
+    struct group gr = {};
+    struct group* result = nullptr;
+    char buffer[4096];
+    auto e = ::getgrnam_r(group.c_str(), &gr, buffer, sizeof(buffer), &result);
+    if (!result)
+        throwPosixError(KES_HERE(), Util::format("Unknown group %s", group.c_str()), e ? e : ENOENT);
+
+    return gr.gr_gid;
+}
+
+} // namespace {}
+
+
+SnapshotPublisher::~SnapshotPublisher()
+{
+    stop();
+
+    m_processes->removeListener(this);
+
+    // readers still holding the old mapping learn that it is stale
+    m_header->state.store(uint32_t(Snapshot::State::Closed), std::memory_order_release);
+
+    ::munmap(m_region, m_size);
+    ::shm_unlink(m_options.name.c_str());
+}
+
+SnapshotPublisher::SnapshotPublisher(Log::ILog* log, ProcessManager* processes, const std::string& procFsRoot, const SnapshotOptions& options)
+    : m_log(log)
+    , m_processes(processes)
+    , m_options(options)
+    , m_procFs(log, procFsRoot)
+    , m_size(Snapshot::regionSize(options.capacity, options.stringCapacity))
+    , m_stop(false)
+{
+    if (!m_options.capacity || (m_options.stringCapacity > UINT32_MAX))
+        throw Kes::Exception(KES_HERE(), "Invalid snapshot capacity");
+
+    auto fd = ::shm_open(m_options.name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if ((fd == -1) && (errno == EEXIST))
+    {
+        removeAbandoned(m_options.name);
+        fd = ::shm_open(m_options.name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    }
+
+    if (fd == -1)
+        throwPosixError(KES_HERE(), Util::format("Failed to create the shared memory region %s", m_options.name.c_str()), errno);
+
+    if (!m_options.group.empty())
+    {
+        try
+        {
+            auto gid = groupId(m_options.group);
+            if ((::fchown(fd, uid_t(-1), gid) == -1) || (::fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP) == -1))
+                throwPosixError(KES_HERE(), Util::format("Failed to give the group %s access to the shared memory region", m_options.group.c_str()), errno);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            ::shm_unlink(m_options.name.c_str());
+            throw;
+        }
+    }
+
+    if (::ftruncate(fd, off_t(m_size)) == -1)
+    {
+        auto e = errno;
+        ::close(fd);
+        ::shm_unlink(m_options.name.c_str());
+        throwPosixError(KES_HERE(), "Failed to size the shared memory region", e);
+    }
+
+    m_region = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto e = errno;
+    ::close(fd);
+
+    if (m_region == MAP_FAILED)
+    {
+        ::shm_unlink(m_options.name.c_str());
+        throwPosixError(KES_HERE(), "Failed to map the shared memory region", e);
+    }
+
+    // the region comes zero-filled; the magic goes last so that readers never see a half-made header
+    m_header = static_cast<Snapshot::Header*>(m_region);
+    m_header->version = Snapshot::Version;
+    m_header->headerSize = uint32_t(Snapshot::headerSize());
+    m_header->processSize = sizeof(Snapshot::Process);
+    m_header->capacity = m_options.capacity;
+    m_header->stringCapacity = m_options.stringCapacity;
+    m_header->bufferSize = Snapshot::bufferSize(m_options.capacity, m_options.stringCapacity);
+    m_header->bufferOffset[0] = Snapshot::headerSize();
+    m_header->bufferOffset[1] = Snapshot::headerSize() + m_header->bufferSize;
+    m_header->regionSize = m_size;
+    m_header->writerPid = ::getpid();
+    m_header->state.store(uint32_t(Snapshot::State::Live), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_header->magic, Snapshot::Magic, sizeof(Snapshot::Magic));
+
+    m_processes->addListener(this);
+
+    m_log->write(Log::Level::Info, "SnapshotPublisher: publishing %s (%llu bytes)", m_options.name.c_str(), (unsigned long long)m_size);
+}
+
+void SnapshotPublisher::start()
+{
+    assert(!m_thread);
+    m_thread.reset(new std::thread([this]() { run(); }));
+}
+
+void SnapshotPublisher::stop() noexcept
+{
+    if (!m_thread)
+        return;
+
+    m_stop.set();
+
+    if (m_thread->joinable())
+        m_thread->join();
+
+    m_thread.reset();
+}
+
+void SnapshotPublisher::run() noexcept
+{
+    do
+    {
+        try
+        {
+            publish();
+        }
+        catch (Kes::Exception& e)
+        {
+            Util::logException(m_log, Log::Level::Error, e);
+        }
+        catch (std::exception& e)
+        {
+            Util::logException(m_log, Log::Level::Error, e);
+        }
+    } while (!m_stop.wait(m_options.interval));
+}
+
+void SnapshotPublisher::scanned(const std::vector<IScanListener::Process>& processes, uint64_t)
+{
+    std::lock_guard l(m_sampleMutex);
+
+    m_sample = processes;
+    m_sampled = true;
+}
+
+void SnapshotPublisher::publish()
+{
+    // calls scanned() unless a session scan was recent enough
+    m_processes->sample(m_options.interval);
+
+    std::vector<IScanListener::Process> processes;
+    {
+        std::lock_guard l(m_sampleMutex);
+        if (!m_sampled)
+            return;
+
+        processes.swap(m_sample);
+        m_sampled = false;
+    }
+
+    // a truncated snapshot keeps the lowest pids
+    std::sort(processes.begin(), processes.end(), [](auto& a, auto& b) { return a.pid < b.pid; });
+
+    auto generation = m_header->generation.load(std::memory_order_relaxed) + 1;
+    auto buffer = reinterpret_cast<Snapshot::Buffer*>(static_cast<char*>(m_region) + m_header->bufferOffset[generation & 1]);
+
+    // the seqlock stays odd while the buffer is filled; readers are on the other buffer meanwhile
+    auto sequence = buffer->sequence.load(std::memory_order_relaxed);
+    buffer->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    buffer->count = 0;
+    buffer->flags = 0;
+    buffer->stringsUsed = 0;
+
+    auto records = Snapshot::processes(buffer);
+    for (auto& process: processes)
+    {
+        if (buffer->count >= m_options.capacity)
+        {
+            buffer->flags |= Snapshot::BufferTruncated;
+            break;
+        }
+
+        auto& details = this->details(process, generation);
+
+        auto& record = records[buffer->count++];
+        std::memset(&record, 0, sizeof(record));
+        record.pid = process.pid;
+        record.flags = Snapshot::ProcessValid;
+        record.ppid = process.ppid;
+        record.pgrp = process.pgrp;
+        record.tpgid = process.tpgid;
+        record.session = process.session;
+        record.ruid = int32_t(process.ruid);
+        record.comm = addString(buffer, details.comm);
+        record.statComm = addString(buffer, process.comm);
+        record.exe = addString(buffer, details.exe);
+        record.cmdLine = addString(buffer, details.cmdLine);
+    }
+
+    struct timespec now = {};
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    buffer->timestamp = uint64_t(now.tv_sec) * 1000000000ULL + uint64_t(now.tv_nsec);
+    buffer->generation = generation;
+
+    buffer->sequence.store(sequence + 2, std::memory_order_release);
+    m_header->generation.store(generation, std::memory_order_release);
+
+    // forget the processes that are gone
+    for (auto it = m_details.begin(); it != m_details.end();)
+    {
+        if (it->second.generation != generation)
+            it = m_details.erase(it);
+        else
+            ++it;
+    }
+}
+
+const SnapshotPublisher::Details& SnapshotPublisher::details(const IScanListener::Process& process, uint64_t generation)
+{
+    // a reused pid starts later, an exec changes the name
+    auto& details = m_details[process.pid];
+    if ((details.startTicks != process.startTicks) || (details.statComm != process.comm) || !details.generation)
+    {
+        details.startTicks = process.startTicks;
+        details.statComm = process.comm;
+        details.comm = m_procFs.readComm(process.pid);
+        details.exe = m_procFs.readExePath(process.pid);
+        details.cmdLine = m_procFs.readCmdLine(process.pid);
+    }
+
+    details.generation = generation;
+    return details;
+}
+
+Snapshot::StringRef SnapshotPublisher::addString(Snapshot::Buffer* buffer, const std::string& s) noexcept
+{
+    if (s.empty())
+        return Snapshot::StringRef{};
+
+    if (buffer->stringsUsed + s.length() > m_options.stringCapacity)
+    {
+        buffer->flags |= Snapshot::BufferTruncated;
+        return Snapshot::StringRef{};
+    }
+
+    Snapshot::StringRef ref{ uint32_t(buffer->stringsUsed), uint32_t(s.length()) };
+    std::memcpy(Snapshot::strings(buffer, m_options.capacity) + ref.offset, s.data(), s.length());
+    buffer->stringsUsed += s.length();
+
+    return ref;
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
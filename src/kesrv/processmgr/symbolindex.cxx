@@ -0,0 +1,431 @@
+#include <kesrv/exception.hxx>
+#include <kesrv/processmanager/symbolindex.hxx>
+#include <kesrv/trace/trace.hxx>
+#include <kesrv/util/format.hxx>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace Kes
+{
+
+namespace ProcFs
+{
+
+namespace
+{
+
+// FNV-1a
+uint64_t hash(const char* data, size_t size, uint64_t h = 14695981039346656037ULL) noexcept
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= uint8_t(data[i]);
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+std::string readText(const std::string& path)
+{
+    std::ifstream stream(path);
+    std::ostringstream text;
+    text << stream.rdbuf();
+    return text.str();
+}
+
+} // namespace {}
+
+
+SymbolIndex::~SymbolIndex()
+{
+    if (m_region)
+        ::munmap(m_region, m_regionSize);
+}
+
+std::unique_ptr<SymbolIndex> SymbolIndex::load(const std::string& path, const std::string& modulesPath)
+{
+    Trace::FileScope trace("kallsyms");
+
+    std::ifstream stream(path);
+    if (!stream.good())
+        throw Kes::Exception(KES_HERE(), Util::format("Failed to open %s", path.c_str()));
+
+    auto index = std::make_unique<SymbolIndex>();
+    auto& entries = index->m_ownedEntries;
+    auto& pool = index->m_ownedPool;
+    auto& modules = index->m_ownedModules;
+
+    // offset 0 is the empty name of module 0, the kernel
+    pool.push_back('\0');
+    modules.push_back(0);
+    std::unordered_map<std::string, uint16_t> moduleIds;
+
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        // "ffffffff81000000 T _stext", "ffffffffc0a01000 t ext4_fill_super\t[ext4]"
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+
+        uint64_t address = 0;
+        auto r = std::from_chars(begin, end, address, 16);
+        if ((r.ec != std::errc()) || (end - r.ptr < 4) || (r.ptr[0] != ' ') || (r.ptr[2] != ' '))
+            continue;
+
+        auto type = r.ptr[1];
+        auto name = r.ptr + 3;
+        auto nameEnd = std::find(name, end, '\t');
+        if (name == nameEnd)
+            continue;
+
+        uint16_t module = 0;
+        auto open = std::find(nameEnd, end, '[');
+        auto close = std::find(open, end, ']');
+        if (close != end)
+        {
+            std::string moduleName(open + 1, close);
+            auto it = moduleIds.find(moduleName);
+            if (it == moduleIds.end())
+            {
+                if (modules.size() > UINT16_MAX)
+                    throw Kes::Exception(KES_HERE(), Util::format("Too many modules in %s", path.c_str()));
+
+                it = moduleIds.insert({ moduleName, uint16_t(modules.size()) }).first;
+                modules.push_back(uint32_t(pool.size()));
+                pool.insert(pool.end(), moduleName.begin(), moduleName.end());
+                pool.push_back('\0');
+            }
+
+            module = it->second;
+        }
+
+        if (pool.size() + size_t(nameEnd - name) >= UINT32_MAX)
+            throw Kes::Exception(KES_HERE(), Util::format("Too many symbols in %s", path.c_str()));
+
+        entries.push_back({ address, uint32_t(pool.size()), module, type, 0 });
+        pool.insert(pool.end(), name, nameEnd);
+        pool.push_back('\0');
+    }
+
+    // "ext4 1060864 2 - Live 0xffffffffc0a00000": where each module ends; all zeroes when
+    // kptr_restrict hides the addresses
+    auto& moduleEnds = index->m_ownedModuleEnds;
+    moduleEnds.resize(modules.size(), 0);
+    if (!modulesPath.empty())
+    {
+        std::ifstream modulesFile(modulesPath);
+        while (std::getline(modulesFile, line))
+        {
+            std::istringstream fields(line);
+            std::string name, references, dependencies, state, base;
+            uint64_t size = 0;
+            fields >> name >> size >> references >> dependencies >> state >> base;
+
+            auto it = moduleIds.find(name);
+            if ((it == moduleIds.end()) || (base.size() <= 2))
+                continue;
+
+            uint64_t start = 0;
+            auto r = std::from_chars(base.data() + 2, base.data() + base.size(), start, 16);
+            if ((r.ec == std::errc()) && start)
+                moduleEnds[it->second] = start + size;
+        }
+    }
+
+    // the modules come after the kernel, each in an order of its own; of the symbols that share
+    // an address, the global ones go first
+    auto local = [](char type) { return !std::isupper(uint8_t(type)); };
+    std::sort(entries.begin(), entries.end(), [&pool, &local](const Entry& a, const Entry& b)
+    {
+        if (a.address != b.address)
+            return a.address < b.address;
+
+        if (local(a.type) != local(b.type))
+            return local(b.type);
+
+        return std::string_view(pool.data() + a.name) < std::string_view(pool.data() + b.name);
+    });
+
+    auto& byName = index->m_ownedByName;
+    byName.resize(entries.size());
+    for (size_t i = 0; i < byName.size(); ++i)
+        byName[i] = uint32_t(i);
+
+    std::sort(byName.begin(), byName.end(), [&entries, &pool](uint32_t a, uint32_t b)
+    {
+        auto c = std::string_view(pool.data() + entries[a].name).compare(pool.data() + entries[b].name);
+        return c ? (c < 0) : (a < b);
+    });
+
+    index->attach();
+    return index;
+}
+
+void SymbolIndex::attach() noexcept
+{
+    m_entries = m_ownedEntries.data();
+    m_byName = m_ownedByName.data();
+    m_modules = m_ownedModules.data();
+    m_moduleEnds = m_ownedModuleEnds.data();
+    m_pool = m_ownedPool.data();
+    m_count = m_ownedEntries.size();
+    m_moduleCount = m_ownedModules.size();
+    m_poolSize = m_ownedPool.size();
+}
+
+std::unique_ptr<SymbolIndex> SymbolIndex::map(const std::string& cachePath, uint64_t key, Log::ILog* log) noexcept
+{
+    Trace::FileScope trace("symbol_cache");
+
+    try
+    {
+        auto fd = ::open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            LogDebug(log, "No symbol cache at %s: %d", cachePath.c_str(), errno);
+            return nullptr;
+        }
+
+        struct stat st = {};
+        if ((::fstat(fd, &st) == -1) || (size_t(st.st_size) < sizeof(CacheHeader)))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        auto size = size_t(st.st_size);
+        auto region = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (region == MAP_FAILED)
+        {
+            LogDebug(log, "Failed to map the symbol cache %s: %d", cachePath.c_str(), errno);
+            return nullptr;
+        }
+
+        auto index = std::make_unique<SymbolIndex>();
+        index->m_region = region;
+        index->m_regionSize = size;
+
+        auto header = static_cast<const CacheHeader*>(region);
+        if (std::memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) || (header->version != CacheVersion) || (header->entrySize != sizeof(Entry)))
+        {
+            log->write(Log::Level::Warning, "%s is not a symbol cache of this version", cachePath.c_str());
+            return nullptr;
+        }
+
+        if (header->key != key)
+        {
+            LogDebug(log, "The symbol cache %s belongs to another kernel or module set", cachePath.c_str());
+            return nullptr;
+        }
+
+        // the sizes have to add up to the file, without overflowing on the way
+        auto available = size - sizeof(CacheHeader);
+        if ((header->count > available / (sizeof(Entry) + sizeof(uint32_t))) || (header->modules > available / (sizeof(uint64_t) + sizeof(uint32_t))) ||
+            (header->count * (sizeof(Entry) + sizeof(uint32_t)) + header->modules * (sizeof(uint64_t) + sizeof(uint32_t)) + header->poolSize != available) ||
+            !header->poolSize || !header->modules)
+        {
+            log->write(Log::Level::Warning, "The symbol cache %s is truncated", cachePath.c_str());
+            return nullptr;
+        }
+
+        auto base = static_cast<const char*>(region) + sizeof(CacheHeader);
+        index->m_count = size_t(header->count);
+        index->m_moduleCount = size_t(header->modules);
+        index->m_poolSize = size_t(header->poolSize);
+        index->m_entries = reinterpret_cast<const Entry*>(base);
+        index->m_moduleEnds = reinterpret_cast<const uint64_t*>(index->m_entries + index->m_count);
+        index->m_byName = reinterpret_cast<const uint32_t*>(index->m_moduleEnds + index->m_moduleCount);
+        index->m_modules = index->m_byName + index->m_count;
+        index->m_pool = reinterpret_cast<const char*>(index->m_modules + index->m_moduleCount);
+
+        // nothing may point out of the file
+        auto valid = !index->m_pool[index->m_poolSize - 1];
+        for (size_t i = 0; valid && (i < index->m_count); ++i)
+        {
+            auto& entry = index->m_entries[i];
+            valid = (entry.name < index->m_poolSize) && (entry.module < index->m_moduleCount) && (index->m_byName[i] < index->m_count);
+        }
+
+        for (size_t i = 0; valid && (i < index->m_moduleCount); ++i)
+            valid = index->m_modules[i] < index->m_poolSize;
+
+        if (!valid)
+        {
+            log->write(Log::Level::Warning, "The symbol cache %s is corrupt", cachePath.c_str());
+            return nullptr;
+        }
+
+        return index;
+    }
+    catch (std::exception& e)
+    {
+        log->write(Log::Level::Error, "Failed to map the symbol cache %s: %s", cachePath.c_str(), e.what());
+    }
+
+    return nullptr;
+}
+
+bool SymbolIndex::save(const std::string& cachePath, uint64_t key, Log::ILog* log) const noexcept
+{
+    auto temporary = Util::format("%s.%d.tmp", cachePath.c_str(), int(::getpid()));
+
+    try
+    {
+        CacheHeader header = {};
+        std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+        header.version = CacheVersion;
+        header.entrySize = sizeof(Entry);
+        header.key = key;
+        header.count = m_count;
+        header.modules = m_moduleCount;
+        header.poolSize = m_poolSize;
+
+        {
+            std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            stream.write(reinterpret_cast<const char*>(m_entries), std::streamsize(m_count * sizeof(Entry)));
+            stream.write(reinterpret_cast<const char*>(m_moduleEnds), std::streamsize(m_moduleCount * sizeof(uint64_t)));
+            stream.write(reinterpret_cast<const char*>(m_byName), std::streamsize(m_count * sizeof(uint32_t)));
+            stream.write(reinterpret_cast<const char*>(m_modules), std::streamsize(m_moduleCount * sizeof(uint32_t)));
+            stream.write(m_pool, std::streamsize(m_poolSize));
+            stream.close();
+
+            if (!stream)
+                throw Kes::Exception(KES_HERE(), Util::format("Failed to write %s", temporary.c_str()));
+        }
+
+        // a reader sees the old file or the new one, never half of one
+        if (::rename(temporary.c_str(), cachePath.c_str()) == -1)
+            throw Kes::Exception(KES_HERE(), Util::format("Failed to rename %s: %d", temporary.c_str(), errno));
+
+        return true;
+    }
+    catch (std::exception& e)
+    {
+        log->write(Log::Level::Error, "Failed to save the symbol cache %s: %s", cachePath.c_str(), e.what());
+    }
+
+    ::unlink(temporary.c_str());
+    return false;
+}
+
+uint64_t SymbolIndex::kernelKey(const std::string& procFsRoot) noexcept
+{
+    Trace::FileScope trace("modules");
+
+    try
+    {
+        std::string text = readText(procFsRoot + "/sys/kernel/osrelease");
+        text.push_back('\0');
+        text.append(readText(procFsRoot + "/sys/kernel/version"));
+        text.push_back('\0');
+        // KASLR moves the kernel and the modules on every boot
+        text.append(readText(procFsRoot + "/sys/kernel/random/boot_id"));
+        text.push_back('\0');
+
+        // "ext4 1060864 2 - Live 0xffffffffc0a00000"; the name, the size and the address: the
+        // reference count changes all the time
+        std::ifstream modules(procFsRoot + "/modules");
+        std::string line;
+        while (std::getline(modules, line))
+        {
+            std::istringstream fields(line);
+            std::string name, size, references, dependencies, state, address;
+            fields >> name >> size >> references >> dependencies >> state >> address;
+
+            text.append(name);
+            text.push_back(' ');
+            text.append(size);
+            text.push_back(' ');
+            text.append(address);
+            text.push_back('\n');
+        }
+
+        return hash(text.data(), text.size());
+    }
+    catch (std::exception&)
+    {
+    }
+
+    return 0;
+}
+
+SymbolIndex::Symbol SymbolIndex::symbolAt(uint32_t index) const noexcept
+{
+    auto& entry = m_entries[index];
+
+    Symbol symbol;
+    symbol.address = entry.address;
+    symbol.type = entry.type;
+    symbol.name = std::string_view(m_pool + entry.name);
+    if (entry.module)
+        symbol.module = std::string_view(m_pool + m_modules[entry.module]);
+
+    return symbol;
+}
+
+std::optional<SymbolIndex::Symbol> SymbolIndex::lookup(uint64_t address) const noexcept
+{
+    auto end = m_entries + m_count;
+    auto it = std::upper_bound(m_entries, end, address, [](uint64_t a, const Entry& e) { return a < e.address; });
+    if (it == m_entries)
+        return std::nullopt;
+
+    // past the last symbol of its module the address belongs to the module as far as it extends,
+    // to the kernel not at all: its last symbol is _end
+    auto next = it--;
+    if ((next == end) || (next->module != it->module))
+    {
+        auto moduleEnd = m_moduleEnds[it->module];
+        if (moduleEnd ? (address >= moduleEnd) : (address != it->address))
+            return std::nullopt;
+    }
+
+    // the first of the ones at that address
+    it = std::lower_bound(m_entries, it, it->address, [](const Entry& e, uint64_t a) { return e.address < a; });
+    return symbolAt(uint32_t(it - m_entries));
+}
+
+std::vector<SymbolIndex::Symbol> SymbolIndex::findPrefix(std::string_view prefix, size_t limit, bool& more) const
+{
+    auto nameOf = [this](uint32_t index) { return std::string_view(m_pool + m_entries[index].name); };
+
+    auto end = m_byName + m_count;
+    auto it = std::lower_bound(m_byName, end, prefix, [&nameOf](uint32_t index, std::string_view p) { return nameOf(index) < p; });
+
+    std::vector<Symbol> result;
+    more = false;
+    for (; (it != end) && (nameOf(*it).compare(0, prefix.size(), prefix) == 0); ++it)
+    {
+        if (result.size() == limit)
+        {
+            more = true;
+            break;
+        }
+
+        result.push_back(symbolAt(*it));
+    }
+
+    return result;
+}
+
+
+} // namespace ProcFs {}
+
+} // namespace Kes {}
@@ -0,0 +1,230 @@
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/processmanager/symbolmanager.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+#include <charconv>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+const char* const s_commands[] =
+{
+    "lookup_symbol",
+    "find_symbols"
+};
+
+bool fail(PropertyBag& response, Kes::Request::Id id, std::string&& reason)
+{
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Fail));
+    Util::addToTable<Kes::Response::Props::Reason>(response, std::move(reason));
+    return true;
+}
+
+// hex, with or without 0x
+bool parseAddress(const std::string& text, uint64_t& address)
+{
+    auto begin = text.data();
+    auto end = begin + text.size();
+    if ((text.size() > 2) && (text[0] == '0') && ((text[1] == 'x') || (text[1] == 'X')))
+        begin += 2;
+
+    auto r = std::from_chars(begin, end, address, 16);
+    return (r.ec == std::errc()) && (r.ptr == end);
+}
+
+std::string formatAddress(uint64_t address)
+{
+    return Util::format("0x%llx", (unsigned long long)address);
+}
+
+void addSymbol(PropertyBag& table, const ProcFs::SymbolIndex::Symbol& symbol)
+{
+    Util::addToTable<ProcessProps::SymbolName>(table, std::string(symbol.name));
+    Util::addToTable<ProcessProps::SymbolModule>(table, std::string(symbol.module));
+    Util::addToTable<ProcessProps::SymbolType>(table, std::string(1, symbol.type));
+}
+
+} // namespace {}
+
+
+SymbolManager::~SymbolManager()
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->unregisterHandler(cmd, this);
+    }
+}
+
+SymbolManager::SymbolManager(IRequestProcessor* rp, Log::ILog* log, const std::string& procFsRoot, const std::string& cachePath)
+    : m_rp(rp)
+    , m_log(log)
+    , m_procFsRoot(procFsRoot)
+    , m_cachePath(cachePath)
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->registerHandler(cmd, this);
+    }
+}
+
+bool SymbolManager::process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    assert(request.isTable());
+    assert(response.isTable());
+
+    std::lock_guard l(m_mutex);
+
+    bool lookup = !std::strcmp(key, "lookup_symbol");
+    if (!lookup && std::strcmp(key, "find_symbols"))
+    {
+        m_log->write(Log::Level::Error, "SymbolManager: unknown command [%s]", key);
+        return false;
+    }
+
+    std::string error;
+    auto index = this->index(request, error);
+    if (!index)
+        return fail(response, id, std::move(error));
+
+    Util::addToTable<ProcessProps::SymbolCount>(response, uint64_t(index->size()));
+
+    return lookup ? lookupSymbol(*index, id, request, response) : findSymbols(*index, id, request, response);
+}
+
+const ProcFs::SymbolIndex* SymbolManager::index(const PropertyBag& request, std::string& error)
+{
+    auto refresh = Util::findInTable<ProcessProps::Refresh>(request);
+    if (m_index && !(refresh && *refresh))
+        return m_index.get();
+
+    auto key = ProcFs::SymbolIndex::kernelKey(m_procFsRoot);
+    if (m_index && (key == m_key))
+        return m_index.get();
+
+    std::unique_ptr<ProcFs::SymbolIndex> index;
+    if (!m_cachePath.empty())
+        index = ProcFs::SymbolIndex::map(m_cachePath, key, m_log);
+
+    if (!index)
+    {
+        try
+        {
+            index = ProcFs::SymbolIndex::load(m_procFsRoot + "/kallsyms", m_procFsRoot + "/modules");
+        }
+        catch (std::exception& e)
+        {
+            m_log->write(Log::Level::Error, "Failed to load the kernel symbols: %s", e.what());
+            error = Util::format("Kernel symbols are not available: %s", e.what());
+            return nullptr;
+        }
+
+        // the addresses are what makes an index worth keeping
+        if (!m_cachePath.empty() && !index->addressesHidden())
+            index->save(m_cachePath, key, m_log);
+    }
+
+    LogInfo(m_log, "%zu kernel symbols %s", index->size(), index->mapped() ? "mapped from the cache" : "loaded");
+
+    m_index = std::move(index);
+    m_key = key;
+    return m_index.get();
+}
+
+bool SymbolManager::lookupSymbol(const ProcFs::SymbolIndex& index, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    std::vector<uint64_t> addresses;
+    auto list = request.table().find(ProcessProps::SymbolAddresses::idstr());
+    if ((list != request.table().end()) && list->second->isArray())
+    {
+        for (auto& item: list->second->array())
+        {
+            auto text = item->isProperty() ? std::any_cast<std::string>(&item->property().value) : nullptr;
+            if (!text)
+                return fail(response, id, "Addresses must be strings");
+
+            uint64_t address = 0;
+            if (!parseAddress(*text, address))
+                return fail(response, id, Util::format("Invalid address [%s]", text->c_str()));
+
+            addresses.push_back(address);
+        }
+    }
+
+    if (addresses.empty())
+        return fail(response, id, "No addresses to look up");
+
+    if (index.addressesHidden())
+        return fail(response, id, "Kernel addresses are hidden from the server (kernel.kptr_restrict)");
+
+    {
+        PropertyBag symbolArray{Kes::ProcessProps::SymbolList::idstr(), PropertyBag::Array()};
+
+        for (auto address: addresses)
+        {
+            PropertyBag table{std::string(), PropertyBag::Table()};
+            Util::addToTable<ProcessProps::SymbolAddress>(table, formatAddress(address));
+
+            if (auto symbol = index.lookup(address))
+            {
+                addSymbol(table, *symbol);
+                Util::addToTable<ProcessProps::SymbolOffset>(table, address - symbol->address);
+            }
+
+            Util::addToArray<Kes::ProcessProps::Symbol>(symbolArray, std::move(table));
+        }
+
+        Util::addToTable<Kes::ProcessProps::SymbolList>(response, std::move(symbolArray));
+    }
+
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+bool SymbolManager::findSymbols(const ProcFs::SymbolIndex& index, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    auto prefix = Util::findInTable<ProcessProps::SymbolPrefix>(request);
+    if (!prefix || prefix->empty())
+        return fail(response, id, "No symbol prefix");
+
+    auto limit = Util::findInTable<ProcessProps::Limit>(request);
+    if (limit && (*limit <= 0))
+        return fail(response, id, Util::format("Invalid limit [%d]", *limit));
+
+    bool more = false;
+    auto symbols = index.findPrefix(*prefix, limit ? std::min(size_t(*limit), MaxLimit) : DefaultLimit, more);
+
+    {
+        PropertyBag symbolArray{Kes::ProcessProps::SymbolList::idstr(), PropertyBag::Array()};
+
+        for (auto& symbol: symbols)
+        {
+            PropertyBag table{std::string(), PropertyBag::Table()};
+            Util::addToTable<ProcessProps::SymbolAddress>(table, formatAddress(symbol.address));
+            addSymbol(table, symbol);
+
+            Util::addToArray<Kes::ProcessProps::Symbol>(symbolArray, std::move(table));
+        }
+
+        Util::addToTable<Kes::ProcessProps::SymbolList>(response, std::move(symbolArray));
+    }
+
+    Util::addToTable<ProcessProps::SymbolMore>(response, more);
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
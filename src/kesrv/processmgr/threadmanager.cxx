@@ -0,0 +1,365 @@
+#include <kesrv/exception.hxx>
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/processmanager/threadmanager.hxx>
+#include <kesrv/trace/trace.hxx>
+#include <kesrv/util/crc32.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+const char* const s_commands[] =
+{
+    "list_threads",
+    "diff_threads"
+};
+
+} // namespace {}
+
+
+ThreadManager::Pool::~Pool()
+{
+    {
+        std::lock_guard l(m_mutex);
+        m_stop = true;
+    }
+
+    m_wakeup.notify_all();
+
+    for (auto& thread: m_threads)
+        thread.join();
+}
+
+ThreadManager::Pool::Pool(size_t threads)
+{
+    m_threads.reserve(threads);
+    try
+    {
+        for (size_t i = 0; i < threads; ++i)
+            m_threads.emplace_back([this]() { worker(); });
+    }
+    catch (std::exception&)
+    {
+        // fewer workers do the same job
+    }
+}
+
+void ThreadManager::Pool::parallelFor(size_t count, size_t helpers, size_t chunk, const Job& job)
+{
+    helpers = std::min(helpers, m_threads.size());
+    if (!helpers)
+    {
+        job(size_t(0), count);
+        return;
+    }
+
+    {
+        std::lock_guard l(m_mutex);
+        assert(!m_job);
+        m_job = &job;
+        m_count = count;
+        m_chunk = chunk;
+        m_next.store(0, std::memory_order_relaxed);
+        m_wanted = helpers;
+        ++m_generation;
+    }
+
+    m_wakeup.notify_all();
+
+    drain();
+
+    std::unique_lock l(m_mutex);
+    // nothing is left for a helper that has not woken up yet
+    m_wanted = 0;
+    m_done.wait(l, [this]() { return !m_busy; });
+    m_job = nullptr;
+}
+
+void ThreadManager::Pool::worker() noexcept
+{
+    uint64_t seen = 0;
+    std::unique_lock l(m_mutex);
+    for (;;)
+    {
+        m_wakeup.wait(l, [this, &seen]() { return m_stop || (m_wanted && (m_generation != seen)); });
+        if (m_stop)
+            break;
+
+        seen = m_generation;
+        --m_wanted;
+        ++m_busy;
+
+        l.unlock();
+        drain();
+        l.lock();
+
+        if (!--m_busy)
+            m_done.notify_all();
+    }
+}
+
+void ThreadManager::Pool::drain() noexcept
+{
+    for (;;)
+    {
+        auto begin = m_next.fetch_add(m_chunk, std::memory_order_relaxed);
+        if (begin >= m_count)
+            break;
+
+        (*m_job)(begin, std::min(begin + m_chunk, m_count));
+    }
+}
+
+
+ThreadManager::~ThreadManager()
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->unregisterHandler(cmd, this);
+    }
+}
+
+ThreadManager::ThreadManager(IRequestProcessor* rp, Log::ILog* log, const std::string& procFsRoot, size_t workers)
+    : m_rp(rp)
+    , m_log(log)
+    , m_procFs(log, procFsRoot)
+    , m_workers(workers ? workers : std::clamp(size_t(std::thread::hardware_concurrency()), size_t(1), MaxWorkers))
+    , m_pool(m_workers - 1)
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->registerHandler(cmd, this);
+    }
+}
+
+bool ThreadManager::process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    assert(request.isTable());
+    assert(response.isTable());
+
+    std::lock_guard l(m_mutex);
+
+    auto it = m_sessions.find(sessionId);
+    assert(it != m_sessions.end());
+    if (it == m_sessions.end())
+        return false;
+
+    if (!std::strcmp(key, "list_threads"))
+        return listThreads(true, it->second.get(), id, request, response);
+    else if (!std::strcmp(key, "diff_threads"))
+        return listThreads(false, it->second.get(), id, request, response);
+
+    m_log->write(Log::Level::Error, "ThreadManager: unknown command [%s]", key);
+    return false;
+}
+
+void ThreadManager::startSession(uint32_t id)
+{
+    std::lock_guard l(m_mutex);
+
+    if (m_sessions.find(id) == m_sessions.end())
+        m_sessions.insert({ id, std::make_unique<Session>(id) });
+}
+
+void ThreadManager::endSession(uint32_t id)
+{
+    std::lock_guard l(m_mutex);
+
+    m_sessions.erase(id);
+}
+
+bool ThreadManager::listThreads(bool initial, Session* session, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    auto pid = Util::findInTable<ProcessProps::Pid>(request);
+    if (pid && (*pid <= 0))
+    {
+        Util::addToTable<Kes::Request::Props::Id>(response, id);
+        Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Fail));
+        Util::addToTable<Kes::Response::Props::Reason>(response, Util::format("Invalid pid [%d]", *pid));
+        return true;
+    }
+
+    auto pids = pid ? std::vector<pid_t>{ pid_t(*pid) } : m_procFs.enumeratePids();
+
+    ++session->timestamp;
+    if (initial)
+        session->threads.clear();
+
+    auto tasks = scan(session, pids);
+
+    m_cpu.beginScan();
+
+    {
+        PropertyBag threadArray{Kes::ProcessProps::ThreadList::idstr(), PropertyBag::Array()};
+
+        for (auto& task: tasks)
+        {
+            auto result = session->threads.try_emplace(task.tid);
+            auto newcomer = result.second;
+            auto& info = result.first->second;
+
+            info.pid = task.pid;
+            info.timestamp = session->timestamp;
+            if (task.wchanRead || !task.stat.valid || (task.stat.state == 'R'))
+                info.wchan = std::move(task.wchan);
+
+            info.stat = std::move(task.stat);
+            info.cpu = info.stat.valid ? m_cpu.update(task.tid, info.stat.starttime, info.stat.utime + info.stat.stime, task.time) : -1;
+
+            auto digest = info.computeDigest();
+            if (initial || newcomer || (digest != info.digest))
+                Util::addToArray<Kes::ProcessProps::Thread>(threadArray, info.serialize(newcomer && !initial));
+
+            info.digest = digest;
+        }
+
+        Util::addToTable<Kes::ProcessProps::ThreadList>(response, std::move(threadArray));
+    }
+
+    if (!initial)
+    {
+        PropertyBag threadArray{Kes::ProcessProps::DeletedThreadList::idstr(), PropertyBag::Array()};
+
+        for (auto it = session->threads.begin(); it != session->threads.end();)
+        {
+            if (it->second.timestamp < session->timestamp)
+            {
+                Util::addToArray<Kes::ProcessProps::DeletedThread>(threadArray, int(it->first));
+                it = session->threads.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        Util::addToTable<Kes::ProcessProps::DeletedThreadList>(response, std::move(threadArray));
+    }
+
+    Util::addToTable<Kes::Request::Props::Id>(response, id);
+    Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+    return true;
+}
+
+// the workers only read the session
+std::vector<ThreadManager::Task> ThreadManager::scan(const Session* session, const std::vector<pid_t>& pids)
+{
+    std::vector<std::vector<pid_t>> tids(pids.size());
+    m_pool.parallelFor(pids.size(), workersFor(pids.size()) - 1, 32, [this, &pids, &tids](size_t begin, size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+            tids[i] = m_procFs.enumerateTids(pids[i]);
+    });
+
+    std::vector<Task> tasks;
+    for (size_t i = 0; i < pids.size(); ++i)
+    {
+        for (auto tid: tids[i])
+            tasks.push_back(Task{ pids[i], tid });
+    }
+
+    m_pool.parallelFor(tasks.size(), workersFor(tasks.size()) - 1, 64, [this, session, &tasks](size_t begin, size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto& task = tasks[i];
+            task.stat = m_procFs.readTaskStat(task.pid, task.tid);
+            task.time = Metrics::now();
+
+            if (!task.stat.valid || (task.stat.state == 'R'))
+                continue;
+
+            // has not run since the previous scan: still waiting in the same place
+            auto known = session->threads.find(task.tid);
+            if ((known != session->threads.end()) && known->second.stat.valid && (known->second.stat.starttime == task.stat.starttime) &&
+                (known->second.stat.state == task.stat.state) && (known->second.stat.utime == task.stat.utime) && (known->second.stat.stime == task.stat.stime))
+            {
+                continue;
+            }
+
+            task.wchan = m_procFs.readWChan(task.pid, task.tid);
+            task.wchanRead = true;
+        }
+    });
+
+    return tasks;
+}
+
+size_t ThreadManager::workersFor(size_t items) const noexcept
+{
+    // a traced request reads everything on its own thread, so that every read is accounted
+    if (Trace::Context::current())
+        return 1;
+
+    return std::clamp(items / MinTasksPerWorker, size_t(1), m_workers);
+}
+
+uint32_t ThreadManager::ThreadInfo::computeDigest() const noexcept
+{
+    auto add = [](uint32_t crc, const std::string& s)
+    {
+        auto length = uint32_t(s.length());
+        crc = Util::crc32(&length, sizeof(length), crc);
+        return Util::crc32(s.data(), s.length(), crc);
+    };
+
+    const int64_t values[] = { int64_t(stat.valid), int64_t(stat.state), int64_t(stat.processor), int64_t(stat.priority), int64_t(stat.nice),
+        int64_t(stat.utime), int64_t(stat.stime), int64_t(std::round(cpu * 100)) };
+
+    auto crc = Util::crc32(values, sizeof(values));
+    crc = add(crc, stat.error);
+    crc = add(crc, stat.comm);
+    return add(crc, wchan);
+}
+
+PropertyBag ThreadManager::ThreadInfo::serialize(bool newcomer) const
+{
+    PropertyBag table{std::string(), PropertyBag::Table()};
+
+    Util::addToTable<ProcessProps::Tid>(table, int(stat.pid));
+    Util::addToTable<ProcessProps::ThreadPid>(table, int(pid));
+
+    if (newcomer)
+        Util::addToTable<ProcessProps::ThreadNewcomer>(table, true);
+
+    if (!stat.valid)
+    {
+        Util::addToTable<ProcessProps::ThreadError>(table, stat.error);
+        return table;
+    }
+
+    Util::addToTable<ProcessProps::ThreadComm>(table, stat.comm);
+    Util::addToTable<ProcessProps::ThreadState>(table, std::string(1, stat.state));
+    if (cpu >= 0)
+        Util::addToTable<ProcessProps::ThreadCpu>(table, std::round(cpu * 100) / 100);
+
+    Util::addToTable<ProcessProps::ThreadProcessor>(table, stat.processor);
+    if (!wchan.empty())
+        Util::addToTable<ProcessProps::ThreadWChan>(table, wchan);
+
+    Util::addToTable<ProcessProps::ThreadPriority>(table, int64_t(stat.priority));
+    Util::addToTable<ProcessProps::ThreadNice>(table, int64_t(stat.nice));
+    Util::addToTable<ProcessProps::ThreadUTime>(table, uint64_t(stat.utime));
+    Util::addToTable<ProcessProps::ThreadSTime>(table, uint64_t(stat.stime));
+
+    return table;
+}
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
@@ -339,6 +339,10 @@ static void propertyToJson(const PropertyBag& bag, Json::Writer<Json::StringBuff
     {
         writer.Uint64(std::any_cast<uint64_t>(prop.value));
     }
+    else if (*type == typeid(double))
+    {
+        writer.Double(std::any_cast<double>(prop.value));
+    }
     else if (*type == typeid(std::string))
     {
         auto s = std::any_cast<std::string>(prop.value);
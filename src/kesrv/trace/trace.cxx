@@ -0,0 +1,91 @@
+#include <kesrv/trace/trace.hxx>
+#include <kesrv/trace/traceprops.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+
+namespace Kes
+{
+
+namespace Trace
+{
+
+namespace
+{
+
+thread_local Frame t_frame;
+
+uint64_t elapsed(uint64_t from, uint64_t to) noexcept
+{
+    return (from && (to > from)) ? Util::Clock::nanoseconds(to - from) : 0;
+}
+
+} // namespace {}
+
+
+PropertyBag Context::serialize() const
+{
+    PropertyBag table{TraceProps::Trace::idstr(), PropertyBag::Table()};
+
+    Util::addToTable<TraceProps::Frame>(table, Util::Clock::nanoseconds(m_frame.detection));
+    Util::addToTable<TraceProps::Queue>(table, elapsed(m_frame.framed, m_parseStarted));
+    Util::addToTable<TraceProps::Parse>(table, elapsed(m_parseStarted, m_parsed));
+    Util::addToTable<TraceProps::Handler>(table, elapsed(m_parsed, m_handled));
+    Util::addToTable<TraceProps::Serialize>(table, elapsed(m_handled, m_serialized));
+    Util::addToTable<TraceProps::Clock>(table, std::string(Util::Clock::usesTsc() ? "tsc" : "monotonic_raw"));
+
+    if (m_fileCount)
+    {
+        PropertyBag files{TraceProps::FileList::idstr(), PropertyBag::Array()};
+
+        for (size_t i = 0; i < m_fileCount; ++i)
+        {
+            PropertyBag file{std::string(), PropertyBag::Table()};
+            Util::addToTable<TraceProps::FileName>(file, std::string(m_files[i].name));
+            Util::addToTable<TraceProps::FileReads>(file, uint64_t(m_files[i].count));
+            Util::addToTable<TraceProps::FileTime>(file, Util::Clock::nanoseconds(m_files[i].ticks));
+
+            Util::addToArray<TraceProps::File>(files, std::move(file));
+        }
+
+        Util::addToTable<TraceProps::FileList>(table, std::move(files));
+    }
+
+    return table;
+}
+
+void Context::appendTo(std::string& response) const
+{
+    PropertyBag wrapper{std::string(), PropertyBag::Table()};
+    Util::addToTable<TraceProps::Trace>(wrapper, serialize());
+
+    auto trace = propertyBagToJson(wrapper); // {"response.trace":{...}}
+
+    auto end = response.find_last_of('}');
+    if ((end == std::string::npos) || (trace.length() < 2))
+        return;
+
+    response.resize(end);
+
+    // the response may be an empty object
+    auto last = response.find_last_not_of(" \t\r\n");
+    if ((last != std::string::npos) && (response[last] != '{'))
+        response.push_back(',');
+
+    response.append(trace, 1, std::string::npos);
+}
+
+
+KESRV_EXPORT void setFrame(const Frame& frame) noexcept
+{
+    t_frame = frame;
+}
+
+KESRV_EXPORT const Frame& frame() noexcept
+{
+    return t_frame;
+}
+
+
+} // namespace Trace {}
+
+} // namespace Kes {}
@@ -0,0 +1,36 @@
+#include <kesrv/knownprops.hxx>
+#include <kesrv/trace/traceprops.hxx>
+
+
+namespace Kes
+{
+
+namespace TraceProps
+{
+
+namespace Private
+{
+
+KESRV_EXPORT void registerAll()
+{
+    registerProperty(new PropertyInfoWrapper<TraceProps::Trace>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::Frame>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::Queue>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::Parse>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::Handler>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::Serialize>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::Clock>);
+
+    registerProperty(new PropertyInfoWrapper<TraceProps::File>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::FileList>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::FileName>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::FileReads>);
+    registerProperty(new PropertyInfoWrapper<TraceProps::FileTime>);
+}
+
+
+} // namespace Private {}
+
+} // namespace TraceProps {}
+
+} // namespace Kes {}
@@ -0,0 +1,80 @@
+#include <kesrv/util/clock.hxx>
+
+#include <chrono>
+#include <thread>
+
+#if KES_HAS_TSC
+    #include <cpuid.h>
+#endif
+
+
+namespace Kes
+{
+
+namespace Util
+{
+
+namespace Clock
+{
+
+namespace
+{
+
+uint64_t monotonicRaw() noexcept
+{
+    struct timespec ts = {};
+    ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+double calibrate() noexcept
+{
+#if KES_HAS_TSC
+    auto ns0 = monotonicRaw();
+    auto tsc0 = __rdtsc();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    auto ns1 = monotonicRaw();
+    auto tsc1 = __rdtsc();
+
+    if ((tsc1 > tsc0) && (ns1 > ns0))
+        return double(ns1 - ns0) / double(tsc1 - tsc0);
+#endif
+
+    return 1.0;
+}
+
+} // namespace {}
+
+
+KESRV_EXPORT bool detectInvariantTsc() noexcept
+{
+#if KES_HAS_TSC
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || (eax < 0x80000007))
+        return false;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+KESRV_EXPORT uint64_t nanoseconds(uint64_t ticks) noexcept
+{
+    if (!usesTsc())
+        return ticks;
+
+    static const double nsPerTick = calibrate();
+    return uint64_t(double(ticks) * nsPerTick);
+}
+
+} // namespace Clock {}
+
+} // namespace Util {}
+
+} // namespace Kes {}
@@ -44,6 +44,65 @@ KESRV_EXPORT boost::asio::ip::tcp::endpoint endpointFromString(const std::string
     return boost::asio::ip::tcp::endpoint(address, parts.second);
 }
 
+KESRV_EXPORT bool isLocalAddress(const std::string& s) noexcept
+{
+    return !s.compare(0, sizeof(LocalAddressPrefix) - 1, LocalAddressPrefix);
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+KESRV_EXPORT boost::asio::local::stream_protocol::endpoint localEndpointFromString(const std::string& s)
+{
+    if (!isLocalAddress(s))
+        throw Kes::Exception(KES_HERE(), "Not a unix domain socket address");
+
+    auto path = s.substr(sizeof(LocalAddressPrefix) - 1);
+    if (path.empty() || (path == "@"))
+        throw Kes::Exception(KES_HERE(), "Empty unix domain socket path");
+
+    // abstract names start with a NUL byte instead of '@'
+    if (path[0] == '@')
+        path[0] = '\0';
+
+    if (path.size() >= sizeof(sockaddr_un::sun_path))
+        throw Kes::Exception(KES_HERE(), "Unix domain socket path is too long");
+
+    return boost::asio::local::stream_protocol::endpoint(path);
+}
+
+#endif
+
+KESRV_EXPORT std::vector<boost::asio::generic::stream_protocol::endpoint> resolveEndpoints(boost::asio::io_context& io, const std::string& s)
+{
+    std::vector<boost::asio::generic::stream_protocol::endpoint> endpoints;
+
+    if (isLocalAddress(s))
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        endpoints.push_back(localEndpointFromString(s));
+        return endpoints;
+#else
+        throw Kes::Exception(KES_HERE(), "Unix domain sockets are not supported");
+#endif
+    }
+
+    auto parts = splitAddress(s);
+
+    boost::asio::ip::tcp::resolver resolver(io);
+    boost::system::error_code ec;
+    auto results = resolver.resolve(parts.first, "", ec);
+    if (ec)
+        throw Kes::Exception(KES_HERE(), std::string("Failed to resolve the server address: ") + ec.message());
+
+    for (auto& r : results)
+        endpoints.push_back(boost::asio::ip::tcp::endpoint(r.endpoint().address(), parts.second));
+
+    if (endpoints.empty())
+        throw Kes::Exception(KES_HERE(), "No server address");
+
+    return endpoints;
+}
+
 
 } // namespace Util {}
 
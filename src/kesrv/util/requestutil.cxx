@@ -41,6 +41,7 @@ void registerAll()
 {
     Kes::registerProperty(new PropertyInfoWrapper<Kes::Request::Props::Id>);
     Kes::registerProperty(new PropertyInfoWrapper<Kes::Request::Props::Command>);
+    Kes::registerProperty(new PropertyInfoWrapper<Kes::Request::Props::Trace>);
 }
 
 } // namespace Private {}
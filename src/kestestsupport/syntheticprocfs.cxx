@@ -0,0 +1,355 @@
+#include <kesrv/exception.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+#include <kesrv/util/format.hxx>
+
+#include <filesystem>
+#include <fstream>
+
+
+namespace Kes
+{
+
+namespace ProcFs
+{
+
+namespace
+{
+
+const uint64_t kBootTime = 1700000000;
+
+void writeFile(const std::string& path, const std::string& content)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), content.size());
+    if (!file)
+        throw Exception(KES_HERE(), Util::format("Failed to write %s", path.c_str()));
+}
+
+std::string commOf(pid_t pid)
+{
+    // a few processes get names that are awkward to parse
+    if (pid % 97 == 0)
+        return Util::format("odd) (name %d", pid);
+
+    return Util::format("synth-%d", pid);
+}
+
+unsigned threadCountOf(pid_t pid) noexcept
+{
+    return (pid % 8 == 0) ? 4 : 1;
+}
+
+pid_t tidOf(pid_t pid, unsigned thread) noexcept
+{
+    return pid_t(pid + thread * 1000000);
+}
+
+} // namespace {}
+
+
+SyntheticProcFs::~SyntheticProcFs()
+{
+    std::error_code ec;
+    std::filesystem::remove_all(m_root, ec);
+}
+
+SyntheticProcFs::SyntheticProcFs(const std::string& root, size_t processes, unsigned seed)
+    : m_root(root)
+    , m_cgroupRoot(root + "/cgroupfs")
+    , m_random(seed)
+{
+    std::error_code ec;
+    if (std::filesystem::exists(m_root, ec) && !std::filesystem::is_empty(m_root, ec))
+        throw Exception(KES_HERE(), Util::format("%s is not empty", m_root.c_str()));
+
+    std::filesystem::create_directories(m_root);
+
+    writeFile(m_root + "/cmdline", "BOOT_IMAGE=/vmlinuz-synthetic root=/dev/null\n");
+
+    m_pids.reserve(processes);
+    for (size_t i = 0; i < processes; ++i)
+        addProcess(m_nextPid++);
+
+    writeSystemStat();
+    writeNet();
+    writeCgroups();
+    writeKernel();
+}
+
+std::string SyntheticProcFs::cgroupOf(pid_t pid)
+{
+    return cgroupPath(unsigned(pid % CgroupCount));
+}
+
+std::string SyntheticProcFs::cgroupPath(unsigned n)
+{
+    return Util::format("/system.slice/svc-%u.service", n);
+}
+
+// <cgroup root>/<cgroupPath(n)>/{cpu.stat,memory.current,memory.pressure} for the CgroupCount
+// cgroups; the processes name theirs in <pid>/cgroup
+void SyntheticProcFs::writeCgroups()
+{
+    for (unsigned n = 0; n < CgroupCount; ++n)
+    {
+        auto dir = m_cgroupRoot + cgroupPath(n);
+        std::filesystem::create_directories(dir);
+
+        auto usage = (n + 1) * 1000000ULL;
+        writeFile(dir + "/cpu.stat", Util::format(
+            "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\nnr_periods 0\nnr_throttled %u\nthrottled_usec %u\n",
+            usage, usage / 2, usage / 2, n, n * 100));
+        writeFile(dir + "/memory.current", Util::format("%llu\n", (n + 1) * 1024 * 1024ULL));
+        writeFile(dir + "/memory.pressure", Util::format(
+            "some avg10=%u.00 avg60=0.50 avg300=0.25 total=%u\nfull avg10=0.00 avg60=0.00 avg300=0.00 total=0\n", n, n * 1000));
+    }
+}
+
+std::string SyntheticProcFs::kernelSymbolName(unsigned i)
+{
+    return Util::format("synth_func_%04u", i);
+}
+
+std::string SyntheticProcFs::moduleSymbolName(unsigned i)
+{
+    return Util::format("%s_fn_%02u", ModuleName, i);
+}
+
+// kallsyms, modules and sys/kernel/{osrelease,version,random/boot_id}: a booted kernel with one
+// module loaded
+void SyntheticProcFs::writeKernel()
+{
+    std::filesystem::create_directories(m_root + "/sys/kernel/random");
+    writeFile(m_root + "/sys/kernel/osrelease", "6.1.0-synthetic\n");
+    writeFile(m_root + "/sys/kernel/version", "#1 SMP PREEMPT_DYNAMIC synthetic\n");
+    writeFile(m_root + "/sys/kernel/random/boot_id", "5ee4c0de-0000-4000-8000-000000000001\n");
+    writeFile(m_root + "/modules", Util::format("%s %llu 0 - Live 0x%llx\n", ModuleName, (unsigned long long)ModuleSize, (unsigned long long)ModuleBase));
+
+    std::string kallsyms;
+    kallsyms.append(Util::format("%016llx T _text\n", (unsigned long long)KernelTextBase));
+    kallsyms.append(Util::format("%016llx T _stext\n", (unsigned long long)KernelTextBase));
+    for (unsigned i = 0; i < KernelSymbolCount; ++i)
+    {
+        kallsyms.append(Util::format("%016llx %c %s\n", (unsigned long long)(KernelTextBase + i * SymbolStep),
+            (i % 2) ? 't' : 'T', kernelSymbolName(i).c_str()));
+    }
+
+    kallsyms.append(Util::format("%016llx B _end\n", (unsigned long long)(KernelTextBase + KernelSymbolCount * SymbolStep)));
+
+    for (unsigned i = ModuleSymbolCount; i-- > 0;)
+    {
+        kallsyms.append(Util::format("%016llx t %s\t[%s]\n", (unsigned long long)(ModuleBase + i * SymbolStep),
+            moduleSymbolName(i).c_str(), ModuleName));
+    }
+
+    writeFile(m_root + "/kallsyms", kallsyms);
+}
+
+void SyntheticProcFs::churn(size_t count)
+{
+    count = std::min(count, m_pids.size());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::uniform_int_distribution<size_t> pick(0, m_pids.size() - 1);
+        auto index = pick(m_random);
+        auto pid = m_pids[index];
+
+        m_pids[index] = m_pids.back();
+        m_pids.pop_back();
+        removeProcess(pid);
+    }
+
+    ++m_churns;
+
+    std::uniform_int_distribution<unsigned long> ticks(0, 10);
+    for (auto pid: m_pids)
+    {
+        writeIo(pid);
+
+        for (unsigned t = 0; t < threadCountOf(pid); ++t)
+            writeStat(pid, tidOf(pid, t), 100 + ticks(m_random) + m_nextPid, 50 + ticks(m_random));
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        addProcess(m_nextPid++);
+
+    // the system is 25% busy
+    m_busyTicks += 25;
+    m_idleTicks += 75;
+    writeSystemStat();
+    writeNet();
+}
+
+// net/{tcp,tcp6,udp,udp6,unix}: the socket of every process's fd 2 listens on 127.0.0.1:<pid>,
+// plus a few sockets nobody owns
+void SyntheticProcFs::writeNet()
+{
+    std::filesystem::create_directories(m_root + "/net");
+
+    const char* const inetHeader = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+
+    std::string tcp = inetHeader;
+    size_t line = 0;
+    for (auto pid: m_pids)
+    {
+        tcp.append(Util::format("%4zu: 0100007F:%04X 00000000:0000 0A 00000000:00000000 00:00000000 00000000  1000        0 %llu 1 0000000000000000 100 0 0 10 0\n",
+            line++, unsigned(pid), (unsigned long long)(pid * 16 + 2)));
+    }
+
+    // 127.0.0.1:50000 -> 127.0.0.1:80, closed already
+    tcp.append(Util::format("%4zu: 0100007F:C350 0100007F:0050 06 00000000:00000000 03:00001000 00000000     0        0 0 3 0000000000000000\n", line));
+    writeFile(m_root + "/net/tcp", tcp);
+
+    // [::1]:8080, the same
+    writeFile(m_root + "/net/tcp6", std::string(inetHeader) +
+        "   0: 00000000000000000000000001000000:1F90 00000000000000000000000001000000:D431 06 00000000:00000000 03:00001000 00000000     0        0 0 3 0000000000000000\n");
+
+    writeFile(m_root + "/net/udp", std::string(inetHeader) +
+        "   0: 00000000:0035 00000000:0000 07 00000000:00000000 00:00000000 00000000   101        0 0 2 0000000000000000 0\n");
+
+    writeFile(m_root + "/net/udp6", inetHeader);
+
+    writeFile(m_root + "/net/unix",
+        "Num       RefCount Protocol Flags    Type St Inode Path\n"
+        "0000000000000000: 00000002 00000000 00010000 0001 01 777 /run/synthetic.sock\n"
+        "0000000000000000: 00000003 00000000 00000000 0001 03 778\n");
+}
+
+// stat: the system CPU times and the boot time
+void SyntheticProcFs::writeSystemStat()
+{
+    writeFile(m_root + "/stat", Util::format("cpu  %llu 0 0 %llu 0 0 0 0 0 0\nbtime %llu\nprocesses %zu\n",
+        (unsigned long long)m_busyTicks, (unsigned long long)m_idleTicks, (unsigned long long)kBootTime, size_t(m_nextPid - FirstPid)));
+}
+
+// <pid>/io: the counters are the same function of the pid and the churn count for everyone
+void SyntheticProcFs::writeIo(pid_t pid)
+{
+    auto read = uint64_t(pid) * 4096 + m_churns * IoReadStep;
+    auto written = uint64_t(pid) * 1024 + m_churns * IoWriteStep;
+
+    writeFile(Util::format("%s/%d/io", m_root.c_str(), pid), Util::format(
+        "rchar: %llu\nwchar: %llu\nsyscr: %llu\nsyscw: %llu\nread_bytes: %llu\nwrite_bytes: %llu\ncancelled_write_bytes: %llu\n",
+        (unsigned long long)(read * 2), (unsigned long long)(written * 2), (unsigned long long)(read / 4096), (unsigned long long)(written / 4096),
+        (unsigned long long)read, (unsigned long long)written, (unsigned long long)(m_churns * 4096)));
+}
+
+// fd/<n> symlinks with their fdinfo/<n>
+void SyntheticProcFs::writeFds(const std::string& dir, pid_t pid)
+{
+    std::filesystem::create_directories(dir + "/fd");
+    std::filesystem::create_directories(dir + "/fdinfo");
+
+    for (size_t fd = 0; fd < fdCountOf(pid); ++fd)
+    {
+        std::string target;
+        switch (fd)
+        {
+        case 0: target = "/dev/null"; break;
+        case 1: target = Util::format("pipe:[%llu]", (unsigned long long)(pid * 16 + fd)); break;
+        case 2: target = Util::format("socket:[%llu]", (unsigned long long)(pid * 16 + fd)); break;
+        case 3: target = "anon_inode:[eventfd]"; break;
+        default: target = Util::format("/var/lib/synth/%d/%zu.dat", pid, fd); break;
+        }
+
+        std::filesystem::create_symlink(target, Util::format("%s/fd/%zu", dir.c_str(), fd));
+
+        // O_RDWR | O_LARGEFILE
+        writeFile(Util::format("%s/fdinfo/%zu", dir.c_str(), fd), Util::format("pos:\t%zu\nflags:\t0100002\nmnt_id:\t21\n", fd * 512));
+    }
+}
+
+// <pid>/: stat, status, statm, smaps_rollup, io, comm, cmdline, cgroup, an exe symlink,
+// ns/{pid,mnt,net,user,cgroup}, fds and task/<tid>/{stat,comm,wchan}
+void SyntheticProcFs::addProcess(pid_t pid)
+{
+    auto dir = Util::format("%s/%d", m_root.c_str(), pid);
+    std::filesystem::create_directories(dir + "/task");
+
+    auto comm = commOf(pid);
+    auto threads = threadCountOf(pid);
+
+    writeFile(dir + "/comm", comm + "\n");
+    writeFile(dir + "/cgroup", "0::" + cgroupOf(pid) + "\n");
+
+    // on the host or in one of the ContainerCount containers
+    std::filesystem::create_directories(dir + "/ns");
+    const char* const namespaces[] = { "pid", "mnt", "net", "user", "cgroup" };
+    for (unsigned kind = 0; kind < std::size(namespaces); ++kind)
+        std::filesystem::create_symlink(Util::format("%s:[%llu]", namespaces[kind], (unsigned long long)namespaceOf(pid, kind)), dir + "/ns/" + namespaces[kind]);
+
+    auto nsPid = containerOf(pid) ? Util::format("%d\t%d", pid, nsPidOf(pid)) : std::to_string(pid);
+
+    std::string cmdLine = "/usr/bin/" + comm;
+    cmdLine.push_back('\0');
+    cmdLine.append("--instance");
+    cmdLine.push_back('\0');
+    cmdLine.append(std::to_string(pid));
+    cmdLine.push_back('\0');
+    writeFile(dir + "/cmdline", cmdLine);
+
+    // resident pages: 3/4 anonymous, 1/4 file-backed; a page in every 8 is swapped out
+    auto rss = 1024 + pid % 4096;
+    writeFile(dir + "/status", Util::format(
+        "Name:\t%s\nState:\tS (sleeping)\nTgid:\t%d\nPid:\t%d\nPPid:\t1\nUid:\t1000\t1000\t1000\t1000\nGid:\t1000\t1000\t1000\t1000\nNSpid:\t%s\n"
+        "VmRSS:\t%d kB\nRssAnon:\t%d kB\nRssFile:\t%d kB\nRssShmem:\t0 kB\nVmSwap:\t%d kB\nThreads:\t%u\n",
+        comm.c_str(), pid, pid, nsPid.c_str(), rss, rss * 3 / 4, rss - rss * 3 / 4, rss / 8, threads));
+
+    // in 4 kB pages
+    writeFile(dir + "/statm", Util::format("%d %d %d 16 0 %d 0\n", rss / 2, rss / 4, rss / 16, rss * 3 / 16));
+
+    // the file-backed pages are shared with one other process
+    writeFile(dir + "/smaps_rollup", Util::format(
+        "00400000-7fff0000 ---p 00000000 00:00 0                          [rollup]\n"
+        "Rss:            %8d kB\nPss:            %8d kB\nPss_Anon:       %8d kB\nPss_File:       %8d kB\nPss_Shmem:      %8d kB\n"
+        "Shared_Clean:   %8d kB\nSwap:           %8d kB\nSwapPss:        %8d kB\n",
+        rss, rss * 3 / 4 + (rss - rss * 3 / 4) / 2, rss * 3 / 4, (rss - rss * 3 / 4) / 2, 0, rss - rss * 3 / 4, rss / 8, rss / 8));
+
+    std::filesystem::create_symlink("/usr/bin/" + comm, dir + "/exe");
+
+    writeIo(pid);
+    writeFds(dir, pid);
+
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        auto tid = tidOf(pid, t);
+        auto taskDir = Util::format("%s/task/%d", dir.c_str(), tid);
+        std::filesystem::create_directories(taskDir);
+
+        writeFile(taskDir + "/comm", comm + "\n");
+        writeFile(taskDir + "/wchan", (t == 0) ? "do_select" : "futex_wait_queue");
+        writeStat(pid, tid, 100, 50);
+    }
+
+    m_pids.push_back(pid);
+}
+
+void SyntheticProcFs::removeProcess(pid_t pid)
+{
+    std::filesystem::remove_all(Util::format("%s/%d", m_root.c_str(), pid));
+}
+
+void SyntheticProcFs::writeStat(pid_t pid, pid_t tid, unsigned long utime, unsigned long stime)
+{
+    auto comm = commOf(pid);
+    auto threads = threadCountOf(pid);
+    auto starttime = (unsigned long long)(pid - FirstPid) * 10;
+    auto rss = 256 + pid % 1024;
+
+    // 52 fields as in proc(5)
+    auto stat = Util::format(
+        "%d (%s) S 1 %d %d 0 -1 4194560 %d 0 0 0 %lu %lu 0 0 20 0 %u 0 %llu %lu %d 18446744073709551615 "
+        "1 1 0 0 0 0 0 4096 0 0 0 0 17 %d 0 0 0 0 0 0 0 0 0 0 0 0\n",
+        tid, comm.c_str(), pid, pid, pid % 100, utime, stime, threads, starttime, (unsigned long)rss * 4096 * 4, rss, tid % 4);
+
+    // the main thread stat doubles as the process stat
+    writeFile(Util::format("%s/%d/task/%d/stat", m_root.c_str(), pid, tid), stat);
+    if (tid == pid)
+        writeFile(Util::format("%s/%d/stat", m_root.c_str(), pid), stat);
+}
+
+
+} // namespace ProcFs {}
+
+} // namespace Kes {}
@@ -15,13 +15,36 @@ namespace Kes
 namespace Private
 {
 
+namespace
+{
+
+// each record takes 3 iovecs: prefix, text, newline
+const size_t kBatchSize = IOV_MAX / 3;
+
+} // namespace {}
+
+
 Logger::~Logger()
 {
+    if (m_flusher)
+    {
+        m_stop = true;
+        m_wakeup.set();
+
+        if (m_flusher->joinable())
+            m_flusher->join();
+    }
+
+    if ((m_options.fsync != FsyncPolicy::Never) && m_dirty)
+        ::fsync(m_file);
 }
 
-Logger::Logger(Kes::Log::Level level, const char* fileName)
+Logger::Logger(Kes::Log::Level level, const char* fileName, const LoggerOptions& options)
     : m_file(::open(fileName, O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH))
     , m_level(level)
+    , m_options(options)
+    , m_lastFsync(std::chrono::steady_clock::now().time_since_epoch().count())
+    , m_wakeup(true)
 {
     if (m_file == -1)
         throw Kes::Exception(KES_HERE(), "Failed to create the logfile", Kes::ExceptionProps::PosixErrorCode(errno));
@@ -33,6 +56,23 @@ Logger::Logger(Kes::Log::Level level, const char* fileName)
 
         throw Kes::Exception(KES_HERE(), "Failed to lock the logfile", Kes::ExceptionProps::PosixErrorCode(errno));
     }
+
+    if (m_options.binary)
+    {
+        m_options.async = true;
+
+        std::string header;
+        Kes::Log::Binary::appendHeader(header);
+
+        struct iovec iov = { header.data(), header.size() };
+        writeAll(m_file, &iov, 1);
+    }
+
+    if (m_options.async)
+    {
+        m_ring.reset(new Util::MpscRing<Entry>(m_options.queueSize));
+        m_flusher.reset(new std::thread([this]() { flusher(); }));
+    }
 }
 
 Kes::Log::Level Logger::level() const noexcept
@@ -45,81 +85,321 @@ bool Logger::writev(Kes::Log::Level level, const char* format, va_list args) noe
     if (level < m_level)
         return true;
 
+    Kes::Log::Record record;
+    record.assignv(format, args);
+
+    if (m_ring)
+        writeAsync(level, std::move(record));
+    else
+        writeSync(level, record);
+
+    return true;
+}
+
+bool Logger::write(Kes::Log::Level level, const char* format, ...) noexcept
+{
+    if (level < m_level)
+        return true;
+
+    va_list args;
+    va_start(args, format);
+
+    auto result = writev(level, format, args);
+
+    va_end(args);
+
+    return result;
+}
+
+bool Logger::put(Kes::Log::Level level, Kes::Log::Record&& record) noexcept
+{
+    if (level < m_level)
+        return true;
+
+    if (m_ring)
+        writeAsync(level, std::move(record));
+    else
+        writeSync(level, record);
+
+    return true;
+}
+
+void Logger::writeSync(Kes::Log::Level level, const Kes::Log::Record& record) noexcept
+{
     try
     {
-        va_list args1;
-        va_copy(args1, args);
-        auto required = ::vsnprintf(nullptr, 0, format, args1);
-
         std::string formatted;
-        formatted.resize(required);
-        ::vsnprintf(formatted.data(), required + 1, format, args);
-
-        va_end(args1);
+        Kes::Log::render(record, formatted);
 
         struct timespec now = {};
         ::clock_gettime(CLOCK_REALTIME, &now);
 
-        const char* strLevel = "?";
-        switch (level)
+        char prefix[64];
+        auto prefixLength = Kes::Log::formatPrefix(level, now, prefix, _countof(prefix));
+
+        struct iovec iov[3] =
+        {
+            { prefix, prefixLength },
+            { formatted.data(), formatted.length() },
+            { const_cast<char*>("\n"), 1 }
+        };
+
+#if KES_DEBUG
+        writeAll(STDOUT_FILENO, iov, _countof(iov));
+#endif
+
+        writeAll(m_file, iov, _countof(iov));
+        m_dirty = true;
+        maybeFsync(level >= Kes::Log::Level::Error);
+    }
+    catch (...)
+    {
+        // not much we can do here
+    }
+}
+
+void Logger::writeAsync(Kes::Log::Level level, Kes::Log::Record&& record) noexcept
+{
+    // formatting is left to the flusher: only the format pointer and raw arguments are queued
+    auto pushed = m_ring->push(
+        [level, &record](Entry& e)
+        {
+            e.level = level;
+            ::clock_gettime(CLOCK_REALTIME, &e.time);
+            e.record = std::move(record);
+        }
+    );
+
+    if (!pushed)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        m_wakeup.set();
+        return;
+    }
+
+    // errors are flushed promptly; everything else is batched unless the ring fills up
+    if (level >= Kes::Log::Level::Error)
+    {
+        m_errorPending = true;
+        m_wakeup.set();
+    }
+    else if (m_ring->size() > m_ring->capacity() / 2)
+    {
+        m_wakeup.set();
+    }
+}
+
+void Logger::flusher() noexcept
+{
+    while (!m_stop)
+    {
+        m_wakeup.wait(m_options.flushInterval);
+
+        while (flush() > 0)
         {
-        case Kes::Log::Level::Debug: strLevel = "D"; break;
-        case Kes::Log::Level::Info: strLevel = "I"; break;
-        case Kes::Log::Level::Warning: strLevel = "W"; break;
-        case Kes::Log::Level::Error: strLevel = "E"; break;
-        case Kes::Log::Level::Fatal: strLevel = "!"; break;
         }
 
-        // round nanoseconds to milliseconds
-        long msec = 0;
-        if (now.tv_nsec >= 999500000)
+        auto dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped > m_droppedReported)
         {
-            now.tv_sec++;
-            msec = 0;
+            struct timespec now = {};
+            ::clock_gettime(CLOCK_REALTIME, &now);
+
+            char prefix[64];
+            auto prefixLength = Kes::Log::formatPrefix(Kes::Log::Level::Warning, now, prefix, _countof(prefix));
+
+            char text[128];
+            auto textLength = ::snprintf(text, _countof(text), "Logger: %llu message(s) dropped\n", (unsigned long long)(dropped - m_droppedReported));
+            m_droppedReported = dropped;
+
+            struct iovec iov[2] =
+            {
+                { prefix, prefixLength },
+                { text, size_t(std::max(textLength, 0)) }
+            };
+
+            writeAll(m_file, iov, _countof(iov));
+            m_dirty = true;
         }
-        else
+
+        // Periodic policy must not leave a quiet log unsynced forever
+        maybeFsync(false);
+    }
+
+    // drain whatever is left
+    while (flush() > 0)
+    {
+    }
+}
+
+size_t Logger::flush() noexcept
+{
+    Entry* entries[kBatchSize];
+    auto count = m_ring->peek(entries, kBatchSize);
+    if (!count)
+        return 0;
+
+    bool error = m_errorPending.exchange(false);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (entries[i]->level >= Kes::Log::Level::Error)
+            error = true;
+    }
+
+    if (m_options.binary)
+        flushBinary(entries, count);
+    else
+        flushText(entries, count, true);
+
+    m_dirty = true;
+
+    for (size_t i = 0; i < count; ++i)
+        entries[i]->record.clear();
+
+    m_ring->release(count);
+
+    maybeFsync(error);
+
+    return count;
+}
+
+size_t Logger::flushText(Entry** entries, size_t count, bool toFile) noexcept
+{
+    char prefixes[kBatchSize][32];
+    size_t offsets[kBatchSize + 1];
+    struct iovec iov[kBatchSize * 3];
+
+    try
+    {
+        // render the whole batch into one buffer first: it may reallocate
+        m_text.clear();
+        for (size_t i = 0; i < count; ++i)
         {
-            msec = (now.tv_nsec + 500000) / 1000000;
+            offsets[i] = m_text.size();
+            Kes::Log::render(entries[i]->record, m_text);
         }
 
-        struct tm localNow = {};
-        ::localtime_r(&now.tv_sec, &localNow);
+        offsets[count] = m_text.size();
+    }
+    catch (...)
+    {
+        return 0; // not much we can do here
+    }
 
-        char prefix[256];
-        ::snprintf(prefix, _countof(prefix), "[%02d:%02d:%02d.%03d %s] ", localNow.tm_hour, localNow.tm_min, localNow.tm_sec, msec, strLevel);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto e = entries[i];
+        auto prefixLength = Kes::Log::formatPrefix(e->level, e->time, prefixes[i], sizeof(prefixes[i]));
 
-        std::string message = std::string(prefix);
-        message.append(formatted);
-        message.append("\n");
+        iov[i * 3] = { prefixes[i], prefixLength };
+        iov[i * 3 + 1] = { m_text.data() + offsets[i], offsets[i + 1] - offsets[i] };
+        iov[i * 3 + 2] = { const_cast<char*>("\n"), 1 };
+    }
 
 #if KES_DEBUG
-        std::cout << message;
+    writeAll(STDOUT_FILENO, iov, count * 3);
 #endif
 
-        ::write(m_file, message.data(), message.length());
-        ::fsync(m_file);
+    if (toFile)
+        writeAll(m_file, iov, count * 3);
+
+    return count;
+}
+
+size_t Logger::flushBinary(Entry** entries, size_t count) noexcept
+{
+    try
+    {
+        m_text.clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto e = entries[i];
+
+            // format strings are written once, records refer to them by id
+            auto format = m_formats.find(e->record.format);
+            if (format == m_formats.end())
+            {
+                format = m_formats.insert({ e->record.format, uint32_t(m_formats.size()) }).first;
+                Kes::Log::Binary::appendFormat(m_text, format->second, e->record.format);
+            }
+
+            Kes::Log::Binary::appendRecord(m_text, e->level, e->time, format->second, e->record);
+        }
     }
     catch (...)
     {
-        // not much we can do here
+        return 0; // not much we can do here
     }
 
-    return true;
+    struct iovec iov = { m_text.data(), m_text.size() };
+    writeAll(m_file, &iov, 1);
+
+#if KES_DEBUG
+    flushText(entries, count, false);
+#endif
+
+    return count;
 }
 
-bool Logger::write(Kes::Log::Level level, const char* format, ...) noexcept
+void Logger::writeAll(int fd, struct iovec* iov, size_t count) noexcept
 {
-    if (level < m_level)
-        return true;
+    while (count > 0)
+    {
+        auto chunk = std::min(count, size_t(IOV_MAX));
+        auto written = ::writev(fd, iov, int(chunk));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
 
-    va_list args;
-    va_start(args, format);
+            return; // not much we can do here
+        }
 
-    auto result = writev(level, format, args);
+        // skip what has been written, adjust a partially written iovec
+        while ((count > 0) && (size_t(written) >= iov->iov_len))
+        {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
 
-    va_end(args);
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+}
 
-    return result;
+void Logger::maybeFsync(bool error) noexcept
+{
+    if (!m_dirty.load(std::memory_order_relaxed))
+        return;
+
+    bool sync = false;
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+    switch (m_options.fsync)
+    {
+    case FsyncPolicy::Always:
+        sync = true;
+        break;
+    case FsyncPolicy::Never:
+        break;
+    case FsyncPolicy::OnError:
+        sync = error;
+        break;
+    case FsyncPolicy::Periodic:
+        sync = error || (now - std::chrono::steady_clock::duration(m_lastFsync.load(std::memory_order_relaxed)) >= m_options.fsyncInterval);
+        break;
+    }
+
+    if (sync)
+    {
+        m_dirty = false;
+        ::fsync(m_file);
+        m_lastFsync.store(now.count(), std::memory_order_relaxed);
+    }
 }
 
 
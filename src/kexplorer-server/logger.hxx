@@ -1,8 +1,18 @@
 #pragma once
 
 
+#include <kesrv/condition.hxx>
 #include <kesrv/log.hxx>
 #include <kesrv/util/generichandle.hxx>
+#include <kesrv/util/mpscring.hxx>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/uio.h>
+#include <time.h>
 
 
 namespace Kes
@@ -12,17 +22,45 @@ namespace Private
 {
 
 
+enum class FsyncPolicy
+{
+    Always,     // after every record (the classic behavior)
+    Never,
+    Periodic,   // at most once per LoggerOptions::fsyncInterval
+    OnError     // only after Error/Fatal records
+};
+
+
+struct LoggerOptions
+{
+    bool async = false;
+    bool binary = false; // deferred formatting, implies async; see kexplorer-logdump
+    FsyncPolicy fsync = FsyncPolicy::Always;
+    std::chrono::milliseconds fsyncInterval = std::chrono::milliseconds(1000);
+    std::chrono::milliseconds flushInterval = std::chrono::milliseconds(50);
+    size_t queueSize = 8192;
+
+    LoggerOptions() noexcept = default;
+};
+
+
 class Logger final
     : public Kes::Log::ILog
     , public boost::noncopyable
 {
 public:
     ~Logger();
-    explicit Logger(Kes::Log::Level level, const char* fileName);
+    explicit Logger(Kes::Log::Level level, const char* fileName, const LoggerOptions& options = LoggerOptions());
 
     Kes::Log::Level level() const noexcept override;
     bool writev(Kes::Log::Level level, const char* format, va_list args) noexcept override;
     bool write(Kes::Log::Level level, const char* format, ...) noexcept override;
+    bool put(Kes::Log::Level level, Kes::Log::Record&& record) noexcept override;
+
+    uint64_t dropped() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
 
 private:
     struct FileCloser
@@ -35,8 +73,37 @@ private:
 
     using File = Util::GenericHandle<int, int, -1, FileCloser>;
 
+    struct Entry
+    {
+        Kes::Log::Level level = Kes::Log::Level::Info;
+        struct timespec time = {};
+        Kes::Log::Record record;
+    };
+
+    void writeSync(Kes::Log::Level level, const Kes::Log::Record& record) noexcept;
+    void writeAsync(Kes::Log::Level level, Kes::Log::Record&& record) noexcept;
+    void flusher() noexcept;
+    size_t flush() noexcept;
+    size_t flushText(Entry** entries, size_t count, bool toFile) noexcept;
+    size_t flushBinary(Entry** entries, size_t count) noexcept;
+    static void writeAll(int fd, struct iovec* iov, size_t count) noexcept;
+    void maybeFsync(bool error) noexcept;
+
     File m_file;
     Kes::Log::Level m_level = Kes::Log::Level::Info;
+    LoggerOptions m_options;
+    std::atomic<int64_t> m_lastFsync; // steady_clock ticks
+    std::atomic<bool> m_dirty = false;
+    std::atomic<uint64_t> m_dropped = 0;
+    uint64_t m_droppedReported = 0;
+    std::unique_ptr<Util::MpscRing<Entry>> m_ring;
+    Condition m_wakeup;
+    std::atomic<bool> m_stop = false;
+    std::atomic<bool> m_errorPending = false;
+    std::unique_ptr<std::thread> m_flusher;
+    // flusher thread only
+    std::string m_text;
+    std::unordered_map<const char*, uint32_t> m_formats; // format string pointer -> id in the binary log
 };
 
 
@@ -1,14 +1,22 @@
 #include <kesrv/condition.hxx>
 #include <kesrv/knownprops.hxx>
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/processmanager/cgroupmanager.hxx>
+#include <kesrv/processmanager/fdmanager.hxx>
 #include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/snapshotpublisher.hxx>
+#include <kesrv/processmanager/symbolmanager.hxx>
+#include <kesrv/processmanager/threadmanager.hxx>
 #include <kesrv/util/exceptionutil.hxx>
+#include <kesrv/util/netutil.hxx>
 
 #include "globalcmdhandler.hxx"
 #include "iorunner.hxx"
 #include "logger.hxx"
 #include "requestprocessor.hxx"
 #include "sessionhandler.hxx"
-#include "tcpserver.hxx"
+#include "socketserver.hxx"
+#include "statshandler.hxx"
 
 #include <iostream>
 #include <sstream>
@@ -73,6 +81,25 @@ void daemonize() noexcept
     ::umask(0);
 }
 
+Kes::Private::FsyncPolicy parseFsyncPolicy(const std::string& s, std::chrono::milliseconds& interval)
+{
+    if (s == "always")
+        return Kes::Private::FsyncPolicy::Always;
+    if (s == "never")
+        return Kes::Private::FsyncPolicy::Never;
+    if (s == "error")
+        return Kes::Private::FsyncPolicy::OnError;
+
+    // a number of milliseconds
+    char* end = nullptr;
+    auto ms = std::strtoul(s.c_str(), &end, 10);
+    if (!ms || (end && *end && std::strcmp(end, "ms")))
+        throw std::invalid_argument("Invalid fsync policy: " + s);
+
+    interval = std::chrono::milliseconds(ms);
+    return Kes::Private::FsyncPolicy::Periodic;
+}
+
 void terminateHandler()
 {
     std::ostringstream ss;
@@ -103,7 +130,20 @@ int main(int argc, char* argv[])
         ("help,h", "display this message")
         ("verbose,v", "display debug output")
         ("daemon,d", "run as a daemon")
-        ("address,a", po::value<std::string>(), "server bind address:port")
+        ("address,a", po::value<std::string>(), "server bind address:port, unix:/path or unix:@abstract-name")
+        ("log-async", "write the log from a background thread")
+        ("log-fsync", po::value<std::string>(), "log fsync policy: always|never|error|<N>ms")
+        ("log-format", po::value<std::string>(), "log format: text|binary (binary implies --log-async; read it with kexplorer-logdump)")
+        ("procfs-root", po::value<std::string>(), "procfs mount point (default /proc)")
+        ("cgroupfs-root", po::value<std::string>(), "cgroup v2 mount point (default /sys/fs/cgroup)")
+        ("symbol-cache", po::value<std::string>(), "keep the kernel symbol index in this file between runs")
+        ("capture", po::value<std::string>(), "record incoming requests into this file (replay it with kexplorer-ctl --replay)")
+        ("shm", po::value<std::string>()->implicit_value(std::string(Kes::Snapshot::DefaultName)), "publish the process table in this POSIX shared memory region")
+        ("shm-interval", po::value<unsigned>()->default_value(1000), "shared memory snapshot interval, ms")
+        ("shm-capacity", po::value<uint32_t>()->default_value(32768), "shared memory snapshot capacity, processes")
+        ("shm-group", po::value<std::string>(), "group allowed to read the shared memory snapshot (default: the server's user only)")
+        ("slow-interval", po::value<unsigned>()->default_value(10000), "refresh interval of the fields that are expensive to read (smaps_rollup), ms")
+        ("scan-budget", po::value<unsigned>()->default_value(50), "time a scan may spend on expensive reads, ms")
     ;
 
     po::variables_map vm;
@@ -123,10 +163,40 @@ int main(int argc, char* argv[])
 
     Kes::Log::Level logLevel = vm.count("verbose") ? Kes::Log::Level::Debug : Kes::Log::Level::Info;
 
+    Kes::Private::LoggerOptions logOptions;
+    logOptions.async = (vm.count("log-async") > 0);
+    if (vm.count("log-fsync"))
+    {
+        try
+        {
+            logOptions.fsync = parseFsyncPolicy(vm["log-fsync"].as<std::string>(), logOptions.fsyncInterval);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (vm.count("log-format"))
+    {
+        auto format = vm["log-format"].as<std::string>();
+        if (format == "binary")
+        {
+            logOptions.binary = true;
+            logOptions.async = true;
+        }
+        else if (format != "text")
+        {
+            std::cerr << "Invalid log format: " << format << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
 #if !KES_DEBUG
-    Kes::Private::Logger logger(logLevel, "/var/log/kexplorer-server.log");
+    Kes::Private::Logger logger(logLevel, logOptions.binary ? "/var/log/kexplorer-server.binlog" : "/var/log/kexplorer-server.log", logOptions);
 #else
-    Kes::Private::Logger logger(logLevel, "kexplorer-server.log");
+    Kes::Private::Logger logger(logLevel, logOptions.binary ? "kexplorer-server.binlog" : "kexplorer-server.log", logOptions);
 #endif
 
     g_log = &logger;
@@ -172,14 +242,77 @@ int main(int argc, char* argv[])
             }
         );
 
-        Kes::Private::RequestProcessor requestProcessor(&logger);
+        Kes::Metrics::Registry metrics;
+        Kes::Private::RequestProcessor requestProcessor(&logger, &metrics);
         Kes::Private::GlobalCmdHandler globalHandler(&requestProcessor, exitCondition, &logger);
-        Kes::Private::ProcessManager processManaher(&requestProcessor, &logger);
+        Kes::Private::StatsHandler statsHandler(&requestProcessor, &metrics, &logger);
+        std::string procFsRoot(Kes::ProcFs::ProcFs::DefaultRoot);
+        if (vm.count("procfs-root"))
+        {
+            procFsRoot = vm["procfs-root"].as<std::string>();
+            logger.write(Kes::Log::Level::Info, "Using procfs at %s", procFsRoot.c_str());
+        }
+
+        std::string cgroupRoot(Kes::Private::CgroupManager::DefaultRoot);
+        if (vm.count("cgroupfs-root"))
+        {
+            cgroupRoot = vm["cgroupfs-root"].as<std::string>();
+            logger.write(Kes::Log::Level::Info, "Using cgroupfs at %s", cgroupRoot.c_str());
+        }
+
+        std::string symbolCache;
+        if (vm.count("symbol-cache"))
+            symbolCache = vm["symbol-cache"].as<std::string>();
+
+        Kes::Private::RefreshOptions refreshOptions;
+        refreshOptions.slowInterval = std::chrono::milliseconds(vm["slow-interval"].as<unsigned>());
+        refreshOptions.scanBudget = std::chrono::milliseconds(vm["scan-budget"].as<unsigned>());
+
+        Kes::Private::ProcessManager processManaher(&requestProcessor, &logger, &metrics, procFsRoot, Kes::Private::ProcessManager::DefaultHistoryDepth, refreshOptions);
+        Kes::Private::ThreadManager threadManager(&requestProcessor, &logger, procFsRoot);
+        Kes::Private::FdManager fdManager(&requestProcessor, &logger, procFsRoot);
+        Kes::Private::CgroupManager cgroupManager(&requestProcessor, &logger, &processManaher, procFsRoot, cgroupRoot);
+        Kes::Private::SymbolManager symbolManager(&requestProcessor, &logger, procFsRoot, symbolCache);
+
+        std::unique_ptr<Kes::Private::SnapshotPublisher> snapshot;
+        if (vm.count("shm"))
+        {
+            Kes::Private::SnapshotOptions snapshotOptions;
+            snapshotOptions.name = vm["shm"].as<std::string>();
+            snapshotOptions.interval = std::chrono::milliseconds(std::max(vm["shm-interval"].as<unsigned>(), 1u));
+            snapshotOptions.capacity = vm["shm-capacity"].as<uint32_t>();
+            snapshotOptions.stringCapacity = uint64_t(snapshotOptions.capacity) * 256;
+            if (vm.count("shm-group"))
+                snapshotOptions.group = vm["shm-group"].as<std::string>();
+
+            snapshot.reset(new Kes::Private::SnapshotPublisher(&logger, &processManaher, procFsRoot, snapshotOptions));
+            snapshot->start();
+        }
 
         const size_t bufferSize = 65536;
         const size_t bufferLimit = 65536;
-        Kes::Private::SessionHandlerOptions sho(bufferSize, bufferLimit, &requestProcessor, &logger);
-        Kes::Private::TcpServer<Kes::Private::SessionHandler, Kes::Private::SessionHandlerOptions> server(runner->io_context(), sho, bindAddr.c_str(), bufferSize, &logger);
+        std::unique_ptr<Kes::Capture::Writer> capture;
+        if (vm.count("capture"))
+        {
+            auto captureFile = vm["capture"].as<std::string>();
+            capture.reset(new Kes::Capture::Writer(captureFile.c_str()));
+            logger.write(Kes::Log::Level::Info, "Capturing requests into %s", captureFile.c_str());
+        }
+
+        Kes::Private::SessionHandlerOptions sho(bufferSize, bufferLimit, &requestProcessor, &logger, capture.get());
+
+        // the transport is picked by the address form; both share the session code
+        std::shared_ptr<void> server;
+        if (Kes::Util::isLocalAddress(bindAddr))
+        {
+            using LocalServer = Kes::Private::SocketServer<Kes::Private::SessionHandler, Kes::Private::SessionHandlerOptions, boost::asio::local::stream_protocol>;
+            server = std::make_shared<LocalServer>(io, sho, Kes::Util::localEndpointFromString(bindAddr), bufferSize, &logger, &metrics);
+        }
+        else
+        {
+            using TcpServer = Kes::Private::SocketServer<Kes::Private::SessionHandler, Kes::Private::SessionHandlerOptions, boost::asio::ip::tcp>;
+            server = std::make_shared<TcpServer>(io, sho, Kes::Util::endpointFromString(bindAddr), bufferSize, &logger, &metrics);
+        }
 
         exitCondition.wait();
         if (signalReceived)
@@ -1,8 +1,11 @@
 #include "requestprocessor.hxx"
 
 #include <kesrv/exception.hxx>
+#include <kesrv/trace/trace.hxx>
 #include <kesrv/util/requestutil.hxx>
 
+#include <optional>
+
 
 namespace Kes
 {
@@ -45,14 +48,32 @@ private:
 
 
 std::string RequestProcessor::process(uint32_t sessionId, char* request, [[maybe_unused]] size_t length)
+{
+    size_t command = Metrics::Registry::UnknownCommand;
+    bool failed = true;
+
+    auto response = process(sessionId, request, command, failed);
+
+    if (m_metrics)
+        m_metrics->countRequest(command, failed);
+
+    return response;
+}
+
+std::string RequestProcessor::process(uint32_t sessionId, char* request, size_t& command, bool& failed)
 {
     try
     {
         LogDebug(m_log, "\n-> %s\n", request);
 
+        // the metrics time every request; whether this one is traced is only known once it is parsed
+        auto started = m_metrics ? Util::Clock::ticks() : 0;
+
         JsonErrorHandler eh(m_log);
         auto parsedRequest = propertyBagFromJson(request, &eh);
         
+        auto parsed = m_metrics ? Util::Clock::ticks() : 0;
+
         if (!parsedRequest.isTable())
         {
             m_log->write(Log::Level::Error, "RequestProcessor: request is not a JSON object");
@@ -79,13 +100,33 @@ std::string RequestProcessor::process(uint32_t sessionId, char* request, [[maybe
 
         auto key = std::any_cast<std::string>(requestKeyIt->second->property().value);
 
+        // the trace context only exists for requests that ask for it
+        std::optional<Trace::Context> trace;
+        auto traceIt = parsedRequest.table().find(Kes::Request::Props::Trace::idstr());
+        if ((traceIt != parsedRequest.table().end()) && traceIt->second->isProperty() && std::any_cast<bool>(traceIt->second->property().value))
+        {
+            // without the metrics the parse is taken to start where the session found the end of the request
+            if (!m_metrics)
+            {
+                started = Trace::frame().framed;
+                parsed = Util::Clock::ticks();
+            }
+
+            trace.emplace(Trace::frame(), started, parsed);
+        }
+
         {
             PropertyBag response{std::string(), PropertyBag::Table()};
 
             bool handlerFound = false;
             {
+                Trace::Context::Activate activate(trace ? &*trace : nullptr);
                 std::lock_guard l(m_mutex);
 
+                auto commandIt = m_commandIds.find(key);
+                if (commandIt != m_commandIds.end())
+                    command = commandIt->second;
+
                 auto range = m_handlers.equal_range(key);
                 for (auto it = range.first; it != range.second; ++it)
                 {
@@ -100,10 +141,30 @@ std::string RequestProcessor::process(uint32_t sessionId, char* request, [[maybe
                 return Util::Response::fail(requestId, "Unsupported request");
             }
 
+            auto timed = m_metrics || trace;
+            auto handled = timed ? Util::Clock::ticks() : 0;
+
             auto out = propertyBagToJson(response);
 
+            auto serialized = timed ? Util::Clock::ticks() : 0;
+
+            if (m_metrics)
+            {
+                m_metrics->recordStage(command, Metrics::Stage::Parse, Util::Clock::nanoseconds(parsed - started));
+                m_metrics->recordStage(command, Metrics::Stage::Handler, Util::Clock::nanoseconds(handled - parsed));
+                m_metrics->recordStage(command, Metrics::Stage::Serialize, Util::Clock::nanoseconds(serialized - handled));
+            }
+
+            if (trace)
+            {
+                trace->handled(handled);
+                trace->serialized(serialized);
+                trace->appendTo(out);
+            }
+
             LogDebug(m_log, "\n<- %s\n", out.c_str());
 
+            failed = false;
             return out;
         }
     }
@@ -123,6 +184,9 @@ void RequestProcessor::registerHandler(const char* key, IRequestHandler* handler
 
     m_handlers.insert({ key, handler });
 
+    if (m_metrics && (m_commandIds.find(key) == m_commandIds.end()))
+        m_commandIds.insert({ key, m_metrics->registerCommand(key) });
+
     m_log->write(Log::Level::Info, "RequestProcessor: registered handler %p for %s", handler, key);
 }
 
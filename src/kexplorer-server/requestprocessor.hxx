@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kesrv/log.hxx>
+#include <kesrv/metrics/metrics.hxx>
 #include <kesrv/requestprocessor.hxx>
 
 #include <mutex>
@@ -19,8 +20,9 @@ class RequestProcessor final
     , public boost::noncopyable
 {
 public:
-    explicit RequestProcessor(Log::ILog* log)
+    explicit RequestProcessor(Log::ILog* log, Metrics::Registry* metrics)
         : m_log(log)
+        , m_metrics(metrics)
     {
     }
 
@@ -31,9 +33,13 @@ public:
     void endSession(uint32_t id) override;
 
 private:
+     std::string process(uint32_t sessionId, char* request, size_t& command, bool& failed);
+
      Log::ILog* m_log;
+     Metrics::Registry* m_metrics;
      std::mutex m_mutex;
      std::unordered_multimap<std::string, IRequestHandler*> m_handlers;
+     std::unordered_map<std::string, size_t> m_commandIds; // metrics ids
 };
 
 
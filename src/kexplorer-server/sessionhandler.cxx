@@ -2,6 +2,7 @@
 #include "sessionhandler.hxx"
 
 #include <kesrv/exception.hxx>
+#include <kesrv/trace/trace.hxx>
 
 
 namespace Kes
@@ -13,6 +14,9 @@ namespace Private
 SessionHandler::~SessionHandler()
 {
     m_options.requestProcessor->endSession(m_id);
+
+    if (m_options.capture)
+        m_options.capture->sessionFinished(m_id);
 }
 
 SessionHandler::SessionHandler(const SessionHandlerOptions& options, const std::string& peerAddr, uint32_t id)
@@ -21,6 +25,9 @@ SessionHandler::SessionHandler(const SessionHandlerOptions& options, const std::
     , m_id(id)
     , m_buffer(options.bufferSize, options.bufferLimit)
 {
+    if (m_options.capture)
+        m_options.capture->sessionStarted(m_id);
+
     m_options.requestProcessor->startSession(m_id);
 }
 
@@ -35,69 +42,83 @@ std::pair<CallbackResult, std::string> SessionHandler::process(const char* data,
 
     try
     {
-        auto posPrev = m_buffer.used();
+        if (!m_framer.inProgress())
+            m_frame = { Util::Clock::ticks(), 0, 0 };
 
         if (!m_buffer.push(data, size))
             throw Exception(KES_HERE(), "Packet size exceeds limit");
 
-        auto posCur = m_buffer.used();
-
-        if (posCur == posPrev)
+        // a chunk may carry several pipelined requests; their responses are sent together
+        auto detectionStarted = Util::Clock::ticks();
+        auto pos = m_scanned;
+        for (;;)
         {
-            // nothing to process
-            return std::make_pair(CallbackResult::Continue, response);
-        }
+            auto end = m_framer.next(m_buffer.data(), pos, m_buffer.used());
+            if (end == Util::JsonFramer::Incomplete)
+                break;
 
-        auto cur = m_buffer.data() + posPrev;
-        auto end = m_buffer.data() + posCur;
-        while (cur < end)
-        {
-            if (*cur == '{')
-            {
-                ++m_jsonDepth;
-                if (m_jsonDepth > m_jsonDepthMax)
-                    m_jsonDepthMax = m_jsonDepth;
-            }
-            else if (*cur == '}')
-            {
-                if (m_jsonDepth == 0)
-                    throw Exception(KES_HERE(), "Invalid JSON");
-
-                --m_jsonDepth;
-            }
-
-            ++cur;
-        }
+            m_frame.framed = Util::Clock::ticks();
+            m_frame.detection += m_frame.framed - detectionStarted;
 
-        if (m_jsonDepth == 0)
-        {
-            // JSON complete
-            if (m_jsonDepthMax == 0)
-            {
-                // nothing to process
-                return std::make_pair(CallbackResult::Continue, response);
-            }
+            response.append(processRequest(end));
 
-            m_buffer.push("", 1); // append '\0'
+            // the request behind this one has waited for it: its frame starts now
+            pos = 0;
+            m_frame = { Util::Clock::ticks(), 0, 0 };
+            detectionStarted = m_frame.received;
+        }
 
-            response = m_options.requestProcessor->process(m_id, m_buffer.data(), posCur);
+        m_frame.detection += Util::Clock::ticks() - detectionStarted;
 
-            m_buffer.pop(posCur + 1); // also pop '\0'
-            m_jsonDepthMax = 0;
-        }
+        m_scanned = m_buffer.used();
     }
     catch (std::exception& e)
     {
         m_options.log->write(Kes::Log::Level::Error, "SessionHandler: failed to process the request: %s", e.what());
         m_buffer.reset();
-        m_jsonDepth = 0;
-        m_jsonDepthMax = 0;
+        m_framer.reset();
+        m_scanned = 0;
         return std::make_pair(CallbackResult::Abort, response); // server should reset the connection in this case
     }
 
     return std::make_pair(CallbackResult::Continue, response);
 }
 
+std::string SessionHandler::processRequest(size_t length)
+{
+    // the request is parsed in place and has to be zero-terminated
+    bool last = (length == m_buffer.used());
+    char saved = 0;
+    if (last)
+    {
+        m_buffer.push("", 1);
+    }
+    else
+    {
+        saved = m_buffer.data()[length];
+        m_buffer.data()[length] = '\0';
+    }
+
+    // captured before the in situ parse trashes the request
+    if (m_options.capture)
+        m_options.capture->request(m_id, m_frame.received, m_buffer.data(), length);
+
+    Trace::setFrame(m_frame);
+    auto response = m_options.requestProcessor->process(m_id, m_buffer.data(), length);
+
+    if (last)
+    {
+        m_buffer.pop(length + 1); // also pop '\0'
+    }
+    else
+    {
+        m_buffer.data()[length] = saved;
+        m_buffer.pop(length);
+    }
+
+    return response;
+}
+
 
 } // namespace Private {}
 
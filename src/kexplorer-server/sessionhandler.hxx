@@ -1,7 +1,10 @@
 #pragma once
 
+#include <kesrv/capture.hxx>
 #include <kesrv/log.hxx>
+#include <kesrv/trace/trace.hxx>
 #include <kesrv/util/continuousbuffer.hxx>
+#include <kesrv/util/jsonframer.hxx>
 
 
 namespace Kes
@@ -17,12 +20,14 @@ struct SessionHandlerOptions
     size_t bufferLimit;
     IRequestProcessor* requestProcessor;
     Kes::Log::ILog* log;
+    Kes::Capture::Writer* capture;  // optional
 
-    explicit SessionHandlerOptions(size_t bufferSize, size_t bufferLimit, IRequestProcessor* requestProcessor, Kes::Log::ILog* log)
+    explicit SessionHandlerOptions(size_t bufferSize, size_t bufferLimit, IRequestProcessor* requestProcessor, Kes::Log::ILog* log, Kes::Capture::Writer* capture)
         : bufferSize(bufferSize)
         , bufferLimit(bufferLimit)
         , requestProcessor(requestProcessor)
         , log(log)
+        , capture(capture)
     {}
 };
 
@@ -39,12 +44,15 @@ public:
     const std::string& peer() const noexcept { return m_peerAddr; }
 
 private:
+    std::string processRequest(size_t length);
+
     SessionHandlerOptions m_options;
     std::string m_peerAddr;
     uint32_t m_id;
     Kes::Util::ContinuousBuffer m_buffer;
-    size_t m_jsonDepth = 0;
-    size_t m_jsonDepthMax = 0;
+    Trace::Frame m_frame;
+    Kes::Util::JsonFramer m_framer;
+    size_t m_scanned = 0;       // bytes of m_buffer already seen by m_framer
 };
 
 
@@ -0,0 +1,589 @@
+#pragma once
+
+#include <kesrv/exception.hxx>
+#include <kesrv/log.hxx>
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/util/format.hxx>
+#include <kesrv/util/netutil.hxx>
+#include <kesrv/util/readbuffer.hxx>
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+//
+// what differs between the transports: how a peer is described and what a listening address
+// leaves behind
+//
+
+template <class ProtocolT>
+struct SocketTraits;
+
+template <>
+struct SocketTraits<boost::asio::ip::tcp>
+{
+    static std::string describe(const boost::asio::ip::tcp::endpoint& endpoint)
+    {
+        return endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+    }
+
+    static std::string peer(boost::asio::ip::tcp::socket& socket)
+    {
+        return socket.remote_endpoint().address().to_string();
+    }
+
+    static void prepare(const boost::asio::ip::tcp::endpoint&) noexcept
+    {
+    }
+
+    static void cleanup(const boost::asio::ip::tcp::endpoint&) noexcept
+    {
+    }
+};
+
+template <>
+struct SocketTraits<boost::asio::local::stream_protocol>
+{
+    static bool isAbstract(const boost::asio::local::stream_protocol::endpoint& endpoint) noexcept
+    {
+        auto path = endpoint.path();
+        return path.empty() || (path[0] == '\0');
+    }
+
+    static std::string describe(const boost::asio::local::stream_protocol::endpoint& endpoint)
+    {
+        auto path = endpoint.path();
+        if (isAbstract(endpoint) && !path.empty())
+            path[0] = '@';
+
+        return "unix:" + path;
+    }
+
+    // unix peers have no address worth logging, their credentials are
+    static std::string peer(boost::asio::local::stream_protocol::socket& socket)
+    {
+        struct ucred cred = {};
+        socklen_t length = sizeof(cred);
+        if (::getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &cred, &length) == -1)
+            return "unix:?";
+
+        return "unix:pid=" + std::to_string(cred.pid) + ",uid=" + std::to_string(cred.uid) + ",gid=" + std::to_string(cred.gid);
+    }
+
+    // a socket file left over by a previous instance would make bind() fail; it is removed only
+    // if it is a socket nobody listens on, anything else at the path fails the bind
+    static void prepare(const boost::asio::local::stream_protocol::endpoint& endpoint)
+    {
+        if (isAbstract(endpoint))
+            return;
+
+        auto path = endpoint.path();
+        if (auto reason = removeStale(path))
+            throw Kes::Exception(KES_HERE(), Util::format("Cannot listen on %s: %s", path.c_str(), reason));
+    }
+
+    // our own socket is closed by now, so it looks stale; one another instance bound since is kept
+    static void cleanup(const boost::asio::local::stream_protocol::endpoint& endpoint) noexcept
+    {
+        if (!isAbstract(endpoint))
+            removeStale(endpoint.path());
+    }
+
+    // nullptr if the path is free now, otherwise why it was left alone
+    static const char* removeStale(const std::string& path) noexcept
+    {
+        struct stat st = {};
+        if (::lstat(path.c_str(), &st) == -1)
+            return (errno == ENOENT) ? nullptr : "the path is not accessible";
+
+        if (!S_ISSOCK(st.st_mode))
+            return "the path exists and is not a socket";
+
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path))
+            return "the path is too long";
+
+        std::memcpy(addr.sun_path, path.data(), path.size());
+
+        // only a refused connection proves there is no listener; a full backlog says EAGAIN
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            return "failed to create a probe socket";
+
+        auto connected = (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0);
+        auto error = errno;
+        ::close(fd);
+
+        if (connected)
+            return "another server is listening on it";
+
+        if (error != ECONNREFUSED)
+            return "the socket could not be probed";
+
+        if ((::unlink(path.c_str()) == -1) && (errno != ENOENT))
+            return "failed to remove the stale socket";
+
+        return nullptr;
+    }
+};
+
+
+template <class SessionHandlerT, class SessionHandlerArgsT, class ProtocolT = boost::asio::ip::tcp>
+class SocketServer final
+    : public boost::noncopyable
+{
+public:
+    using SessionHandler = SessionHandlerT;
+    using SessionHandlerArgs = SessionHandlerArgsT;
+    using Protocol = ProtocolT;
+    using Socket = typename Protocol::socket;
+    using Endpoint = typename Protocol::endpoint;
+    using Traits = SocketTraits<Protocol>;
+
+    ~SocketServer()
+    {
+        m_log->write(Kes::Log::Level::Debug, "SocketServer: shutting down");
+
+        m_stop = true;
+
+        boost::system::error_code ec;
+        m_retryTimer.cancel(ec);
+
+        for (auto& session: m_sessions)
+        {
+            session->close();
+        }
+
+        m_acceptor.cancel(ec);
+        m_acceptor.close(ec);
+
+        Traits::cleanup(m_endpoint);
+    }
+
+    explicit SocketServer(
+        boost::asio::io_context& io,
+        const SessionHandlerArgs& sessionHandlerArgs,
+        const Endpoint& endpoint,
+        size_t inBufferSize,
+        Kes::Log::ILog* log,
+        Kes::Metrics::Registry* metrics
+    )
+        : m_sessionHandlerArgs(sessionHandlerArgs)
+        , m_inBufferSize(inBufferSize)
+        , m_log(log)
+        , m_metrics(metrics)
+        , m_io(io)
+        , m_retryTimer(m_io)
+        , m_strand(m_io)
+        , m_endpoint(endpoint)
+        , m_acceptor(m_io)
+    {
+        m_log->write(Kes::Log::Level::Debug, "SocketServer: starting on %s", Traits::describe(m_endpoint).c_str());
+
+        Traits::prepare(m_endpoint);
+
+        m_acceptor.open(m_endpoint.protocol());
+        m_acceptor.set_option(typename Protocol::acceptor::reuse_address(true));
+        m_acceptor.bind(m_endpoint);
+        m_acceptor.listen();
+
+        accept();
+    }
+
+    void removeSession(uint32_t id) noexcept
+    {
+        std::lock_guard l(m_mutex);
+
+        for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+        {
+            if (it->get()->id() == id)
+            {
+                m_sessions.erase(it);
+                break;
+            }
+        }
+    }
+
+private:
+    class Session final
+    {
+    public:
+        using Ptr = std::shared_ptr<Session>;
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        Session(Session&&) = delete;
+        Session& operator=(Session&&) = delete;
+
+        ~Session()
+        {
+            if (m_metrics)
+                m_metrics->sessionFinished();
+
+            m_log->write(Kes::Log::Level::Debug, "SocketServer: session %d destroyed", m_id);
+        }
+
+        explicit Session(
+            SocketServer* owner,
+            const SessionHandlerArgs& sessionHandlerArgs,
+            size_t inBufferSize,
+            boost::asio::io_context& io,
+            std::shared_ptr<Socket> socket,
+            Kes::Log::ILog* log,
+            Kes::Metrics::Registry* metrics
+            )
+            : m_owner(owner)
+            , m_sessionHandlerArgs(sessionHandlerArgs)
+            , m_inBufferSize(inBufferSize)
+            , m_log(log)
+            , m_metrics(metrics)
+            , m_io(io)
+            , m_strand(io)
+            , m_socket(socket)
+            , m_id(makeNextId())
+        {
+            if (m_metrics)
+                m_metrics->sessionStarted();
+
+            m_log->write(Kes::Log::Level::Debug, "SocketServer: session %d created", m_id);
+        }
+
+        static Ptr create(
+            SocketServer* owner,
+            const SessionHandlerArgs& sessionHandlerArgs,
+            size_t inBufferSize,
+            boost::asio::io_context& io,
+            std::shared_ptr<Socket> socket,
+            Kes::Log::ILog* log,
+            Kes::Metrics::Registry* metrics
+        ) noexcept
+        {
+            try
+            {
+                return std::make_shared<Session>(
+                    owner,
+                    sessionHandlerArgs,
+                    inBufferSize,
+                    io,
+                    socket,
+                    log,
+                    metrics
+                );
+            }
+            catch (std::exception& e)
+            {
+                log->write(Kes::Log::Level::Error, "SocketServer: failed to create session: %s", e.what());
+                return Ptr();
+            }
+        }
+
+        void close() noexcept
+        {
+            if (m_sessionHandler)
+            {
+                m_sessionHandler->close();
+            }
+
+            if (m_socket->is_open())
+            {
+                boost::system::error_code ec;
+                m_socket->shutdown(Socket::shutdown_send, ec);
+                m_socket->close(ec);
+            }
+        }
+
+        std::optional<uint32_t> start() noexcept
+        {
+            try
+            {
+                auto peerAddr = Traits::peer(*m_socket);
+
+                m_sessionHandler.reset(new SessionHandler(m_sessionHandlerArgs, peerAddr, m_id));
+
+                read(nullptr);
+
+                m_log->write(Kes::Log::Level::Debug, "SocketServer: session %d started with [%s]", m_id, peerAddr.c_str());
+            }
+            catch (std::exception& e)
+            {
+                m_log->write(Kes::Log::Level::Error, "SocketServer: failed to start session: %s", e.what());
+                return std::nullopt;
+            }
+
+            return m_id;
+        }
+
+        uint32_t id() const noexcept
+        {
+            return m_id;
+        }
+
+    private:
+        bool read(Kes::Util::ReadBuffer::Ptr buffer) noexcept
+        {
+            try
+            {
+                if (!buffer)
+                {
+                    buffer = Kes::Util::ReadBuffer::create(m_inBufferSize);
+                }
+
+                m_socket->async_read_some(
+                    boost::asio::buffer(buffer->data(buffer->w_index()), buffer->size()),
+                    m_strand.wrap(
+                        [this, buffer](const boost::system::error_code& ec, size_t transferred)
+                        {
+                            this->onRead(ec, transferred, buffer);
+                        }
+                    )
+                );
+
+            }
+            catch (std::exception& e)
+            {
+                m_log->write(Kes::Log::Level::Error, "SocketServer: failed to receive data: %s", e.what());
+
+                close();
+                m_owner->removeSession(m_id);
+
+                return false;
+            }
+
+            return true;
+        }
+
+        void onRead(const boost::system::error_code& ec, size_t transferred, Kes::Util::ReadBuffer::Ptr buffer) noexcept
+        {
+            if (ec)
+            {
+                m_log->write(Kes::Log::Level::Warning, "SocketServer: read() failed: %s", ec.message().c_str());
+
+                close();
+                m_owner->removeSession(m_id);
+            }
+            else
+            {
+#if KES_DEBUG
+                m_log->write(Kes::Log::Level::Debug, "SocketServer: received  %d bytes", transferred);
+#endif
+
+                if (m_metrics)
+                    m_metrics->countBytesIn(transferred);
+
+                buffer->swap();
+
+                // start another read immediately
+                read(buffer);
+
+                // this MUST be noexcept
+                auto result = m_sessionHandler->process(buffer->data(buffer->r_index()), transferred);
+                if (result.first == CallbackResult::Abort)
+                {
+                    // abort connection
+                    close();
+                    m_owner->removeSession(m_id);
+                }
+                else
+                {
+                    write(std::make_shared<std::string>(std::move(result.second)));
+                }
+            }
+        }
+
+        // responses are written one at a time: concurrent async_write()s could interleave
+        void write(std::shared_ptr<std::string> buffer) noexcept
+        {
+            if (buffer->empty())
+                return; // incomplete request
+
+            try
+            {
+                m_writeQueue.push_back({ std::move(buffer), m_metrics ? Kes::Metrics::now() : 0 });
+            }
+            catch (std::exception& e)
+            {
+                m_log->write(Kes::Log::Level::Error, "SocketServer: failed to send data: %s", e.what());
+
+                close();
+                m_owner->removeSession(m_id);
+                return;
+            }
+
+            if (m_writeQueue.size() == 1)
+                writeNext();
+        }
+
+        void writeNext() noexcept
+        {
+            try
+            {
+                auto& pending = m_writeQueue.front();
+
+                boost::asio::async_write(
+                    *m_socket,
+                    boost::asio::const_buffer(pending.data->data(), pending.data->size()),
+                    m_strand.wrap(
+                        [this, data = pending.data, started = pending.started](const boost::system::error_code& ec, size_t transferred)
+                        {
+                            this->onWrite(ec, transferred, started);
+                        }
+                    )
+                );
+            }
+            catch (std::exception& e)
+            {
+                m_log->write(Kes::Log::Level::Error, "SocketServer: failed to send data: %s", e.what());
+
+                close();
+                m_owner->removeSession(m_id);
+            }
+        }
+
+        void onWrite(const boost::system::error_code& ec, size_t transferred, uint64_t started) noexcept
+        {
+            if (ec)
+            {
+                m_log->write(Kes::Log::Level::Error, "SocketServer: write() failed: %s", ec.message().c_str());
+
+                m_writeQueue.clear();
+
+                close();
+                m_owner->removeSession(m_id);
+            }
+            else
+            {
+#if KES_DEBUG
+                m_log->write(Kes::Log::Level::Debug, "SocketServer: sent  %d bytes", transferred);
+#endif
+
+                // the latency includes the time spent behind earlier responses
+                if (m_metrics)
+                    m_metrics->recordWrite(Kes::Metrics::now() - started, transferred);
+
+                m_writeQueue.pop_front();
+                if (!m_writeQueue.empty())
+                    writeNext();
+            }
+        }
+
+        static uint32_t makeNextId() noexcept
+        {
+            static std::atomic<uint32_t> nextId = 0;
+            return nextId++;
+        }
+
+        SocketServer* m_owner;
+        std::unique_ptr<SessionHandler> m_sessionHandler;
+        const SessionHandlerArgs& m_sessionHandlerArgs;
+        size_t m_inBufferSize;
+        Kes::Log::ILog* m_log;
+        Kes::Metrics::Registry* m_metrics;
+        boost::asio::io_context& m_io;
+        boost::asio::io_service::strand m_strand;
+        std::shared_ptr<Socket> m_socket;
+        uint32_t m_id;
+
+        struct PendingWrite
+        {
+            std::shared_ptr<std::string> data;
+            uint64_t started;
+        };
+
+        std::deque<PendingWrite> m_writeQueue;
+    };
+
+    void accept() noexcept
+    {
+        auto socket = std::make_shared<Socket>(m_io);
+        m_acceptor.async_accept(
+            *socket,
+            m_strand.wrap(
+                [this, socket](const boost::system::error_code& ec)
+                {
+                    onAccept(socket, ec);
+                }
+            )
+        );
+    }
+
+    void onAccept(std::shared_ptr<Socket> socket, const boost::system::error_code& ec) noexcept
+    {
+        if (m_stop)
+            return;
+
+        if (ec)
+        {
+            m_log->write(Kes::Log::Level::Error, "SocketServer: accept() failed: %s", ec.message().c_str());
+
+            // retry after 1 second
+            m_retryTimer.expires_from_now(boost::posix_time::milliseconds(1000));
+            m_retryTimer.async_wait(
+                [this](const boost::system::error_code& e)
+                {
+                    if (!e && !m_stop)
+                        accept();
+                }
+            );
+
+        }
+        else
+        {
+            m_log->write(Kes::Log::Level::Debug, "SocketServer: connection accepted");
+
+            // continue accepting clients
+            accept();
+
+            auto session = Session::create(this, m_sessionHandlerArgs, m_inBufferSize, m_io, socket, m_log, m_metrics);
+            if (!session)
+                return;
+
+            {
+                std::lock_guard l(m_mutex);
+                m_sessions.push_back(session);
+            }
+
+            if (!session->start().has_value())
+            {
+                session->close();
+                removeSession(session->id());
+            }
+        }
+    }
+
+    SessionHandlerArgs m_sessionHandlerArgs;
+    size_t m_inBufferSize;
+    Kes::Log::ILog* m_log;
+    Kes::Metrics::Registry* m_metrics;
+    boost::asio::io_context& m_io;
+    boost::asio::deadline_timer m_retryTimer;
+    boost::asio::io_service::strand m_strand;
+    Endpoint m_endpoint;
+    typename Protocol::acceptor m_acceptor;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::vector<typename Session::Ptr> m_sessions;
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
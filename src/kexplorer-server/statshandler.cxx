@@ -0,0 +1,137 @@
+#include "statshandler.hxx"
+
+#include <kesrv/metrics/metricsprops.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+
+namespace Kes
+{
+
+namespace Private
+{
+
+namespace
+{
+
+const char* const s_commands[] =
+{
+    "stats"
+};
+
+template <typename PropertyInfoT>
+void addHistogram(PropertyBag& table, const Metrics::Histogram& h)
+{
+    if (!h.count())
+        return;
+
+    PropertyBag histogram{PropertyInfoT::idstr(), PropertyBag::Table()};
+
+    Util::addToTable<MetricsProps::Count>(histogram, h.count());
+    Util::addToTable<MetricsProps::Min>(histogram, h.min());
+    Util::addToTable<MetricsProps::Mean>(histogram, h.mean());
+    Util::addToTable<MetricsProps::P50>(histogram, h.percentile(0.5));
+    Util::addToTable<MetricsProps::P99>(histogram, h.percentile(0.99));
+    Util::addToTable<MetricsProps::P999>(histogram, h.percentile(0.999));
+    Util::addToTable<MetricsProps::Max>(histogram, h.max());
+
+    Util::addToTable<PropertyInfoT>(table, std::move(histogram));
+}
+
+void addStages(PropertyBag& table, const Metrics::Histogram* stages)
+{
+    addHistogram<MetricsProps::Parse>(table, stages[size_t(Metrics::Stage::Parse)]);
+    addHistogram<MetricsProps::Handler>(table, stages[size_t(Metrics::Stage::Handler)]);
+    addHistogram<MetricsProps::Serialize>(table, stages[size_t(Metrics::Stage::Serialize)]);
+}
+
+} // namespace {}
+
+StatsHandler::~StatsHandler()
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->unregisterHandler(cmd, this);
+    }
+}
+
+StatsHandler::StatsHandler(IRequestProcessor* rp, Metrics::Registry* metrics, Log::ILog* log)
+    : m_rp(rp)
+    , m_metrics(metrics)
+    , m_log(log)
+{
+    for (auto cmd: s_commands)
+    {
+        m_rp->registerHandler(cmd, this);
+    }
+}
+
+bool StatsHandler::process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response)
+{
+    assert(request.isTable());
+    assert(response.isTable());
+
+    if (!std::strcmp(key, "stats"))
+    {
+        LogDebug(m_log, "StatsHandler: [stats] command received");
+
+        auto snapshot = m_metrics->snapshot();
+
+        {
+            PropertyBag commandArray{MetricsProps::CommandList::idstr(), PropertyBag::Array()};
+
+            for (auto& command: snapshot.commands)
+            {
+                if (!command.requests)
+                    continue;
+
+                PropertyBag table{std::string(), PropertyBag::Table()};
+                Util::addToTable<MetricsProps::Name>(table, command.name);
+                Util::addToTable<MetricsProps::Requests>(table, command.requests);
+                Util::addToTable<MetricsProps::Errors>(table, command.errors);
+                addStages(table, command.stages);
+
+                Util::addToArray<MetricsProps::Command>(commandArray, std::move(table));
+            }
+
+            Util::addToTable<MetricsProps::CommandList>(response, std::move(commandArray));
+        }
+
+        {
+            PropertyBag stages{MetricsProps::Stages::idstr(), PropertyBag::Table()};
+            addStages(stages, snapshot.stages);
+            addHistogram<MetricsProps::Write>(stages, snapshot.write);
+
+            Util::addToTable<MetricsProps::Stages>(response, std::move(stages));
+        }
+
+        addHistogram<MetricsProps::Scan>(response, snapshot.scan);
+        Util::addToTable<MetricsProps::ScanProcesses>(response, snapshot.scanProcesses);
+        Util::addToTable<MetricsProps::BytesIn>(response, snapshot.bytesIn);
+        Util::addToTable<MetricsProps::BytesOut>(response, snapshot.bytesOut);
+        Util::addToTable<MetricsProps::ActiveSessions>(response, snapshot.sessionsActive);
+        Util::addToTable<MetricsProps::TotalSessions>(response, snapshot.sessionsTotal);
+
+        Util::addToTable<Kes::Request::Props::Id>(response, id);
+        Util::addToTable<Kes::Response::Props::Status>(response, std::string(Kes::Response::Success));
+
+        return true;
+    }
+
+    m_log->write(Log::Level::Error, "StatsHandler: unknown command [%s]", key);
+
+    return false;
+}
+
+void StatsHandler::startSession(uint32_t id)
+{
+
+}
+
+void StatsHandler::endSession(uint32_t id)
+{
+
+}
+
+} // namespace Private {}
+
+} // namespace Kes {}
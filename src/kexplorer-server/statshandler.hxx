@@ -0,0 +1,34 @@
+#pragma once
+
+#include <kesrv/log.hxx>
+#include <kesrv/metrics/metrics.hxx>
+#include <kesrv/requestprocessor.hxx>
+
+namespace Kes
+{
+
+namespace Private
+{
+
+class StatsHandler final
+    : public IRequestHandler
+    , public boost::noncopyable
+{
+public:
+    ~StatsHandler();
+    explicit StatsHandler(IRequestProcessor* rp, Metrics::Registry* metrics, Log::ILog* log);
+
+    bool process(uint32_t sessionId, const char* key, Kes::Request::Id id, const PropertyBag& request, PropertyBag& response) override;
+    void startSession(uint32_t id) override;
+    void endSession(uint32_t id) override;
+
+private:
+    IRequestProcessor* m_rp;
+    Metrics::Registry* m_metrics;
+    Log::ILog* m_log;
+};
+
+
+} // namespace Private {}
+
+} // namespace Kes {}
@@ -0,0 +1,98 @@
+#include "common.hpp"
+
+#include <kesrv/capture.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/util/clock.hxx>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+
+TEST(Kes_Capture, roundTrip)
+{
+    auto fileName = "/tmp/kestests-" + std::to_string(::getpid()) + "-capture";
+
+    {
+        Kes::Capture::Writer writer(fileName.c_str());
+        writer.sessionStarted(1);
+
+        // received well before it is recorded
+        auto received = Kes::Util::Clock::ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        const char request[] = "{\"request.request\":\"list_processes\",\"request.id\":1}";
+        writer.request(1, received, request, sizeof(request) - 1);
+
+        writer.sessionStarted(2);
+        writer.sessionFinished(1);
+    }
+
+    std::ifstream file(fileName, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(fileName.c_str());
+
+    std::istringstream stream(data);
+    Kes::Capture::Reader reader(stream);
+
+    Kes::Capture::Record record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, Kes::Capture::RecordType::SessionStarted);
+    EXPECT_EQ(record.session, 1u);
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, Kes::Capture::RecordType::Request);
+    EXPECT_EQ(record.session, 1u);
+    EXPECT_EQ(record.data, "{\"request.request\":\"list_processes\",\"request.id\":1}");
+    auto requestTime = record.time;
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, Kes::Capture::RecordType::SessionStarted);
+    EXPECT_EQ(record.session, 2u);
+
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, Kes::Capture::RecordType::SessionFinished);
+    EXPECT_EQ(record.session, 1u);
+    EXPECT_GE(record.time, requestTime + 50000000);
+
+    EXPECT_FALSE(reader.next(record));
+
+    // corrupted input
+    std::istringstream bad(data.substr(0, data.size() - 3));
+    Kes::Capture::Reader badReader(bad);
+    EXPECT_TRUE(badReader.next(record));
+    EXPECT_TRUE(badReader.next(record));
+    EXPECT_TRUE(badReader.next(record));
+    EXPECT_THROW(badReader.next(record), Kes::Exception);
+
+    std::istringstream notCapture("garbage!");
+    EXPECT_THROW(Kes::Capture::Reader r(notCapture), Kes::Exception);
+}
+
+TEST(Kes_Capture, periodicFlush)
+{
+    auto fileName = "/tmp/kestests-" + std::to_string(::getpid()) + "-capture-flush";
+
+    auto fileSize = [&fileName]()
+    {
+        std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+        return size_t(file.tellg());
+    };
+
+    {
+        Kes::Capture::Writer writer(fileName.c_str(), std::chrono::milliseconds(10));
+        writer.sessionStarted(1);
+
+        // far below the flush threshold, so only the timer writes it out
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while ((fileSize() == 0) && (std::chrono::steady_clock::now() < deadline))
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        EXPECT_EQ(fileSize(), sizeof(Kes::Capture::Magic) + 1 + sizeof(uint32_t) + sizeof(uint64_t));
+    }
+
+    std::remove(fileName.c_str());
+}
@@ -0,0 +1,188 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesrv/processmanager/cgroupmanager.hxx>
+#include <kesrv/processmanager/cpusampler.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/util/requestutil.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+
+#include <map>
+#include <thread>
+
+#include <unistd.h>
+
+
+TEST(Kes_ProcFs, cgroups)
+{
+    const size_t count = 40;
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("cgroups"), count);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+    Kes::Private::CgroupManager cm(&rp, Logger::instance(), &pm, synthetic.root(), synthetic.cgroupRoot());
+
+    const uint32_t sessionId = 1;
+    cm.startSession(sessionId);
+
+    auto traced = [&cm](const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        return tracedReads(cm, sessionId, "list_cgroups", request, response);
+    };
+
+    auto cgroupsOf = [](const Kes::PropertyBag& response)
+    {
+        std::map<std::string, const Kes::PropertyBag*> cgroups;
+        for (auto& cgroup: response.table().find(Kes::ProcessProps::CgroupList::idstr())->second->array())
+            cgroups[*Kes::Util::findInTable<Kes::ProcessProps::CgroupPath>(*cgroup)] = cgroup.get();
+
+        return cgroups;
+    };
+
+    // what the cgroups should add up to, the parents included
+    auto expected = [&synthetic]()
+    {
+        std::map<std::string, std::pair<uint64_t, uint64_t>> sums;
+        for (auto pid: synthetic.pids())
+        {
+            for (auto path: { Kes::ProcFs::SyntheticProcFs::cgroupOf(pid), std::string("/system.slice"), std::string("/") })
+            {
+                auto& sum = sums[path];
+                ++sum.first;
+                sum.second += uint64_t(256 + pid % 1024) * uint64_t(::sysconf(_SC_PAGESIZE));
+            }
+        }
+
+        return sums;
+    };
+
+    auto check = [&expected, &cgroupsOf](const Kes::PropertyBag& response)
+    {
+        auto cgroups = cgroupsOf(response);
+        auto sums = expected();
+        ASSERT_EQ(cgroups.size(), sums.size());
+        for (auto& sum: sums)
+        {
+            auto& cgroup = *cgroups.at(sum.first);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupProcesses>(cgroup), sum.second.first) << sum.first;
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupRss>(cgroup), sum.second.second) << sum.first;
+        }
+    };
+
+    Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+
+    // every process has its cgroup read once
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, response);
+        EXPECT_EQ(files["cgroup"], count);
+        EXPECT_EQ(files["stat"], count);
+        EXPECT_EQ(files["cpu.stat"], Kes::ProcFs::SyntheticProcFs::CgroupCount + 2);
+        check(response);
+
+        auto cgroups = cgroupsOf(response);
+        ASSERT_EQ(cgroups.size(), size_t(Kes::ProcFs::SyntheticProcFs::CgroupCount + 2));
+
+        // the parents have no members of their own
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupProcesses>(*cgroups.at("/")), count);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupOwnProcesses>(*cgroups.at("/")), 0u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupOwnProcesses>(*cgroups.at("/system.slice")), 0u);
+
+        auto& svc = *cgroups.at(Kes::ProcFs::SyntheticProcFs::cgroupPath(2));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupProcesses>(svc), count / 4);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupOwnProcesses>(svc), count / 4);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupCpuUsage>(svc), 3000000u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupCpuUser>(svc), 1500000u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupCpuNrThrottled>(svc), 2u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupCpuThrottled>(svc), 200u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupMemoryCurrent>(svc), 3u * 1024 * 1024);
+        EXPECT_DOUBLE_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupMemorySomeAvg10>(svc), 2);
+        EXPECT_DOUBLE_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupMemorySomeAvg60>(svc), 0.5);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupMemorySomeTotal>(svc), 2000u);
+        EXPECT_DOUBLE_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupMemoryFullAvg10>(svc), 0);
+
+        // no rates before a second sample
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::CgroupCpu>(svc), nullptr);
+    }
+
+    // and not again while it is recent; nor are the stats
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, response);
+        EXPECT_EQ(files.count("cgroup"), 0u);
+        EXPECT_EQ(files.count("stat"), 0u);
+        check(response);
+    }
+
+    // only the newcomers are read; the ones that are gone leave their cgroups
+    std::this_thread::sleep_for(std::chrono::nanoseconds(Kes::Private::CpuSampler::MinInterval));
+    synthetic.churn(6);
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, response);
+        EXPECT_EQ(files["cgroup"], 6u);
+        check(response);
+
+        auto cgroups = cgroupsOf(response);
+        double cpu = 0;
+        for (unsigned n = 0; n < Kes::ProcFs::SyntheticProcFs::CgroupCount; ++n)
+            cpu += *Kes::Util::findInTable<Kes::ProcessProps::CgroupCpu>(*cgroups.at(Kes::ProcFs::SyntheticProcFs::cgroupPath(n)));
+
+        EXPECT_GT(cpu, 0);
+        EXPECT_NEAR(*Kes::Util::findInTable<Kes::ProcessProps::CgroupCpu>(*cgroups.at("/")), cpu, 0.01);
+    }
+
+    // a process listing is a scan the cgroups take, instead of reading the stats again
+    std::this_thread::sleep_for(std::chrono::nanoseconds(Kes::Private::CpuSampler::MinInterval));
+    synthetic.churn(2);
+
+    {
+        pm.startSession(sessionId);
+
+        Kes::PropertyBag listing{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, listing));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, response);
+        EXPECT_EQ(files.count("stat"), 0u);
+        EXPECT_EQ(files["cgroup"], 2u);
+        check(response);
+
+        pm.endSession(sessionId);
+    }
+
+    // a subtree
+    {
+        Kes::PropertyBag subtree{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::CgroupPath>(subtree, Kes::ProcFs::SyntheticProcFs::cgroupPath(1) + "/");
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(cm.process(sessionId, "list_cgroups", 2, subtree, response));
+
+        auto cgroups = cgroupsOf(response);
+        ASSERT_EQ(cgroups.size(), 1u);
+        EXPECT_EQ(cgroups.begin()->first, Kes::ProcFs::SyntheticProcFs::cgroupPath(1));
+    }
+
+    {
+        Kes::PropertyBag prefix{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::CgroupPath>(prefix, std::string("/system.sl"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(cm.process(sessionId, "list_cgroups", 3, prefix, response));
+        EXPECT_TRUE(cgroupsOf(response).empty());
+    }
+
+    {
+        Kes::PropertyBag relative{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::CgroupPath>(relative, std::string("system.slice"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(cm.process(sessionId, "list_cgroups", 4, relative, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    cm.endSession(sessionId);
+}
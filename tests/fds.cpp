@@ -0,0 +1,373 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesrv/processmanager/fdmanager.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/util/requestutil.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+
+#include <algorithm>
+#include <map>
+
+
+TEST(Kes_ProcFs, fds)
+{
+    const size_t count = 40;
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("fds"), count);
+
+    size_t expected = 0;
+    for (auto pid: synthetic.pids())
+        expected += Kes::ProcFs::SyntheticProcFs::fdCountOf(pid);
+
+    RequestProcessor rp;
+    Kes::Private::FdManager fm(&rp, Logger::instance(), synthetic.root());
+
+    const uint32_t sessionId = 1;
+    fm.startSession(sessionId);
+
+    auto traced = [&fm](const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        return tracedReads(fm, sessionId, "list_fds", request, response);
+    };
+
+    // every descriptor once, in order, a chunk at a time
+    {
+        std::vector<std::pair<int, int>> seen;
+        std::string cursor;
+        size_t chunks = 0;
+        for (;;)
+        {
+            Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+            Kes::Util::addToTable<Kes::ProcessProps::Limit>(request, 50);
+            if (!cursor.empty())
+                Kes::Util::addToTable<Kes::ProcessProps::Cursor>(request, cursor);
+
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            EXPECT_TRUE(fm.process(sessionId, "list_fds", ++chunks, request, response));
+            ASSERT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Success);
+            EXPECT_LE(arraySize(response, Kes::ProcessProps::FdList::idstr()), 50u);
+
+            for (auto& fd: response.table().find(Kes::ProcessProps::FdList::idstr())->second->array())
+                seen.push_back({ *Kes::Util::findInTable<Kes::ProcessProps::FdPid>(*fd), *Kes::Util::findInTable<Kes::ProcessProps::FdNumber>(*fd) });
+
+            auto next = Kes::Util::findInTable<Kes::ProcessProps::NextCursor>(response);
+            if (!next)
+                break;
+
+            cursor = *next;
+            ASSERT_LT(chunks, 100u);
+        }
+
+        EXPECT_EQ(seen.size(), expected);
+        EXPECT_TRUE(std::is_sorted(seen.begin(), seen.end()));
+        EXPECT_EQ(std::adjacent_find(seen.begin(), seen.end()), seen.end());
+        EXPECT_EQ(chunks, (expected + 49) / 50);
+    }
+
+    // a big process: its directory is walked by the first chunk only, and only the chunk is readlink'ed
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Pid>(request, 1008);
+        Kes::Util::addToTable<Kes::ProcessProps::Limit>(request, 10);
+
+        Kes::PropertyBag first{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, first);
+        EXPECT_EQ(files["fds"], 1u);
+        EXPECT_EQ(files["fd"], 10u);
+        EXPECT_EQ(files.count("fdinfo"), 0u);
+        ASSERT_NE(Kes::Util::findInTable<Kes::ProcessProps::NextCursor>(first), nullptr);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NextCursor>(first), "1008:9");
+
+        Kes::Util::addToTable<Kes::ProcessProps::Cursor>(request, std::string("1008:9"));
+        Kes::PropertyBag second{std::string(), Kes::PropertyBag::Table()};
+        files = traced(request, second);
+        EXPECT_EQ(files.count("fds"), 0u);
+        EXPECT_EQ(files["fd"], 10u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdNumber>(*second.table().find(Kes::ProcessProps::FdList::idstr())->second->array().front()), 10);
+
+        // a replayed cursor does not match where the previous chunk stopped: the directory is walked again
+        Kes::PropertyBag replayed{std::string(), Kes::PropertyBag::Table()};
+        files = traced(request, replayed);
+        EXPECT_EQ(files["fds"], 1u);
+        EXPECT_EQ(files["fd"], 10u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdNumber>(*replayed.table().find(Kes::ProcessProps::FdList::idstr())->second->array().front()), 10);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NextCursor>(replayed), "1008:19");
+
+        // and the cursor it returned continues from the session again
+        request.table().erase(Kes::ProcessProps::Cursor::idstr());
+        Kes::Util::addToTable<Kes::ProcessProps::Cursor>(request, std::string("1008:19"));
+        Kes::PropertyBag third{std::string(), Kes::PropertyBag::Table()};
+        files = traced(request, third);
+        EXPECT_EQ(files.count("fds"), 0u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdNumber>(*third.table().find(Kes::ProcessProps::FdList::idstr())->second->array().front()), 20);
+    }
+
+    // classification and fdinfo
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Pid>(request, 1001);
+        Kes::Util::addToTable<Kes::ProcessProps::FdWithInfo>(request, true);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, response);
+        EXPECT_EQ(files["fdinfo"], 5u);
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::NextCursor>(response), nullptr);
+
+        auto& fds = response.table().find(Kes::ProcessProps::FdList::idstr())->second->array();
+        ASSERT_EQ(fds.size(), 5u);
+
+        const char* const types[] = { "file", "pipe", "socket", "anon_inode", "file" };
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            auto& fd = *fds[i];
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdNumber>(fd), int(i));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdType>(fd), types[i]);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdPos>(fd), i * 512);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdFlags>(fd), 0100002u);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdMntId>(fd), 21);
+        }
+
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdTarget>(*fds[0]), "/dev/null");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdInode>(*fds[2]), 1001u * 16 + 2);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdTarget>(*fds[3]), "anon_inode:[eventfd]");
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::FdInode>(*fds[3]), nullptr);
+    }
+
+    // bad requests
+    for (auto& cursor: { "1008", "1008:x", "-1:2", "1008:-3" })
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Cursor>(request, std::string(cursor));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_fds", 1, request, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail) << cursor;
+    }
+
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Pid>(request, 999999);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_fds", 1, request, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    fm.endSession(sessionId);
+
+    // fd_count only walks the directories
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+    pm.startSession(sessionId);
+
+    {
+        auto request = fieldsRequest({ "fd_count" });
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(request, std::string("fd_count > 10"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = tracedReads(pm, sessionId, "list_processes", request, response);
+
+        EXPECT_EQ(files["fdcount"], count);
+        EXPECT_EQ(files.count("fd"), 0u);
+        EXPECT_EQ(files.count("fds"), 0u);
+
+        auto& processes = response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array();
+        ASSERT_EQ(processes.size(), 2u);
+        for (auto& process: processes)
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::FdCount>(*process), 64u);
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, sockets)
+{
+    const size_t count = 30;
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("sockets"), count);
+
+    size_t fds = 0;
+    for (auto pid: synthetic.pids())
+        fds += Kes::ProcFs::SyntheticProcFs::fdCountOf(pid);
+
+    RequestProcessor rp;
+    Kes::Private::FdManager fm(&rp, Logger::instance(), synthetic.root(), std::chrono::hours(1));
+
+    const uint32_t sessionId = 1;
+    fm.startSession(sessionId);
+
+    auto traced = [&fm](const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        return tracedReads(fm, sessionId, "list_sockets", request, response);
+    };
+
+    auto socketsOf = [](const Kes::PropertyBag& response)
+    {
+        std::vector<const Kes::PropertyBag*> sockets;
+        for (auto& socket: response.table().find(Kes::ProcessProps::SocketList::idstr())->second->array())
+            sockets.push_back(socket.get());
+
+        return sockets;
+    };
+
+    auto ownersOf = [](const Kes::PropertyBag& socket)
+    {
+        std::vector<int> pids;
+        auto it = socket.table().find(Kes::ProcessProps::SocketPids::idstr());
+        if (it != socket.table().end())
+        {
+            for (auto& pid: it->second->array())
+                pids.push_back(std::any_cast<int>(pid->property().value));
+        }
+
+        return pids;
+    };
+
+    auto withPort = [](int port, bool refresh = false)
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::SocketLocalPort>(request, port);
+        if (refresh)
+            Kes::Util::addToTable<Kes::ProcessProps::Refresh>(request, true);
+
+        return request;
+    };
+
+    // the first query walks every fd directory
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(request, response);
+        EXPECT_EQ(files["fd"], fds);
+        EXPECT_EQ(files["tcp"], 1u);
+        EXPECT_EQ(files["unix"], 1u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketIndexGeneration>(response), 1u);
+
+        auto sockets = socketsOf(response);
+        ASSERT_EQ(sockets.size(), count + 5);
+
+        std::map<std::string, const Kes::PropertyBag*> byName;
+        for (auto socket: sockets)
+        {
+            auto protocol = *Kes::Util::findInTable<Kes::ProcessProps::SocketProtocol>(*socket);
+            auto port = Kes::Util::findInTable<Kes::ProcessProps::SocketLocalPort>(*socket);
+            auto path = Kes::Util::findInTable<Kes::ProcessProps::SocketPath>(*socket);
+            byName[protocol + ":" + (port ? std::to_string(*port) : (path ? *path : std::string()))] = socket;
+        }
+
+        auto& listener = *byName.at("tcp:1005");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketLocalAddress>(listener), "127.0.0.1");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketState>(listener), "LISTEN");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketUid>(listener), 1000);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketInode>(listener), 1005u * 16 + 2);
+        EXPECT_EQ(ownersOf(listener), std::vector<int>{ 1005 });
+
+        auto& closed = *byName.at("tcp6:8080");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketLocalAddress>(closed), "::1");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketRemotePort>(closed), 54321);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketState>(closed), "TIME_WAIT");
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::SocketInode>(closed), nullptr);
+        EXPECT_TRUE(ownersOf(closed).empty());
+
+        auto& dns = *byName.at("udp:53");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketLocalAddress>(dns), "0.0.0.0");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketState>(dns), "UNCONNECTED");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketUid>(dns), 101);
+
+        auto& unixListener = *byName.at("unix:/run/synthetic.sock");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketState>(unixListener), "LISTEN");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketInode>(unixListener), 777u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketState>(*byName.at("unix:")), "CONNECTED");
+    }
+
+    // who owns the port: answered from the index
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(withPort(1010), response);
+        EXPECT_EQ(files.count("fd"), 0u);
+        EXPECT_EQ(files.count("fds"), 0u);
+        EXPECT_EQ(files.count("unix"), 0u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketIndexGeneration>(response), 1u);
+
+        auto sockets = socketsOf(response);
+        ASSERT_EQ(sockets.size(), 1u);
+        EXPECT_EQ(ownersOf(*sockets[0]), std::vector<int>{ 1010 });
+    }
+
+    // a new process is unknown to the index until the interval is over, or until asked for
+    synthetic.churn(3);
+    auto newcomer = synthetic.pids().back();
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_sockets", 2, withPort(newcomer), response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketIndexGeneration>(response), 1u);
+        ASSERT_EQ(socketsOf(response).size(), 1u);
+        EXPECT_TRUE(ownersOf(*socketsOf(response)[0]).empty());
+    }
+
+    // unless list_fds came across its socket
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Pid>(request, newcomer);
+
+        Kes::PropertyBag fdResponse{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_fds", 2, request, fdResponse));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(withPort(newcomer), response);
+        EXPECT_EQ(files.count("fd"), 0u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketIndexGeneration>(response), 1u);
+        ASSERT_EQ(socketsOf(response).size(), 1u);
+        EXPECT_EQ(ownersOf(*socketsOf(response)[0]), std::vector<int>{ newcomer });
+    }
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_sockets", 3, withPort(newcomer, true), response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SocketIndexGeneration>(response), 2u);
+        ASSERT_EQ(socketsOf(response).size(), 1u);
+        EXPECT_EQ(ownersOf(*socketsOf(response)[0]), std::vector<int>{ newcomer });
+    }
+
+    // bad requests
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::SocketProtocol>(request, std::string("sctp"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_sockets", 4, request, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(fm.process(sessionId, "list_sockets", 5, withPort(70000), response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    fm.endSession(sessionId);
+
+    // with no interval, an unknown socket is enough for a new generation
+    {
+        Kes::Private::FdManager eager(&rp, Logger::instance(), synthetic.root(), std::chrono::milliseconds(0));
+        eager.startSession(sessionId);
+
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::SocketProtocol>(request, std::string("tcp"));
+
+        auto generation = [&eager, &request]()
+        {
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            EXPECT_TRUE(eager.process(sessionId, "list_sockets", 1, request, response));
+            return *Kes::Util::findInTable<Kes::ProcessProps::SocketIndexGeneration>(response);
+        };
+
+        EXPECT_EQ(generation(), 1u);
+        EXPECT_EQ(generation(), 1u);
+
+        synthetic.churn(1);
+        EXPECT_EQ(generation(), 2u);
+
+        eager.endSession(sessionId);
+    }
+}
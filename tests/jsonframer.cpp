@@ -0,0 +1,45 @@
+#include "common.hpp"
+
+#include <kesrv/util/jsonframer.hxx>
+
+
+TEST(Kes_JsonFramer, pipelined)
+{
+    Kes::Util::JsonFramer framer;
+
+    std::string stream("{\"a\":{\"b\":1}}\n{\"c\":\"}{\\\"}\"}{\"d\":2}");
+
+    auto end = framer.next(stream.data(), 0, stream.size());
+    EXPECT_EQ(stream.substr(0, end), "{\"a\":{\"b\":1}}");
+    EXPECT_FALSE(framer.inProgress());
+
+    // braces and escaped quotes inside strings do not count
+    auto begin = end;
+    end = framer.next(stream.data(), begin, stream.size());
+    EXPECT_EQ(stream.substr(begin, end - begin), "\n{\"c\":\"}{\\\"}\"}");
+
+    begin = end;
+    end = framer.next(stream.data(), begin, stream.size());
+    EXPECT_EQ(stream.substr(begin, end - begin), "{\"d\":2}");
+
+    EXPECT_EQ(framer.next(stream.data(), end, stream.size()), Kes::Util::JsonFramer::Incomplete);
+}
+
+TEST(Kes_JsonFramer, partial)
+{
+    Kes::Util::JsonFramer framer;
+
+    std::string stream("{\"request\":\"li{st\"}");
+
+    // byte by byte, as if every read returned one character
+    for (size_t i = 0; i + 1 < stream.size(); ++i)
+    {
+        EXPECT_EQ(framer.next(stream.data(), i, i + 1), Kes::Util::JsonFramer::Incomplete);
+        EXPECT_TRUE(framer.inProgress());
+    }
+
+    EXPECT_EQ(framer.next(stream.data(), stream.size() - 1, stream.size()), stream.size());
+    EXPECT_FALSE(framer.inProgress());
+
+    EXPECT_THROW(framer.next("}", 0, 1), Kes::Exception);
+}
@@ -0,0 +1,607 @@
+#include "common.hpp"
+
+#include <kesclient/connection.hxx>
+#include <kesclient/processlist.hxx>
+#include <kesrv/capture.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/util/clock.hxx>
+#include <kesrv/util/jsonframer.hxx>
+#include <kesrv/util/netutil.hxx>
+#include <src/kesctl/loadgen.hxx>
+#include <src/kesctl/replay.hxx>
+#include <src/kesctl/watch.hxx>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+
+namespace
+{
+
+//
+// a scripted server: accepts connections and hands every received request frame to 'reply'
+//
+
+template <class ProtocolT>
+class BasicFakeServer final
+{
+public:
+    using Socket = typename ProtocolT::socket;
+    using Endpoint = typename ProtocolT::endpoint;
+    using Reply = std::function<void(Socket& socket, std::vector<std::string>& requests)>;
+
+    ~BasicFakeServer()
+    {
+        m_io.stop();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    explicit BasicFakeServer(size_t connections, Reply reply, const Endpoint& endpoint = Endpoint(boost::asio::ip::address_v4::loopback(), 0))
+        : m_acceptor(m_io, endpoint)
+        , m_thread([this, connections, reply]() { run(connections, reply); })
+    {
+    }
+
+    uint16_t port() const
+    {
+        return m_acceptor.local_endpoint().port();
+    }
+
+private:
+    void run(size_t connections, Reply reply)
+    {
+        for (size_t i = 0; i < connections; ++i)
+        {
+            Socket socket(m_io);
+            boost::system::error_code ec;
+            m_acceptor.accept(socket, ec);
+            if (ec)
+                return;
+
+            reply(socket, m_requests);
+        }
+    }
+
+    boost::asio::io_context m_io;
+    typename ProtocolT::acceptor m_acceptor;
+    std::vector<std::string> m_requests;
+    std::thread m_thread;
+};
+
+using FakeServer = BasicFakeServer<boost::asio::ip::tcp>;
+
+// blocks until 'count' more request frames have arrived
+template <class SocketT>
+void receive(SocketT& socket, std::vector<std::string>& requests, size_t count)
+{
+    Kes::Util::JsonFramer framer;
+    std::string data;
+    size_t start = 0;
+    size_t scanned = 0;
+
+    while (count > 0)
+    {
+        char buffer[1024];
+        boost::system::error_code ec;
+        auto n = socket.read_some(boost::asio::buffer(buffer), ec);
+        if (ec)
+            return;
+
+        data.append(buffer, n);
+
+        for (;;)
+        {
+            auto end = framer.next(data.data(), scanned, data.size());
+            if (end == Kes::Util::JsonFramer::Incomplete)
+            {
+                scanned = data.size();
+                break;
+            }
+
+            requests.push_back(data.substr(start, end - start));
+            start = scanned = end;
+            --count;
+        }
+    }
+}
+
+int requestId(const std::string& request)
+{
+    auto id = Kes::Client::ResponseView(request.data(), request.size()).id();
+    return id ? *id : -1;
+}
+
+// answers the last 'count' requests newest first
+void replyReversed(boost::asio::ip::tcp::socket& socket, const std::vector<std::string>& requests, size_t count)
+{
+    for (size_t i = requests.size(); i > requests.size() - count; --i)
+    {
+        auto out = "{\"request.id\":" + std::to_string(requestId(requests[i - 1])) + ",\"response.status\":\"success\"}";
+        boost::asio::write(socket, boost::asio::buffer(out));
+    }
+}
+
+// runs 'io' until it is stopped or a few seconds pass
+void runFor(boost::asio::io_context& io)
+{
+    std::thread runner([&io]() { io.run(); });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!io.stopped() && (std::chrono::steady_clock::now() < deadline))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    io.stop();
+    runner.join();
+}
+
+// the requests and errors columns of a command row in a load report
+std::vector<uint64_t> reportRow(const std::string& report, const std::string& command)
+{
+    std::istringstream in(report);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream row(line);
+        std::string name;
+        row >> name;
+        if (name != command)
+            continue;
+
+        std::vector<uint64_t> columns(2);
+        row >> columns[0] >> columns[1];
+        return columns;
+    }
+
+    return {};
+}
+
+} // namespace {}
+
+
+TEST(Kes_Client, responseView)
+{
+    std::string json("{\"process.process_list\":[{\"process.pid\":1,\"response.status\":\"nested\"}],"
+        " \"response.reason\" : \"say \\\"no\\\"\", \"request.id\":42,\"response.status\":\"fail\",\"x\":{\"y\":[1,2]}}");
+
+    Kes::Client::ResponseView view(json.data(), json.size());
+    EXPECT_EQ(view.id(), 42);
+    EXPECT_EQ(view.status(), "fail");
+    EXPECT_FALSE(view.success());
+    EXPECT_EQ(view.reason(), "say \\\"no\\\"");
+    EXPECT_EQ(view.raw("x"), "{\"y\":[1,2]}");
+    EXPECT_EQ(view.raw("missing"), "");
+    EXPECT_FALSE(view.integer("response.status"));
+
+    std::string broken("{\"request.id\":");
+    EXPECT_FALSE(Kes::Client::ResponseView(broken.data(), broken.size()).id());
+}
+
+TEST(Kes_Client, decodeProcesses)
+{
+    Kes::Client::ProcessList list;
+
+    std::string first("{\"process.process_list\":[{\"process.pid\":1,\"process.comm\":\"init\",\"process.cmdline\":\"/sbin/init splash\",\"process.cpu\":12.5},"
+        "{\"process.pid\":7,\"process.newcomer\":true,\"process.unknown\":{\"process.pid\":99}}],\"process.deleted_process_list\":[3,4],"
+        "\"process.token\":\"abc.1\",\"process.resumed\":true,\"process.next_cursor\":\"pid:a:7:7\",\"system.cpu_busy\":40}");
+    Kes::Client::decodeProcesses(first, list);
+
+    ASSERT_EQ(list.processes.size(), 2u);
+    EXPECT_EQ(list.processes[0].pid, 1);
+    EXPECT_EQ(list.processes[0].comm, "init");
+    EXPECT_EQ(list.processes[0].cmdLine, "/sbin/init splash");
+    EXPECT_DOUBLE_EQ(list.processes[0].cpu, 12.5);
+    EXPECT_EQ(list.processes[1].pid, 7);
+    EXPECT_TRUE(list.processes[1].newcomer);
+    EXPECT_LT(list.processes[1].cpu, 0);
+    EXPECT_EQ(list.deleted, std::vector<int>({ 3, 4 }));
+    EXPECT_EQ(list.token, "abc.1");
+    EXPECT_TRUE(list.resumed);
+    EXPECT_EQ(list.nextCursor, "pid:a:7:7");
+    EXPECT_DOUBLE_EQ(list.systemBusy, 40);
+
+    // entries are reused: fields missing from the new response are reset
+    std::string second("{\"process.process_list\":[{\"process.pid\":2,\"process.error\":\"gone\"}]}");
+    Kes::Client::decodeProcesses(second, list);
+
+    ASSERT_EQ(list.processes.size(), 1u);
+    EXPECT_EQ(list.processes[0].pid, 2);
+    EXPECT_EQ(list.processes[0].comm, "");
+    EXPECT_EQ(list.processes[0].error, "gone");
+    EXPECT_TRUE(list.deleted.empty());
+    EXPECT_TRUE(list.token.empty());
+    EXPECT_FALSE(list.resumed);
+    EXPECT_TRUE(list.nextCursor.empty());
+    EXPECT_LT(list.systemBusy, 0);
+
+    EXPECT_THROW(Kes::Client::decodeProcesses("{\"process.process_list\":[", list), Kes::Exception);
+}
+
+TEST(Kes_Client, pipelining)
+{
+    // answers three requests in reverse order, the last frame split between two writes
+    FakeServer server(
+        1,
+        [](boost::asio::ip::tcp::socket& socket, std::vector<std::string>& requests)
+        {
+            receive(socket, requests, 3);
+
+            std::string out;
+            for (auto it = requests.rbegin(); it != requests.rend(); ++it)
+                out += "{\"request.id\":" + std::to_string(requestId(*it)) + ",\"response.status\":\"success\",\"echo\":" + *it + "}";
+
+            boost::asio::write(socket, boost::asio::buffer(out.data(), out.size() - 5));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            boost::asio::write(socket, boost::asio::buffer(out.data() + out.size() - 5, 5));
+
+            receive(socket, requests, 1);
+        }
+    );
+
+    boost::asio::io_context io;
+    Kes::Client::Connection connection(io, "127.0.0.1:" + std::to_string(server.port()));
+
+    std::vector<std::pair<int, std::string>> results;
+    std::promise<void> done;
+    auto callback = [&results, &done](const boost::system::error_code& ec, const Kes::Client::ResponseView& response)
+    {
+        EXPECT_FALSE(ec);
+        results.push_back({ response.id().value_or(-1), std::string(response.raw("echo")) });
+        if (results.size() == 3)
+            done.set_value();
+    };
+
+    auto id1 = connection.command("list_processes", callback);
+    auto id2 = connection.send("{\"request.request\":\"custom\",\"x\":[1]}", callback);
+    auto id3 = connection.send("{}", callback);
+
+    std::thread runner([&io]() { io.run(); });
+
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].first, id3);
+    EXPECT_EQ(results[0].second, "{\"request.id\":" + std::to_string(id3) + "}");
+    EXPECT_EQ(results[1].first, id2);
+    EXPECT_EQ(results[1].second, "{\"request.id\":" + std::to_string(id2) + ",\"request.request\":\"custom\",\"x\":[1]}");
+    EXPECT_EQ(results[2].first, id1);
+
+    // outstanding requests are aborted on stop
+    auto future = connection.command("version");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    connection.stop();
+    EXPECT_THROW(future.get(), Kes::Exception);
+
+    io.stop();
+    runner.join();
+
+    EXPECT_THROW(connection.send("[]", callback), Kes::Exception);
+}
+
+TEST(Kes_Client, leftoverBytes)
+{
+    // every write ends inside a frame: the bytes after a complete frame must start the next one,
+    // both when the frame came from a single read and when it was buffered across reads
+    FakeServer server(
+        1,
+        [](boost::asio::ip::tcp::socket& socket, std::vector<std::string>& requests)
+        {
+            receive(socket, requests, 4);
+
+            std::vector<std::string> responses;
+            for (auto& request: requests)
+                responses.push_back("{\"request.id\":" + std::to_string(requestId(request)) + ",\"response.status\":\"success\"}");
+
+            std::string writes[] =
+            {
+                responses[0] + responses[1].substr(0, 7),
+                responses[1].substr(7) + responses[2] + responses[3].substr(0, 3),
+                responses[3].substr(3)
+            };
+
+            for (auto& w: writes)
+            {
+                boost::asio::write(socket, boost::asio::buffer(w));
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+
+            receive(socket, requests, 1);
+        }
+    );
+
+    boost::asio::io_context io;
+    Kes::Client::Connection connection(io, "127.0.0.1:" + std::to_string(server.port()));
+
+    std::vector<int> results;
+    std::promise<void> done;
+    auto callback = [&results, &done](const boost::system::error_code& ec, const Kes::Client::ResponseView& response)
+    {
+        EXPECT_FALSE(ec);
+        EXPECT_TRUE(response.success());
+        results.push_back(response.id().value_or(-1));
+        if (results.size() == 4)
+            done.set_value();
+    };
+
+    std::vector<int> ids;
+    for (int i = 0; i < 4; ++i)
+        ids.push_back(connection.command("version", callback));
+
+    std::thread runner([&io]() { io.run(); });
+
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(results, ids);
+
+    connection.stop();
+    io.stop();
+    runner.join();
+}
+
+TEST(Kes_Client, reconnect)
+{
+    // the first connection drops without answering, the second one answers
+    FakeServer server(
+        2,
+        [](boost::asio::ip::tcp::socket& socket, std::vector<std::string>& requests)
+        {
+            receive(socket, requests, 1);
+
+            if (requests.size() > 1)
+            {
+                auto out = "{\"request.id\":" + std::to_string(requestId(requests.back())) + ",\"response.status\":\"success\"}";
+                boost::asio::write(socket, boost::asio::buffer(out));
+                receive(socket, requests, 1);
+            }
+        }
+    );
+
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread runner([&io]() { io.run(); });
+
+    Kes::Client::Connection connection(io, "127.0.0.1:" + std::to_string(server.port()));
+
+    auto lost = connection.command("diff_processes");
+    EXPECT_THROW(lost.get(), Kes::Exception);
+
+    auto response = connection.command("list_processes").get();
+    EXPECT_TRUE(response.view().success());
+    EXPECT_TRUE(connection.connected());
+
+    connection.stop();
+    work.reset();
+    io.stop();
+    runner.join();
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+TEST(Kes_Client, localSocket)
+{
+    EXPECT_TRUE(Kes::Util::isLocalAddress("unix:/tmp/kes.sock"));
+    EXPECT_FALSE(Kes::Util::isLocalAddress("127.0.0.1:6665"));
+    EXPECT_THROW(Kes::Util::localEndpointFromString("unix:"), Kes::Exception);
+    EXPECT_THROW(Kes::Util::localEndpointFromString("unix:/" + std::string(200, 'x')), Kes::Exception);
+
+    // the abstract namespace leaves nothing behind in the filesystem
+    auto address = "unix:@kestests-" + std::to_string(::getpid());
+    BasicFakeServer<boost::asio::local::stream_protocol> server(
+        1,
+        [](boost::asio::local::stream_protocol::socket& socket, std::vector<std::string>& requests)
+        {
+            receive(socket, requests, 1);
+
+            auto out = "{\"request.id\":" + std::to_string(requestId(requests.back())) + ",\"response.status\":\"success\"}";
+            boost::asio::write(socket, boost::asio::buffer(out));
+            receive(socket, requests, 1);
+        },
+        Kes::Util::localEndpointFromString(address)
+    );
+
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread runner([&io]() { io.run(); });
+
+    Kes::Client::Connection connection(io, address);
+    auto response = connection.command("version").get();
+    EXPECT_TRUE(response.view().success());
+
+    connection.stop();
+    work.reset();
+    io.stop();
+    runner.join();
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+TEST(Kes_Client, watcher)
+{
+    // a full list, then a diff that changes one process, adds one and drops one
+    FakeServer server(
+        1,
+        [](boost::asio::ip::tcp::socket& socket, std::vector<std::string>& requests)
+        {
+            receive(socket, requests, 1);
+            std::string list("{\"request.id\":" + std::to_string(requestId(requests.back())) + ",\"response.status\":\"success\",\"process.process_list\":["
+                "{\"process.pid\":1,\"process.ppid\":0,\"process.ruid\":0,\"process.cpu\":0.5,\"process.comm\":\"init\",\"process.cmdline\":\"/sbin/init\"},"
+                "{\"process.pid\":42,\"process.ppid\":1,\"process.ruid\":1000,\"process.cpu\":1.5,\"process.comm\":\"sleeper\",\"process.cmdline\":\"sleep 100\"}],"
+                "\"process.token\":\"t.1\"}");
+            boost::asio::write(socket, boost::asio::buffer(list));
+
+            receive(socket, requests, 1);
+            std::string diff("{\"request.id\":" + std::to_string(requestId(requests.back())) + ",\"response.status\":\"success\",\"process.process_list\":["
+                "{\"process.pid\":1,\"process.ppid\":0,\"process.ruid\":0,\"process.cpu\":12.5,\"process.comm\":\"init\",\"process.cmdline\":\"/sbin/init\"},"
+                "{\"process.pid\":77,\"process.ppid\":1,\"process.ruid\":1000,\"process.newcomer\":true,\"process.comm\":\"newbie\",\"process.cmdline\":\"newbie --x\"}],"
+                "\"process.deleted_process_list\":[42],\"process.token\":\"t.2\"}");
+            boost::asio::write(socket, boost::asio::buffer(diff));
+
+            receive(socket, requests, 1);
+        }
+    );
+
+    boost::asio::io_context io;
+    std::ostringstream out;
+
+    Kesctl::WatchOptions options;
+    options.interval = 0.01;
+    options.count = 2;
+    Kesctl::Watcher watcher(io, "127.0.0.1:" + std::to_string(server.port()), options, out);
+    watcher.start();
+
+    std::thread runner([&io]() { io.run(); });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!io.stopped() && (std::chrono::steady_clock::now() < deadline))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    watcher.stop();
+    runner.join();
+
+    // each frame starts with the header line
+    auto screen = out.str();
+    auto second = screen.find("processes:", screen.find("processes:") + 1);
+    ASSERT_NE(second, std::string::npos);
+    auto first = screen.substr(0, second);
+    auto last = screen.substr(second);
+
+    EXPECT_NE(first.find("processes: 2  new: 2  gone: 0"), std::string::npos);
+    EXPECT_NE(first.find("     42       1   1000    1.5 sleeper          sleep 100"), std::string::npos);
+
+    EXPECT_NE(last.find("processes: 2  new: 1  gone: 1"), std::string::npos);
+    EXPECT_NE(last.find("      1       0      0   12.5 init             /sbin/init"), std::string::npos);
+    EXPECT_NE(last.find("     77       1   1000      - newbie           newbie --x"), std::string::npos);
+    EXPECT_EQ(last.find("sleeper"), std::string::npos);
+
+    // rows are in pid order
+    EXPECT_LT(last.find("/sbin/init"), last.find("newbie --x"));
+}
+
+TEST(Kes_Client, replay)
+{
+    auto fileName = (std::filesystem::temp_directory_path() / ("kestests-replay-" + std::to_string(Kes::Util::Clock::ticks()))).string();
+
+    {
+        Kes::Capture::Writer writer(fileName.c_str());
+        const char* requests[][2] = {
+            { "1", "{\"request.request\":\"list_processes\",\"request.id\":77}" },
+            { "2", "{\"request.id\":5,\"request.request\":\"list_processes\"}" },
+            { "1", "{\"request.request\":\"diff_processes\", \"request.id\" : 78 }" },
+            { "2", "{\"request.request\":\"stop\",\"request.id\":6}" },
+            { "2", "{\"request.request\":\"diff_processes\",\"request.id\":7,\"process.token\":\"t.1\"}" }
+        };
+
+        writer.sessionStarted(1);
+        writer.sessionStarted(2);
+        for (auto& request: requests)
+            writer.request(uint32_t(std::stoul(request[0])), Kes::Util::Clock::ticks(), request[1], std::strlen(request[1]));
+    }
+
+    std::ifstream file(fileName, std::ios::binary);
+    std::stringstream capture;
+    capture << file.rdbuf();
+    file.close();
+    std::remove(fileName.c_str());
+
+    // each session pipelines its two requests and gets the answers out of order
+    FakeServer server(
+        2,
+        [](boost::asio::ip::tcp::socket& socket, std::vector<std::string>& requests)
+        {
+            receive(socket, requests, 2);
+
+            // the captured ids are replaced, not duplicated
+            for (auto i = requests.size() - 2; i < requests.size(); ++i)
+            {
+                auto& request = requests[i];
+                EXPECT_EQ(request.find("request.id"), request.rfind("request.id")) << request;
+                EXPECT_NE(request.find("\"request.request\""), std::string::npos) << request;
+            }
+
+            replyReversed(socket, requests, 2);
+            receive(socket, requests, 1);
+        }
+    );
+
+    boost::asio::io_context io;
+    Kesctl::Replayer replayer(io, "127.0.0.1:" + std::to_string(server.port()), capture, 0);
+    replayer.start();
+    runFor(io);
+
+    std::ostringstream report;
+    replayer.report(report);
+
+    EXPECT_EQ(reportRow(report.str(), "list_processes"), std::vector<uint64_t>({ 2, 0 }));
+    EXPECT_EQ(reportRow(report.str(), "diff_processes"), std::vector<uint64_t>({ 2, 0 }));
+    EXPECT_TRUE(reportRow(report.str(), "stop").empty());
+}
+
+TEST(Kes_Client, loadGenerator)
+{
+    // the first pipelined pair is answered out of order, the rest as they come until the session hangs up
+    FakeServer server(
+        2,
+        [](boost::asio::ip::tcp::socket& socket, std::vector<std::string>&)
+        {
+            Kes::Util::JsonFramer framer;
+            std::string data;
+            size_t scanned = 0;
+            std::vector<int> held;
+            bool first = true;
+
+            for (;;)
+            {
+                char buffer[1024];
+                boost::system::error_code ec;
+                auto n = socket.read_some(boost::asio::buffer(buffer), ec);
+                if (ec)
+                    return;
+
+                data.append(buffer, n);
+
+                size_t end;
+                while ((end = framer.next(data.data(), scanned, data.size())) != Kes::Util::JsonFramer::Incomplete)
+                {
+                    held.push_back(requestId(data.substr(0, end)));
+                    data.erase(0, end);
+                    scanned = 0;
+                }
+
+                scanned = data.size();
+
+                if (first && (held.size() < 2))
+                    continue;
+
+                first = false;
+                std::string out;
+                for (auto it = held.rbegin(); it != held.rend(); ++it)
+                    out += "{\"request.id\":" + std::to_string(*it) + ",\"response.status\":\"success\"}";
+
+                boost::asio::write(socket, boost::asio::buffer(out));
+                held.clear();
+            }
+        }
+    );
+
+    boost::asio::io_context io;
+
+    Kesctl::LoadOptions options;
+    options.sessions = 2;
+    options.pipeline = 2;
+    options.duration = 0.1;
+    options.commands = { "list_processes", "diff_processes" };
+    Kesctl::LoadGenerator generator(io, "127.0.0.1:" + std::to_string(server.port()), options);
+    generator.start();
+    runFor(io);
+
+    std::ostringstream report;
+    generator.report(report);
+
+    for (auto command: { "list_processes", "diff_processes" })
+    {
+        auto row = reportRow(report.str(), command);
+        ASSERT_EQ(row.size(), 2u) << report.str();
+        EXPECT_GT(row[0], 0u) << report.str();
+        EXPECT_EQ(row[1], 0u) << report.str();
+    }
+}
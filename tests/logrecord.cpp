@@ -0,0 +1,108 @@
+#include "common.hpp"
+
+#include <kesrv/exception.hxx>
+#include <kesrv/log.hxx>
+
+#include <sstream>
+
+
+namespace
+{
+
+template <typename... Args>
+std::string render(const char* format, const Args&... args)
+{
+    Kes::Log::Record record;
+    record.assign(format, args...);
+
+    std::string out;
+    Kes::Log::render(record, out);
+    return out;
+}
+
+} // namespace {}
+
+
+TEST(Kes_LogRecord, render)
+{
+    EXPECT_EQ(render("plain text"), "plain text");
+    EXPECT_EQ(render("%d%%", 42), "42%");
+    EXPECT_EQ(render("[%s] [%5s] [%-3s]", "abc", "de", "f"), "[abc] [   de] [f  ]");
+    EXPECT_EQ(render("%s", std::string("std::string")), "std::string");
+    EXPECT_EQ(render("%u %x %lu %zu", 7u, 255u, 8ul, size_t(9)), "7 ff 8 9");
+    EXPECT_EQ(render("%lld %i", -5ll, int16_t(-3)), "-5 -3");
+    EXPECT_EQ(render("%.2f", 3.14159), "3.14");
+    EXPECT_EQ(render("%*d|%.*s", 4, 1, 2, "xyz"), "   1|xy");
+    EXPECT_EQ(render("%s", (const char*)nullptr), "(null)");
+
+    // length modifiers don't matter: the recorded type does
+    EXPECT_EQ(render("%d %ld", uint64_t(1) << 40, -1), "1099511627776 -1");
+
+    // missing arguments are left as is
+    EXPECT_EQ(render("%d %s", 1), "1 %s");
+}
+
+TEST(Kes_LogRecord, strings)
+{
+    // long strings go to the heap
+    std::string longString(1000, 'x');
+    EXPECT_EQ(render("%s-%s", longString, "tail"), longString + "-tail");
+
+    // moving keeps the copied arguments
+    char buffer[] = "transient";
+    Kes::Log::Record r1;
+    r1.assign("%s %d", buffer, 1);
+    buffer[0] = 'T';
+
+    Kes::Log::Record r2(std::move(r1));
+    std::string out;
+    Kes::Log::render(r2, out);
+    EXPECT_EQ(out, "transient 1");
+
+    // a buffer counts up to its terminator, not its size
+    char name[16] = "abc";
+    const char* nothing = nullptr;
+    EXPECT_EQ(render("[%s] [%s]", name, nothing), "[abc] [(null)]");
+}
+
+TEST(Kes_LogRecord, binary)
+{
+    std::string data;
+    Kes::Log::Binary::appendHeader(data);
+    Kes::Log::Binary::appendFormat(data, 0, "pid %d name %s");
+    Kes::Log::Binary::appendFormat(data, 1, "%.1f");
+
+    Kes::Log::Record record;
+    struct timespec time = { 100, 5 };
+
+    record.assign("pid %d name %s", 123, "init");
+    Kes::Log::Binary::appendRecord(data, Kes::Log::Level::Warning, time, 0, record);
+
+    record.assign("%.1f", 0.25);
+    Kes::Log::Binary::appendRecord(data, Kes::Log::Level::Debug, time, 1, record);
+
+    std::istringstream stream(data);
+    Kes::Log::Binary::Reader reader(stream);
+
+    Kes::Log::Binary::Reader::Entry entry;
+    ASSERT_TRUE(reader.next(entry));
+    EXPECT_EQ(entry.level, Kes::Log::Level::Warning);
+    EXPECT_EQ(entry.time.tv_sec, 100);
+    EXPECT_EQ(entry.time.tv_nsec, 5);
+    EXPECT_EQ(entry.text, "pid 123 name init");
+
+    ASSERT_TRUE(reader.next(entry));
+    EXPECT_EQ(entry.level, Kes::Log::Level::Debug);
+    EXPECT_EQ(entry.text, "0.2");
+
+    EXPECT_FALSE(reader.next(entry));
+
+    // corrupted input
+    std::istringstream bad(data.substr(0, data.size() - 3));
+    Kes::Log::Binary::Reader badReader(bad);
+    EXPECT_TRUE(badReader.next(entry));
+    EXPECT_THROW(badReader.next(entry), Kes::Exception);
+
+    std::istringstream notLog("garbage!");
+    EXPECT_THROW(Kes::Log::Binary::Reader r(notLog), Kes::Exception);
+}
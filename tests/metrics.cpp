@@ -0,0 +1,125 @@
+#include "common.hpp"
+
+#include <kesrv/metrics/metrics.hxx>
+
+#include <thread>
+#include <vector>
+
+
+TEST(Kes_Metrics, histogramBuckets)
+{
+    using Kes::Metrics::Histogram;
+
+    // exact range
+    for (uint64_t v = 0; v < 2 * Histogram::SubBuckets; ++v)
+    {
+        EXPECT_EQ(Histogram::bucketIndex(v), v);
+        EXPECT_EQ(Histogram::bucketUpperBound(v), v);
+    }
+
+    // every value falls into a bucket that covers it within the precision
+    size_t prevIndex = 0;
+    for (uint64_t v = 1; v < (uint64_t(1) << 30); v = v * 17 / 16 + 1)
+    {
+        auto index = Histogram::bucketIndex(v);
+        EXPECT_GE(index, prevIndex);
+        EXPECT_LT(index, Histogram::BucketCount);
+        prevIndex = index;
+
+        auto upper = Histogram::bucketUpperBound(index);
+        EXPECT_GE(upper, v);
+        EXPECT_LE(double(upper - v), double(v) / Histogram::SubBuckets);
+    }
+
+    EXPECT_EQ(Histogram::bucketIndex(UINT64_MAX), Histogram::BucketCount - 1);
+    EXPECT_EQ(Histogram::bucketUpperBound(Histogram::BucketCount - 1), Histogram::MaxValue);
+}
+
+TEST(Kes_Metrics, histogramPercentiles)
+{
+    Kes::Metrics::Histogram h;
+    EXPECT_EQ(h.percentile(0.5), 0);
+
+    for (uint64_t v = 1; v <= 10000; ++v)
+        h.record(v * 1000);
+
+    EXPECT_EQ(h.count(), 10000);
+    EXPECT_EQ(h.min(), 1000);
+    EXPECT_EQ(h.max(), 10000000);
+
+    auto near = [](uint64_t actual, uint64_t expected)
+    {
+        return (actual >= expected) && (double(actual - expected) <= double(expected) / Kes::Metrics::Histogram::SubBuckets);
+    };
+
+    EXPECT_PRED2(near, h.percentile(0.5), 5000000);
+    EXPECT_PRED2(near, h.percentile(0.99), 9900000);
+    EXPECT_PRED2(near, h.percentile(0.999), 9990000);
+    EXPECT_EQ(h.percentile(1.0), 10000000);
+
+    Kes::Metrics::Histogram h2;
+    h2.record(1);
+    h2.merge(h);
+    EXPECT_EQ(h2.count(), 10001);
+    EXPECT_EQ(h2.min(), 1);
+    EXPECT_EQ(h2.percentile(0), 1);
+}
+
+TEST(Kes_Metrics, registry)
+{
+    Kes::Metrics::Registry registry;
+    auto list = registry.registerCommand("list");
+    auto diff = registry.registerCommand("diff");
+    EXPECT_NE(list, Kes::Metrics::Registry::UnknownCommand);
+    EXPECT_NE(list, diff);
+    EXPECT_EQ(registry.registerCommand("list"), list);
+
+    const size_t threadCount = 4;
+    const size_t iterations = 10000;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back(
+            [&registry, list, diff, t]()
+            {
+                registry.sessionStarted();
+
+                for (size_t i = 0; i < iterations; ++i)
+                {
+                    auto command = (i % 2) ? list : diff;
+                    registry.countRequest(command, (i % 100) == 0);
+                    registry.recordStage(command, Kes::Metrics::Stage::Handler, 1000 + t);
+                    registry.countBytesIn(10);
+                    registry.recordWrite(100, 20);
+                }
+
+                if (t > 0)
+                    registry.sessionFinished();
+            }
+        );
+    }
+
+    for (auto& t: threads)
+        t.join();
+
+    registry.recordScan(5000, 42);
+
+    auto snapshot = registry.snapshot();
+    ASSERT_EQ(snapshot.commands.size(), 3);
+    EXPECT_EQ(snapshot.commands[list].name, "list");
+    EXPECT_EQ(snapshot.commands[list].requests, threadCount * iterations / 2);
+    EXPECT_EQ(snapshot.commands[diff].errors, threadCount * iterations / 100);
+    EXPECT_EQ(snapshot.commands[list].stages[size_t(Kes::Metrics::Stage::Handler)].count(), threadCount * iterations / 2);
+    EXPECT_EQ(snapshot.commands[list].stages[size_t(Kes::Metrics::Stage::Parse)].count(), 0);
+    EXPECT_EQ(snapshot.stages[size_t(Kes::Metrics::Stage::Handler)].count(), threadCount * iterations);
+    EXPECT_EQ(snapshot.stages[size_t(Kes::Metrics::Stage::Handler)].min(), 1000);
+    EXPECT_EQ(snapshot.stages[size_t(Kes::Metrics::Stage::Handler)].max(), 1000 + threadCount - 1);
+    EXPECT_EQ(snapshot.write.count(), threadCount * iterations);
+    EXPECT_EQ(snapshot.bytesIn, threadCount * iterations * 10);
+    EXPECT_EQ(snapshot.bytesOut, threadCount * iterations * 20);
+    EXPECT_EQ(snapshot.sessionsTotal, threadCount);
+    EXPECT_EQ(snapshot.sessionsActive, 1);
+    EXPECT_EQ(snapshot.scan.count(), 1);
+    EXPECT_EQ(snapshot.scanProcesses, 42);
+}
@@ -0,0 +1,84 @@
+#include "common.hpp"
+
+#include <kesrv/util/mpscring.hxx>
+
+#include <thread>
+#include <vector>
+
+
+TEST(Kes_MpscRing, single)
+{
+    Kes::Util::MpscRing<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4);
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.push([i](int& v) { v = i; }));
+
+    // full
+    EXPECT_FALSE(ring.push([](int& v) { v = -1; }));
+    EXPECT_EQ(ring.size(), 4);
+
+    int* items[8];
+    auto count = ring.peek(items, 2);
+    ASSERT_EQ(count, 2);
+    EXPECT_EQ(*items[0], 0);
+    EXPECT_EQ(*items[1], 1);
+    ring.release(count);
+
+    EXPECT_TRUE(ring.push([](int& v) { v = 4; }));
+
+    count = ring.peek(items, _countof(items));
+    ASSERT_EQ(count, 3);
+    EXPECT_EQ(*items[0], 2);
+    EXPECT_EQ(*items[1], 3);
+    EXPECT_EQ(*items[2], 4);
+    ring.release(count);
+
+    EXPECT_EQ(ring.peek(items, _countof(items)), 0);
+}
+
+TEST(Kes_MpscRing, producers)
+{
+    const int kProducers = 4;
+    const int kItems = 100000;
+
+    Kes::Util::MpscRing<std::pair<int, int>> ring(1024);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back(
+            [&ring, p]()
+            {
+                for (int i = 0; i < kItems; ++i)
+                {
+                    while (!ring.push([p, i](std::pair<int, int>& v) { v = { p, i }; }))
+                        std::this_thread::yield();
+                }
+            }
+        );
+    }
+
+    // every producer's items must arrive complete and in order
+    std::vector<int> next(kProducers, 0);
+    int total = 0;
+    while (total < kProducers * kItems)
+    {
+        std::pair<int, int>* items[64];
+        auto count = ring.peek(items, _countof(items));
+        for (size_t i = 0; i < count; ++i)
+        {
+            ASSERT_EQ(items[i]->second, next[items[i]->first]);
+            ++next[items[i]->first];
+        }
+
+        ring.release(count);
+        total += int(count);
+    }
+
+    for (auto& t: producers)
+        t.join();
+
+    for (auto n: next)
+        EXPECT_EQ(n, kItems);
+}
@@ -0,0 +1,72 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+
+#include <algorithm>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+// diff_processes used to erase under its own iterator, list the deleted pids under the process
+// list key and serialize process.ruid without it being registered
+TEST(Kes_ProcessManager, diffDeletedProcesses)
+{
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr);
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    std::vector<int> children;
+    for (int i = 0; i < 8; ++i)
+    {
+        auto pid = ::fork();
+        ASSERT_NE(pid, -1);
+        if (!pid)
+        {
+            ::pause();
+            ::_exit(0);
+        }
+
+        children.push_back(int(pid));
+    }
+
+    Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+        EXPECT_NE(Kes::propertyBagToJson(response).find("\"process.ruid\""), std::string::npos);
+    }
+
+    // several processes go at once
+    for (auto pid: children)
+    {
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+    }
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, request, response));
+
+        auto list = response.table().find(Kes::ProcessProps::DeletedProcessList::idstr());
+        ASSERT_NE(list, response.table().end());
+        EXPECT_EQ(list->second->name(), Kes::ProcessProps::DeletedProcessList::idstr());
+
+        std::vector<int> deleted;
+        for (auto& item: list->second->array())
+            deleted.push_back(std::any_cast<int>(item->property().value));
+
+        for (auto pid: children)
+            EXPECT_EQ(std::count(deleted.begin(), deleted.end(), pid), 1) << pid;
+
+        EXPECT_NE(Kes::propertyBagToJson(response).find("\"process.deleted_process_list\""), std::string::npos);
+    }
+
+    pm.endSession(sessionId);
+}
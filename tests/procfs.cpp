@@ -0,0 +1,1314 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesrv/exception.hxx>
+#include <kesrv/processmanager/cpusampler.hxx>
+#include <kesrv/processmanager/processfilter.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/processmanager/procfs.hxx>
+#include <kesrv/processmanager/threadmanager.hxx>
+#include <kesrv/util/requestutil.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <thread>
+
+#include <unistd.h>
+
+
+namespace
+{
+
+size_t newcomers(const Kes::PropertyBag& response)
+{
+    size_t count = 0;
+    for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+    {
+        if (process->table().count(Kes::ProcessProps::Newcomer::idstr()))
+            ++count;
+    }
+
+    return count;
+}
+
+std::vector<int> pidsOf(const Kes::PropertyBag& response)
+{
+    std::vector<int> pids;
+    for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+        pids.push_back(*Kes::Util::findInTable<Kes::ProcessProps::Pid>(*process));
+
+    return pids;
+}
+
+} // namespace {}
+
+
+TEST(Kes_ProcFs, synthetic)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("synthetic"), 100);
+    Kes::ProcFs::ProcFs procFs(Logger::instance(), synthetic.root());
+    EXPECT_EQ(procFs.root(), synthetic.root());
+
+    auto pids = procFs.enumeratePids();
+    std::sort(pids.begin(), pids.end());
+    EXPECT_EQ(pids, synthetic.pids());
+
+    // read up front, not on the first use by one of several threads
+    EXPECT_EQ(procFs.getBootTime(), 1700000000u);
+
+    auto pid = Kes::ProcFs::SyntheticProcFs::FirstPid + 8;
+    auto stat = procFs.readStat(pid);
+    EXPECT_TRUE(stat.valid);
+    EXPECT_EQ(stat.pid, pid);
+    EXPECT_EQ(stat.comm, "synth-" + std::to_string(pid));
+    EXPECT_EQ(stat.ppid, 1);
+    EXPECT_EQ(stat.num_threads, 4);
+    EXPECT_EQ(stat.utime, 100u);
+
+    EXPECT_EQ(procFs.readComm(pid), "synth-" + std::to_string(pid));
+    EXPECT_EQ(procFs.readExePath(pid), "/usr/bin/synth-" + std::to_string(pid));
+    EXPECT_EQ(procFs.readCmdLine(pid), "/usr/bin/synth-" + std::to_string(pid) + " --instance " + std::to_string(pid));
+
+    // names with parentheses and spaces
+    pid = 1067; // 1067 = 11 * 97
+    stat = procFs.readStat(pid);
+    EXPECT_TRUE(stat.valid);
+    EXPECT_EQ(stat.comm, "odd) (name " + std::to_string(pid));
+    EXPECT_EQ(stat.ppid, 1);
+
+    EXPECT_FALSE(procFs.readStat(1).valid);
+}
+
+TEST(Kes_ProcFs, diffWithChurn)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("churn"), 50);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+    ASSERT_EQ(rp.handlers.size(), 2u);
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 50u);
+    }
+
+    synthetic.churn(5);
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, request, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 50u);
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), 5u);
+        EXPECT_EQ(newcomers(response), 5u);
+
+        // serializable after a diff
+        EXPECT_FALSE(Kes::propertyBagToJson(response).empty());
+    }
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 3, request, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), 0u);
+        EXPECT_EQ(newcomers(response), 0u);
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, resumeWithToken)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("resume"), 50);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root(), 2);
+
+    auto tokenOf = [](const Kes::PropertyBag& response)
+    {
+        auto token = Kes::Util::findInTable<Kes::ProcessProps::Token>(response);
+        return token ? *token : std::string();
+    };
+
+    auto resumed = [](const Kes::PropertyBag& response)
+    {
+        auto r = Kes::Util::findInTable<Kes::ProcessProps::Resumed>(response);
+        return r && *r;
+    };
+
+    std::string token;
+    {
+        pm.startSession(1);
+
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(1, "list_processes", 1, request, response));
+        token = tokenOf(response);
+        EXPECT_FALSE(token.empty());
+        EXPECT_FALSE(resumed(response));
+
+        pm.endSession(1);
+    }
+
+    synthetic.churn(5);
+
+    // a new session presenting the token gets the delta only
+    std::string next;
+    {
+        pm.startSession(2);
+
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Token>(request, token);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(2, "diff_processes", 1, request, response));
+        EXPECT_TRUE(resumed(response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 5u);
+        EXPECT_EQ(newcomers(response), 5u);
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), 5u);
+
+        next = tokenOf(response);
+        EXPECT_NE(next, token);
+
+        // later diffs of the resumed session work as usual
+        Kes::PropertyBag request2{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag response2{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(2, "diff_processes", 2, request2, response2));
+        EXPECT_EQ(arraySize(response2, Kes::ProcessProps::ProcessList::idstr()), 50u);
+        EXPECT_EQ(newcomers(response2), 0u);
+        EXPECT_EQ(tokenOf(response2), next); // nothing changed
+
+        pm.endSession(2);
+    }
+
+    // the history keeps two generations: the first token has been dropped by now
+    synthetic.churn(1);
+    {
+        pm.startSession(3);
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(3, "list_processes", 1, request, response));
+        pm.endSession(3);
+    }
+
+    for (auto& stale: { token, std::string("garbage"), std::string() })
+    {
+        pm.startSession(4);
+
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Token>(request, stale);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(4, "diff_processes", 1, request, response));
+        EXPECT_FALSE(resumed(response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 50u);
+        EXPECT_EQ(newcomers(response), 0u);
+
+        pm.endSession(4);
+    }
+}
+
+TEST(Kes_ProcFs, generationHistory)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("generations"), 20);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root(), 2, Kes::Private::RefreshOptions(), std::chrono::milliseconds(300));
+
+    struct Result
+    {
+        std::string token;
+        bool resumed = false;
+        size_t listed = 0;
+    };
+
+    uint32_t sessionId = 0;
+    auto list = [&pm, &sessionId](const std::string& token, const char* field)
+    {
+        pm.startSession(++sessionId);
+
+        auto request = field ? fieldsRequest({ field }) : Kes::PropertyBag{std::string(), Kes::PropertyBag::Table()};
+        if (!token.empty())
+            Kes::Util::addToTable<Kes::ProcessProps::Token>(request, token);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 1, request, response));
+        pm.endSession(sessionId);
+
+        Result result;
+        auto t = Kes::Util::findInTable<Kes::ProcessProps::Token>(response);
+        result.token = t ? *t : std::string();
+        auto r = Kes::Util::findInTable<Kes::ProcessProps::Resumed>(response);
+        result.resumed = r && *r;
+        result.listed = arraySize(response, Kes::ProcessProps::ProcessList::idstr());
+        return result;
+    };
+
+    // sessions that see the same through the same projection share a generation
+    auto first = list(std::string(), nullptr);
+    EXPECT_EQ(list(std::string(), nullptr).token, first.token);
+
+    // another projection has generations of its own and does not push the others out
+    auto narrow = list(std::string(), "ppid");
+    EXPECT_NE(narrow.token, first.token);
+    synthetic.churn(1);
+    list(std::string(), "ppid");
+    synthetic.churn(1);
+    list(std::string(), "ppid");
+
+    auto resumed = list(first.token, nullptr);
+    EXPECT_TRUE(resumed.resumed);
+    EXPECT_EQ(resumed.listed, 2u);
+
+    // a token is only good for the projection it was made for
+    auto other = list(first.token, "ppid");
+    EXPECT_FALSE(other.resumed);
+    EXPECT_EQ(other.listed, 20u);
+
+    // and only for a while
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    auto expired = list(resumed.token, nullptr);
+    EXPECT_FALSE(expired.resumed);
+    EXPECT_EQ(expired.listed, 20u);
+}
+
+TEST(Kes_ProcFs, resumeSeesCounters)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("resumecounters"), 30);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    auto request = []()
+    {
+        return fieldsRequest({ "utime", "comm" });
+    };
+
+    auto utimes = [](const Kes::PropertyBag& response)
+    {
+        std::map<int, uint64_t> result;
+        auto list = response.table().find(Kes::ProcessProps::ProcessList::idstr());
+        for (auto& item: list->second->array())
+        {
+            auto pid = Kes::Util::findInTable<Kes::ProcessProps::Pid>(*item);
+            auto utime = Kes::Util::findInTable<Kes::ProcessProps::UTime>(*item);
+            if (pid && utime)
+                result[*pid] = *utime;
+        }
+
+        return result;
+    };
+
+    std::string token;
+    std::map<int, uint64_t> before;
+    {
+        pm.startSession(1);
+        auto r = request();
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(1, "list_processes", 1, r, response));
+        token = *Kes::Util::findInTable<Kes::ProcessProps::Token>(response);
+        before = utimes(response);
+        pm.endSession(1);
+    }
+
+    // the same processes, but they all ran for a while
+    synthetic.churn(0);
+
+    pm.startSession(2);
+    auto r = request();
+    Kes::Util::addToTable<Kes::ProcessProps::Token>(r, token);
+    Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+    EXPECT_TRUE(pm.process(2, "diff_processes", 1, r, response));
+    pm.endSession(2);
+
+    auto resumed = Kes::Util::findInTable<Kes::ProcessProps::Resumed>(response);
+    EXPECT_TRUE(resumed && *resumed);
+    EXPECT_EQ(newcomers(response), 0u);
+    EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), 0u);
+
+    auto after = utimes(response);
+    ASSERT_EQ(after.size(), before.size());
+    for (auto& entry: after)
+        EXPECT_GT(entry.second, before[entry.first]) << entry.first;
+}
+
+TEST(Kes_ProcFs, filterExpressions)
+{
+    Kes::ProcFs::Stat stat;
+    stat.valid = true;
+    stat.pid = 4242;
+    stat.ppid = 1;
+    stat.ruid = 1000;
+    stat.state = 'D';
+    stat.comm = "nginx";
+
+    std::string comm("nginx");
+    std::string exe("/usr/sbin/nginx");
+    std::string cmdLine("/usr/sbin/nginx -g daemon off;");
+    Kes::Private::ProcessFilter::Subject subject{ stat, comm, exe, cmdLine };
+
+    auto match = [&subject](const char* expression)
+    {
+        Kes::Private::ProcessFilter filter(expression);
+        return filter.match(subject);
+    };
+
+    EXPECT_TRUE(match("uid == 1000"));
+    EXPECT_TRUE(match("process.ruid == 1000"));
+    EXPECT_FALSE(match("uid != 1000"));
+    EXPECT_TRUE(match("pid > 4000 && pid <= 4242"));
+    EXPECT_FALSE(match("pid < 4242"));
+    EXPECT_TRUE(match("state == D"));
+    EXPECT_TRUE(match("not state == Z"));
+    EXPECT_TRUE(match("!(state == Z)"));
+    EXPECT_TRUE(match("comm ~ 'ngin*'"));
+    EXPECT_FALSE(match("comm ~ 'apache*'"));
+    EXPECT_TRUE(match("cmdline =~ \"^/usr/s?bin/\""));
+    EXPECT_TRUE(match("uid == 1000 and (comm ~ 'httpd*' or exe =~ 'nginx$') and not state == Z"));
+    EXPECT_TRUE(match("uid == 0 or comm == nginx"));
+    EXPECT_TRUE(match("comm == 'httpd'  or  comm == \"nginx\""));
+    EXPECT_TRUE(match("comm == 'a\\'b' or ppid == 1"));
+    EXPECT_TRUE(match("comm > nfs and comm < nginy"));
+
+    // errors name the position
+    for (auto bad: { "", "uid", "uid ==", "uid == nginx", "comm == 10", "pid ~ '1*'", "bogus == 1", "(uid == 1", "uid == 1 )", "comm == 'open", "exe =~ '('", "uid == 1 and" })
+        EXPECT_THROW(Kes::Private::ProcessFilter filter(bad), Kes::Exception) << bad;
+
+    try
+    {
+        Kes::Private::ProcessFilter filter("uid == 1 and bogus == 2");
+        ADD_FAILURE();
+    }
+    catch (Kes::Exception& e)
+    {
+        EXPECT_NE(std::string(e.what()).find("position 13"), std::string::npos) << e.what();
+    }
+
+    std::string deep(Kes::Private::ProcessFilter::MaxDepth + 1, '(');
+    deep.append("uid == 1");
+    deep.append(Kes::Private::ProcessFilter::MaxDepth + 1, ')');
+    EXPECT_THROW(Kes::Private::ProcessFilter filter(deep), Kes::Exception);
+
+    EXPECT_THROW(Kes::Private::ProcessFilter filter(std::string(Kes::Private::ProcessFilter::MaxLength + 1, ' ')), Kes::Exception);
+
+    // whatever a response can carry, an expression can test
+    for (auto& field: Kes::Private::ProcessField::all())
+    {
+        EXPECT_EQ(Kes::Private::ProcessField::find(field.idstr), &field);
+        EXPECT_EQ(Kes::Private::ProcessField::find(field.name()), &field);
+        EXPECT_NE(!field.number, !field.text) << field.name();
+
+        auto expression = std::string(field.name()) + (field.number ? " >= -1" : " ~ '*'");
+        EXPECT_NO_THROW(Kes::Private::ProcessFilter filter(expression)) << expression;
+    }
+
+    EXPECT_TRUE(match("minflt == 0 and majflt < 1 and flags >= 0"));
+    EXPECT_FALSE(match("fd_count >= 0")); // not read
+}
+
+TEST(Kes_ProcFs, diffWithFilter)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("filter"), 50);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    auto filtered = [](const char* expression)
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(request, std::string(expression));
+        return request;
+    };
+
+    // synthetic processes start out with utime 100, the survivors of a churn accumulate more
+    auto request = filtered("utime == 100 and comm ~ 'synth-*'");
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 50u);
+    }
+
+    synthetic.churn(5);
+
+    // the 5 new processes match, the removed ones and the survivors that left the filter are deleted
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, request, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 5u);
+        EXPECT_EQ(newcomers(response), 5u);
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), 50u);
+    }
+
+    // dropping the filter brings the others back as new
+    {
+        Kes::PropertyBag unfiltered{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 3, unfiltered, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 50u);
+        EXPECT_EQ(newcomers(response), 45u);
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), 0u);
+    }
+
+    // a bad expression fails the request, not the session
+    {
+        auto bad = filtered("uid ==");
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 4, bad, response));
+
+        auto status = Kes::Util::findInTable<Kes::Response::Props::Status>(response);
+        ASSERT_NE(status, nullptr);
+        EXPECT_EQ(*status, Kes::Response::Fail);
+        EXPECT_NE(Kes::Util::findInTable<Kes::Response::Props::Reason>(response), nullptr);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Request::Props::Id>(response), 4);
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, sortedPages)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("sorted"), 50);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    auto sorted = [](const char* sortBy, const char* order, int limit, const std::string& cursor)
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::SortBy>(request, std::string(sortBy));
+        Kes::Util::addToTable<Kes::ProcessProps::Order>(request, std::string(order));
+        Kes::Util::addToTable<Kes::ProcessProps::Limit>(request, limit);
+        if (!cursor.empty())
+            Kes::Util::addToTable<Kes::ProcessProps::Cursor>(request, cursor);
+
+        return request;
+    };
+
+    auto nextCursor = [](const Kes::PropertyBag& response)
+    {
+        auto cursor = Kes::Util::findInTable<Kes::ProcessProps::NextCursor>(response);
+        return cursor ? *cursor : std::string();
+    };
+
+    // synthetic rss is 256 + pid % 1024: 1000..1023 are the largest, 1024..1049 the smallest
+    {
+        auto request = sorted("process.rss", "desc", 10, std::string());
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+        EXPECT_EQ(pidsOf(response), std::vector<int>({ 1023, 1022, 1021, 1020, 1019, 1018, 1017, 1016, 1015, 1014 }));
+        EXPECT_FALSE(nextCursor(response).empty());
+    }
+
+    // walking the pages visits everybody once, in order
+    std::vector<int> expected;
+    for (int pid = 1024; pid < 1050; ++pid)
+        expected.push_back(pid);
+    for (int pid = 1000; pid < 1024; ++pid)
+        expected.push_back(pid);
+
+    std::vector<int> walked;
+    std::string cursor;
+    std::string firstCursor;
+    for (int page = 0; page < 10; ++page)
+    {
+        auto request = sorted("rss", "asc", 7, cursor);
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 2, request, response));
+
+        auto pids = pidsOf(response);
+        EXPECT_LE(pids.size(), 7u);
+        walked.insert(walked.end(), pids.begin(), pids.end());
+
+        cursor = nextCursor(response);
+        if (firstCursor.empty())
+            firstCursor = cursor;
+
+        if (cursor.empty())
+            break;
+    }
+
+    EXPECT_EQ(walked, expected);
+
+    // a cursor only makes sense in the order it came from
+    {
+        auto request = sorted("rss", "desc", 7, firstCursor);
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 3, request, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    struct Bad
+    {
+        const char* sortBy;
+        const char* order;
+        int limit;
+        const char* cursor;
+    };
+
+    for (auto& b: { Bad{ "bogus", "asc", 1, "" }, Bad{ "pid", "sideways", 1, "" }, Bad{ "pid", "asc", -1, "" }, Bad{ "pid", "asc", 1, "pid:a:x:1" } })
+    {
+        auto bad = sorted(b.sortBy, b.order, b.limit, b.cursor);
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 4, bad, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    // top 10 by pid: the new processes push the old ones out of the view
+    auto top = sorted("pid", "desc", 10, std::string());
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 5, top, response));
+        EXPECT_EQ(pidsOf(response).front(), 1049);
+    }
+
+    synthetic.churn(5);
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 6, top, response));
+
+        auto pids = pidsOf(response);
+        ASSERT_EQ(pids.size(), 10u);
+        EXPECT_EQ(std::vector<int>(pids.begin(), pids.begin() + 5), std::vector<int>({ 1054, 1053, 1052, 1051, 1050 }));
+        EXPECT_GE(newcomers(response), 5u);
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedProcessList::idstr()), newcomers(response));
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, fieldProjection)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("projection"), 20);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    // the procfs files read while handling a request
+    auto process = [&pm](const char* command, const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        std::set<std::string> files;
+        for (auto& file: tracedReads(pm, sessionId, command, request, response))
+            files.insert(file.first);
+
+        files.erase("pids");
+        files.erase("sysstat");
+        return files;
+    };
+
+    auto keysOf = [](const Kes::PropertyBag& response)
+    {
+        std::set<std::string> keys;
+        for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+        {
+            for (auto& field: process->table())
+                keys.insert(field.first);
+        }
+
+        return keys;
+    };
+
+    // a tree view reads stat and comm only
+    {
+        auto request = fieldsRequest({ "pid", "ppid", "process.comm" });
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_EQ(process("list_processes", request, response), std::set<std::string>({ "stat", "comm" }));
+        EXPECT_EQ(keysOf(response), std::set<std::string>({ "process.pid", "process.ppid", "process.comm" }));
+    }
+
+    // a filter pulls in what it looks at, without adding it to the response
+    {
+        auto request = fieldsRequest({ "pid" });
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(request, std::string("cmdline =~ 'instance 100[0-4]$'"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_EQ(process("diff_processes", request, response), std::set<std::string>({ "cmdline" }));
+        EXPECT_EQ(keysOf(response), std::set<std::string>({ "process.pid", "process.newcomer" })); // they entered the view
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 5u);
+    }
+
+    // the default set reads everything
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_EQ(process("list_processes", request, response), std::set<std::string>({ "stat", "comm", "exe", "cmdline" }));
+        EXPECT_EQ(keysOf(response).count("process.exe"), 1u);
+        EXPECT_EQ(keysOf(response).count("process.minflt"), 0u);
+    }
+
+    // all of stat
+    {
+        auto request = fieldsRequest({ "*" });
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        process("list_processes", request, response);
+
+        auto keys = keysOf(response);
+        for (auto key: { "process.state", "process.minflt", "process.num_threads", "process.rss", "process.exit_code", "process.start_time" })
+            EXPECT_EQ(keys.count(key), 1u) << key;
+
+        auto& first = *response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array().front();
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::State>(first), "S");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NumThreads>(first), Kes::ProcessProps::NumThreads::ValueType((*Kes::Util::findInTable<Kes::ProcessProps::Pid>(first) % 8 == 0) ? 4 : 1));
+        EXPECT_FALSE(Kes::propertyBagToJson(response).empty());
+    }
+
+    {
+        auto request = fieldsRequest({ "pid", "bogus" });
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        process("list_processes", request, response);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, cpuSampler)
+{
+    const uint64_t second = 1000000000ULL;
+    const auto hz = uint64_t(::sysconf(_SC_CLK_TCK));
+
+    Kes::Private::CpuSampler sampler;
+    sampler.beginScan();
+    EXPECT_LT(sampler.update(100, 5, 0, 0), 0);
+
+    // too close to the baseline to say anything yet
+    EXPECT_LT(sampler.update(100, 5, 1, second / 20), 0);
+
+    sampler.beginScan();
+    EXPECT_DOUBLE_EQ(sampler.update(100, 5, hz / 2, second), 50);
+
+    // until the next interval the last rate stands
+    sampler.beginScan();
+    EXPECT_DOUBLE_EQ(sampler.update(100, 5, hz, second + second / 20), 50);
+
+    // pid reuse
+    sampler.beginScan();
+    EXPECT_LT(sampler.update(100, 6, 0, 2 * second), 0);
+
+    // the table grows with the processes and forgets the gone ones
+    for (pid_t pid = 1; pid <= 3000; ++pid)
+        sampler.update(1000 + pid, 1, 0, 3 * second);
+
+    EXPECT_EQ(sampler.size(), 3001u);
+
+    for (int scan = 0; scan < 3; ++scan)
+        sampler.beginScan();
+
+    for (pid_t pid = 1; pid <= 3000; ++pid)
+        sampler.update(10000 + pid, 1, 0, 4 * second);
+
+    EXPECT_LT(sampler.size(), 6001u);
+    EXPECT_GE(sampler.size(), 3000u);
+
+    EXPECT_LT(sampler.systemBusy(), 0);
+
+    Kes::ProcFs::CpuTimes times;
+    times.valid = true;
+    sampler.updateSystem(times, 0);
+    EXPECT_LT(sampler.systemBusy(), 0);
+
+    times.user = 20;
+    times.system = 10;
+    times.idle = 80;
+    times.iowait = 10;
+    sampler.updateSystem(times, second);
+    EXPECT_DOUBLE_EQ(sampler.systemBusy(), 25);
+    EXPECT_DOUBLE_EQ(sampler.systemIdle(), 75);
+}
+
+TEST(Kes_ProcFs, cpuRates)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("cpu"), 20);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::SystemBusy>(response), nullptr);
+    }
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds(Kes::Private::CpuSampler::MinInterval));
+    synthetic.churn(5);
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, request, response));
+
+        ASSERT_NE(Kes::Util::findInTable<Kes::ProcessProps::SystemBusy>(response), nullptr);
+        EXPECT_DOUBLE_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SystemBusy>(response), 25);
+        EXPECT_DOUBLE_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SystemIdle>(response), 75);
+
+        // the survivors accumulated CPU time, the newcomers have no history
+        size_t rated = 0;
+        for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+        {
+            auto cpu = Kes::Util::findInTable<Kes::ProcessProps::Cpu>(*process);
+            auto newcomer = process->table().count(Kes::ProcessProps::Newcomer::idstr()) > 0;
+            EXPECT_EQ(cpu == nullptr, newcomer);
+            if (cpu)
+            {
+                EXPECT_GT(*cpu, 0);
+                ++rated;
+            }
+        }
+
+        EXPECT_EQ(rated, 15u);
+
+        // doubles survive a round trip
+        auto json = Kes::propertyBagToJson(response);
+        EXPECT_NE(json.find("\"system.cpu_busy\":25.0"), std::string::npos) << json.substr(0, 200);
+    }
+
+    // sortable and filterable
+    {
+        Kes::PropertyBag sorted{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::SortBy>(sorted, std::string("cpu"));
+        Kes::Util::addToTable<Kes::ProcessProps::Order>(sorted, std::string("desc"));
+        Kes::Util::addToTable<Kes::ProcessProps::Limit>(sorted, 3);
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(sorted, std::string("cpu >= 0.5"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 3, sorted, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 3u);
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, threads)
+{
+    // enough tasks to spread them over several workers
+    const size_t count = 600;
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("threads"), count);
+
+    size_t expected = 0;
+    for (auto pid: synthetic.pids())
+        expected += (pid % 8 == 0) ? 4 : 1;
+
+    RequestProcessor rp;
+    Kes::Private::ThreadManager tm(&rp, Logger::instance(), synthetic.root(), 4);
+
+    const uint32_t sessionId = 1;
+    tm.startSession(sessionId);
+
+    auto threadsOf = [](const Kes::PropertyBag& response)
+    {
+        std::map<int, const Kes::PropertyBag*> threads;
+        for (auto& thread: response.table().find(Kes::ProcessProps::ThreadList::idstr())->second->array())
+            threads[*Kes::Util::findInTable<Kes::ProcessProps::Tid>(*thread)] = thread.get();
+
+        return threads;
+    };
+
+    // the files read while handling a request, with their counts
+    auto traced = [&tm](const char* command, const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        return tracedReads(tm, sessionId, command, request, response);
+    };
+
+    Kes::PropertyBag all{std::string(), Kes::PropertyBag::Table()};
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(tm.process(sessionId, "list_threads", 1, all, response));
+
+        auto threads = threadsOf(response);
+        ASSERT_EQ(threads.size(), expected);
+        EXPECT_EQ(response.table().count(Kes::ProcessProps::DeletedThreadList::idstr()), 0u);
+
+        auto& worker = *threads.at(3001008);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::ThreadPid>(worker), 1008);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::ThreadState>(worker), "S");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::ThreadWChan>(worker), "futex_wait_queue");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::ThreadProcessor>(worker), 3001008 % 4);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::ThreadComm>(worker), "synth-1008");
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::ThreadWChan>(*threads.at(1008)), "do_select");
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::ThreadCpu>(worker), nullptr);
+    }
+
+    // nothing changed, nothing sent
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(tm.process(sessionId, "diff_threads", 2, all, response));
+        EXPECT_TRUE(threadsOf(response).empty());
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedThreadList::idstr()), 0u);
+    }
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds(Kes::Private::CpuSampler::MinInterval));
+    synthetic.churn(10);
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(tm.process(sessionId, "diff_threads", 3, all, response));
+
+        // every survivor ran, so every thread is sent again
+        size_t newcomers = 0;
+        for (auto& thread: threadsOf(response))
+        {
+            auto newcomer = thread.second->table().count(Kes::ProcessProps::ThreadNewcomer::idstr()) > 0;
+            auto cpu = Kes::Util::findInTable<Kes::ProcessProps::ThreadCpu>(*thread.second);
+            EXPECT_EQ(cpu == nullptr, newcomer) << thread.first;
+            if (newcomer)
+                ++newcomers;
+        }
+
+        EXPECT_GE(newcomers, 10u);
+        EXPECT_GE(arraySize(response, Kes::ProcessProps::DeletedThreadList::idstr()), 10u);
+    }
+
+    // one process; the threads of the others are gone from this session's point of view
+    Kes::PropertyBag one{std::string(), Kes::PropertyBag::Table()};
+    auto pid = synthetic.pids()[0];
+    Kes::Util::addToTable<Kes::ProcessProps::Pid>(one, int(pid));
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced("list_threads", one, response);
+
+        auto threads = threadsOf(response);
+        EXPECT_EQ(threads.size(), (pid % 8 == 0) ? 4u : 1u);
+        EXPECT_EQ(files["tids"], 1u);
+        EXPECT_EQ(files["taskstat"], threads.size());
+        EXPECT_EQ(files["wchan"], threads.size());
+        EXPECT_EQ(files.count("pids"), 0u);
+    }
+
+    // threads that did not run keep their wchan without reading it again
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced("diff_threads", one, response);
+        EXPECT_TRUE(threadsOf(response).empty());
+        EXPECT_EQ(files.count("wchan"), 0u);
+    }
+
+    {
+        Kes::PropertyBag bad{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::Pid>(bad, -5);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(tm.process(sessionId, "list_threads", 4, bad, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    tm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, memoryDetail)
+{
+    const size_t count = 30;
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("memory"), count);
+
+    Kes::Private::RefreshOptions options;
+    options.slowInterval = std::chrono::hours(1);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root(), Kes::Private::ProcessManager::DefaultHistoryDepth, options);
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    auto request = [](std::initializer_list<const char*> fields, bool refresh)
+    {
+        auto request = fieldsRequest(fields);
+        if (refresh)
+            Kes::Util::addToTable<Kes::ProcessProps::Refresh>(request, true);
+
+        return request;
+    };
+
+    // how many times each file was read while handling a request
+    auto process = [](Kes::Private::ProcessManager& pm, const char* command, const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        return tracedReads(pm, sessionId, command, request, response);
+    };
+
+    auto byPid = [](const Kes::PropertyBag& response)
+    {
+        std::map<int, const Kes::PropertyBag*> processes;
+        for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+            processes[*Kes::Util::findInTable<Kes::ProcessProps::Pid>(*process)] = process.get();
+
+        return processes;
+    };
+
+    auto detail = request({ "rss_anon", "rss_file", "swap", "shared", "pss", "pss_file" }, false);
+    const uint64_t pageSize = uint64_t(::sysconf(_SC_PAGESIZE));
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = process(pm, "list_processes", detail, response);
+        EXPECT_EQ(files["status"], count);
+        EXPECT_EQ(files["statm"], count);
+        EXPECT_EQ(files["smaps_rollup"], count);
+        EXPECT_EQ(files.count("cmdline"), 0u);
+
+        auto processes = byPid(response);
+        ASSERT_EQ(processes.size(), count);
+
+        auto pid = synthetic.pids()[3];
+        uint64_t rss = 1024 + pid % 4096;
+        auto& p = *processes.at(pid);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::RssAnon>(p), rss * 3 / 4 * 1024);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::RssFile>(p), (rss - rss * 3 / 4) * 1024);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::Swap>(p), rss / 8 * 1024);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::Shared>(p), rss / 16 * pageSize);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::Pss>(p), (rss * 3 / 4 + (rss - rss * 3 / 4) / 2) * 1024);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::PssFile>(p), (rss - rss * 3 / 4) / 2 * 1024);
+        EXPECT_NE(Kes::Util::findInTable<Kes::ProcessProps::SmapsAge>(p), nullptr);
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::PssAnon>(p), nullptr);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // cached: the cheap fields are read again, the slow ones just get older
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = process(pm, "diff_processes", detail, response);
+        EXPECT_EQ(files["status"], count);
+        EXPECT_EQ(files.count("smaps_rollup"), 0u);
+
+        for (auto& p: byPid(response))
+        {
+            EXPECT_NE(Kes::Util::findInTable<Kes::ProcessProps::Pss>(*p.second), nullptr);
+            EXPECT_GE(*Kes::Util::findInTable<Kes::ProcessProps::SmapsAge>(*p.second), 20u);
+        }
+    }
+
+    // on demand
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = process(pm, "diff_processes", request({ "pss" }, true), response);
+        EXPECT_EQ(files["smaps_rollup"], count);
+        EXPECT_EQ(files.count("status"), 0u);
+
+        for (auto& p: byPid(response))
+            EXPECT_LT(*Kes::Util::findInTable<Kes::ProcessProps::SmapsAge>(*p.second), 20u);
+    }
+
+    // a filter that does not look at the slow fields narrows what is worth reading
+    {
+        auto filtered = request({ "pss" }, true);
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(filtered, "pid == " + std::to_string(synthetic.pids()[0]));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = process(pm, "diff_processes", filtered, response);
+        EXPECT_EQ(files["smaps_rollup"], 1u);
+    }
+
+    // one that does needs them all
+    {
+        auto filtered = request({ "pss" }, true);
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(filtered, std::string("pss > 0 and swap_pss > 0"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = process(pm, "diff_processes", filtered, response);
+        EXPECT_EQ(files["smaps_rollup"], count);
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), count);
+    }
+
+    pm.endSession(sessionId);
+
+    // no budget at all: one slow read per scan, the never read ones first
+    options.slowInterval = std::chrono::milliseconds(0);
+    options.scanBudget = std::chrono::milliseconds(0);
+    Kes::Private::ProcessManager starved(&rp, Logger::instance(), nullptr, synthetic.root(), Kes::Private::ProcessManager::DefaultHistoryDepth, options);
+    starved.startSession(sessionId);
+
+    for (size_t scan = 1; scan <= 3; ++scan)
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = process(starved, (scan == 1) ? "list_processes" : "diff_processes", request({ "pss" }, false), response);
+        EXPECT_EQ(files["smaps_rollup"], 1u);
+
+        size_t known = 0;
+        for (auto& p: byPid(response))
+            known += p.second->table().count(Kes::ProcessProps::Pss::idstr());
+
+        EXPECT_EQ(known, scan);
+    }
+
+    starved.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, ioRates)
+{
+    const size_t count = 20;
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("io"), count);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    auto request = fieldsRequest({ "io_read_bytes", "io_write_bytes", "io_syscr", "io_read_bytes_rate", "io_write_bytes_rate" });
+
+    auto byPid = [](const Kes::PropertyBag& response)
+    {
+        std::map<int, const Kes::PropertyBag*> processes;
+        for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+            processes[*Kes::Util::findInTable<Kes::ProcessProps::Pid>(*process)] = process.get();
+
+        return processes;
+    };
+
+    // the first samples are taken by the list
+    auto started = std::chrono::steady_clock::now();
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+
+        auto processes = byPid(response);
+        ASSERT_EQ(processes.size(), count);
+
+        auto pid = synthetic.pids()[0];
+        auto& p = *processes.at(pid);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::IoReadBytes>(p), uint64_t(pid) * 4096);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::IoWriteBytes>(p), uint64_t(pid) * 1024);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::IoSyscR>(p), uint64_t(pid));
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::IoReadBytesRate>(p), nullptr);
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::IoRChar>(p), nullptr);
+    }
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds(Kes::Private::CpuSampler::MinInterval));
+    synthetic.churn(2);
+
+    // unreadable io: no io fields, the rest is there
+    auto hidden = synthetic.pids()[1];
+    std::filesystem::remove(synthetic.root() + "/" + std::to_string(hidden) + "/io");
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, request, response));
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        size_t rated = 0;
+        for (auto& p: byPid(response))
+        {
+            auto newcomer = p.second->table().count(Kes::ProcessProps::Newcomer::idstr()) > 0;
+            auto read = Kes::Util::findInTable<Kes::ProcessProps::IoReadBytesRate>(*p.second);
+            auto written = Kes::Util::findInTable<Kes::ProcessProps::IoWriteBytesRate>(*p.second);
+
+            if (p.first == hidden)
+            {
+                EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::IoReadBytes>(*p.second), nullptr);
+                EXPECT_EQ(read, nullptr);
+                continue;
+            }
+
+            EXPECT_EQ(read == nullptr, newcomer) << p.first;
+            if (!read)
+                continue;
+
+            // one step over somewhere between the sleep and the whole test so far
+            EXPECT_LE(*read, Kes::ProcFs::SyntheticProcFs::IoReadStep / 0.2 + 1);
+            EXPECT_GE(*read, Kes::ProcFs::SyntheticProcFs::IoReadStep / elapsed - 1);
+            EXPECT_NEAR(*read / *written, double(Kes::ProcFs::SyntheticProcFs::IoReadStep) / Kes::ProcFs::SyntheticProcFs::IoWriteStep, 0.01);
+            ++rated;
+        }
+
+        EXPECT_EQ(rated, count - 3);
+    }
+
+    // the disk hammerers first
+    {
+        Kes::PropertyBag sorted{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::SortBy>(sorted, std::string("io_read_bytes_rate"));
+        Kes::Util::addToTable<Kes::ProcessProps::Order>(sorted, std::string("desc"));
+        Kes::Util::addToTable<Kes::ProcessProps::Limit>(sorted, 3);
+        Kes::Util::addToTable<Kes::ProcessProps::Filter>(sorted, std::string("io_write_bytes_rate > 0"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 3, sorted, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 3u);
+    }
+
+    pm.endSession(sessionId);
+}
+
+TEST(Kes_ProcFs, namespaces)
+{
+    using Synthetic = Kes::ProcFs::SyntheticProcFs;
+
+    const size_t count = 25;
+    Synthetic synthetic(tempRoot("namespaces"), count);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    auto grouped = [](const char* filter)
+    {
+        auto request = fieldsRequest({ "pid_ns", "net_ns", "user_ns", "ns_pid", "ns_level" });
+        Kes::Util::addToTable<Kes::ProcessProps::GroupBy>(request, std::string("namespace"));
+        if (filter)
+            Kes::Util::addToTable<Kes::ProcessProps::Filter>(request, std::string(filter));
+
+        return request;
+    };
+
+    auto groupsOf = [](const Kes::PropertyBag& response)
+    {
+        std::vector<const Kes::PropertyBag*> groups;
+        for (auto& group: response.table().find(Kes::ProcessProps::GroupList::idstr())->second->array())
+            groups.push_back(group.get());
+
+        return groups;
+    };
+
+    auto pidsOf = [](const Kes::PropertyBag& group)
+    {
+        std::vector<int> pids;
+        for (auto& pid: group.table().find(Kes::ProcessProps::GroupPids::idstr())->second->array())
+            pids.push_back(std::any_cast<int>(pid->property().value));
+
+        return pids;
+    };
+
+    std::string token;
+
+    // the host and every container; NSpid comes with the one status read
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = tracedReads(pm, sessionId, "list_processes", grouped(nullptr), response);
+
+        EXPECT_EQ(files["ns"], count * Kes::ProcFs::Namespaces::KindCount);
+        EXPECT_EQ(files["status"], count);
+        EXPECT_EQ(response.table().count(Kes::ProcessProps::DeletedGroupList::idstr()), 0u);
+        token = *Kes::Util::findInTable<Kes::ProcessProps::Token>(response);
+
+        std::map<int, const Kes::PropertyBag*> processes;
+        for (auto& process: response.table().find(Kes::ProcessProps::ProcessList::idstr())->second->array())
+            processes[*Kes::Util::findInTable<Kes::ProcessProps::Pid>(*process)] = process.get();
+
+        ASSERT_EQ(processes.size(), count);
+
+        auto& host = *processes.at(1005);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::PidNs>(host), Synthetic::namespaceOf(1005, Kes::ProcFs::Namespaces::Pid));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NsPid>(host), 1005);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NsLevel>(host), 0);
+
+        auto& contained = *processes.at(1007);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::PidNs>(contained), Synthetic::namespaceOf(1007, Kes::ProcFs::Namespaces::Pid));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NetNs>(contained), Synthetic::namespaceOf(1007, Kes::ProcFs::Namespaces::Net));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::UserNs>(contained), Synthetic::namespaceOf(1005, Kes::ProcFs::Namespaces::User));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NsPid>(contained), 2);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::NsLevel>(contained), 1);
+
+        auto groups = groupsOf(response);
+        ASSERT_EQ(groups.size(), Synthetic::ContainerCount + 1);
+
+        // the host first, with no init of its own
+        EXPECT_EQ(pidsOf(*groups[0]), (std::vector<int>{ 1000, 1005, 1010, 1015, 1020 }));
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::GroupLeader>(*groups[0]), nullptr);
+
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::GroupProcesses>(*groups[2]), 5u);
+        EXPECT_EQ(pidsOf(*groups[2]), (std::vector<int>{ 1002, 1007, 1012, 1017, 1022 }));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::GroupLeader>(*groups[2]), 1002);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::PidNs>(*groups[2]), Synthetic::namespaceOf(1002, Kes::ProcFs::Namespaces::Pid));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::MntNs>(*groups[2]), Synthetic::namespaceOf(1002, Kes::ProcFs::Namespaces::Mnt));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::CgroupNs>(*groups[2]), Synthetic::namespaceOf(1002, Kes::ProcFs::Namespaces::Cgroup));
+        EXPECT_NE(*Kes::Util::findInTable<Kes::ProcessProps::GroupKey>(*groups[2]), *Kes::Util::findInTable<Kes::ProcessProps::GroupKey>(*groups[0]));
+    }
+
+    // nothing changed, no group is sent again
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, grouped(nullptr), response));
+        EXPECT_TRUE(groupsOf(response).empty());
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedGroupList::idstr()), 0u);
+    }
+
+    // nor to a session that resumes from the list
+    {
+        const uint32_t resumed = 2;
+        pm.startSession(resumed);
+
+        auto request = grouped(nullptr);
+        Kes::Util::addToTable<Kes::ProcessProps::Token>(request, token);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(resumed, "diff_processes", 1, request, response));
+        EXPECT_NE(Kes::Util::findInTable<Kes::ProcessProps::Resumed>(response), nullptr);
+        EXPECT_TRUE(groupsOf(response).empty());
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedGroupList::idstr()), 0u);
+
+        pm.endSession(resumed);
+    }
+
+    // one container, which the client has already; the groups follow the filter, not the page
+    {
+        auto filter = "pid_ns == " + std::to_string(Synthetic::namespaceOf(1003, Kes::ProcFs::Namespaces::Pid));
+        auto request = grouped(filter.c_str());
+        Kes::Util::addToTable<Kes::ProcessProps::Limit>(request, 2);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 2, request, response));
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::ProcessList::idstr()), 2u);
+        EXPECT_TRUE(groupsOf(response).empty());
+        EXPECT_EQ(arraySize(response, Kes::ProcessProps::DeletedGroupList::idstr()), size_t(Synthetic::ContainerCount));
+    }
+
+    // the newcomers join the groups of their namespaces
+    synthetic.churn(10);
+
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 3, grouped("ns_level > 0"), response));
+
+        size_t contained = 0;
+        for (auto pid: synthetic.pids())
+            contained += Synthetic::containerOf(pid) ? 1 : 0;
+
+        size_t members = 0;
+        for (auto group: groupsOf(response))
+        {
+            auto pids = pidsOf(*group);
+            for (auto pid: pids)
+                EXPECT_EQ(Synthetic::containerOf(pid), Synthetic::containerOf(pids.front())) << pid;
+
+            members += pids.size();
+        }
+
+        EXPECT_EQ(members, contained);
+    }
+
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::Util::addToTable<Kes::ProcessProps::GroupBy>(request, std::string("uid"));
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(pm.process(sessionId, "diff_processes", 4, request, response));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+    }
+
+    pm.endSession(sessionId);
+}
@@ -0,0 +1,57 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/trace/trace.hxx>
+#include <kesrv/trace/traceprops.hxx>
+#include <kesrv/util/clock.hxx>
+#include <kesrv/util/requestutil.hxx>
+
+#include <unistd.h>
+
+
+std::string tempRoot(const char* name)
+{
+    return "/tmp/kestests-" + std::to_string(::getpid()) + "-" + name;
+}
+
+size_t arraySize(const Kes::PropertyBag& response, const char* key)
+{
+    auto it = response.table().find(key);
+    if (it == response.table().end())
+        return 0;
+
+    return it->second->array().size();
+}
+
+Kes::PropertyBag fieldsRequest(std::initializer_list<const char*> fields)
+{
+    Kes::PropertyBag array{Kes::ProcessProps::Fields::idstr(), Kes::PropertyBag::Array()};
+    for (auto field: fields)
+        array.array().push_back(std::make_unique<Kes::PropertyBag>(std::string(), Kes::Property(Kes::InvalidPropId, std::string(field))));
+
+    Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+    request.table().insert({ Kes::ProcessProps::Fields::idstr(), std::make_unique<Kes::PropertyBag>(std::move(array)) });
+    return request;
+}
+
+std::map<std::string, uint64_t> tracedReads(Kes::IRequestHandler& handler, uint32_t sessionId, const char* command, const Kes::PropertyBag& request, Kes::PropertyBag& response)
+{
+    auto started = Kes::Util::Clock::ticks();
+    Kes::Trace::Context context(Kes::Trace::Frame{}, started, started);
+    {
+        Kes::Trace::Context::Activate activate(&context);
+        EXPECT_TRUE(handler.process(sessionId, command, 1, request, response));
+    }
+
+    std::map<std::string, uint64_t> files;
+    auto trace = context.serialize();
+    auto list = trace.table().find(Kes::TraceProps::FileList::idstr());
+    if (list != trace.table().end())
+    {
+        for (auto& file: list->second->array())
+            files[*Kes::Util::findInTable<Kes::TraceProps::FileName>(*file)] = *Kes::Util::findInTable<Kes::TraceProps::FileReads>(*file);
+    }
+
+    return files;
+}
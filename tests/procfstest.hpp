@@ -0,0 +1,54 @@
+#pragma once
+
+
+#include <kesrv/propertybag.hxx>
+#include <kesrv/requestprocessor.hxx>
+
+#include <initializer_list>
+#include <map>
+#include <string>
+
+
+// a directory for a SyntheticProcFs of this test run
+std::string tempRoot(const char* name);
+
+// the number of items in the array 'key' of the response, 0 if there is none
+size_t arraySize(const Kes::PropertyBag& response, const char* key);
+
+// a request table that selects 'fields'
+Kes::PropertyBag fieldsRequest(std::initializer_list<const char*> fields);
+
+// has the handler process the request under a trace and returns how many times each file was read
+std::map<std::string, uint64_t> tracedReads(Kes::IRequestHandler& handler, uint32_t sessionId, const char* command, const Kes::PropertyBag& request, Kes::PropertyBag& response);
+
+
+// keeps the handlers the managers register
+class RequestProcessor final
+    : public Kes::IRequestProcessor
+{
+public:
+    std::string process(uint32_t, char*, size_t) override
+    {
+        return std::string();
+    }
+
+    void registerHandler(const char* key, Kes::IRequestHandler* handler) override
+    {
+        handlers[key] = handler;
+    }
+
+    void unregisterHandler(const char* key, Kes::IRequestHandler*) override
+    {
+        handlers.erase(key);
+    }
+
+    void startSession(uint32_t) override
+    {
+    }
+
+    void endSession(uint32_t) override
+    {
+    }
+
+    std::map<std::string, Kes::IRequestHandler*> handlers;
+};
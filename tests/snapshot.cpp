@@ -0,0 +1,303 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesclient/snapshotreader.hxx>
+#include <kesrv/exception.hxx>
+#include <kesrv/processmanager/processmanager.hxx>
+#include <kesrv/processmanager/snapshotpublisher.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+
+#include <algorithm>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+std::string shmName(const char* name)
+{
+    return "/kestests-" + std::to_string(::getpid()) + "-" + name;
+}
+
+std::vector<pid_t> pidsOf(const Kes::Client::ProcessList& list)
+{
+    std::vector<pid_t> pids;
+    for (auto& entry: list.processes)
+        pids.push_back(entry.pid);
+
+    std::sort(pids.begin(), pids.end());
+    return pids;
+}
+
+// maps a new region of the snapshot header size; the caller fills it in
+Kes::Snapshot::Header* createRegion(const std::string& name)
+{
+    auto fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+        return nullptr;
+
+    void* region = MAP_FAILED;
+    if (::ftruncate(fd, off_t(Kes::Snapshot::headerSize())) == 0)
+        region = ::mmap(nullptr, Kes::Snapshot::headerSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+    return (region == MAP_FAILED) ? nullptr : static_cast<Kes::Snapshot::Header*>(region);
+}
+
+struct stat regionStat(const std::string& name)
+{
+    struct stat st = {};
+    auto fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd != -1)
+    {
+        ::fstat(fd, &st);
+        ::close(fd);
+    }
+
+    return st;
+}
+
+} // namespace {}
+
+
+TEST(Kes_Snapshot, publishAndRead)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("snapshot"), 50);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    Kes::Private::SnapshotOptions options;
+    options.name = shmName("snapshot");
+    options.interval = std::chrono::milliseconds(0);    // every publish() samples
+    options.capacity = 100;
+    options.stringCapacity = 64 * 1024;
+
+    EXPECT_THROW(Kes::Client::SnapshotReader reader(options.name), Kes::Exception);
+
+    std::unique_ptr<Kes::Client::SnapshotReader> reader;
+    Kes::Client::ProcessList list;
+
+    {
+        Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+
+        reader.reset(new Kes::Client::SnapshotReader(options.name));
+        EXPECT_EQ(reader->generation(), 0u);
+        EXPECT_FALSE(reader->read(list));
+
+        publisher.publish();
+        EXPECT_EQ(reader->generation(), 1u);
+        ASSERT_TRUE(reader->read(list));
+        EXPECT_EQ(reader->lastGeneration(), 1u);
+        EXPECT_GT(reader->lastTimestamp(), 0u);
+        EXPECT_FALSE(reader->truncated());
+        EXPECT_EQ(pidsOf(list), synthetic.pids());
+
+        auto pid = Kes::ProcFs::SyntheticProcFs::FirstPid + 8;
+        auto it = std::find_if(list.processes.begin(), list.processes.end(), [pid](auto& e) { return e.pid == pid; });
+        ASSERT_NE(it, list.processes.end());
+        EXPECT_EQ(it->ppid, 1);
+        EXPECT_EQ(it->comm, "synth-" + std::to_string(pid));
+        EXPECT_EQ(it->statComm, "synth-" + std::to_string(pid));
+        EXPECT_EQ(it->exe, "/usr/bin/synth-" + std::to_string(pid));
+        EXPECT_EQ(it->cmdLine, "/usr/bin/synth-" + std::to_string(pid) + " --instance " + std::to_string(pid));
+        EXPECT_TRUE(it->error.empty());
+
+        // the next scan goes to the other buffer
+        synthetic.churn(5);
+        publisher.publish();
+        ASSERT_TRUE(reader->read(list));
+        EXPECT_EQ(reader->lastGeneration(), 2u);
+
+        auto expected = synthetic.pids();
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(pidsOf(list), expected);
+    }
+
+    // the region is gone with the publisher
+    EXPECT_EQ(reader->generation(), 0u);
+    EXPECT_FALSE(reader->read(list));
+
+    // a new publisher under the same name is picked up
+    Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+    publisher.publish();
+    ASSERT_TRUE(reader->read(list));
+    EXPECT_EQ(reader->lastGeneration(), 1u);
+    EXPECT_EQ(list.processes.size(), 50u);
+}
+
+TEST(Kes_Snapshot, truncated)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("truncated"), 20);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    Kes::Private::SnapshotOptions options;
+    options.name = shmName("truncated");
+    options.capacity = 10;
+    options.stringCapacity = 4096;
+
+    Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+    publisher.publish();
+
+    Kes::Client::SnapshotReader reader(options.name);
+    Kes::Client::ProcessList list;
+    ASSERT_TRUE(reader.read(list));
+    EXPECT_TRUE(reader.truncated());
+    EXPECT_EQ(list.processes.size(), 10u);
+}
+
+TEST(Kes_Snapshot, concurrentReads)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("concurrent"), 30);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    Kes::Private::SnapshotOptions options;
+    options.name = shmName("concurrent");
+    options.interval = std::chrono::milliseconds(1);
+    options.capacity = 64;
+    options.stringCapacity = 64 * 1024;
+
+    Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+    publisher.start();
+
+    // every snapshot that is read must be a complete one
+    Kes::Client::SnapshotReader reader(options.name);
+    Kes::Client::ProcessList list;
+    uint64_t last = 0;
+    size_t reads = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        if (!reader.read(list))
+            continue;
+
+        ++reads;
+        EXPECT_GE(reader.lastGeneration(), last);
+        last = reader.lastGeneration();
+
+        ASSERT_EQ(list.processes.size(), 30u);
+        for (auto& entry: list.processes)
+            ASSERT_TRUE((entry.comm.substr(0, 6) == "synth-") || (entry.comm.substr(0, 4) == "odd)")) << entry.comm;
+    }
+
+    publisher.stop();
+
+    EXPECT_GT(reads, 0u);
+    EXPECT_GT(last, 1u);
+}
+
+TEST(Kes_Snapshot, existingRegion)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("existing"), 10);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    Kes::Private::SnapshotOptions options;
+    options.name = shmName("existing");
+    options.capacity = 20;
+    options.stringCapacity = 4096;
+
+    {
+        Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+        publisher.publish();
+
+        // private to the owner by default
+        EXPECT_EQ(regionStat(options.name).st_mode & 0777, 0600u);
+
+        // a live publisher keeps its region
+        EXPECT_THROW(Kes::Private::SnapshotPublisher(Logger::instance(), &pm, synthetic.root(), options), Kes::Exception);
+
+        Kes::Client::SnapshotReader reader(options.name);
+        Kes::Client::ProcessList list;
+        ASSERT_TRUE(reader.read(list));
+        EXPECT_EQ(pidsOf(list), synthetic.pids());
+    }
+
+    // something that is not a snapshot is left alone
+    auto foreign = createRegion(options.name);
+    ASSERT_NE(foreign, nullptr);
+    EXPECT_THROW(Kes::Private::SnapshotPublisher(Logger::instance(), &pm, synthetic.root(), options), Kes::Exception);
+    ::munmap(foreign, Kes::Snapshot::headerSize());
+    EXPECT_EQ(regionStat(options.name).st_size, off_t(Kes::Snapshot::headerSize()));
+    ::shm_unlink(options.name.c_str());
+
+    // a crashed publisher's region is closed and replaced
+    auto child = ::fork();
+    if (child == 0)
+        ::_exit(0);
+    ASSERT_GT(child, 0);
+    ::waitpid(child, nullptr, 0);
+
+    auto abandoned = createRegion(options.name);
+    ASSERT_NE(abandoned, nullptr);
+    std::memcpy(abandoned->magic, Kes::Snapshot::Magic, sizeof(Kes::Snapshot::Magic));
+    abandoned->writerPid = child;
+    abandoned->state.store(uint32_t(Kes::Snapshot::State::Live));
+
+    {
+        options.group = std::to_string(::getegid());
+        Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+        EXPECT_EQ(abandoned->state.load(), uint32_t(Kes::Snapshot::State::Closed));
+
+        auto st = regionStat(options.name);
+        EXPECT_EQ(st.st_mode & 0777, 0640u);
+        EXPECT_EQ(st.st_gid, ::getegid());
+    }
+
+    ::munmap(abandoned, Kes::Snapshot::headerSize());
+
+    options.group = "kestests-no-such-group";
+    EXPECT_THROW(Kes::Private::SnapshotPublisher(Logger::instance(), &pm, synthetic.root(), options), Kes::Exception);
+    EXPECT_EQ(regionStat(options.name).st_size, 0);
+}
+
+TEST(Kes_Snapshot, sessionScan)
+{
+    Kes::ProcFs::SyntheticProcFs synthetic(tempRoot("sessionscan"), 20);
+
+    RequestProcessor rp;
+    Kes::Private::ProcessManager pm(&rp, Logger::instance(), nullptr, synthetic.root());
+
+    Kes::Private::SnapshotOptions options;
+    options.name = shmName("sessionscan");
+    options.interval = std::chrono::hours(1);
+    options.capacity = 100;
+    options.stringCapacity = 64 * 1024;
+
+    Kes::Private::SnapshotPublisher publisher(Logger::instance(), &pm, synthetic.root(), options);
+
+    const uint32_t sessionId = 1;
+    pm.startSession(sessionId);
+
+    Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+    Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+    EXPECT_TRUE(pm.process(sessionId, "list_processes", 1, request, response));
+    auto scanned = synthetic.pids();
+    std::sort(scanned.begin(), scanned.end());
+
+    // the session scan is published as it was, the publisher does not scan again
+    synthetic.churn(5);
+    publisher.publish();
+
+    Kes::Client::SnapshotReader reader(options.name);
+    Kes::Client::ProcessList list;
+    ASSERT_TRUE(reader.read(list));
+    EXPECT_EQ(pidsOf(list), scanned);
+
+    // nothing new to publish
+    publisher.publish();
+    EXPECT_EQ(publisher.generation(), 1u);
+
+    pm.endSession(sessionId);
+}
@@ -0,0 +1,67 @@
+#include "common.hpp"
+
+#include <src/kexplorer-server/socketserver.hxx>
+
+#include <fstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+using Local = boost::asio::local::stream_protocol;
+using LocalTraits = Kes::Private::SocketTraits<Local>;
+
+bool exists(const std::string& path)
+{
+    struct stat st = {};
+    return ::lstat(path.c_str(), &st) == 0;
+}
+
+} // namespace {}
+
+
+TEST(Kes_SocketServer, staleSocket)
+{
+    auto path = "/tmp/kestests-" + std::to_string(::getpid()) + ".sock";
+    ::unlink(path.c_str());
+    Local::endpoint endpoint(path);
+
+    // nothing there
+    EXPECT_NO_THROW(LocalTraits::prepare(endpoint));
+
+    // not a socket: left alone
+    std::ofstream(path) << "precious";
+    EXPECT_THROW(LocalTraits::prepare(endpoint), Kes::Exception);
+    LocalTraits::cleanup(endpoint);
+    EXPECT_TRUE(exists(path));
+    ::unlink(path.c_str());
+
+    boost::asio::io_context io;
+
+    {
+        // somebody listens: left alone
+        Local::acceptor acceptor(io, endpoint);
+        EXPECT_THROW(LocalTraits::prepare(endpoint), Kes::Exception);
+        LocalTraits::cleanup(endpoint);
+        EXPECT_TRUE(exists(path));
+    }
+
+    // the listener is gone and its file stayed: removed
+    ASSERT_TRUE(exists(path));
+    EXPECT_NO_THROW(LocalTraits::prepare(endpoint));
+    EXPECT_FALSE(exists(path));
+
+    {
+        Local::acceptor acceptor(io, endpoint);
+    }
+
+    LocalTraits::cleanup(endpoint);
+    EXPECT_FALSE(exists(path));
+
+    // the abstract namespace has no files
+    Local::endpoint abstract(std::string("\0kestests-abstract", 18));
+    EXPECT_NO_THROW(LocalTraits::prepare(abstract));
+}
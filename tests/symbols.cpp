@@ -0,0 +1,257 @@
+#include "common.hpp"
+#include "procfstest.hpp"
+
+#include <kesrv/processmanager/processprops.hxx>
+#include <kesrv/processmanager/symbolmanager.hxx>
+#include <kesrv/util/requestutil.hxx>
+#include <kestestsupport/syntheticprocfs.hxx>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+
+TEST(Kes_ProcFs, kernelSymbols)
+{
+    using Synthetic = Kes::ProcFs::SyntheticProcFs;
+
+    Synthetic synthetic(tempRoot("symbols"), 1);
+    auto cachePath = synthetic.root() + "/symbols.cache";
+
+    RequestProcessor rp;
+    const uint32_t sessionId = 1;
+
+    auto traced = [](Kes::Private::SymbolManager& sm, const char* command, const Kes::PropertyBag& request, Kes::PropertyBag& response)
+    {
+        return tracedReads(sm, sessionId, command, request, response);
+    };
+
+    auto lookup = [](std::initializer_list<std::string> addresses)
+    {
+        Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+        Kes::PropertyBag array{Kes::ProcessProps::SymbolAddresses::idstr(), Kes::PropertyBag::Array()};
+        for (auto& address: addresses)
+            array.array().push_back(std::make_unique<Kes::PropertyBag>(std::string(), Kes::Property(Kes::InvalidPropId, address)));
+
+        request.table().insert({ Kes::ProcessProps::SymbolAddresses::idstr(), std::make_unique<Kes::PropertyBag>(std::move(array)) });
+        return request;
+    };
+
+    auto symbolsOf = [](const Kes::PropertyBag& response)
+    {
+        std::vector<const Kes::PropertyBag*> symbols;
+        auto list = response.table().find(Kes::ProcessProps::SymbolList::idstr());
+        if (list != response.table().end())
+        {
+            for (auto& symbol: list->second->array())
+                symbols.push_back(symbol.get());
+        }
+
+        return symbols;
+    };
+
+    auto nameOf = [](const Kes::PropertyBag* symbol)
+    {
+        auto name = Kes::Util::findInTable<Kes::ProcessProps::SymbolName>(*symbol);
+        return name ? *name : std::string();
+    };
+
+    auto hex = [](uint64_t address)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "0x%llx", (unsigned long long)address);
+        return std::string(text);
+    };
+
+    const auto symbolCount = size_t(Synthetic::KernelSymbolCount + 3 + Synthetic::ModuleSymbolCount);
+    const auto kernelEnd = Synthetic::KernelTextBase + Synthetic::KernelSymbolCount * Synthetic::SymbolStep;
+    const auto moduleEnd = Synthetic::ModuleBase + Synthetic::ModuleSize;
+
+    // the symbols reach no further than the kernel and the module
+    auto checkBounds = [&](Kes::Private::SymbolManager& sm)
+    {
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        EXPECT_TRUE(sm.process(sessionId, "lookup_symbol", 5, lookup({
+            hex(kernelEnd - 1),
+            hex(kernelEnd),
+            hex(kernelEnd + 1),
+            hex(moduleEnd - 1),
+            hex(moduleEnd),
+            hex(Synthetic::ModuleBase - 1) }), response));
+
+        auto symbols = symbolsOf(response);
+        ASSERT_EQ(symbols.size(), 6u);
+
+        EXPECT_EQ(nameOf(symbols[0]), Synthetic::kernelSymbolName(Synthetic::KernelSymbolCount - 1));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[0]), Synthetic::SymbolStep - 1);
+        EXPECT_EQ(nameOf(symbols[1]), "_end");
+        EXPECT_EQ(nameOf(symbols[2]), "");
+
+        EXPECT_EQ(nameOf(symbols[3]), Synthetic::moduleSymbolName(Synthetic::ModuleSymbolCount - 1));
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[3]), moduleEnd - 1 - (Synthetic::ModuleBase + (Synthetic::ModuleSymbolCount - 1) * Synthetic::SymbolStep));
+        EXPECT_EQ(nameOf(symbols[4]), "");
+        EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[4]), nullptr);
+
+        // between the kernel and the module
+        EXPECT_EQ(nameOf(symbols[5]), "");
+    };
+
+    {
+        Kes::Private::SymbolManager sm(&rp, Logger::instance(), synthetic.root(), cachePath);
+
+        // kallsyms is parsed by the first request and only by it
+        {
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            auto files = traced(sm, "lookup_symbol", lookup({
+                hex(Synthetic::KernelTextBase),
+                hex(Synthetic::KernelTextBase + 5 * Synthetic::SymbolStep + 0x42),
+                "ffffffff81000100",
+                hex(Synthetic::KernelTextBase - 1),
+                hex(Synthetic::ModuleBase + 7 * Synthetic::SymbolStep + 8) }), response);
+            EXPECT_EQ(files["kallsyms"], 1u);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Success);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolCount>(response), symbolCount);
+
+            auto symbols = symbolsOf(response);
+            ASSERT_EQ(symbols.size(), 5u);
+
+            // of the three at the start of the text, the global one first by name
+            EXPECT_EQ(nameOf(symbols[0]), "_stext");
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[0]), 0u);
+
+            EXPECT_EQ(nameOf(symbols[1]), Synthetic::kernelSymbolName(5));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[1]), 0x42u);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolType>(*symbols[1]), "t");
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolModule>(*symbols[1]), "");
+
+            EXPECT_EQ(nameOf(symbols[2]), Synthetic::kernelSymbolName(1));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolAddress>(*symbols[2]), hex(Synthetic::KernelTextBase + Synthetic::SymbolStep));
+
+            EXPECT_EQ(nameOf(symbols[3]), "");
+            EXPECT_EQ(Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[3]), nullptr);
+
+            EXPECT_EQ(nameOf(symbols[4]), Synthetic::moduleSymbolName(7));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolOffset>(*symbols[4]), 8u);
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolModule>(*symbols[4]), Synthetic::ModuleName);
+        }
+
+        checkBounds(sm);
+
+        // prefix search, cut short by the limit
+        {
+            Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+            Kes::Util::addToTable<Kes::ProcessProps::SymbolPrefix>(request, std::string("synth_func_01"));
+            Kes::Util::addToTable<Kes::ProcessProps::Limit>(request, 30);
+
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            auto files = traced(sm, "find_symbols", request, response);
+            EXPECT_EQ(files["kallsyms"], 0u);
+            EXPECT_TRUE(*Kes::Util::findInTable<Kes::ProcessProps::SymbolMore>(response));
+
+            auto symbols = symbolsOf(response);
+            ASSERT_EQ(symbols.size(), 30u);
+            for (unsigned i = 0; i < symbols.size(); ++i)
+            {
+                EXPECT_EQ(nameOf(symbols[i]), Synthetic::kernelSymbolName(100 + i));
+                EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolAddress>(*symbols[i]), hex(Synthetic::KernelTextBase + (100 + i) * Synthetic::SymbolStep));
+            }
+        }
+
+        {
+            Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+            Kes::Util::addToTable<Kes::ProcessProps::SymbolPrefix>(request, std::string(Synthetic::ModuleName));
+
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            EXPECT_TRUE(sm.process(sessionId, "find_symbols", 2, request, response));
+            EXPECT_FALSE(*Kes::Util::findInTable<Kes::ProcessProps::SymbolMore>(response));
+
+            auto symbols = symbolsOf(response);
+            ASSERT_EQ(symbols.size(), size_t(Synthetic::ModuleSymbolCount));
+            for (unsigned i = 0; i < symbols.size(); ++i)
+                EXPECT_EQ(nameOf(symbols[i]), Synthetic::moduleSymbolName(i));
+        }
+
+        // bad requests
+        for (auto& address: { std::string("0xzz"), std::string(""), std::string("0x") })
+        {
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            EXPECT_TRUE(sm.process(sessionId, "lookup_symbol", 3, lookup({ address }), response));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail) << address;
+        }
+
+        {
+            Kes::PropertyBag request{std::string(), Kes::PropertyBag::Table()};
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            EXPECT_TRUE(sm.process(sessionId, "find_symbols", 4, request, response));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+        }
+    }
+
+    EXPECT_TRUE(std::filesystem::exists(cachePath));
+
+    // another server on the same kernel maps the cache instead of parsing kallsyms
+    {
+        Kes::Private::SymbolManager sm(&rp, Logger::instance(), synthetic.root(), cachePath);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(sm, "lookup_symbol", lookup({ hex(Synthetic::KernelTextBase + 999 * Synthetic::SymbolStep + 1) }), response);
+        EXPECT_EQ(files["kallsyms"], 0u);
+        EXPECT_EQ(files["symbol_cache"], 1u);
+        EXPECT_EQ(*Kes::Util::findInTable<Kes::ProcessProps::SymbolCount>(response), symbolCount);
+
+        auto symbols = symbolsOf(response);
+        ASSERT_EQ(symbols.size(), 1u);
+        EXPECT_EQ(nameOf(symbols[0]), Synthetic::kernelSymbolName(999));
+
+        // the module extents come with the cache
+        checkBounds(sm);
+    }
+
+    // a module set the cache was not made for
+    {
+        std::ofstream modules(synthetic.root() + "/modules", std::ios::app);
+        modules << "othermod 8192 0 - Live 0xffffffffc1000000\n";
+    }
+
+    {
+        Kes::Private::SymbolManager sm(&rp, Logger::instance(), synthetic.root(), cachePath);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(sm, "lookup_symbol", lookup({ hex(Synthetic::KernelTextBase) }), response);
+        EXPECT_EQ(files["kallsyms"], 1u);
+    }
+
+    // the same kernel booted again: KASLR has moved the symbols since the cache was saved
+    {
+        Kes::Private::SymbolManager sm(&rp, Logger::instance(), synthetic.root(), cachePath);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(sm, "lookup_symbol", lookup({ hex(Synthetic::KernelTextBase) }), response);
+        EXPECT_EQ(files["kallsyms"], 0u);
+    }
+
+    {
+        std::ofstream bootId(synthetic.root() + "/sys/kernel/random/boot_id", std::ios::trunc);
+        bootId << "5ee4c0de-0000-4000-8000-000000000002\n";
+    }
+
+    {
+        Kes::Private::SymbolManager sm(&rp, Logger::instance(), synthetic.root(), cachePath);
+
+        Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+        auto files = traced(sm, "lookup_symbol", lookup({ hex(Synthetic::KernelTextBase) }), response);
+        EXPECT_EQ(files["kallsyms"], 1u);
+    }
+
+    // no kallsyms, no index: the next request tries again
+    {
+        Kes::Private::SymbolManager sm(&rp, Logger::instance(), synthetic.root() + "/missing");
+
+        for (Kes::Request::Id id = 1; id <= 2; ++id)
+        {
+            Kes::PropertyBag response{std::string(), Kes::PropertyBag::Table()};
+            EXPECT_TRUE(sm.process(sessionId, "lookup_symbol", id, lookup({ hex(Synthetic::KernelTextBase) }), response));
+            EXPECT_EQ(*Kes::Util::findInTable<Kes::Response::Props::Status>(response), Kes::Response::Fail);
+        }
+    }
+}
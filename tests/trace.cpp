@@ -0,0 +1,91 @@
+#include "common.hpp"
+
+#include <kesrv/trace/trace.hxx>
+#include <kesrv/trace/traceprops.hxx>
+
+
+TEST(Kes_Trace, clock)
+{
+    auto t0 = Kes::Util::Clock::ticks();
+    auto t1 = Kes::Util::Clock::ticks();
+    EXPECT_GE(t1, t0);
+
+    // conversion is roughly linear
+    auto ns = Kes::Util::Clock::nanoseconds(1000000);
+    EXPECT_GT(ns, 0u);
+    EXPECT_NEAR(double(Kes::Util::Clock::nanoseconds(2000000)), 2.0 * ns, ns * 0.01 + 1);
+}
+
+TEST(Kes_Trace, fileScope)
+{
+    {
+        // no context: nothing to account to
+        Kes::Trace::FileScope scope("stat");
+        EXPECT_EQ(Kes::Trace::Context::current(), nullptr);
+    }
+
+    auto started = Kes::Util::Clock::ticks();
+    Kes::Trace::Context context(Kes::Trace::Frame{}, started, started);
+
+    {
+        Kes::Trace::Context::Activate activate(&context);
+        EXPECT_EQ(Kes::Trace::Context::current(), &context);
+
+        for (int i = 0; i < 3; ++i)
+            Kes::Trace::FileScope scope("stat");
+
+        Kes::Trace::FileScope scope("cmdline");
+    }
+
+    EXPECT_EQ(Kes::Trace::Context::current(), nullptr);
+
+    context.handled(Kes::Util::Clock::ticks());
+    context.serialized(Kes::Util::Clock::ticks());
+
+    auto trace = context.serialize();
+    ASSERT_TRUE(trace.isTable());
+
+    auto files = trace.table().find(Kes::TraceProps::FileList::idstr());
+    ASSERT_NE(files, trace.table().end());
+    ASSERT_TRUE(files->second->isArray());
+    ASSERT_EQ(files->second->array().size(), 2u);
+
+    auto& stat = files->second->array()[0]->table();
+    EXPECT_EQ(std::any_cast<std::string>(stat.find(Kes::TraceProps::FileName::idstr())->second->property().value), "stat");
+    EXPECT_EQ(std::any_cast<uint64_t>(stat.find(Kes::TraceProps::FileReads::idstr())->second->property().value), 3u);
+}
+
+TEST(Kes_Trace, appendTo)
+{
+    auto started = Kes::Util::Clock::ticks();
+    Kes::Trace::Context context(Kes::Trace::Frame{}, started, started);
+
+    std::string empty("{}");
+    context.appendTo(empty);
+    EXPECT_EQ(empty.find("{\"response.trace\":{"), 0u);
+
+    std::string response("{\"response.status\":\"success\"}");
+    context.appendTo(response);
+    EXPECT_EQ(response.find("{\"response.status\":\"success\",\"response.trace\":{"), 0u);
+    EXPECT_EQ(response.back(), '}');
+}
+
+TEST(Kes_Trace, frame)
+{
+    // the session stamps every request; the queue runs from the end of the request to the parse
+    auto received = Kes::Util::Clock::ticks();
+    Kes::Trace::Frame frame{ received, 2000000, received + 3000000 };
+    Kes::Trace::Context context(frame, frame.framed + 4000000, frame.framed + 4000000);
+
+    auto trace = context.serialize();
+    auto value = [&trace](const std::string& key) { return std::any_cast<uint64_t>(trace.table().find(key)->second->property().value); };
+
+    EXPECT_EQ(value(Kes::TraceProps::Frame::idstr()), Kes::Util::Clock::nanoseconds(2000000));
+    EXPECT_EQ(value(Kes::TraceProps::Queue::idstr()), Kes::Util::Clock::nanoseconds(4000000));
+    EXPECT_EQ(value(Kes::TraceProps::Parse::idstr()), 0u);
+
+    // a request that did not come through a session has no framing to report
+    Kes::Trace::Context unframed(Kes::Trace::Frame{}, received, received);
+    trace = unframed.serialize();
+    EXPECT_EQ(value(Kes::TraceProps::Queue::idstr()), 0u);
+}